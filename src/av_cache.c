@@ -0,0 +1,324 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "av_cache.h"
+
+// On disk, a cache is a header followed by the entries and then a string
+// table, which starts with the empty string.  Names are offsets into it.
+#define AV_CACHE_MAGIC "SEAVC2"
+
+struct av_cache_header {
+	char magic[8];
+	uint32_t policyvers;
+	uint32_t entry_count;
+	uint64_t class_ino;
+	int64_t class_ctime_sec;
+	int64_t class_ctime_nsec;
+	uint32_t strings_size;
+	uint32_t reserved;
+};
+
+struct av_disk_entry {
+	uint32_t kind;
+	int32_t bit;
+	uint32_t class_name;
+	uint32_t name;
+};
+
+struct av_cache {
+	struct av_disk_entry *entries;
+	uint32_t entry_count;
+	uint32_t entry_cap;
+	char *strings;
+	uint32_t strings_size;
+	uint32_t strings_cap;
+	// Permissions of a class follow it, so its name is only stored once
+	uint32_t last_class;
+	int failed;
+};
+
+enum selint_error read_av_cache_key(const char *selinuxfs_path, struct av_cache_key *key)
+{
+	size_t len = strlen(selinuxfs_path) + sizeof("/policyvers");
+	char *path = malloc(len);
+
+	if (!path) {
+		return SELINT_OUT_OF_MEM;
+	}
+
+	enum selint_error res = SELINT_IO_ERROR;
+	unsigned int policyvers;
+	struct stat st;
+	snprintf(path, len, "%s/policyvers", selinuxfs_path);
+	FILE *fd = fopen(path, "r");
+	if (!fd) {
+		goto out;
+	}
+	int read = fscanf(fd, "%u", &policyvers);
+	fclose(fd);
+	if (read != 1) {
+		goto out;
+	}
+
+	// The kernel does not update the times of the load file, but it
+	// removes and recreates the class directory on every policy load
+	snprintf(path, len, "%s/class", selinuxfs_path);
+	if (stat(path, &st) != 0 || !S_ISDIR(st.st_mode)) {
+		goto out;
+	}
+
+	memset(key, 0, sizeof(struct av_cache_key));
+	key->policyvers = policyvers;
+	key->class_ino = (uint64_t)st.st_ino;
+	key->class_ctime_sec = (int64_t)st.st_ctim.tv_sec;
+	key->class_ctime_nsec = (int64_t)st.st_ctim.tv_nsec;
+	res = SELINT_SUCCESS;
+
+out:
+	free(path);
+	return res;
+}
+
+struct av_cache *make_av_cache(void)
+{
+	struct av_cache *cache = calloc(1, sizeof(struct av_cache));
+
+	if (!cache) {
+		return NULL;
+	}
+	cache->strings = malloc(64);
+	if (!cache->strings) {
+		free(cache);
+		return NULL;
+	}
+	cache->strings[0] = '\0';
+	cache->strings_size = 1;
+	cache->strings_cap = 64;
+
+	return cache;
+}
+
+// Returns the offset of the copy of str, or UINT32_MAX if out of memory
+static uint32_t add_string(struct av_cache *cache, const char *str)
+{
+	if (!str || !*str) {
+		return 0;
+	}
+
+	size_t len = strlen(str) + 1;
+	if (len > UINT32_MAX - cache->strings_size) {
+		return UINT32_MAX;
+	}
+	while (cache->strings_cap - cache->strings_size < len) {
+		if (cache->strings_cap > UINT32_MAX / 2) {
+			return UINT32_MAX;
+		}
+		char *grown = realloc(cache->strings, cache->strings_cap * 2);
+		if (!grown) {
+			return UINT32_MAX;
+		}
+		cache->strings = grown;
+		cache->strings_cap *= 2;
+	}
+
+	uint32_t offset = cache->strings_size;
+	memcpy(cache->strings + offset, str, len);
+	cache->strings_size += (uint32_t)len;
+
+	return offset;
+}
+
+void av_cache_add(void *ctx, enum av_entry_kind kind,
+                  const char *class_name, const char *name, int bit)
+{
+	struct av_cache *cache = ctx;
+
+	if (cache->failed) {
+		return;
+	}
+
+	if (cache->entry_count == cache->entry_cap) {
+		uint32_t cap = cache->entry_cap ? cache->entry_cap * 2 : 256;
+		struct av_disk_entry *grown = realloc(cache->entries,
+		                                      cap * sizeof(struct av_disk_entry));
+		if (!grown) {
+			cache->failed = 1;
+			return;
+		}
+		cache->entries = grown;
+		cache->entry_cap = cap;
+	}
+
+	struct av_disk_entry *entry = &cache->entries[cache->entry_count];
+	memset(entry, 0, sizeof(struct av_disk_entry));
+	entry->kind = kind;
+	entry->bit = bit;
+	if (class_name && cache->last_class &&
+	    0 == strcmp(class_name, cache->strings + cache->last_class)) {
+		entry->class_name = cache->last_class;
+	} else {
+		entry->class_name = add_string(cache, class_name);
+		if (entry->class_name != UINT32_MAX && entry->class_name != 0) {
+			cache->last_class = entry->class_name;
+		}
+	}
+	entry->name = add_string(cache, name);
+	if (entry->class_name == UINT32_MAX || entry->name == UINT32_MAX) {
+		cache->failed = 1;
+		return;
+	}
+	cache->entry_count++;
+}
+
+enum selint_error write_av_cache(const struct av_cache *cache,
+                                 const struct av_cache_key *key, const char *path)
+{
+	if (cache->failed) {
+		return SELINT_OUT_OF_MEM;
+	}
+
+	size_t len = strlen(path) + sizeof(".XXXXXX");
+	char *tmp_path = malloc(len);
+	if (!tmp_path) {
+		return SELINT_OUT_OF_MEM;
+	}
+	snprintf(tmp_path, len, "%s.XXXXXX", path);
+
+	int fd = mkstemp(tmp_path);
+	if (fd < 0) {
+		free(tmp_path);
+		return SELINT_IO_ERROR;
+	}
+	FILE *out = fdopen(fd, "wb");
+	if (!out) {
+		close(fd);
+		unlink(tmp_path);
+		free(tmp_path);
+		return SELINT_IO_ERROR;
+	}
+
+	struct av_cache_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, AV_CACHE_MAGIC, sizeof(AV_CACHE_MAGIC));
+	header.policyvers = key->policyvers;
+	header.entry_count = cache->entry_count;
+	header.class_ino = key->class_ino;
+	header.class_ctime_sec = key->class_ctime_sec;
+	header.class_ctime_nsec = key->class_ctime_nsec;
+	header.strings_size = cache->strings_size;
+
+	enum selint_error res = SELINT_SUCCESS;
+	if (fwrite(&header, sizeof(header), 1, out) != 1 ||
+	    fwrite(cache->entries, sizeof(struct av_disk_entry), cache->entry_count, out) != cache->entry_count ||
+	    fwrite(cache->strings, 1, cache->strings_size, out) != cache->strings_size) {
+		res = SELINT_IO_ERROR;
+	}
+	if (fclose(out) != 0) {
+		res = SELINT_IO_ERROR;
+	}
+	if (res == SELINT_SUCCESS && rename(tmp_path, path) != 0) {
+		res = SELINT_IO_ERROR;
+	}
+	if (res != SELINT_SUCCESS) {
+		unlink(tmp_path);
+	}
+
+	free(tmp_path);
+	return res;
+}
+
+void free_av_cache(struct av_cache *cache)
+{
+	if (!cache) {
+		return;
+	}
+	free(cache->entries);
+	free(cache->strings);
+	free(cache);
+}
+
+enum selint_error replay_av_cache(const char *path, const struct av_cache_key *key,
+                                  av_entry_fn fn, void *ctx)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return SELINT_IO_ERROR;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		return SELINT_IO_ERROR;
+	}
+	size_t size = (size_t)st.st_size;
+	if (size < sizeof(struct av_cache_header)) {
+		close(fd);
+		return SELINT_PARSE_ERROR;
+	}
+
+	void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		return SELINT_IO_ERROR;
+	}
+
+	const struct av_cache_header *header = map;
+	const char *start = map;
+	uint64_t expected = (uint64_t)sizeof(struct av_cache_header) +
+	                    (uint64_t)header->entry_count * sizeof(struct av_disk_entry) +
+	                    header->strings_size;
+	if (memcmp(header->magic, AV_CACHE_MAGIC, sizeof(AV_CACHE_MAGIC)) != 0 ||
+	    expected != size ||
+	    header->strings_size == 0 ||
+	    start[size - 1] != '\0' ||
+	    header->policyvers != key->policyvers ||
+	    header->class_ino != key->class_ino ||
+	    header->class_ctime_sec != key->class_ctime_sec ||
+	    header->class_ctime_nsec != key->class_ctime_nsec) {
+		munmap(map, size);
+		return SELINT_PARSE_ERROR;
+	}
+
+	const struct av_disk_entry *entries =
+		(const struct av_disk_entry *)(start + sizeof(struct av_cache_header));
+	const char *strings = (const char *)(entries + header->entry_count);
+
+	// Check every entry first, so that a damaged cache adds nothing
+	for (uint32_t i = 0; i < header->entry_count; i++) {
+		if (entries[i].kind > AV_ENTRY_CLASS_PERM ||
+		    entries[i].class_name >= header->strings_size ||
+		    entries[i].name >= header->strings_size) {
+			munmap(map, size);
+			return SELINT_PARSE_ERROR;
+		}
+	}
+
+	for (uint32_t i = 0; i < header->entry_count; i++) {
+		fn(ctx, (enum av_entry_kind)entries[i].kind, strings + entries[i].class_name,
+		   strings + entries[i].name, entries[i].bit);
+	}
+
+	munmap(map, size);
+	return SELINT_SUCCESS;
+}
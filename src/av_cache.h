@@ -0,0 +1,98 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef AV_CACHE_H
+#define AV_CACHE_H
+
+#include <stdint.h>
+
+#include "selint_error.h"
+
+// What an entry found in the selinuxfs class directory adds to the maps
+enum av_entry_kind {
+	// A class, with no permissions yet
+	AV_ENTRY_CLASS,
+	// A permission name, not tied to a class
+	AV_ENTRY_PERM,
+	// A permission of a class, and its bit
+	AV_ENTRY_CLASS_PERM
+};
+
+// Identifies the loaded kernel policy.  Loading a policy is expected to
+// replace the class directory of selinuxfs, or the entries in it, which
+// gives it a new inode or change time.  This has only been tried against
+// directory trees standing in for selinuxfs, not on a host running SELinux.
+struct av_cache_key {
+	uint32_t policyvers;
+	uint64_t class_ino;
+	int64_t class_ctime_sec;
+	int64_t class_ctime_nsec;
+};
+
+// Entries being collected to be written to a cache
+struct av_cache;
+
+typedef void (*av_entry_fn)(void *ctx, enum av_entry_kind kind,
+                            const char *class_name, const char *name, int bit);
+
+/*********************************************
+* Read the key of the policy loaded in a selinuxfs directory
+* selinuxfs_path - The selinuxfs mount, or a directory standing in for it
+* key - Set to the key on success
+* returns SELINT_SUCCESS, or SELINT_IO_ERROR if policyvers or the class
+* directory cannot be read
+*********************************************/
+enum selint_error read_av_cache_key(const char *selinuxfs_path, struct av_cache_key *key);
+
+struct av_cache *make_av_cache(void);
+
+/*********************************************
+* Add an entry to a cache.  Has the signature of an av_entry_fn, with the
+* cache as ctx.  Entries are replayed in the order they were added.  If
+* memory runs out, the cache is marked as failed and not written.
+*********************************************/
+void av_cache_add(void *cache, enum av_entry_kind kind,
+                  const char *class_name, const char *name, int bit);
+
+/*********************************************
+* Write a cache to disk, replacing any cache at path only once it is fully
+* written.  The cache is in the byte order of the machine writing it.
+* cache - The collected entries
+* key - The key of the policy the entries were read from
+* path - The file to write
+* returns SELINT_SUCCESS, SELINT_OUT_OF_MEM if an entry could not be added,
+* or SELINT_IO_ERROR
+*********************************************/
+enum selint_error write_av_cache(const struct av_cache *cache,
+                                 const struct av_cache_key *key, const char *path);
+
+void free_av_cache(struct av_cache *cache);
+
+/*********************************************
+* Map a cache written by write_av_cache() into memory and call fn with each
+* of its entries, if its key matches
+* path - The cache file
+* key - The key of the loaded policy
+* fn - Called with every entry
+* ctx - Passed to every call of fn
+* returns SELINT_SUCCESS, SELINT_IO_ERROR if the file could not be read,
+* or SELINT_PARSE_ERROR if it is not a valid cache or its key does not
+* match, in which case fn is not called
+*********************************************/
+enum selint_error replay_av_cache(const char *path, const struct av_cache_key *key,
+                                  av_entry_fn fn, void *ctx);
+
+#endif
@@ -0,0 +1,445 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <uthash.h>
+
+#include "call_graph.h"
+
+// The graph is stored as compressed sparse rows: the callees of id are
+// callee_ids[callee_start[id]] up to (not including)
+// callee_ids[callee_start[id + 1]], and the callers likewise.
+
+#define UNVISITED ((unsigned int)-1)
+
+struct name_elem {
+	char *name;
+	unsigned int id;
+	UT_hash_handle hh;
+};
+
+struct edge {
+	unsigned int from;
+	unsigned int to;
+};
+
+static struct name_elem *name_ids = NULL;
+static struct name_elem **names = NULL;
+static unsigned int node_count = 0;
+static unsigned int *callee_start = NULL;
+static unsigned int *callee_ids = NULL;
+static unsigned int *caller_start = NULL;
+static unsigned int *caller_ids = NULL;
+static unsigned int *components = NULL;
+static unsigned char *cyclic = NULL;
+// Scratch space for call_graph_reachable()
+static unsigned int *visited = NULL;
+static unsigned int visit_generation = 0;
+
+static int is_definition(const struct policy_node *node)
+{
+	return node->flavor == NODE_INTERFACE_DEF || node->flavor == NODE_TEMP_DEF;
+}
+
+static enum selint_error add_name(const char *name)
+{
+	if (call_graph_id(name) != -1) {
+		return SELINT_SUCCESS;
+	}
+
+	struct name_elem *elem = malloc(sizeof(struct name_elem));
+	if (!elem) {
+		return SELINT_OUT_OF_MEM;
+	}
+	elem->name = strdup(name);
+	if (!elem->name) {
+		free(elem);
+		return SELINT_OUT_OF_MEM;
+	}
+	elem->id = node_count++;
+	HASH_ADD_KEYPTR(hh, name_ids, elem->name, strlen(elem->name), elem);
+
+	return SELINT_SUCCESS;
+}
+
+// Collect the calls between defined names, in the order they appear
+static enum selint_error collect_edges(const struct policy_file_list *files,
+                                       struct edge **edges, unsigned int *edge_count)
+{
+	unsigned int cap = 0;
+
+	*edges = NULL;
+	*edge_count = 0;
+
+	for (const struct policy_file_node *file = files->head; file; file = file->next) {
+		for (const struct policy_node *node = file->file->ast; node; node = dfs_next(node)) {
+			if (node->flavor != NODE_IF_CALL) {
+				continue;
+			}
+			int to = call_graph_id(node->data.ic_data->name);
+			if (to == -1) {
+				continue;
+			}
+			const struct policy_node *def = node->parent;
+			while (def && !is_definition(def)) {
+				def = def->parent;
+			}
+			if (!def) {
+				continue;
+			}
+
+			if (*edge_count == cap) {
+				cap = cap ? cap * 2 : 64;
+				struct edge *grown = realloc(*edges, cap * sizeof(struct edge));
+				if (!grown) {
+					free(*edges);
+					*edges = NULL;
+					return SELINT_OUT_OF_MEM;
+				}
+				*edges = grown;
+			}
+			(*edges)[*edge_count].from = (unsigned int)call_graph_id(def->data.str);
+			(*edges)[*edge_count].to = (unsigned int)to;
+			(*edge_count)++;
+		}
+	}
+
+	return SELINT_SUCCESS;
+}
+
+// Fill start and ids with the edges grouped by their from (or to, if
+// reverse is set) end, leaving out repeated edges.  seen is scratch space of
+// node_count entries.
+static void fill_rows(const struct edge *edges, unsigned int edge_count, int reverse,
+                      unsigned int *start, unsigned int *ids, unsigned int *seen)
+{
+	memset(start, 0, (node_count + 1) * sizeof(unsigned int));
+	for (unsigned int i = 0; i < edge_count; i++) {
+		start[(reverse ? edges[i].to : edges[i].from) + 1]++;
+	}
+	for (unsigned int i = 0; i < node_count; i++) {
+		start[i + 1] += start[i];
+	}
+
+	// Place each edge, using seen[] to hold the next free slot of each row
+	memcpy(seen, start, node_count * sizeof(unsigned int));
+	for (unsigned int i = 0; i < edge_count; i++) {
+		unsigned int row = reverse ? edges[i].to : edges[i].from;
+		ids[seen[row]++] = reverse ? edges[i].from : edges[i].to;
+	}
+
+	// Drop repeats, compacting the rows towards the front
+	for (unsigned int i = 0; i < node_count; i++) {
+		seen[i] = UNVISITED;
+	}
+	unsigned int out = 0;
+	for (unsigned int row = 0; row < node_count; row++) {
+		unsigned int begin = start[row];
+		unsigned int end = start[row + 1];
+		start[row] = out;
+		for (unsigned int i = begin; i < end; i++) {
+			if (seen[ids[i]] != row) {
+				seen[ids[i]] = row;
+				ids[out++] = ids[i];
+			}
+		}
+	}
+	start[node_count] = out;
+}
+
+struct tarjan_frame {
+	unsigned int id;
+	unsigned int next_edge;
+};
+
+// Number the strongly connected components with Tarjan's algorithm, which
+// completes callee components before their callers
+static enum selint_error find_components(void)
+{
+	unsigned int *index = malloc(node_count * sizeof(unsigned int));
+	unsigned int *low = malloc(node_count * sizeof(unsigned int));
+	unsigned int *stack = malloc(node_count * sizeof(unsigned int));
+	struct tarjan_frame *frames = malloc(node_count * sizeof(struct tarjan_frame));
+	unsigned char *on_stack = calloc(node_count, sizeof(unsigned char));
+
+	if (!index || !low || !stack || !frames || !on_stack) {
+		free(index);
+		free(low);
+		free(stack);
+		free(frames);
+		free(on_stack);
+		return SELINT_OUT_OF_MEM;
+	}
+
+	for (unsigned int i = 0; i < node_count; i++) {
+		index[i] = UNVISITED;
+	}
+
+	unsigned int next_index = 0;
+	unsigned int stack_size = 0;
+	unsigned int component_count = 0;
+
+	for (unsigned int root = 0; root < node_count; root++) {
+		if (index[root] != UNVISITED) {
+			continue;
+		}
+
+		unsigned int depth = 0;
+		frames[depth].id = root;
+		frames[depth].next_edge = callee_start[root];
+		index[root] = low[root] = next_index++;
+		stack[stack_size++] = root;
+		on_stack[root] = 1;
+
+		while (1) {
+			struct tarjan_frame *frame = &frames[depth];
+			unsigned int v = frame->id;
+
+			if (frame->next_edge < callee_start[v + 1]) {
+				unsigned int w = callee_ids[frame->next_edge++];
+				if (index[w] == UNVISITED) {
+					depth++;
+					frames[depth].id = w;
+					frames[depth].next_edge = callee_start[w];
+					index[w] = low[w] = next_index++;
+					stack[stack_size++] = w;
+					on_stack[w] = 1;
+				} else if (on_stack[w] && index[w] < low[v]) {
+					low[v] = index[w];
+				}
+				continue;
+			}
+
+			if (low[v] == index[v]) {
+				unsigned int w;
+				unsigned int size = 0;
+				do {
+					w = stack[--stack_size];
+					on_stack[w] = 0;
+					components[w] = component_count;
+					size++;
+				} while (w != v);
+				if (size > 1) {
+					for (unsigned int i = stack_size; i < stack_size + size; i++) {
+						cyclic[stack[i]] = 1;
+					}
+				}
+				component_count++;
+			}
+
+			if (depth == 0) {
+				break;
+			}
+			depth--;
+			unsigned int u = frames[depth].id;
+			if (low[v] < low[u]) {
+				low[u] = low[v];
+			}
+		}
+	}
+
+	// Calls from a name to itself
+	for (unsigned int v = 0; v < node_count; v++) {
+		for (unsigned int i = callee_start[v]; i < callee_start[v + 1]; i++) {
+			if (callee_ids[i] == v) {
+				cyclic[v] = 1;
+			}
+		}
+	}
+
+	free(index);
+	free(low);
+	free(stack);
+	free(frames);
+	free(on_stack);
+
+	return SELINT_SUCCESS;
+}
+
+enum selint_error build_call_graph(const struct policy_file_list *files)
+{
+	enum selint_error res = SELINT_SUCCESS;
+
+	free_call_graph();
+
+	for (const struct policy_file_node *file = files->head;
+	     file && res == SELINT_SUCCESS;
+	     file = file->next) {
+		for (const struct policy_node *node = file->file->ast;
+		     node && res == SELINT_SUCCESS;
+		     node = dfs_next(node)) {
+			if (is_definition(node) && node->data.str) {
+				res = add_name(node->data.str);
+			}
+		}
+	}
+	if (res != SELINT_SUCCESS) {
+		free_call_graph();
+		return res;
+	}
+
+	struct edge *edges;
+	unsigned int edge_count;
+	res = collect_edges(files, &edges, &edge_count);
+	if (res != SELINT_SUCCESS) {
+		free_call_graph();
+		return res;
+	}
+
+	// With no definitions the graph is empty, and nothing can be looked up
+	if (node_count == 0) {
+		free(edges);
+		return SELINT_SUCCESS;
+	}
+
+	names = malloc(node_count * sizeof(struct name_elem *));
+	callee_start = malloc((node_count + 1) * sizeof(unsigned int));
+	caller_start = malloc((node_count + 1) * sizeof(unsigned int));
+	components = malloc(node_count * sizeof(unsigned int));
+	cyclic = calloc(node_count, sizeof(unsigned char));
+	visited = calloc(node_count, sizeof(unsigned int));
+	// The edge lists stay NULL if nothing is called
+	if (edge_count > 0) {
+		callee_ids = malloc(edge_count * sizeof(unsigned int));
+		caller_ids = malloc(edge_count * sizeof(unsigned int));
+	}
+	if (!names || !callee_start || !caller_start || !components || !cyclic ||
+	    !visited || (edge_count > 0 && (!callee_ids || !caller_ids))) {
+		free(edges);
+		free_call_graph();
+		return SELINT_OUT_OF_MEM;
+	}
+
+	struct name_elem *elem, *tmp;
+	HASH_ITER(hh, name_ids, elem, tmp) {
+		names[elem->id] = elem;
+	}
+
+	// visited is free until the graph is built
+	fill_rows(edges, edge_count, 0, callee_start, callee_ids, visited);
+	fill_rows(edges, edge_count, 1, caller_start, caller_ids, visited);
+	memset(visited, 0, node_count * sizeof(unsigned int));
+	free(edges);
+
+	res = find_components();
+	if (res != SELINT_SUCCESS) {
+		free_call_graph();
+	}
+
+	return res;
+}
+
+unsigned int call_graph_node_count(void)
+{
+	return node_count;
+}
+
+int call_graph_id(const char *name)
+{
+	struct name_elem *elem;
+
+	HASH_FIND(hh, name_ids, name, strlen(name), elem);
+
+	return elem ? (int)elem->id : -1;
+}
+
+const char *call_graph_name(unsigned int id)
+{
+	return id < node_count ? names[id]->name : NULL;
+}
+
+const unsigned int *call_graph_callees(unsigned int id, unsigned int *count)
+{
+	*count = callee_start[id + 1] - callee_start[id];
+
+	return *count ? callee_ids + callee_start[id] : NULL;
+}
+
+const unsigned int *call_graph_callers(unsigned int id, unsigned int *count)
+{
+	*count = caller_start[id + 1] - caller_start[id];
+
+	return *count ? caller_ids + caller_start[id] : NULL;
+}
+
+unsigned int call_graph_component(unsigned int id)
+{
+	return components[id];
+}
+
+int call_graph_in_cycle(unsigned int id)
+{
+	return cyclic[id];
+}
+
+unsigned int call_graph_reachable(unsigned int id, int callers, unsigned int *out)
+{
+	const unsigned int *start = callers ? caller_start : callee_start;
+	const unsigned int *ids = callers ? caller_ids : callee_ids;
+	unsigned int found = 0;
+
+	if (++visit_generation == 0) {
+		// Wrapped around, so old marks could match again
+		memset(visited, 0, node_count * sizeof(unsigned int));
+		visit_generation = 1;
+	}
+
+	// out doubles as the queue of ids whose neighbors are still to be added
+	unsigned int next = 0;
+	unsigned int from = id;
+	while (1) {
+		for (unsigned int i = start[from]; i < start[from + 1]; i++) {
+			if (visited[ids[i]] != visit_generation) {
+				visited[ids[i]] = visit_generation;
+				out[found++] = ids[i];
+			}
+		}
+		if (next == found) {
+			break;
+		}
+		from = out[next++];
+	}
+
+	return found;
+}
+
+void free_call_graph(void)
+{
+	struct name_elem *elem, *tmp;
+
+	HASH_ITER(hh, name_ids, elem, tmp) {
+		HASH_DEL(name_ids, elem);
+		free(elem->name);
+		free(elem);
+	}
+	node_count = 0;
+
+	free(names);
+	free(callee_start);
+	free(callee_ids);
+	free(caller_start);
+	free(caller_ids);
+	free(components);
+	free(cyclic);
+	free(visited);
+	names = NULL;
+	callee_start = callee_ids = caller_start = caller_ids = NULL;
+	components = NULL;
+	cyclic = NULL;
+	visited = NULL;
+	visit_generation = 0;
+}
@@ -0,0 +1,92 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef CALL_GRAPH_H
+#define CALL_GRAPH_H
+
+#include "file_list.h"
+#include "selint_error.h"
+
+/*********************************************
+* Build the graph of calls between the interfaces and templates defined in
+* a list of files, replacing any previous graph.  Each defined name gets an
+* id in [0, call_graph_node_count()), and calls to names that are not
+* defined (such as m4 macros) are left out.  The strongly connected
+* components of the graph are numbered so that a component calling another
+* has the higher number.
+* files - The files to build the graph from
+* returns SELINT_SUCCESS or SELINT_OUT_OF_MEM
+*********************************************/
+enum selint_error build_call_graph(const struct policy_file_list *files);
+
+unsigned int call_graph_node_count(void);
+
+/*********************************************
+* Get the id of an interface or template
+* name - The name of the interface or template
+* returns the id, or -1 if the name is not defined
+*********************************************/
+int call_graph_id(const char *name);
+
+const char *call_graph_name(unsigned int id);
+
+/*********************************************
+* Get the interfaces and templates called directly by id
+* id - The caller
+* count - Set to the number of callees
+* returns the ids of the callees, each listed once, or NULL if there are none
+*********************************************/
+const unsigned int *call_graph_callees(unsigned int id, unsigned int *count);
+
+/*********************************************
+* Get the interfaces and templates that directly call id
+* id - The callee
+* count - Set to the number of callers
+* returns the ids of the callers, each listed once, or NULL if there are none
+*********************************************/
+const unsigned int *call_graph_callers(unsigned int id, unsigned int *count);
+
+/*********************************************
+* Get the strongly connected component an id is in.  Components are
+* numbered callees first: if a calls b and they are in different
+* components, b's component has the lower number.
+* id - The interface or template
+* returns the number of the component
+*********************************************/
+unsigned int call_graph_component(unsigned int id);
+
+/*********************************************
+* Check whether an interface or template can end up calling itself
+* id - The interface or template
+* returns 1 if id is part of a call cycle, and 0 otherwise
+*********************************************/
+int call_graph_in_cycle(unsigned int id);
+
+/*********************************************
+* Find every interface or template reachable from id through one or more
+* calls, in time linear in the size of the graph
+* id - The id to start from
+* callers - If set, follow calls backwards to find the transitive callers of
+* id instead of its transitive callees
+* out - Filled with the ids found.  Must have room for
+* call_graph_node_count() ids.
+* returns the number of ids found
+*********************************************/
+unsigned int call_graph_reachable(unsigned int id, int callers, unsigned int *out);
+
+void free_call_graph(void);
+
+#endif
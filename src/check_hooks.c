@@ -21,6 +21,7 @@
 #include <string.h>
 
 #include "check_hooks.h"
+#include "output.h"
 
 #define ALLOC_NODE(nl)  if (ck->check_nodes[nl]) { \
 		loc = ck->check_nodes[nl]; \
@@ -38,6 +39,17 @@ enum selint_error add_check(enum node_flavor check_flavor, struct checks *ck,
                             const char *check_id,
                             struct check_result *(*check_function)(const struct check_data *check_data,
                                                                    const struct policy_node *node))
+{
+	return add_check_for_files(ALL_FILES, check_flavor, ck, check_id,
+	                           check_function);
+}
+
+enum selint_error add_check_for_files(unsigned int file_mask,
+                                      enum node_flavor check_flavor,
+                                      struct checks *ck,
+                                      const char *check_id,
+                                      struct check_result *(*check_function)(const struct check_data *check_data,
+                                                                             const struct policy_node *node))
 {
 	struct check_node *loc;
 
@@ -46,8 +58,95 @@ enum selint_error add_check(enum node_flavor check_flavor, struct checks *ck,
 	loc->check_function = check_function;
 	loc->check_id = strdup(check_id);
 	loc->issues_found = 0;
+	unsigned int index = check_index(check_id);
+	loc->bit = (index == CHECK_INDEX_INVALID) ? 0 : CHECK_BIT(index);
+	loc->file_mask = file_mask;
 	loc->next = NULL;
 
+	// Stale now
+	free(ck->dispatch);
+	ck->dispatch = NULL;
+
+	return SELINT_SUCCESS;
+}
+
+enum selint_error compile_checks(struct checks *ck)
+{
+	unsigned int count = 0;
+
+	for (int f = 0; f < FILE_FLAVOR_END; f++) {
+		for (int n = 0; n <= NODE_ERROR; n++) {
+			for (const struct check_node *cur = ck->check_nodes[n]; cur; cur = cur->next) {
+				if (cur->file_mask & FILE_MASK(f)) {
+					count++;
+				}
+			}
+		}
+	}
+
+	free(ck->dispatch);
+	// At least one entry, so that a compiled table is never NULL
+	ck->dispatch = malloc((count + 1) * sizeof(struct check_dispatch_entry));
+	if (!ck->dispatch) {
+		return SELINT_OUT_OF_MEM;
+	}
+
+	unsigned int i = 0;
+	for (int f = 0; f < FILE_FLAVOR_END; f++) {
+		for (int n = 0; n <= NODE_ERROR; n++) {
+			ck->dispatch_start[f][n] = i;
+			for (struct check_node *cur = ck->check_nodes[n]; cur; cur = cur->next) {
+				if (cur->file_mask & FILE_MASK(f)) {
+					ck->dispatch[i].check_function = cur->check_function;
+					ck->dispatch[i].check = cur;
+					ck->dispatch[i].bit = cur->bit;
+					i++;
+				}
+			}
+		}
+		ck->dispatch_start[f][NODE_ERROR + 1] = i;
+	}
+
+	return SELINT_SUCCESS;
+}
+
+static void report_check_result(struct check_node *check,
+                                const struct check_data *data,
+                                const struct policy_node *node,
+                                struct check_result *res)
+{
+	// Checks of fc files run on several threads at once
+	__atomic_add_fetch(&check->issues_found, 1, __ATOMIC_RELAXED);
+	res->lineno = node->lineno;
+	display_check_result(res, data);
+	free_check_result(res);
+}
+
+enum selint_error dispatch_checks(struct checks *ck,
+                                  const struct check_data *data,
+                                  struct policy_node *node)
+{
+	if (!ck->dispatch) {
+		enum selint_error ret = compile_checks(ck);
+		if (ret != SELINT_SUCCESS) {
+			return ret;
+		}
+	}
+
+	const unsigned int *starts = ck->dispatch_start[data->flavor];
+	const unsigned int end = starts[node->flavor + 1];
+
+	for (unsigned int i = starts[node->flavor]; i < end; i++) {
+		const struct check_dispatch_entry *entry = &ck->dispatch[i];
+		if (node->exceptions & entry->bit) {
+			continue;
+		}
+		struct check_result *res = entry->check_function(data, node);
+		if (res) {
+			report_check_result(entry->check, data, node, res);
+		}
+	}
+
 	return SELINT_SUCCESS;
 }
 
@@ -65,39 +164,22 @@ enum selint_error call_checks_for_node_type(struct check_node *ck_list,
 	struct check_node *cur = ck_list;
 
 	while (cur) {
-		if (node->exceptions && strstr(node->exceptions, cur->check_id)) {
+		if (node->exceptions & cur->bit) {
 			cur = cur->next;
 			continue;
 		}
 		struct check_result *res = cur->check_function(data, node);
 		if (res) {
-			cur->issues_found++;
-			res->lineno = node->lineno;
-			display_check_result(res, data);
-			free_check_result(res);
+			report_check_result(cur, data, node, res);
 		}
 		cur = cur->next;
 	}
 	return SELINT_SUCCESS;
 }
 
-void display_check_result(struct check_result *res, struct check_data *data)
+void display_check_result(struct check_result *res, const struct check_data *data)
 {
-
-	const size_t len = strlen(data->filename);
-	unsigned int padding;
-
-	if (18 < len) {
-		padding = 0;
-	} else {
-		padding = 18 - len;
-	}
-
-	printf("%s:%*u: (%c): %s (%c-%03u)\n",
-	       data->filename,
-	       padding,
-	       res->lineno,
-	       res->severity, res->message, res->severity, res->check_id);
+	output_append_result(output_get_thread_buffer(), res, data->filename);
 }
 
 struct check_result *alloc_internal_error(const char *string)
@@ -106,44 +188,64 @@ struct check_result *alloc_internal_error(const char *string)
 }
 
 int is_valid_check(const char *check_str)
+{
+	return check_index(check_str) != CHECK_INDEX_INVALID;
+}
+
+// Index of the first check of each severity
+#define C_OFFSET 0
+#define S_OFFSET (C_OFFSET + C_END - 1)
+#define W_OFFSET (S_OFFSET + S_END - 1)
+#define E_OFFSET (W_OFFSET + W_END - 1)
+#define F_OFFSET (E_OFFSET + E_END - 1)
+
+_Static_assert(CHECK_COUNT <= 64, "check sets are 64 bits wide");
+
+unsigned int check_index(const char *check_str)
 {
 	if (!check_str) {
-		return 0;
+		return CHECK_INDEX_INVALID;
 	}
 
-	if (check_str[1] != '-') {
-		return 0;
+	if (check_str[0] == '\0' || check_str[1] != '-') {
+		return CHECK_INDEX_INVALID;
 	}
 
 	int max_id = 0;
+	unsigned int offset = 0;
 
 	char severity = check_str[0];
 
 	switch (severity) {
 	case 'C':
 		max_id = C_END - 1;
+		offset = C_OFFSET;
 		break;
 	case 'S':
 		max_id = S_END - 1;
+		offset = S_OFFSET;
 		break;
 	case 'W':
 		max_id = W_END - 1;
+		offset = W_OFFSET;
 		break;
 	case 'E':
 		max_id = E_END - 1;
+		offset = E_OFFSET;
 		break;
 	case 'F':
-		max_id = 2;
+		max_id = F_END - 1;
+		offset = F_OFFSET;
 		break;
 	default:
-		return 0;
+		return CHECK_INDEX_INVALID;
 	}
 
 	int check_id = atoi(check_str+2);
 	if (check_id > 0 && check_id <= max_id) {
-		return 1;
+		return offset + check_id - 1;
 	} else {
-		return 0;
+		return CHECK_INDEX_INVALID;
 	}
 }
 
@@ -303,6 +405,7 @@ void free_checks(struct checks *to_free)
 			free_check_node(to_free->check_nodes[i]);
 		}
 	}
+	free(to_free->dispatch);
 	free(to_free);
 }
 
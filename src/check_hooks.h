@@ -17,6 +17,8 @@
 #ifndef CHECK_HOOKS_H
 #define CHECK_HOOKS_H
 
+#include <stdint.h>
+
 #include "tree.h"
 #include "selint_error.h"
 
@@ -30,6 +32,9 @@ enum style_ids {
 	S_ID_REQUIRE = 1,
 	S_ID_FC_TYPE = 2,
 	S_ID_SEMICOLON = 3,
+	S_ID_REDUNDANT = 4,
+	S_ID_UNUSED_IF = 5,
+	S_ID_FC_DUPLICATE = 6,
 	S_END
 };
 
@@ -39,28 +44,45 @@ enum warn_ids {
 	W_ID_UNUSED_REQ       = 3,
 	W_ID_FC_REGEX         = 4,
 	W_ID_IF_CALL_OPTIONAL = 5,
+	W_ID_UNUSED_DECL      = 6,
+	W_ID_FC_SHADOWED      = 7,
 	W_END
 };
 
 enum error_ids {
-	E_ID_FC_ERROR = 2,
-	E_ID_FC_USER  = 3,
-	E_ID_FC_ROLE  = 4,
-	E_ID_FC_TYPE  = 5,
+	E_ID_FC_ERROR     = 2,
+	E_ID_FC_USER      = 3,
+	E_ID_FC_ROLE      = 4,
+	E_ID_FC_TYPE      = 5,
+	E_ID_NEVERALLOW   = 6,
+	E_ID_UNKNOWN_PERM = 7,
+	E_ID_FC_CONFLICT  = 8,
 	E_END
 };
 
 enum fatal_ids {
 	F_ID_POLICY_SYNTAX = 1,
-	F_ID_INTERNAL      = 2
+	F_ID_INTERNAL      = 2,
+	F_END
 };
 
+// Number of possible check ids.  Every id has a dense index below this (see
+// check_index()), which is its bit in a check set such as
+// policy_node.exceptions.
+#define CHECK_COUNT ((C_END - 1) + (S_END - 1) + (W_END - 1) + (E_END - 1) + (F_END - 1))
+#define CHECK_INDEX_INVALID ((unsigned int)-1)
+#define CHECK_BIT(index) (UINT64_C(1) << (index))
+
 enum file_flavor {
 	FILE_TE_FILE,
 	FILE_IF_FILE,
-	FILE_FC_FILE
+	FILE_FC_FILE,
+	FILE_FLAVOR_END
 };
 
+#define FILE_MASK(file_flavor) (1u << (file_flavor))
+#define ALL_FILES (FILE_MASK(FILE_TE_FILE) | FILE_MASK(FILE_IF_FILE) | FILE_MASK(FILE_FC_FILE))
+
 struct check_data {
 	char *mod_name;
 	char *filename;
@@ -81,11 +103,27 @@ struct check_node {
 	                                        const struct policy_node * node);
 	char *check_id;
 	unsigned int issues_found;
+	// CHECK_BIT() of the check id, or 0 if the id is not a valid check
+	uint64_t bit;
+	// FILE_MASK()s of the file flavors the check can report issues in
+	unsigned int file_mask;
 	struct check_node *next;
 };
 
+struct check_dispatch_entry {
+	struct check_result *(*check_function) (const struct check_data * data,
+	                                        const struct policy_node * node);
+	struct check_node *check;
+	uint64_t bit;
+};
+
 struct checks {
 	struct check_node *check_nodes[NODE_ERROR + 1];
+	// Compiled from check_nodes by compile_checks().  The checks to run on
+	// node flavor n in a file of flavor f are the entries from
+	// dispatch_start[f][n] up to (not including) dispatch_start[f][n + 1].
+	struct check_dispatch_entry *dispatch;
+	unsigned int dispatch_start[FILE_FLAVOR_END][NODE_ERROR + 2];
 };
 
 /*********************************************
@@ -105,6 +143,49 @@ enum selint_error add_check(enum node_flavor check_flavor, struct checks *ck,
                                                                    policy_node
                                                                    * node));
 
+/*********************************************
+* Add a check that can only report issues in some file flavors.  It is left
+* out of the dispatch table for other file flavors.  Checks called for fc
+* files run on several threads at once, so they must not change any state
+* shared between calls.
+* file_mask - FILE_MASK()s of the file flavors to call the check for
+* check_flavor - The flavor of node to call the check for
+* ck - The check structure to add the check to
+* check_id - The ID code for the check
+* check_function - the check to add
+* returns SELINT_SUCCESS or an error code on failure
+*********************************************/
+enum selint_error add_check_for_files(unsigned int file_mask,
+                                      enum node_flavor check_flavor,
+                                      struct checks *ck,
+                                      const char *check_id,
+                                      struct check_result *(*check_function)(const struct
+                                                                             check_data *
+                                                                             check_data,
+                                                                             const struct
+                                                                             policy_node
+                                                                             * node));
+
+/*********************************************
+* Build the dispatch table of ck from the registered checks.  Adding a check
+* discards the table, and dispatch_checks() rebuilds it when needed.
+* ck - The checks structure
+* returns SELINT_SUCCESS or an error code on failure
+*********************************************/
+enum selint_error compile_checks(struct checks *ck);
+
+/*********************************************
+* Call the checks in the dispatch table for data->flavor files and
+* node->flavor nodes, and write any error messages to STDOUT
+* ck - The checks structure
+* data - Metadata about the file
+* node - the node to check
+* returns SELINT_SUCCESS or an error code on failure
+*********************************************/
+enum selint_error dispatch_checks(struct checks *ck,
+                                  const struct check_data *data,
+                                  struct policy_node *node);
+
 /*********************************************
 * Call all registered checks for node->flavor node types
 * and write any error messages to STDOUT
@@ -130,11 +211,12 @@ enum selint_error call_checks_for_node_type(struct check_node *ck_list,
                                             struct policy_node *node);
 
 /*********************************************
-* Display a result message for a positive check finding
+* Display a result message for a positive check finding.  The message is
+* buffered, see output.h.
 * res - Information about the result of the check
 * data - Metadata about the file
 *********************************************/
-void display_check_result(struct check_result *res, struct check_data *data);
+void display_check_result(struct check_result *res, const struct check_data *data);
 
 /*********************************************
 * Creates a check_result, using a printf style format string and optional
@@ -161,6 +243,14 @@ struct check_result *alloc_internal_error(const char *string);
 *********************************************/
 int is_valid_check(const char *check_str);
 
+/*********************************************
+* Get the dense index of a check id, in [0, CHECK_COUNT).  Anything after the
+* number (such as a ',' separating it from the next id) is ignored.
+* check_str - The check id, e.g. "W-001"
+* returns the index, or CHECK_INDEX_INVALID if check_str is not a valid check
+*********************************************/
+unsigned int check_index(const char *check_str);
+
 /*********************************************
 * Display a count of issues found in a run, but check ID.
 * Don't display checks with no issues found
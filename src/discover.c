@@ -0,0 +1,296 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "discover.h"
+#include "parallel.h"
+
+struct discover_dir;
+
+struct discover_entry {
+	char *path;
+	// Points into path
+	const char *name;
+	int is_dir;
+	// The contents of the directory, if it is walked
+	struct discover_dir *dir;
+};
+
+struct discover_dir {
+	const char *path;
+	struct discover_entry *entries;
+	unsigned int count;
+	// Next directory waiting to be read
+	struct discover_dir *next_queued;
+};
+
+struct discover_walk {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	// Directories waiting to be read
+	struct discover_dir *queue;
+	// Directories queued or being read
+	unsigned int pending;
+	int out_of_mem;
+};
+
+// Append an empty entry to a directory, growing its entries as needed.
+// Returns the new entry, or NULL on allocation failure.
+static struct discover_entry *append_entry(struct discover_dir *dir, unsigned int *cap)
+{
+	if (dir->count == *cap) {
+		unsigned int new_cap = *cap ? *cap * 2 : 16;
+		struct discover_entry *entries = realloc(dir->entries,
+		                                         new_cap * sizeof(struct discover_entry));
+		if (!entries) {
+			return NULL;
+		}
+		dir->entries = entries;
+		*cap = new_cap;
+	}
+
+	struct discover_entry *entry = &dir->entries[dir->count++];
+	memset(entry, 0, sizeof(struct discover_entry));
+
+	return entry;
+}
+
+// Join a directory path and a name as fts(3) does, without doubling a
+// trailing slash.  Sets name to the start of the name in the result.
+static char *join_path(const char *dir_path, const char *name, const char **name_start)
+{
+	size_t dir_len = strlen(dir_path);
+	if (dir_len > 0 && dir_path[dir_len - 1] == '/') {
+		dir_len--;
+	}
+	size_t name_len = strlen(name);
+	char *path = malloc(dir_len + name_len + 2);
+	if (!path) {
+		return NULL;
+	}
+	memcpy(path, dir_path, dir_len);
+	path[dir_len] = '/';
+	memcpy(path + dir_len + 1, name, name_len + 1);
+	*name_start = path + dir_len + 1;
+
+	return path;
+}
+
+// Read the entries of a directory in order.  Subdirectories get an empty
+// discover_dir, which is returned in a list through next_queued.  Returns 0
+// on success, or -1 on allocation failure.
+static int read_discover_dir(struct discover_dir *dir, struct discover_dir **subdirs)
+{
+	unsigned int cap = 0;
+	int fd = openat(AT_FDCWD, dir->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0) {
+		// Unreadable directories are visited without contents, as with fts
+		return 0;
+	}
+
+	DIR *dirp = fdopendir(fd);
+	if (!dirp) {
+		close(fd);
+		return 0;
+	}
+
+	struct dirent *ent;
+	while ((ent = readdir(dirp))) {
+		if (0 == strcmp(ent->d_name, ".") || 0 == strcmp(ent->d_name, "..")) {
+			continue;
+		}
+
+		struct discover_entry *entry = append_entry(dir, &cap);
+		if (!entry || !(entry->path = join_path(dir->path, ent->d_name,
+		                                        &entry->name))) {
+			closedir(dirp);
+			return -1;
+		}
+
+		if (ent->d_type == DT_DIR) {
+			entry->is_dir = 1;
+		} else if (ent->d_type == DT_UNKNOWN) {
+			// Some filesystems do not report the type
+			struct stat st;
+			entry->is_dir = (0 == fstatat(dirfd(dirp), ent->d_name, &st,
+			                              AT_SYMLINK_NOFOLLOW) &&
+			                 S_ISDIR(st.st_mode));
+		}
+	}
+
+	closedir(dirp);
+
+	// Link subdirectories only once the entries array is final
+	for (unsigned int i = dir->count; i > 0; i--) {
+		struct discover_entry *entry = &dir->entries[i - 1];
+		if (entry->is_dir) {
+			entry->dir = calloc(1, sizeof(struct discover_dir));
+			if (!entry->dir) {
+				return -1;
+			}
+			entry->dir->path = entry->path;
+			entry->dir->next_queued = *subdirs;
+			*subdirs = entry->dir;
+		}
+	}
+
+	return 0;
+}
+
+static void discover_worker(void *ctx, __attribute__((unused)) unsigned int item)
+{
+	struct discover_walk *walk = ctx;
+
+	pthread_mutex_lock(&walk->lock);
+	while (1) {
+		while (!walk->queue && walk->pending > 0) {
+			pthread_cond_wait(&walk->cond, &walk->lock);
+		}
+		if (!walk->queue) {
+			break;
+		}
+
+		struct discover_dir *dir = walk->queue;
+		walk->queue = dir->next_queued;
+		pthread_mutex_unlock(&walk->lock);
+
+		struct discover_dir *subdirs = NULL;
+		int failed = walk->out_of_mem || read_discover_dir(dir, &subdirs) != 0;
+
+		pthread_mutex_lock(&walk->lock);
+		if (failed) {
+			walk->out_of_mem = 1;
+		}
+		while (subdirs) {
+			struct discover_dir *next = subdirs->next_queued;
+			subdirs->next_queued = walk->queue;
+			walk->queue = subdirs;
+			walk->pending++;
+			subdirs = next;
+		}
+		walk->pending--;
+		pthread_cond_broadcast(&walk->cond);
+	}
+	pthread_mutex_unlock(&walk->lock);
+}
+
+static void visit_entries(const struct discover_dir *dir, const char *parent_name,
+                          void (*visit)(const struct discovered_file *file, void *ctx),
+                          void *ctx)
+{
+	for (unsigned int i = 0; i < dir->count; i++) {
+		const struct discover_entry *entry = &dir->entries[i];
+		struct discovered_file file = { entry->path, entry->name, parent_name,
+			                        entry->is_dir };
+
+		visit(&file, ctx);
+		if (entry->dir) {
+			visit_entries(entry->dir, entry->name, visit, ctx);
+			visit(&file, ctx);
+		}
+	}
+}
+
+static void free_discover_dir(struct discover_dir *dir)
+{
+	for (unsigned int i = 0; i < dir->count; i++) {
+		if (dir->entries[i].dir) {
+			free_discover_dir(dir->entries[i].dir);
+		}
+		free(dir->entries[i].path);
+	}
+	free(dir->entries);
+	free(dir);
+}
+
+enum selint_error discover_files(char * const *paths, int recursive,
+                                 void (*visit)(const struct discovered_file *file,
+                                               void *ctx),
+                                 void *ctx)
+{
+	struct discover_walk walk;
+	enum selint_error res = SELINT_SUCCESS;
+
+	// The given paths, as the entries of a directory without a name
+	struct discover_dir *roots = calloc(1, sizeof(struct discover_dir));
+	if (!roots) {
+		return SELINT_OUT_OF_MEM;
+	}
+
+	walk.queue = NULL;
+	walk.pending = 0;
+	walk.out_of_mem = 0;
+
+	unsigned int cap = 0;
+	for (char * const *path = paths; *path; path++) {
+		struct discover_entry *entry = append_entry(roots, &cap);
+		if (!entry || !(entry->path = strdup(*path))) {
+			res = SELINT_OUT_OF_MEM;
+			goto out;
+		}
+		const char *slash = strrchr(entry->path, '/');
+		entry->name = slash ? slash + 1 : entry->path;
+
+		// Only the given paths are stat()ed
+		struct stat st;
+		entry->is_dir = (0 == lstat(entry->path, &st) && S_ISDIR(st.st_mode));
+
+		if (entry->is_dir && recursive) {
+			entry->dir = calloc(1, sizeof(struct discover_dir));
+			if (!entry->dir) {
+				res = SELINT_OUT_OF_MEM;
+				goto out;
+			}
+			entry->dir->path = entry->path;
+		}
+	}
+
+	if (recursive) {
+		// Queue the roots so the first one is read first
+		for (unsigned int i = roots->count; i > 0; i--) {
+			struct discover_dir *dir = roots->entries[i - 1].dir;
+			if (dir) {
+				dir->next_queued = walk.queue;
+				walk.queue = dir;
+				walk.pending++;
+			}
+		}
+
+		pthread_mutex_init(&walk.lock, NULL);
+		pthread_cond_init(&walk.cond, NULL);
+		run_in_parallel(get_parallel_jobs(), discover_worker, &walk);
+		pthread_cond_destroy(&walk.cond);
+		pthread_mutex_destroy(&walk.lock);
+
+		if (walk.out_of_mem) {
+			res = SELINT_OUT_OF_MEM;
+			goto out;
+		}
+	}
+
+	visit_entries(roots, "", visit, ctx);
+
+out:
+	free_discover_dir(roots);
+	return res;
+}
@@ -0,0 +1,54 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef DISCOVER_H
+#define DISCOVER_H
+
+#include "selint_error.h"
+
+// A file or directory found while walking the paths given to discover_files()
+struct discovered_file {
+	// The path, made by appending names to one of the given paths
+	const char *path;
+	// The last component of the path
+	const char *name;
+	// The name of the directory containing the file, or "" for the given paths
+	const char *parent_name;
+	int is_dir;
+};
+
+/*********************************************
+* Find all files under a set of paths.  Directories are read in parallel
+* (see get_parallel_jobs()), and are classified by the type reported by the
+* directory entry, so that files are never stat()ed.  Symbolic links are not
+* followed.
+* Every file and directory is then passed to visit on the calling thread in
+* the same order as a depth first walk with fts(3): the given paths in order,
+* and the entries of each directory in the order they are read.  Directories
+* that are walked are visited both before and after their contents, and
+* those that are not are visited once.
+* paths - NULL terminated list of paths to walk
+* recursive - If not set, the contents of directories are not walked
+* visit - Called for every file and directory found
+* ctx - Passed to every call of visit
+* returns SELINT_SUCCESS or SELINT_OUT_OF_MEM
+*********************************************/
+enum selint_error discover_files(char * const *paths, int recursive,
+                                 void (*visit)(const struct discovered_file *file,
+                                               void *ctx),
+                                 void *ctx);
+
+#endif
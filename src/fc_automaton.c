@@ -0,0 +1,839 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <ctype.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fc_automaton.h"
+
+// A regex is compiled into its position (Glushkov) automaton.  Every
+// character set in the regex is a position, and after reading some input
+// the automaton is in the set of positions the input can end on, with
+// position 0 standing for the start of the input.  Sets of positions are
+// bitsets, so reading a character is an or of the follow sets of the
+// current positions, masked by the positions whose set holds the character.
+// Deciding inclusion explores pairs of such sets, one for each regex, which
+// only visits the few states the two regexes can actually reach together.
+
+#define BITS_PER_WORD 64
+#define WORDS(count) (((count) + BITS_PER_WORD - 1) / BITS_PER_WORD)
+#define CHAR_COUNT 256
+#define CHARSET_WORDS (CHAR_COUNT / BITS_PER_WORD)
+// Deeper nesting of groups than this is not supported
+#define MAX_DEPTH 64
+
+struct fc_regex {
+	// Number of positions, including the start
+	unsigned int position_count;
+	// Number of words in a set of positions
+	unsigned int words;
+	// For each position, the positions that can come after it
+	uint64_t *follow;
+	// The positions a match can end on
+	uint64_t *accepting;
+	// For each character, the positions whose set holds it
+	uint64_t *matching;
+	// The longest run of literal characters in the top level sequence
+	char *literal;
+};
+
+enum re_kind {
+	RE_EMPTY,
+	RE_CHARS,
+	RE_CAT,
+	RE_ALT,
+	RE_STAR,
+	RE_PLUS,
+	RE_OPT
+};
+
+// A node of a parsed regex.  RE_CHARS nodes hold the index of their
+// character set in left, and other nodes hold the indexes of their operands.
+// Operands are always parsed before the nodes using them.
+struct re_node {
+	enum re_kind kind;
+	unsigned int left;
+	unsigned int right;
+};
+
+struct re_parser {
+	const char *cur;
+	unsigned int depth;
+	struct re_node *nodes;
+	unsigned int node_count;
+	unsigned int node_cap;
+	uint64_t (*charsets)[CHARSET_WORDS];
+	unsigned int charset_count;
+	unsigned int charset_cap;
+};
+
+static const struct {
+	const char *name;
+	int (*is_member)(int c);
+} char_classes[] = {
+	{ "alnum", isalnum },
+	{ "alpha", isalpha },
+	{ "blank", isblank },
+	{ "cntrl", iscntrl },
+	{ "digit", isdigit },
+	{ "graph", isgraph },
+	{ "lower", islower },
+	{ "print", isprint },
+	{ "punct", ispunct },
+	{ "space", isspace },
+	{ "upper", isupper },
+	{ "xdigit", isxdigit },
+};
+
+static void set_bit(uint64_t *set, unsigned int bit)
+{
+	set[bit / BITS_PER_WORD] |= UINT64_C(1) << (bit % BITS_PER_WORD);
+}
+
+static int has_bit(const uint64_t *set, unsigned int bit)
+{
+	return (set[bit / BITS_PER_WORD] >> (bit % BITS_PER_WORD)) & 1;
+}
+
+static int is_empty_set(const uint64_t *set, unsigned int words)
+{
+	for (unsigned int i = 0; i < words; i++) {
+		if (set[i]) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static int new_node(struct re_parser *p, enum re_kind kind,
+                    unsigned int left, unsigned int right)
+{
+	if (p->node_count == p->node_cap) {
+		unsigned int cap = p->node_cap ? p->node_cap * 2 : 16;
+		struct re_node *grown = realloc(p->nodes, cap * sizeof(struct re_node));
+		if (!grown) {
+			return -1;
+		}
+		p->nodes = grown;
+		p->node_cap = cap;
+	}
+	p->nodes[p->node_count].kind = kind;
+	p->nodes[p->node_count].left = left;
+	p->nodes[p->node_count].right = right;
+
+	return (int)p->node_count++;
+}
+
+// Add an empty character set, and a node for it once it is filled in
+static uint64_t *new_charset(struct re_parser *p)
+{
+	if (p->charset_count == p->charset_cap) {
+		unsigned int cap = p->charset_cap ? p->charset_cap * 2 : 16;
+		uint64_t (*grown)[CHARSET_WORDS] = realloc(p->charsets, cap * sizeof(*grown));
+		if (!grown) {
+			return NULL;
+		}
+		p->charsets = grown;
+		p->charset_cap = cap;
+	}
+	uint64_t *set = p->charsets[p->charset_count++];
+	memset(set, 0, CHARSET_WORDS * sizeof(uint64_t));
+
+	return set;
+}
+
+static int chars_node(struct re_parser *p)
+{
+	return new_node(p, RE_CHARS, p->charset_count - 1, 0);
+}
+
+static int parse_alternation(struct re_parser *p);
+
+// Parse a bracket expression, after the [
+static int parse_bracket(struct re_parser *p)
+{
+	uint64_t *set = new_charset(p);
+	if (!set) {
+		return -1;
+	}
+
+	int negated = 0;
+	if (*p->cur == '^') {
+		negated = 1;
+		p->cur++;
+	}
+
+	const char *start = p->cur;
+	while (*p->cur != ']' || p->cur == start) {
+		unsigned char c = (unsigned char)*p->cur;
+		if (c == '\0') {
+			return -1;
+		}
+		if (c == '[' && p->cur[1] == ':') {
+			const char *name = p->cur + 2;
+			const char *end = strstr(name, ":]");
+			if (!end) {
+				return -1;
+			}
+			size_t i;
+			for (i = 0; i < sizeof(char_classes) / sizeof(char_classes[0]); i++) {
+				if (strlen(char_classes[i].name) == (size_t)(end - name) &&
+				    0 == strncmp(char_classes[i].name, name, (size_t)(end - name))) {
+					break;
+				}
+			}
+			if (i == sizeof(char_classes) / sizeof(char_classes[0])) {
+				return -1;
+			}
+			for (unsigned int ch = 1; ch < CHAR_COUNT; ch++) {
+				if (char_classes[i].is_member((int)ch)) {
+					set_bit(set, ch);
+				}
+			}
+			p->cur = end + 2;
+			continue;
+		}
+		if (c == '[' && (p->cur[1] == '.' || p->cur[1] == '=')) {
+			// Collating elements and equivalence classes
+			return -1;
+		}
+		if (c == '\\') {
+			// As outside of brackets, only escaped punctuation is a literal
+			c = (unsigned char)p->cur[1];
+			if (c == '\0' || isalnum(c)) {
+				return -1;
+			}
+			p->cur++;
+		}
+		unsigned char last = c;
+		if (p->cur[1] == '-' && p->cur[2] != ']' && p->cur[2] != '\0') {
+			last = (unsigned char)p->cur[2];
+			if (last < c) {
+				return -1;
+			}
+			p->cur += 2;
+		}
+		for (unsigned int ch = c; ch <= last; ch++) {
+			set_bit(set, ch);
+		}
+		p->cur++;
+	}
+	p->cur++;
+
+	if (negated) {
+		for (unsigned int i = 0; i < CHARSET_WORDS; i++) {
+			set[i] = ~set[i];
+		}
+	}
+	// Paths never hold NUL, and a set that holds nothing else matches nothing
+	set[0] &= ~UINT64_C(1);
+	if (is_empty_set(set, CHARSET_WORDS)) {
+		return -1;
+	}
+
+	return chars_node(p);
+}
+
+static int parse_atom(struct re_parser *p)
+{
+	unsigned char c = (unsigned char)*p->cur;
+	uint64_t *set;
+
+	switch (c) {
+	case '(':
+		if (++p->depth > MAX_DEPTH) {
+			return -1;
+		}
+		p->cur++;
+		int inner = parse_alternation(p);
+		if (inner < 0 || *p->cur != ')') {
+			return -1;
+		}
+		p->cur++;
+		p->depth--;
+		return inner;
+	case '[':
+		p->cur++;
+		return parse_bracket(p);
+	case '.':
+		p->cur++;
+		set = new_charset(p);
+		if (!set) {
+			return -1;
+		}
+		memset(set, 0xff, CHARSET_WORDS * sizeof(uint64_t));
+		set[0] &= ~UINT64_C(1);
+		return chars_node(p);
+	case '\\':
+		c = (unsigned char)p->cur[1];
+		// Escaped letters and digits are classes such as \d and \w, or back
+		// references, rather than literals
+		if (c == '\0' || isalnum(c)) {
+			return -1;
+		}
+		p->cur += 2;
+		break;
+	case '\0':
+	case '^':
+	case '$':
+	case '{':
+	case '*':
+	case '+':
+	case '?':
+		return -1;
+	default:
+		p->cur++;
+		break;
+	}
+
+	set = new_charset(p);
+	if (!set) {
+		return -1;
+	}
+	set_bit(set, c);
+
+	return chars_node(p);
+}
+
+static int parse_repetition(struct re_parser *p)
+{
+	int node = parse_atom(p);
+
+	while (node >= 0) {
+		enum re_kind kind;
+		switch (*p->cur) {
+		case '*':
+			kind = RE_STAR;
+			break;
+		case '+':
+			kind = RE_PLUS;
+			break;
+		case '?':
+			kind = RE_OPT;
+			break;
+		default:
+			return node;
+		}
+		p->cur++;
+		node = new_node(p, kind, (unsigned int)node, 0);
+	}
+
+	return node;
+}
+
+static int parse_concatenation(struct re_parser *p)
+{
+	int node = -1;
+
+	while (*p->cur != '\0' && *p->cur != '|' && *p->cur != ')') {
+		int next = parse_repetition(p);
+		if (next < 0) {
+			return -1;
+		}
+		node = node < 0 ? next :
+		       new_node(p, RE_CAT, (unsigned int)node, (unsigned int)next);
+		if (node < 0) {
+			return -1;
+		}
+	}
+
+	return node < 0 ? new_node(p, RE_EMPTY, 0, 0) : node;
+}
+
+static int parse_alternation(struct re_parser *p)
+{
+	int node = parse_concatenation(p);
+
+	while (node >= 0 && *p->cur == '|') {
+		p->cur++;
+		int next = parse_concatenation(p);
+		if (next < 0) {
+			return -1;
+		}
+		node = new_node(p, RE_ALT, (unsigned int)node, (unsigned int)next);
+	}
+
+	return node;
+}
+
+// Add the positions in to the follow sets of the positions in from
+static void add_follow(struct fc_regex *re, const uint64_t *from, const uint64_t *to)
+{
+	for (unsigned int i = 0; i < re->words; i++) {
+		uint64_t bits = from[i];
+		while (bits) {
+			unsigned int pos = i * BITS_PER_WORD + (unsigned int)__builtin_ctzll(bits);
+			uint64_t *follow = re->follow + pos * re->words;
+			for (unsigned int j = 0; j < re->words; j++) {
+				follow[j] |= to[j];
+			}
+			bits &= bits - 1;
+		}
+	}
+}
+
+// Compute the first and last positions and nullability of every node,
+// bottom up, filling in the follow sets on the way
+static int build_automaton(struct fc_regex *re, const struct re_parser *p,
+                           unsigned int root)
+{
+	unsigned int words = re->words;
+	uint64_t *first = calloc((size_t)p->node_count * words, sizeof(uint64_t));
+	uint64_t *last = calloc((size_t)p->node_count * words, sizeof(uint64_t));
+	char *nullable = calloc(p->node_count, 1);
+
+	if (!first || !last || !nullable) {
+		free(first);
+		free(last);
+		free(nullable);
+		return 0;
+	}
+
+	for (unsigned int i = 0; i <= root; i++) {
+		const struct re_node *node = &p->nodes[i];
+		uint64_t *f = first + i * words;
+		uint64_t *l = last + i * words;
+		const uint64_t *lf = first + node->left * words;
+		const uint64_t *ll = last + node->left * words;
+		const uint64_t *rf = first + node->right * words;
+		const uint64_t *rl = last + node->right * words;
+
+		switch (node->kind) {
+		case RE_EMPTY:
+			nullable[i] = 1;
+			break;
+		case RE_CHARS:
+			set_bit(f, node->left + 1);
+			set_bit(l, node->left + 1);
+			break;
+		case RE_CAT:
+			add_follow(re, ll, rf);
+			for (unsigned int j = 0; j < words; j++) {
+				f[j] = lf[j] | (nullable[node->left] ? rf[j] : 0);
+				l[j] = rl[j] | (nullable[node->right] ? ll[j] : 0);
+			}
+			nullable[i] = nullable[node->left] && nullable[node->right];
+			break;
+		case RE_ALT:
+			for (unsigned int j = 0; j < words; j++) {
+				f[j] = lf[j] | rf[j];
+				l[j] = ll[j] | rl[j];
+			}
+			nullable[i] = nullable[node->left] || nullable[node->right];
+			break;
+		case RE_STAR:
+		case RE_PLUS:
+		case RE_OPT:
+			if (node->kind != RE_OPT) {
+				add_follow(re, ll, lf);
+			}
+			memcpy(f, lf, words * sizeof(uint64_t));
+			memcpy(l, ll, words * sizeof(uint64_t));
+			nullable[i] = node->kind != RE_PLUS || nullable[node->left];
+			break;
+		}
+	}
+
+	memcpy(re->follow, first + root * words, words * sizeof(uint64_t));
+	memcpy(re->accepting, last + root * words, words * sizeof(uint64_t));
+	if (nullable[root]) {
+		set_bit(re->accepting, 0);
+	}
+
+	for (unsigned int pos = 1; pos < re->position_count; pos++) {
+		for (unsigned int c = 1; c < CHAR_COUNT; c++) {
+			if (has_bit(p->charsets[pos - 1], c)) {
+				set_bit(re->matching + c * words, pos);
+			}
+		}
+	}
+
+	free(first);
+	free(last);
+	free(nullable);
+
+	return 1;
+}
+
+// The character a set holds, if it holds exactly one
+static int single_char(const uint64_t *set)
+{
+	int c = -1;
+
+	for (unsigned int i = 0; i < CHARSET_WORDS; i++) {
+		if (set[i] == 0) {
+			continue;
+		}
+		if (c != -1 || (set[i] & (set[i] - 1))) {
+			return -1;
+		}
+		c = (int)(i * BITS_PER_WORD) + __builtin_ctzll(set[i]);
+	}
+
+	return c;
+}
+
+// The character a node matches, if it matches exactly one
+static int node_char(const struct re_parser *p, unsigned int node)
+{
+	if (p->nodes[node].kind != RE_CHARS) {
+		return -1;
+	}
+
+	return single_char(p->charsets[p->nodes[node].left]);
+}
+
+// Find the last run of single characters in the sequence of nodes the regex
+// is made of, which every match must contain.  Paths tend to end in their
+// most distinctive text.
+static char *find_literal(const struct re_parser *p, unsigned int root)
+{
+	char *literal = malloc(p->node_count + 1);
+	size_t len = 0;
+
+	if (!literal) {
+		return NULL;
+	}
+
+	// Concatenations nest to the left, so the sequence is walked last first
+	unsigned int node = root;
+	int in_run = 0;
+	for (;;) {
+		unsigned int item = p->nodes[node].kind == RE_CAT ? p->nodes[node].right : node;
+		int c = node_char(p, item);
+		if (c != -1) {
+			literal[len++] = (char)c;
+			in_run = 1;
+		} else if (in_run) {
+			break;
+		}
+		if (p->nodes[node].kind != RE_CAT) {
+			break;
+		}
+		node = p->nodes[node].left;
+	}
+
+	for (size_t i = 0; i < len / 2; i++) {
+		char tmp = literal[i];
+		literal[i] = literal[len - 1 - i];
+		literal[len - 1 - i] = tmp;
+	}
+	literal[len] = '\0';
+
+	return literal;
+}
+
+struct fc_regex *compile_fc_regex(const char *regex)
+{
+	struct re_parser p;
+	struct fc_regex *re = NULL;
+
+	memset(&p, 0, sizeof(struct re_parser));
+	p.cur = regex;
+
+	int root = parse_alternation(&p);
+	if (root < 0 || *p.cur != '\0') {
+		goto cleanup;
+	}
+
+	re = calloc(1, sizeof(struct fc_regex));
+	if (!re) {
+		goto cleanup;
+	}
+	re->position_count = p.charset_count + 1;
+	re->words = WORDS(re->position_count);
+	re->follow = calloc((size_t)re->position_count * re->words, sizeof(uint64_t));
+	re->accepting = calloc(re->words, sizeof(uint64_t));
+	re->matching = calloc((size_t)CHAR_COUNT * re->words, sizeof(uint64_t));
+	re->literal = find_literal(&p, (unsigned int)root);
+	if (!re->follow || !re->accepting || !re->matching || !re->literal ||
+	    !build_automaton(re, &p, (unsigned int)root)) {
+		free_fc_regex(re);
+		re = NULL;
+	}
+
+cleanup:
+	free(p.nodes);
+	free(p.charsets);
+	return re;
+}
+
+// Set out to the positions that can come after any of the positions in set
+static void follow_of(const struct fc_regex *re, const uint64_t *set, uint64_t *out)
+{
+	memset(out, 0, re->words * sizeof(uint64_t));
+	for (unsigned int i = 0; i < re->words; i++) {
+		uint64_t bits = set[i];
+		while (bits) {
+			unsigned int pos = i * BITS_PER_WORD + (unsigned int)__builtin_ctzll(bits);
+			const uint64_t *follow = re->follow + pos * re->words;
+			for (unsigned int j = 0; j < re->words; j++) {
+				out[j] |= follow[j];
+			}
+			bits &= bits - 1;
+		}
+	}
+}
+
+// Set out to the positions in follow that can read c.  Returns 0 if there
+// are none.
+static int step(const struct fc_regex *re, const uint64_t *follow,
+                unsigned char c, uint64_t *out)
+{
+	const uint64_t *matching = re->matching + c * re->words;
+	uint64_t any = 0;
+
+	for (unsigned int i = 0; i < re->words; i++) {
+		out[i] = follow[i] & matching[i];
+		any |= out[i];
+	}
+
+	return any != 0;
+}
+
+static int is_accepting(const struct fc_regex *re, const uint64_t *set)
+{
+	for (unsigned int i = 0; i < re->words; i++) {
+		if (set[i] & re->accepting[i]) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+const char *fc_regex_literal(const struct fc_regex *re)
+{
+	return re->literal;
+}
+
+int fc_regex_matches(const struct fc_regex *re, const char *str)
+{
+	uint64_t *set = calloc(2 * re->words, sizeof(uint64_t));
+	if (!set) {
+		return 0;
+	}
+	uint64_t *follow = set + re->words;
+	int matched = 1;
+
+	set_bit(set, 0);
+	for (const char *cur = str; *cur != '\0'; cur++) {
+		follow_of(re, set, follow);
+		if (!step(re, follow, (unsigned char)*cur, set)) {
+			matched = 0;
+			break;
+		}
+	}
+	matched = matched && is_accepting(re, set);
+
+	free(set);
+	return matched;
+}
+
+// A character a position can read, preferring printable ones
+static unsigned char example_char(const struct fc_regex *re, unsigned int pos)
+{
+	for (unsigned int c = '!'; c < 0x7f; c++) {
+		if (has_bit(re->matching + c * re->words, pos)) {
+			return (unsigned char)c;
+		}
+	}
+	for (unsigned int c = 1; c < CHAR_COUNT; c++) {
+		if (has_bit(re->matching + c * re->words, pos)) {
+			return (unsigned char)c;
+		}
+	}
+
+	return 0;
+}
+
+char *fc_regex_example(const struct fc_regex *re)
+{
+	unsigned int count = re->position_count;
+	unsigned int *parent = malloc(count * sizeof(unsigned int));
+	unsigned int *queue = malloc(count * sizeof(unsigned int));
+	char *example = NULL;
+
+	if (!parent || !queue) {
+		goto cleanup;
+	}
+
+	// Breadth first over positions, so the first accepting one is reached
+	// by a shortest string
+	for (unsigned int i = 0; i < count; i++) {
+		parent[i] = UINT_MAX;
+	}
+	unsigned int head = 0, tail = 0;
+	parent[0] = 0;
+	queue[tail++] = 0;
+	while (head < tail) {
+		unsigned int pos = queue[head++];
+		if (has_bit(re->accepting, pos)) {
+			unsigned int len = 0;
+			for (unsigned int cur = pos; cur != 0; cur = parent[cur]) {
+				len++;
+			}
+			example = malloc(len + 1);
+			if (!example) {
+				goto cleanup;
+			}
+			example[len] = '\0';
+			for (unsigned int cur = pos; cur != 0; cur = parent[cur]) {
+				example[--len] = (char)example_char(re, cur);
+			}
+			goto cleanup;
+		}
+		const uint64_t *follow = re->follow + pos * re->words;
+		for (unsigned int next = 1; next < count; next++) {
+			if (has_bit(follow, next) && parent[next] == UINT_MAX) {
+				parent[next] = pos;
+				queue[tail++] = next;
+			}
+		}
+	}
+
+cleanup:
+	free(parent);
+	free(queue);
+	return example;
+}
+
+// A set of explored product states, each a set of positions of the inner
+// regex followed by a set of positions of the outer one
+struct state_table {
+	unsigned int key_words;
+	uint64_t *states;
+	unsigned int count;
+	unsigned int max_count;
+	// Open addressing table of indexes into states
+	unsigned int *slots;
+	unsigned int slot_mask;
+};
+
+static uint64_t hash_state(const uint64_t *state, unsigned int words)
+{
+	uint64_t hash = UINT64_C(14695981039346656037);
+
+	for (unsigned int i = 0; i < words; i++) {
+		hash = (hash ^ state[i]) * UINT64_C(1099511628211);
+		hash ^= hash >> 29;
+	}
+
+	return hash;
+}
+
+// Add a state unless it is there already.  Returns 1 if it was added, 0 if
+// it was there and -1 if the table is full.
+static int add_state(struct state_table *table, const uint64_t *state)
+{
+	size_t size = table->key_words * sizeof(uint64_t);
+	unsigned int slot = (unsigned int)hash_state(state, table->key_words) & table->slot_mask;
+
+	while (table->slots[slot] != UINT_MAX) {
+		if (0 == memcmp(table->states + (size_t)table->slots[slot] * table->key_words,
+		                state, size)) {
+			return 0;
+		}
+		slot = (slot + 1) & table->slot_mask;
+	}
+	if (table->count == table->max_count) {
+		return -1;
+	}
+	memcpy(table->states + (size_t)table->count * table->key_words, state, size);
+	table->slots[slot] = table->count++;
+
+	return 1;
+}
+
+int fc_regex_includes(const struct fc_regex *outer, const struct fc_regex *inner,
+                      unsigned int max_states)
+{
+	struct state_table table;
+	unsigned int iw = inner->words;
+	unsigned int slot_count = 2;
+	int result = 1;
+
+	while (slot_count < 2 * max_states) {
+		slot_count *= 2;
+	}
+	table.key_words = iw + outer->words;
+	table.count = 0;
+	table.max_count = max_states;
+	table.slot_mask = slot_count - 1;
+	table.states = malloc((size_t)max_states * table.key_words * sizeof(uint64_t));
+	table.slots = malloc(slot_count * sizeof(unsigned int));
+	uint64_t *scratch = calloc(2 * (size_t)table.key_words, sizeof(uint64_t));
+	if (!table.states || !table.slots || !scratch || max_states == 0) {
+		result = -1;
+		goto cleanup;
+	}
+	memset(table.slots, 0xff, slot_count * sizeof(unsigned int));
+
+	// scratch holds the follow sets of a state, and then the next state
+	uint64_t *follow = scratch;
+	uint64_t *next = scratch + table.key_words;
+	set_bit(next, 0);
+	set_bit(next + iw, 0);
+	add_state(&table, next);
+
+	for (unsigned int i = 0; i < table.count && result == 1; i++) {
+		const uint64_t *state = table.states + (size_t)i * table.key_words;
+
+		if (is_accepting(inner, state) && !is_accepting(outer, state + iw)) {
+			result = 0;
+			break;
+		}
+		follow_of(inner, state, follow);
+		follow_of(outer, state + iw, follow + iw);
+		for (unsigned int c = 1; c < CHAR_COUNT; c++) {
+			if (!step(inner, follow, (unsigned char)c, next)) {
+				continue;
+			}
+			// Every position can be completed to a match, so inner
+			// matches something with this prefix that outer does not
+			if (!step(outer, follow + iw, (unsigned char)c, next + iw)) {
+				result = 0;
+				break;
+			}
+			if (add_state(&table, next) == -1) {
+				result = -1;
+				break;
+			}
+		}
+	}
+
+cleanup:
+	free(table.states);
+	free(table.slots);
+	free(scratch);
+	return result;
+}
+
+void free_fc_regex(struct fc_regex *re)
+{
+	if (!re) {
+		return;
+	}
+	free(re->follow);
+	free(re->accepting);
+	free(re->matching);
+	free(re->literal);
+	free(re);
+}
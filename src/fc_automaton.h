@@ -0,0 +1,76 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef FC_AUTOMATON_H
+#define FC_AUTOMATON_H
+
+// The maximum number of states fc_regex_includes() explores by default
+#define FC_INCLUSION_STATE_LIMIT 4096
+
+struct fc_regex;
+
+/*********************************************
+* Compile the path regex of a file context entry into a position automaton.
+* The regex must match a whole path, as file contexts are matched.  Literals,
+* escaped punctuation, ., bracket expressions, groups, | and the ?, * and +
+* operators are supported.
+* regex - The regex to compile
+* returns the compiled regex, or NULL if it uses anything else, such as
+* ^, $, {n,m} or escapes of letters and digits like \d, is malformed or memory
+* could not be allocated
+*********************************************/
+struct fc_regex *compile_fc_regex(const char *regex);
+
+/*********************************************
+* Check whether a compiled regex matches a whole string
+* re - The compiled regex
+* str - The string to match
+* returns 1 if it matches, and 0 otherwise
+*********************************************/
+int fc_regex_matches(const struct fc_regex *re, const char *str);
+
+/*********************************************
+* Find a shortest string matched by a compiled regex
+* re - The compiled regex
+* returns a newly allocated string for the caller to free, or NULL if the
+* regex matches nothing or memory could not be allocated
+*********************************************/
+char *fc_regex_example(const struct fc_regex *re);
+
+/*********************************************
+* Get a literal string every string matched by a compiled regex contains:
+* the last run of single characters in the sequence the regex is made of
+* re - The compiled regex
+* returns the literal, which may be empty
+*********************************************/
+const char *fc_regex_literal(const struct fc_regex *re);
+
+/*********************************************
+* Check whether every string matched by inner is also matched by outer, by
+* exploring the product of the automata determinized on the fly
+* outer - The compiled regex that should match more
+* inner - The compiled regex that should match less
+* max_states - The number of product states to explore before giving up
+* returns 1 if outer matches everything inner does, 0 if not, and -1 if
+* that could not be decided within max_states or memory could not be
+* allocated
+*********************************************/
+int fc_regex_includes(const struct fc_regex *outer, const struct fc_regex *inner,
+                      unsigned int max_states);
+
+void free_fc_regex(struct fc_regex *re);
+
+#endif
@@ -15,6 +15,7 @@
 */
 
 #include "fc_checks.h"
+#include "fc_conflicts.h"
 #include "maps.h"
 #include "tree.h"
 
@@ -196,3 +197,48 @@ struct check_result *check_file_context_types_exist(__attribute__((unused)) cons
 
 	return NULL;
 }
+
+struct check_result *check_file_context_duplicates(__attribute__((unused)) const struct check_data *data,
+                                                   const struct policy_node *node)
+{
+	const char *filename;
+	unsigned int lineno;
+
+	if (find_repeated_file_context(node, &filename, &lineno) != FC_DUPLICATE) {
+		return NULL;
+	}
+
+	return make_check_result('S', S_ID_FC_DUPLICATE,
+	                         "File context is a duplicate of the one at %s:%u",
+	                         filename, lineno);
+}
+
+struct check_result *check_file_context_conflicts(__attribute__((unused)) const struct check_data *data,
+                                                  const struct policy_node *node)
+{
+	const char *filename;
+	unsigned int lineno;
+
+	if (find_repeated_file_context(node, &filename, &lineno) != FC_CONFLICT) {
+		return NULL;
+	}
+
+	return make_check_result('E', E_ID_FC_CONFLICT,
+	                         "File context conflicts with the one for the same path at %s:%u",
+	                         filename, lineno);
+}
+
+struct check_result *check_file_context_shadowed(__attribute__((unused)) const struct check_data *data,
+                                                 const struct policy_node *node)
+{
+	const char *filename;
+	unsigned int lineno;
+
+	if (!find_shadowing_file_context(node, &filename, &lineno)) {
+		return NULL;
+	}
+
+	return make_check_result('W', W_ID_FC_SHADOWED,
+	                         "File context never applies, because the one at %s:%u matches every path it does and takes precedence",
+	                         filename, lineno);
+}
@@ -79,4 +79,37 @@ struct check_result *check_file_context_types_exist(const struct check_data
                                                     const struct policy_node
                                                     *node);
 
+/*********************************************
+* Check for fc entries with the same path regex and context as an earlier
+* entry.  The earlier entries come from the index built by
+* build_fc_conflict_index().
+* Called on NODE_FC_ENTRY nodes.
+* node - the node to check
+* returns NULL if passed or check_result for issue S-006
+*********************************************/
+struct check_result *check_file_context_duplicates(const struct check_data *data,
+                                                   const struct policy_node *node);
+
+/*********************************************
+* Check for fc entries with the same path regex as an earlier entry, but
+* another context.  The earlier entries come from the index built by
+* build_fc_conflict_index().
+* Called on NODE_FC_ENTRY nodes.
+* node - the node to check
+* returns NULL if passed or check_result for issue E-008
+*********************************************/
+struct check_result *check_file_context_conflicts(const struct check_data *data,
+                                                  const struct policy_node *node);
+
+/*********************************************
+* Check for fc entries that never apply, because another entry matches every
+* path they do and takes precedence once the entries are sorted.  The other
+* entries come from the index built by build_fc_conflict_index().
+* Called on NODE_FC_ENTRY nodes.
+* node - the node to check
+* returns NULL if passed or check_result for issue W-007
+*********************************************/
+struct check_result *check_file_context_shadowed(const struct check_data *data,
+                                                 const struct policy_node *node);
+
 #endif
@@ -0,0 +1,468 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fc_automaton.h"
+#include "fc_conflicts.h"
+#include "parallel.h"
+
+// Entries with the same path regex are found by sorting the entries by
+// path.  For shadowing, fc_sort orders entries with metacharacters by the
+// length of their literal prefix (the stem) first, so an entry can only be
+// shadowed by an entry whose stem is at least as long.  That entry matches
+// every path the shadowed one does, including an example path built from
+// its automaton, so its stem is one of the prefixes of the example, which
+// are looked up in the entries sorted by stem.  Candidates whose literal
+// text is not in the example, or that do not match it, are ruled out
+// before the rest are compared as automata.
+
+struct indexed_fc {
+	const struct policy_node *node;
+	const char *filename;
+	// Position of the entry in the policy
+	unsigned int seq;
+	// How fc_sort sees the path
+	int meta;
+	unsigned int stem_len;
+	unsigned int str_len;
+	// For entries with metacharacters, the stem with escapes removed
+	char *stem;
+	struct fc_regex *re;
+	char *example;
+	enum fc_repeat repeat;
+	const struct indexed_fc *repeated;
+	const struct indexed_fc *shadowing;
+};
+
+static struct indexed_fc *entries = NULL;
+static unsigned int entry_count = 0;
+// The entries sorted by node, for lookups
+static struct indexed_fc **by_node = NULL;
+
+// Fill in the lengths fc_sort sorts by, and the stem
+static int fill_sort_data(struct indexed_fc *entry)
+{
+	const char *path = entry->node->data.fc_data->path;
+	size_t len = strlen(path);
+
+	entry->stem = malloc(len + 1);
+	if (!entry->stem) {
+		return 0;
+	}
+
+	for (size_t i = 0; i < len; i++) {
+		switch (path[i]) {
+		case '.':
+		case '^':
+		case '$':
+		case '?':
+		case '*':
+		case '+':
+		case '|':
+		case '[':
+		case '(':
+		case '{':
+			if (!entry->meta) {
+				entry->meta = 1;
+				entry->stem_len = entry->str_len;
+			}
+			break;
+		case '\\':
+			if (i + 1 < len) {
+				i++;
+			}
+			// Fall through
+		default:
+			if (!entry->meta) {
+				entry->stem[entry->str_len] = path[i];
+			}
+			entry->str_len++;
+			break;
+		}
+	}
+	if (!entry->meta) {
+		entry->stem_len = entry->str_len;
+	}
+	entry->stem[entry->stem_len] = '\0';
+
+	return 1;
+}
+
+static int compare_specificity(const struct indexed_fc *a, const struct indexed_fc *b)
+{
+	char a_obj = a->node->data.fc_data->obj;
+	char b_obj = b->node->data.fc_data->obj;
+
+	if (a->meta != b->meta) {
+		return a->meta ? -1 : 1;
+	}
+	if (a->stem_len != b->stem_len) {
+		return a->stem_len < b->stem_len ? -1 : 1;
+	}
+	if (a->str_len != b->str_len) {
+		return a->str_len < b->str_len ? -1 : 1;
+	}
+	if ((a_obj == '\0') != (b_obj == '\0')) {
+		return a_obj == '\0' ? -1 : 1;
+	}
+
+	return 0;
+}
+
+// Whether other applies instead of entry to paths both match.  fc_sort keeps
+// equally specific entries in order, and the last match wins.
+static int takes_precedence(const struct indexed_fc *other, const struct indexed_fc *entry)
+{
+	int cmp = compare_specificity(other, entry);
+
+	return cmp > 0 || (cmp == 0 && other->seq > entry->seq);
+}
+
+static int same_string(const char *a, const char *b)
+{
+	if (!a || !b) {
+		return a == b;
+	}
+
+	return 0 == strcmp(a, b);
+}
+
+static int same_context(const struct sel_context *a, const struct sel_context *b)
+{
+	if (!a || !b) {
+		return a == b;
+	}
+
+	return same_string(a->user, b->user) &&
+	       same_string(a->role, b->role) &&
+	       same_string(a->type, b->type) &&
+	       same_string(a->range, b->range);
+}
+
+// Whether one condition is the negation of the other
+static int negates(const char *a, const char *b)
+{
+	if ((a[0] == '!') == (b[0] == '!')) {
+		return 0;
+	}
+
+	return 0 == strcmp(a[0] == '!' ? a + 1 : a, b[0] == '!' ? b + 1 : b);
+}
+
+// Whether the entries are in branches of ifdef or ifndef blocks that are
+// never both taken, so that they are never loaded together
+static int in_exclusive_branches(const struct fc_entry *a, const struct fc_entry *b)
+{
+	for (const struct string_list *cond = a->conditions; cond; cond = cond->next) {
+		for (const struct string_list *other = b->conditions; other; other = other->next) {
+			if (negates(cond->string, other->string)) {
+				return 1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+static int compare_by_path(const void *a, const void *b)
+{
+	const struct indexed_fc *entry_a = *(struct indexed_fc * const *)a;
+	const struct indexed_fc *entry_b = *(struct indexed_fc * const *)b;
+	int cmp = strcmp(entry_a->node->data.fc_data->path, entry_b->node->data.fc_data->path);
+
+	if (cmp != 0) {
+		return cmp;
+	}
+
+	return entry_a->seq < entry_b->seq ? -1 : entry_a->seq > entry_b->seq;
+}
+
+static int compare_by_stem(const void *a, const void *b)
+{
+	const struct indexed_fc *entry_a = *(struct indexed_fc * const *)a;
+	const struct indexed_fc *entry_b = *(struct indexed_fc * const *)b;
+	int cmp = strcmp(entry_a->stem, entry_b->stem);
+
+	if (cmp != 0) {
+		return cmp;
+	}
+
+	return entry_a->seq < entry_b->seq ? -1 : entry_a->seq > entry_b->seq;
+}
+
+static int compare_by_node(const void *a, const void *b)
+{
+	uintptr_t node_a = (uintptr_t)(*(struct indexed_fc * const *)a)->node;
+	uintptr_t node_b = (uintptr_t)(*(struct indexed_fc * const *)b)->node;
+
+	return node_a < node_b ? -1 : node_a > node_b;
+}
+
+// Find the entries repeating an earlier one, in a run of entries with the
+// same path sorted in policy order
+static void find_repeats(struct indexed_fc **run, unsigned int count)
+{
+	for (unsigned int i = 1; i < count; i++) {
+		const struct fc_entry *fc = run[i]->node->data.fc_data;
+
+		for (unsigned int j = 0; j < i; j++) {
+			const struct fc_entry *earlier = run[j]->node->data.fc_data;
+
+			if ((fc->obj != earlier->obj && fc->obj != '\0' && earlier->obj != '\0') ||
+			    in_exclusive_branches(fc, earlier)) {
+				continue;
+			}
+			if (!same_context(fc->context, earlier->context)) {
+				run[i]->repeat = FC_CONFLICT;
+				run[i]->repeated = run[j];
+				break;
+			}
+			if (run[i]->repeat == FC_NOT_REPEATED) {
+				run[i]->repeat = FC_DUPLICATE;
+				run[i]->repeated = run[j];
+			}
+		}
+	}
+}
+
+struct shadow_search {
+	struct indexed_fc **by_stem;
+	unsigned int count;
+};
+
+static void compile_entry(void *ctx, unsigned int item)
+{
+	struct indexed_fc *entry = ((struct shadow_search *)ctx)->by_stem[item];
+
+	entry->re = compile_fc_regex(entry->node->data.fc_data->path);
+	if (entry->re) {
+		entry->example = fc_regex_example(entry->re);
+	}
+}
+
+// Whether other shadows entry
+static int shadows(const struct indexed_fc *other, const struct indexed_fc *entry)
+{
+	char obj = entry->node->data.fc_data->obj;
+	char other_obj = other->node->data.fc_data->obj;
+
+	if (other == entry || !other->re || !takes_precedence(other, entry) ||
+	    (other_obj != '\0' && other_obj != obj) ||
+	    !strstr(entry->example, fc_regex_literal(other->re)) ||
+	    in_exclusive_branches(other->node->data.fc_data, entry->node->data.fc_data) ||
+	    // Same paths are repeats rather than shadows
+	    0 == strcmp(other->node->data.fc_data->path, entry->node->data.fc_data->path)) {
+		return 0;
+	}
+
+	return fc_regex_matches(other->re, entry->example) &&
+	       fc_regex_includes(other->re, entry->re, FC_INCLUSION_STATE_LIMIT) == 1;
+}
+
+// Compare a stem with the first len characters of key
+static int compare_stem(const char *stem, const char *key, size_t len)
+{
+	int cmp = strncmp(stem, key, len);
+
+	if (cmp != 0) {
+		return cmp;
+	}
+
+	// The stem has at least len characters, as the key has no NUL in them
+	return stem[len] != '\0';
+}
+
+static void find_shadow(void *ctx, unsigned int item)
+{
+	const struct shadow_search *search = ctx;
+	struct indexed_fc *entry = search->by_stem[item];
+
+	if (!entry->re || !entry->example) {
+		return;
+	}
+
+	// A shadowing entry matches the example, so its stem is a prefix of the
+	// example at least as long as the stem of the entry
+	size_t example_len = strlen(entry->example);
+	for (size_t len = entry->stem_len; len <= example_len; len++) {
+		unsigned int low = 0, high = search->count;
+		while (low < high) {
+			unsigned int mid = low + (high - low) / 2;
+			if (compare_stem(search->by_stem[mid]->stem, entry->example, len) < 0) {
+				low = mid + 1;
+			} else {
+				high = mid;
+			}
+		}
+		for (unsigned int i = low;
+		     i < search->count &&
+		     0 == compare_stem(search->by_stem[i]->stem, entry->example, len);
+		     i++) {
+			if (shadows(search->by_stem[i], entry)) {
+				entry->shadowing = search->by_stem[i];
+				return;
+			}
+		}
+	}
+}
+
+static enum selint_error find_all_shadows(void)
+{
+	struct shadow_search search;
+
+	search.count = 0;
+	search.by_stem = malloc(entry_count * sizeof(struct indexed_fc *));
+	if (!search.by_stem) {
+		return SELINT_OUT_OF_MEM;
+	}
+	for (unsigned int i = 0; i < entry_count; i++) {
+		if (entries[i].meta) {
+			search.by_stem[search.count++] = &entries[i];
+		}
+	}
+	qsort(search.by_stem, search.count, sizeof(struct indexed_fc *), compare_by_stem);
+
+	run_in_parallel(search.count, compile_entry, &search);
+	run_in_parallel(search.count, find_shadow, &search);
+
+	free(search.by_stem);
+	return SELINT_SUCCESS;
+}
+
+enum selint_error build_fc_conflict_index(const struct policy_file_list *files,
+                                          int find_shadows)
+{
+	free_fc_conflict_index();
+
+	unsigned int count = 0;
+	for (const struct policy_file_node *file = files->head; file; file = file->next) {
+		for (const struct policy_node *node = file->file->ast; node; node = dfs_next(node)) {
+			if (node->flavor == NODE_FC_ENTRY && node->data.fc_data) {
+				count++;
+			}
+		}
+	}
+	if (count == 0) {
+		return SELINT_SUCCESS;
+	}
+
+	entries = calloc(count, sizeof(struct indexed_fc));
+	by_node = malloc(count * sizeof(struct indexed_fc *));
+	if (!entries || !by_node) {
+		free_fc_conflict_index();
+		return SELINT_OUT_OF_MEM;
+	}
+
+	for (const struct policy_file_node *file = files->head; file; file = file->next) {
+		const char *filename = strrchr(file->file->filename, '/');
+		filename = filename ? filename + 1 : file->file->filename;
+
+		for (const struct policy_node *node = file->file->ast; node; node = dfs_next(node)) {
+			if (node->flavor != NODE_FC_ENTRY || !node->data.fc_data) {
+				continue;
+			}
+			struct indexed_fc *entry = &entries[entry_count];
+			entry->node = node;
+			entry->filename = filename;
+			entry->seq = entry_count++;
+			by_node[entry->seq] = entry;
+			if (!fill_sort_data(entry)) {
+				free_fc_conflict_index();
+				return SELINT_OUT_OF_MEM;
+			}
+		}
+	}
+
+	// by_node is used to sort by path before it is sorted by node
+	qsort(by_node, entry_count, sizeof(struct indexed_fc *), compare_by_path);
+	for (unsigned int start = 0, end; start < entry_count; start = end) {
+		const char *path = by_node[start]->node->data.fc_data->path;
+		for (end = start + 1;
+		     end < entry_count && 0 == strcmp(by_node[end]->node->data.fc_data->path, path);
+		     end++) {
+		}
+		find_repeats(by_node + start, end - start);
+	}
+	qsort(by_node, entry_count, sizeof(struct indexed_fc *), compare_by_node);
+
+	if (find_shadows && SELINT_SUCCESS != find_all_shadows()) {
+		free_fc_conflict_index();
+		return SELINT_OUT_OF_MEM;
+	}
+
+	return SELINT_SUCCESS;
+}
+
+static const struct indexed_fc *find_entry(const struct policy_node *node)
+{
+	struct indexed_fc key;
+	const struct indexed_fc *key_ptr = &key;
+
+	if (entry_count == 0) {
+		return NULL;
+	}
+	key.node = node;
+	struct indexed_fc **found = bsearch(&key_ptr, by_node, entry_count,
+	                                    sizeof(struct indexed_fc *), compare_by_node);
+
+	return found ? *found : NULL;
+}
+
+enum fc_repeat find_repeated_file_context(const struct policy_node *node,
+                                          const char **filename,
+                                          unsigned int *lineno)
+{
+	const struct indexed_fc *entry = find_entry(node);
+
+	if (!entry || entry->repeat == FC_NOT_REPEATED) {
+		return FC_NOT_REPEATED;
+	}
+	*filename = entry->repeated->filename;
+	*lineno = entry->repeated->node->lineno;
+
+	return entry->repeat;
+}
+
+int find_shadowing_file_context(const struct policy_node *node,
+                                const char **filename, unsigned int *lineno)
+{
+	const struct indexed_fc *entry = find_entry(node);
+
+	if (!entry || !entry->shadowing) {
+		return 0;
+	}
+	*filename = entry->shadowing->filename;
+	*lineno = entry->shadowing->node->lineno;
+
+	return 1;
+}
+
+void free_fc_conflict_index(void)
+{
+	for (unsigned int i = 0; i < entry_count; i++) {
+		free(entries[i].stem);
+		free_fc_regex(entries[i].re);
+		free(entries[i].example);
+	}
+	free(entries);
+	free(by_node);
+	entries = NULL;
+	by_node = NULL;
+	entry_count = 0;
+}
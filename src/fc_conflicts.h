@@ -0,0 +1,74 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef FC_CONFLICTS_H
+#define FC_CONFLICTS_H
+
+#include "file_list.h"
+#include "selint_error.h"
+#include "tree.h"
+
+enum fc_repeat {
+	FC_NOT_REPEATED = 0,
+	FC_DUPLICATE,   // An earlier entry has the same path and context
+	FC_CONFLICT     // An earlier entry has the same path and another context
+};
+
+/*********************************************
+* Index the entries of a list of fc files, replacing any previous index.
+* Entries are compared the way they are once the files are sorted with
+* fc_sort and loaded: of the entries matching a path, the most specific one
+* applies, and of equally specific ones the last.  Entries with the same
+* path regex repeat each other if their object types are the same or one of
+* them has none.  Entries in branches of ifdef or ifndef blocks that exclude
+* each other are never compared.  Otherwise, an entry is shadowed if another entry matches
+* every path it does, for its object type, and takes precedence over it.
+* Candidates for shadowing an entry are the entries whose literal prefix
+* extends its own, and only those matching an example path of the entry are
+* compared as automata.  Entries with regexes fc_automaton.h cannot compile
+* are never shadowed.
+* files - The fc files to index, in the order they are built in
+* find_shadows - Whether to look for shadowed entries
+* returns SELINT_SUCCESS or SELINT_OUT_OF_MEM
+*********************************************/
+enum selint_error build_fc_conflict_index(const struct policy_file_list *files,
+                                          int find_shadows);
+
+/*********************************************
+* Find an earlier entry with the same path regex as an fc entry.  An
+* earlier entry with another context is preferred.
+* node - The NODE_FC_ENTRY node to check
+* filename - Set to the name of the file the earlier entry is in
+* lineno - Set to the line the earlier entry is on
+* returns whether and how the entry repeats an earlier one
+*********************************************/
+enum fc_repeat find_repeated_file_context(const struct policy_node *node,
+                                          const char **filename,
+                                          unsigned int *lineno);
+
+/*********************************************
+* Find an entry that shadows an fc entry, so that the entry never applies
+* node - The NODE_FC_ENTRY node to check
+* filename - Set to the name of the file the shadowing entry is in
+* lineno - Set to the line the shadowing entry is on
+* returns 1 if a shadowing entry was found, and 0 otherwise
+*********************************************/
+int find_shadowing_file_context(const struct policy_node *node,
+                                const char **filename, unsigned int *lineno);
+
+void free_fc_conflict_index(void);
+
+#endif
@@ -0,0 +1,212 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "file_loader.h"
+
+struct loaded_file {
+	char *data;
+	size_t size;
+	int ready;
+};
+
+struct file_loader {
+	pthread_t thread;
+	int threaded;
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+	// Files are read into slots[index % depth]
+	struct loaded_file *slots;
+	unsigned int depth;
+	const struct policy_file_node *files;
+	// The next file to return, and its index
+	const struct policy_file_node *next_file;
+	size_t returned;
+	int stop;
+};
+
+char *read_file_for_lexing(const char *filename, size_t *size)
+{
+	int fd = open(filename, O_RDONLY);
+
+	if (fd < 0) {
+		return NULL;
+	}
+
+	struct stat st;
+	size_t cap = 4096;
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+		// One extra byte, so that reading up to EOF does not need to grow
+		cap = (size_t)st.st_size + 3;
+	}
+
+	char *buf = malloc(cap);
+	size_t len = 0;
+	while (buf) {
+		if (cap - len < 3) {
+			char *grown = realloc(buf, cap * 2);
+			if (!grown) {
+				free(buf);
+				buf = NULL;
+				break;
+			}
+			buf = grown;
+			cap *= 2;
+		}
+		ssize_t count = read(fd, buf + len, cap - len - 2);
+		if (count > 0) {
+			len += (size_t)count;
+		} else if (count == 0) {
+			break;
+		} else if (errno != EINTR) {
+			free(buf);
+			buf = NULL;
+		}
+	}
+	close(fd);
+
+	if (!buf) {
+		return NULL;
+	}
+
+	buf[len] = '\0';
+	buf[len + 1] = '\0';
+	*size = len + 2;
+
+	return buf;
+}
+
+static void *read_files(void *arg)
+{
+	struct file_loader *loader = arg;
+	size_t index = 0;
+
+	for (const struct policy_file_node *cur = loader->files; cur; cur = cur->next) {
+		pthread_mutex_lock(&loader->lock);
+		while (!loader->stop && index - loader->returned >= loader->depth) {
+			pthread_cond_wait(&loader->changed, &loader->lock);
+		}
+		int stop = loader->stop;
+		pthread_mutex_unlock(&loader->lock);
+
+		if (stop) {
+			break;
+		}
+
+		size_t size = 0;
+		char *data = read_file_for_lexing(cur->file->filename, &size);
+
+		pthread_mutex_lock(&loader->lock);
+		struct loaded_file *slot = &loader->slots[index % loader->depth];
+		slot->data = data;
+		slot->size = size;
+		slot->ready = 1;
+		pthread_cond_broadcast(&loader->changed);
+		pthread_mutex_unlock(&loader->lock);
+
+		index++;
+	}
+
+	return NULL;
+}
+
+struct file_loader *start_file_loader(const struct policy_file_list *files,
+                                      unsigned int depth)
+{
+	struct file_loader *loader = calloc(1, sizeof(struct file_loader));
+
+	if (!loader) {
+		return NULL;
+	}
+
+	loader->depth = depth ? depth : 1;
+	loader->slots = calloc(loader->depth, sizeof(struct loaded_file));
+	if (!loader->slots) {
+		free(loader);
+		return NULL;
+	}
+	loader->files = loader->next_file = files->head;
+
+	pthread_mutex_init(&loader->lock, NULL);
+	pthread_cond_init(&loader->changed, NULL);
+
+	if (files->head &&
+	    0 == pthread_create(&loader->thread, NULL, read_files, loader)) {
+		loader->threaded = 1;
+	}
+
+	return loader;
+}
+
+char *file_loader_next(struct file_loader *loader, size_t *size)
+{
+	if (!loader->next_file) {
+		return NULL;
+	}
+
+	const struct policy_file_node *cur = loader->next_file;
+	loader->next_file = cur->next;
+
+	if (!loader->threaded) {
+		loader->returned++;
+		return read_file_for_lexing(cur->file->filename, size);
+	}
+
+	pthread_mutex_lock(&loader->lock);
+	struct loaded_file *slot = &loader->slots[loader->returned % loader->depth];
+	while (!slot->ready) {
+		pthread_cond_wait(&loader->changed, &loader->lock);
+	}
+	char *data = slot->data;
+	*size = slot->size;
+	slot->data = NULL;
+	slot->ready = 0;
+	loader->returned++;
+	pthread_cond_broadcast(&loader->changed);
+	pthread_mutex_unlock(&loader->lock);
+
+	return data;
+}
+
+void stop_file_loader(struct file_loader *loader)
+{
+	if (!loader) {
+		return;
+	}
+
+	if (loader->threaded) {
+		pthread_mutex_lock(&loader->lock);
+		loader->stop = 1;
+		pthread_cond_broadcast(&loader->changed);
+		pthread_mutex_unlock(&loader->lock);
+		pthread_join(loader->thread, NULL);
+	}
+
+	for (unsigned int i = 0; i < loader->depth; i++) {
+		free(loader->slots[i].data);
+	}
+
+	pthread_cond_destroy(&loader->changed);
+	pthread_mutex_destroy(&loader->lock);
+	free(loader->slots);
+	free(loader);
+}
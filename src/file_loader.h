@@ -0,0 +1,68 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef FILE_LOADER_H
+#define FILE_LOADER_H
+
+#include <stddef.h>
+
+#include "file_list.h"
+
+// Number of files read ahead of the parser
+#define FILE_LOADER_DEPTH 8
+
+// Reads the files of a list in the background, in list order, so that
+// waiting for file I/O overlaps with parsing the files already read
+struct file_loader;
+
+/*********************************************
+* Read a whole file into a buffer followed by the two NUL bytes the lexer
+* needs to scan it in place
+* filename - The file to read
+* size - Set to the size of the returned buffer, including the NUL bytes
+* returns the buffer, to be freed by the caller, or NULL if the file could
+* not be read
+*********************************************/
+char *read_file_for_lexing(const char *filename, size_t *size);
+
+/*********************************************
+* Start reading the files in a list ahead of their use.  The list must not
+* change until the loader is stopped.
+* files - The files to read
+* depth - The maximum number of files read but not yet returned
+* returns the loader, or NULL on allocation failure.  If no background
+* thread can be started, files are read when they are requested instead.
+*********************************************/
+struct file_loader *start_file_loader(const struct policy_file_list *files,
+                                      unsigned int depth);
+
+/*********************************************
+* Get the contents of the next file in the list, as read by
+* read_file_for_lexing(), waiting for it to be read if needed
+* loader - The loader to get the file from
+* size - Set to the size of the returned buffer
+* returns the buffer, to be freed by the caller, or NULL if the file could
+* not be read or all files have already been returned
+*********************************************/
+char *file_loader_next(struct file_loader *loader, size_t *size);
+
+/*********************************************
+* Stop a loader and free it, along with any files read but not returned
+* loader - The loader to stop
+*********************************************/
+void stop_file_loader(struct file_loader *loader);
+
+#endif
@@ -0,0 +1,198 @@
+#!/bin/sh
+
+# Copyright 2020 Tresys Technology, LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#    http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Generate the keyword hash tables used by keywords.c from keywords.gperf.
+# The hash has the form gperf generates for --key-positions=1,5,$: the length
+# of the word plus a value for its first, fifth (if any) and last characters.
+# The values are found with a seeded search, so the output only depends on
+# the input.
+#
+# Usage: gen_keywords.sh keywords.gperf > keywords_table.h
+
+set -e
+
+if [ -z "$1" ]; then
+	echo "Usage: $0 keywords.gperf" >&2
+	exit 64
+fi
+
+LC_ALL=C awk '
+BEGIN {
+	for (i = 0; i < 256; i++) {
+		ord[sprintf("%c", i)] = i
+	}
+	seed = 20200101
+}
+function next_random(limit) {
+	# Park-Miller, exact in the doubles awk computes with
+	seed = (seed * 16807) % 2147483647
+	return seed % limit
+}
+function hash(w,    h) {
+	h = len[w] + value[first[w]] + value[last[w]]
+	if (len[w] > 4) {
+		h += value[fifth[w]]
+	}
+	return h
+}
+function collisions(    w, h, seen, total) {
+	total = 0
+	for (w = 1; w <= count; w++) {
+		h = hash(w)
+		total += seen[h]++
+	}
+	return total
+}
+function max_value(    w, h, m) {
+	m = 0
+	for (w = 1; w <= count; w++) {
+		h = hash(w)
+		if (h > m) {
+			m = h
+		}
+	}
+	return m
+}
+/^%%/ {
+	section++
+	next
+}
+section == 1 && NF == 2 {
+	count++
+	sub(/,$/, "", $1)
+	name[count] = $1
+	token[count] = $2
+	len[count] = length($1)
+	first[count] = ord[substr($1, 1, 1)]
+	fifth[count] = ord[substr($1, 5, 1)]
+	last[count] = ord[substr($1, len[count], 1)]
+	used[first[count]] = 1
+	used[last[count]] = 1
+	if (len[count] > 4) {
+		used[fifth[count]] = 1
+	}
+	if (!min_len || len[count] < min_len) {
+		min_len = len[count]
+	}
+	if (len[count] > max_len) {
+		max_len = len[count]
+	}
+}
+END {
+	if (count == 0) {
+		print "No keywords found" > "/dev/stderr"
+		exit 1
+	}
+
+	# Change the value of a character of a colliding keyword until no two
+	# keywords hash alike, widening the range of values if that stalls
+	range = count
+	current = collisions()
+	stalled = 0
+	while (current > 0) {
+		w = next_random(count) + 1
+		h = hash(w)
+		clash = 0
+		for (o = 1; o <= count; o++) {
+			if (o != w && hash(o) == h) {
+				clash = 1
+				break
+			}
+		}
+		if (!clash) {
+			continue
+		}
+		pick = next_random(len[w] > 4 ? 3 : 2)
+		c = (pick == 0) ? first[w] : (pick == 1) ? last[w] : fifth[w]
+		old = value[c]
+		value[c] = next_random(range)
+		now = collisions()
+		if (now <= current) {
+			if (now < current) {
+				stalled = 0
+			}
+			current = now
+		} else {
+			value[c] = old
+		}
+		if (++stalled > 20000) {
+			range++
+			stalled = 0
+		}
+	}
+
+	# Then make the table smaller where that keeps the hash perfect
+	best = max_value()
+	for (n = 0; n < 50000; n++) {
+		w = next_random(count) + 1
+		pick = next_random(len[w] > 4 ? 3 : 2)
+		c = (pick == 0) ? first[w] : (pick == 1) ? last[w] : fifth[w]
+		old = value[c]
+		value[c] = next_random(range)
+		if (collisions() > 0 || max_value() > best) {
+			value[c] = old
+		} else {
+			best = max_value()
+		}
+	}
+
+	max_hash = 0
+	for (w = 1; w <= count; w++) {
+		h = hash(w)
+		slot[h] = w
+		if (h > max_hash) {
+			max_hash = h
+		}
+	}
+	if (max_hash + 1 > 255) {
+		print "Keyword hash values do not fit in a byte" > "/dev/stderr"
+		exit 1
+	}
+
+	print "// Generated by gen_keywords.sh from keywords.gperf, do not edit"
+	print ""
+	print "#define MIN_KEYWORD_LENGTH " min_len
+	print "#define MAX_KEYWORD_LENGTH " max_len
+	print "#define MAX_KEYWORD_HASH " max_hash
+	print ""
+	print "// Characters that are in none of the hashed positions of any keyword are"
+	print "// given a value past the end of the table, so that most identifiers are"
+	print "// rejected without a string comparison."
+	print "static const unsigned char keyword_char_values[256] = {"
+	for (i = 0; i < 256; i++) {
+		v = (i in used) ? value[i] + 0 : max_hash + 1
+		line = line sprintf("%s%3d,", (i % 16) ? " " : "\t", v)
+		if (i % 16 == 15) {
+			print line
+			line = ""
+		}
+	}
+	print "};"
+	print ""
+	print "struct keyword {"
+	print "\tconst char *name;"
+	print "\tint token;"
+	print "};"
+	print ""
+	print "static const struct keyword keywords[MAX_KEYWORD_HASH + 1] = {"
+	for (h = 0; h <= max_hash; h++) {
+		if (h in slot) {
+			printf "\t[%d] = { \"%s\", %s },\n", h, name[slot[h]], token[slot[h]]
+		}
+	}
+	print "};"
+}
+' "$1"
@@ -0,0 +1,379 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <uthash.h>
+
+#include "header_index.h"
+#include "file_loader.h"
+#include "parallel.h"
+#include "maps.h"
+
+// Definitions are found by a scan of the text, and only the requested ones
+// are handed to the parser.  The text of every indexed file is kept until
+// free_header_index(), since requesting a definition scans it for callees.
+
+struct header_def {
+	char *name;
+	unsigned int file;
+	size_t offset;
+	size_t length;
+	int requested;
+	// Further definitions of the same name, in file order
+	struct header_def *next;
+	UT_hash_handle hh;
+};
+
+struct header_text {
+	char *data;
+	size_t size;
+	struct header_def *defs;
+	unsigned int def_count;
+	enum selint_error res;
+};
+
+static struct header_def *defs_by_name = NULL;
+static struct header_text *texts = NULL;
+static unsigned int text_count = 0;
+static unsigned int requested_count = 0;
+
+static int is_name_char(char c)
+{
+	return isalnum((unsigned char)c) || c == '_';
+}
+
+static int starts_with(const char *text, const char *end, const char *prefix)
+{
+	size_t len = strlen(prefix);
+
+	return (size_t)(end - text) >= len && 0 == strncmp(text, prefix, len);
+}
+
+// Get the length of the name of a definition starting at line, or 0 if no
+// definition starts there
+static size_t definition_name_length(const char *line, const char *end)
+{
+	const char *name;
+
+	if (starts_with(line, end, "interface(`")) {
+		name = line + strlen("interface(`");
+	} else if (starts_with(line, end, "template(`")) {
+		name = line + strlen("template(`");
+	} else {
+		return 0;
+	}
+
+	const char *name_end = name;
+	while (name_end < end && is_name_char(*name_end)) {
+		name_end++;
+	}
+	if (name_end == end || *name_end != '\'') {
+		return 0;
+	}
+
+	return (size_t)(name_end - name);
+}
+
+static const char *next_line(const char *line, const char *end)
+{
+	const char *newline = memchr(line, '\n', (size_t)(end - line));
+
+	return newline ? newline + 1 : end;
+}
+
+static enum selint_error add_definition(struct header_text *text, unsigned int file,
+                                        const char *start, size_t name_length,
+                                        const char *def_end, unsigned int *cap)
+{
+	if (text->def_count == *cap) {
+		*cap = *cap ? *cap * 2 : 16;
+		struct header_def *grown = realloc(text->defs, *cap * sizeof(struct header_def));
+		if (!grown) {
+			return SELINT_OUT_OF_MEM;
+		}
+		text->defs = grown;
+	}
+
+	struct header_def *def = &text->defs[text->def_count];
+	memset(def, 0, sizeof(struct header_def));
+	const char *name = strchr(start, '`') + 1;
+	def->name = strndup(name, name_length);
+	if (!def->name) {
+		return SELINT_OUT_OF_MEM;
+	}
+	def->file = file;
+	def->offset = (size_t)(start - text->data);
+	def->length = (size_t)(def_end - start);
+	text->def_count++;
+
+	return SELINT_SUCCESS;
+}
+
+static void scan_file(void *ctx, unsigned int item)
+{
+	const struct policy_file_node **files = ctx;
+	struct header_text *text = &texts[item];
+	unsigned int cap = 0;
+
+	text->data = read_file_for_lexing(files[item]->file->filename, &text->size);
+	if (!text->data) {
+		text->size = 0;
+		return;
+	}
+
+	// The buffer ends in two NULs, which are not part of the text
+	const char *end = text->data + text->size - 2;
+	const char *line = text->data;
+	while (line < end) {
+		size_t name_length = definition_name_length(line, end);
+		if (!name_length) {
+			line = next_line(line, end);
+			continue;
+		}
+
+		const char *start = line;
+		line = next_line(line, end);
+		while (line < end && !definition_name_length(line, end)) {
+			int closes = starts_with(line, end, "')");
+			line = next_line(line, end);
+			if (closes) {
+				break;
+			}
+		}
+
+		text->res = add_definition(text, item, start, name_length, line, &cap);
+		if (text->res != SELINT_SUCCESS) {
+			return;
+		}
+	}
+}
+
+enum selint_error index_header_files(const struct policy_file_list *files)
+{
+	free_header_index();
+
+	unsigned int count = 0;
+	for (const struct policy_file_node *file = files->head; file; file = file->next) {
+		count++;
+	}
+	if (count == 0) {
+		return SELINT_SUCCESS;
+	}
+
+	const struct policy_file_node **by_index = malloc(count * sizeof(struct policy_file_node *));
+	texts = calloc(count, sizeof(struct header_text));
+	if (!by_index || !texts) {
+		free(by_index);
+		free(texts);
+		texts = NULL;
+		return SELINT_OUT_OF_MEM;
+	}
+	text_count = count;
+	count = 0;
+	for (const struct policy_file_node *file = files->head; file; file = file->next) {
+		by_index[count++] = file;
+	}
+
+	run_in_parallel(text_count, scan_file, by_index);
+	free(by_index);
+
+	for (unsigned int i = 0; i < text_count; i++) {
+		if (texts[i].res != SELINT_SUCCESS) {
+			free_header_index();
+			return SELINT_OUT_OF_MEM;
+		}
+		for (unsigned int j = 0; j < texts[i].def_count; j++) {
+			struct header_def *def = &texts[i].defs[j];
+			struct header_def *first;
+			HASH_FIND(hh, defs_by_name, def->name, strlen(def->name), first);
+			if (!first) {
+				HASH_ADD_KEYPTR(hh, defs_by_name, def->name, strlen(def->name), def);
+				continue;
+			}
+			while (first->next) {
+				first = first->next;
+			}
+			first->next = def;
+		}
+	}
+
+	return SELINT_SUCCESS;
+}
+
+// Call fn(ctx, name) for every name followed by ( in the text
+static enum selint_error for_each_call(const char *text, size_t size,
+                                       enum selint_error (*fn)(void *ctx, const char *name),
+                                       void *ctx)
+{
+	char name[256];
+	size_t i = 0;
+
+	while (i < size) {
+		if (!is_name_char(text[i])) {
+			i++;
+			continue;
+		}
+		size_t start = i;
+		while (i < size && is_name_char(text[i])) {
+			i++;
+		}
+		size_t length = i - start;
+		if (i == size || text[i] != '(' || length >= sizeof(name)) {
+			continue;
+		}
+		memcpy(name, text + start, length);
+		name[length] = '\0';
+		enum selint_error res = fn(ctx, name);
+		if (res != SELINT_SUCCESS) {
+			return res;
+		}
+	}
+
+	return SELINT_SUCCESS;
+}
+
+struct request_stack {
+	struct header_def **defs;
+	unsigned int count;
+	unsigned int cap;
+};
+
+// Mark the definitions of name as requested, and push them so that their
+// callees are requested in turn
+static enum selint_error push_definitions(void *ctx, const char *name)
+{
+	struct request_stack *stack = ctx;
+	struct header_def *def;
+
+	HASH_FIND(hh, defs_by_name, name, strlen(name), def);
+	if (!def || def->requested || look_up_in_ifs_map(name)) {
+		return SELINT_SUCCESS;
+	}
+
+	for (; def; def = def->next) {
+		if (stack->count == stack->cap) {
+			stack->cap = stack->cap ? stack->cap * 2 : 64;
+			struct header_def **grown = realloc(stack->defs,
+			                                    stack->cap * sizeof(struct header_def *));
+			if (!grown) {
+				return SELINT_OUT_OF_MEM;
+			}
+			stack->defs = grown;
+		}
+		def->requested = 1;
+		requested_count++;
+		stack->defs[stack->count++] = def;
+	}
+
+	return SELINT_SUCCESS;
+}
+
+// Scan the definitions on the stack for callees until none are left
+static enum selint_error request_callees(struct request_stack *stack, enum selint_error res)
+{
+	while (res == SELINT_SUCCESS && stack->count > 0) {
+		const struct header_def *def = stack->defs[--stack->count];
+		res = for_each_call(texts[def->file].data + def->offset, def->length,
+		                    push_definitions, stack);
+	}
+
+	free(stack->defs);
+	return res;
+}
+
+enum selint_error request_header_definition(const char *name)
+{
+	struct request_stack stack = { NULL, 0, 0 };
+
+	return request_callees(&stack, push_definitions(&stack, name));
+}
+
+enum selint_error request_header_definitions_in_file(const char *filename)
+{
+	size_t size = 0;
+	char *text = read_file_for_lexing(filename, &size);
+
+	if (!text) {
+		return SELINT_IO_ERROR;
+	}
+
+	struct request_stack stack = { NULL, 0, 0 };
+	enum selint_error res = for_each_call(text, size - 2, push_definitions, &stack);
+	free(text);
+	res = request_callees(&stack, res);
+
+	return res;
+}
+
+char *read_requested_definitions(unsigned int index, size_t *size)
+{
+	if (index >= text_count || !texts[index].data) {
+		return NULL;
+	}
+
+	const struct header_text *text = &texts[index];
+	char *buf = NULL;
+	for (unsigned int i = 0; i < text->def_count; i++) {
+		const struct header_def *def = &text->defs[i];
+		if (!def->requested) {
+			continue;
+		}
+		if (!buf) {
+			// Everything but the line breaks is blanked out, then the
+			// requested definitions are copied back in
+			buf = malloc(text->size);
+			if (!buf) {
+				return NULL;
+			}
+			for (size_t j = 0; j < text->size; j++) {
+				char c = text->data[j];
+				buf[j] = (c == '\n' || c == '\0') ? c : ' ';
+			}
+		}
+		memcpy(buf + def->offset, text->data + def->offset, def->length);
+	}
+
+	if (buf) {
+		*size = text->size;
+	}
+	return buf;
+}
+
+unsigned int requested_definition_count(void)
+{
+	return requested_count;
+}
+
+void free_header_index(void)
+{
+	struct header_def *def, *tmp;
+	HASH_ITER(hh, defs_by_name, def, tmp) {
+		HASH_DEL(defs_by_name, def);
+	}
+	for (unsigned int i = 0; i < text_count; i++) {
+		for (unsigned int j = 0; j < texts[i].def_count; j++) {
+			free(texts[i].defs[j].name);
+		}
+		free(texts[i].defs);
+		free(texts[i].data);
+	}
+	free(texts);
+	texts = NULL;
+	text_count = 0;
+	requested_count = 0;
+}
@@ -0,0 +1,73 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef HEADER_INDEX_H
+#define HEADER_INDEX_H
+
+#include <stddef.h>
+
+#include "file_list.h"
+#include "selint_error.h"
+
+/*********************************************
+* Index where the interfaces and templates of a list of devel header files
+* are defined, without parsing the files, replacing any previous index.  A
+* definition starts on a line beginning with interface(` or template(` and
+* ends after the next line beginning with '), or where the next definition
+* starts.  Files that cannot be read are skipped.
+* files - The header files to index
+* returns SELINT_SUCCESS or SELINT_OUT_OF_MEM
+*********************************************/
+enum selint_error index_header_files(const struct policy_file_list *files);
+
+/*********************************************
+* Request the indexed definition of an interface or template, along with
+* the indexed definitions of every name followed by ( in its text, and in
+* theirs.  Names that are not indexed, or that the ifs or template maps
+* already hold, are ignored.
+* name - The interface or template to request
+* returns SELINT_SUCCESS or SELINT_OUT_OF_MEM
+*********************************************/
+enum selint_error request_header_definition(const char *name);
+
+/*********************************************
+* Request the indexed definitions of every name followed by ( in a policy
+* file, as request_header_definition() does
+* filename - The file to scan
+* returns SELINT_SUCCESS, SELINT_IO_ERROR if the file cannot be read, or
+* SELINT_OUT_OF_MEM
+*********************************************/
+enum selint_error request_header_definitions_in_file(const char *filename);
+
+/*********************************************
+* Get the text of the requested definitions in one of the indexed files,
+* with the rest of the file blanked out so that line numbers are kept
+* index - The position of the file in the list passed to index_header_files()
+* size - Set to the size of the returned buffer
+* returns a buffer as read_file_for_lexing() would return it, to be freed
+* by the caller, or NULL if no definition in the file was requested or
+* memory could not be allocated
+*********************************************/
+char *read_requested_definitions(unsigned int index, size_t *size);
+
+/*********************************************
+* Get the number of definitions requested so far
+*********************************************/
+unsigned int requested_definition_count(void);
+
+void free_header_index(void);
+
+#endif
@@ -17,10 +17,12 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
+#include <uthash.h>
 
 #include "if_checks.h"
 #include "tree.h"
 #include "maps.h"
+#include "references.h"
 
 #define NOT_REQ_MESSAGE "%s %s is used in interface but not required"
 
@@ -44,6 +46,103 @@ struct check_result *check_interface_definitions_have_comment(__attribute__((unu
 	}
 }
 
+struct name_elem {
+	// Points into the AST
+	const char *name;
+	UT_hash_handle hh;
+};
+
+// The names required and used in the interface or template last checked.
+// W-002 and W-003 are called on every node of a definition in turn, so the
+// body is only scanned once per definition.
+static const struct policy_node *names_def = NULL;
+static struct name_elem *required_names = NULL;
+static struct name_elem *used_names = NULL;
+
+static int add_name(struct name_elem **set, const char *name)
+{
+	struct name_elem *elem;
+
+	HASH_FIND_STR(*set, name, elem);
+	if (elem) {
+		return 1;
+	}
+	elem = malloc(sizeof(struct name_elem));
+	if (!elem) {
+		return 0;
+	}
+	elem->name = name;
+	HASH_ADD_KEYPTR(hh, *set, elem->name, strlen(elem->name), elem);
+	return 1;
+}
+
+static int has_name(const struct name_elem *set, const char *name)
+{
+	const struct name_elem *elem;
+
+	HASH_FIND_STR(set, name, elem);
+	return elem != NULL;
+}
+
+static void free_name_set(struct name_elem **set)
+{
+	struct name_elem *cur, *tmp;
+
+	HASH_ITER(hh, *set, cur, tmp) {
+		HASH_DEL(*set, cur);
+		free(cur);
+	}
+}
+
+void free_interface_names(void)
+{
+	free_name_set(&required_names);
+	free_name_set(&used_names);
+	names_def = NULL;
+}
+
+// Add the names of node and the nodes after it, and their children, to the
+// required or used set.  Require blocks can be nested, for example in an
+// ifdef.
+static int collect_names(const struct policy_node *node, int in_require)
+{
+	for (; node; node = node->next) {
+		struct type_iter it;
+		const char *name;
+		type_iter_init(&it, node);
+		while (type_iter_next(&it, &name, NULL)) {
+			if (!add_name(in_require ? &required_names : &used_names, name)) {
+				return 0;
+			}
+		}
+
+		if (node->first_child &&
+		    !collect_names(node->first_child,
+		                   in_require || node->flavor == NODE_GEN_REQ ||
+		                   node->flavor == NODE_REQUIRE)) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+// Make the name sets hold the names of def.  Returns 0 if out of memory.
+static int load_interface_names(const struct policy_node *def)
+{
+	if (def == names_def) {
+		return 1;
+	}
+
+	free_interface_names();
+	if (!collect_names(def->first_child, 0)) {
+		free_interface_names();
+		return 0;
+	}
+	names_def = def;
+	return 1;
+}
+
 struct check_result *check_type_used_but_not_required_in_if(__attribute__((unused)) const struct
                                                             check_data *data,
                                                             const struct
@@ -51,10 +150,11 @@ struct check_result *check_type_used_but_not_required_in_if(__attribute__((unuse
 {
 
 	const struct policy_node *cur = node;
+	struct type_iter it;
+	const char *type;
 
-	struct string_list *types_in_current_node = get_types_in_node(node);
-
-	if (!types_in_current_node) {
+	type_iter_init(&it, node);
+	if (!type_iter_next(&it, &type, NULL)) {
 		return NULL;
 	}
 
@@ -66,77 +166,45 @@ struct check_result *check_type_used_but_not_required_in_if(__attribute__((unuse
 	}
 
 	if (!cur) {
-		free_string_list(types_in_current_node);
 		return NULL;
 	}
 	// In a template or interface, and cur is a pointer to the definition node
-
-	cur = cur->first_child;
-
-	struct string_list *types_required = NULL;
-	struct string_list *types_required_tail = NULL;
-
-	while (cur && cur != node) {
-	       if (cur->flavor == NODE_GEN_REQ
-	           || cur->flavor == NODE_REQUIRE) {
-			if (!types_required) {
-				types_required = get_types_required(cur);
-				types_required_tail = types_required;
-			} else {
-				types_required_tail->next = get_types_required(cur);
-			}
-			while (types_required_tail && types_required_tail->next) {
-				types_required_tail = types_required_tail->next;
-			}
-		}
-
-		cur = dfs_next(cur); // The normal case is that the gen_require block
-		                     // is at the top level, but it could be nested,
-		                     // for example in an ifdef
+	if (!load_interface_names(cur)) {
+		return alloc_internal_error("Out of memory collecting required names");
 	}
 
-	struct string_list *type_node = types_in_current_node;
 	const char *flavor = NULL;
 
-	while (type_node) {
-		if (!str_in_sl(type_node->string, types_required)) {
-			if (0 == strcmp(type_node->string, "system_r")) {
+	type_iter_init(&it, node);
+	while (type_iter_next(&it, &type, NULL)) {
+		if (!has_name(required_names, type)) {
+			if (0 == strcmp(type, "system_r")) {
 				// system_r is required by default in all modules
 				// so that is an exception that shouldn't be warned
 				// about.
-				type_node = type_node->next;
 				continue;
 			}
-			if (look_up_in_decl_map(type_node->string, DECL_TYPE)) {
+			if (look_up_in_decl_map(type, DECL_TYPE)) {
 				flavor = "Type";
 			} else
 			if (look_up_in_decl_map
-			            (type_node->string, DECL_ATTRIBUTE)) {
+			            (type, DECL_ATTRIBUTE)) {
 				flavor = "Attribute";
 			} else
 			if (look_up_in_decl_map
-			            (type_node->string, DECL_ROLE)) {
+			            (type, DECL_ROLE)) {
 				flavor = "Role";
 			} else {
 				// This is a string we don't recognize.  Other checks and/or
 				// the compiler catch invalid bare words
-				type_node = type_node->next;
 				continue;
 			}
 
-			struct check_result *res =
-				make_check_result('W', W_ID_NO_REQ, NOT_REQ_MESSAGE,
-				                  flavor, type_node->string);
-			free_string_list(types_in_current_node);
-			free_string_list(types_required);
-			return res;
+			return make_check_result('W', W_ID_NO_REQ, NOT_REQ_MESSAGE,
+			                         flavor, type);
 		}
-		type_node = type_node->next;
 	}
 
-	free_string_list(types_in_current_node);
-	free_string_list(types_required);
-
 	return NULL;
 }
 
@@ -176,64 +244,43 @@ struct check_result *check_type_required_but_not_used_in_if(__attribute__((unuse
 		return NULL;
 	}
 
-	struct string_list *types_to_check = get_types_in_node(node);
-	if (!types_to_check) {
+	struct type_iter it;
+	const char *type;
+
+	type_iter_init(&it, node);
+	if (!type_iter_next(&it, &type, NULL)) {
 		// This should never happen
 		return alloc_internal_error(
 			"Declaration with no declared items");
 	}
 
-	cur = req_block_node;
-
-	cur = cur->next;
-
-	struct string_list *sl_end = NULL;
-	struct string_list *sl_head = NULL;
-
-	int depth = 0;
-
-	while (cur) {
-		struct string_list *types_used = get_types_in_node(cur);
-		if (types_used) {
-			if (!sl_head) {
-				sl_head = sl_end = types_used;
-			} else {
-				sl_end->next = types_used;
-			}
-
-			while (sl_end->next) {
-				sl_end = sl_end->next;
-			}
-		}
-
-		if (cur->first_child) {
-			cur = cur->first_child;
-			depth++;
-		} else if (!cur->next && depth > 0 && cur->parent) {
-			cur = cur->parent->next;
-			depth--;
-		} else {
-			cur = cur->next;
-		}
+	if (!load_interface_names(cur)) {
+		return alloc_internal_error("Out of memory collecting used names");
 	}
 
-	struct string_list *type_node = types_to_check;
+	do {
+		if (!has_name(used_names, type)) {
+			return make_check_result('W',
+			                         W_ID_UNUSED_REQ,
+			                         "%s %s is listed in require block but not used in interface",
+			                         flavor,
+			                         type);
+		}
+	} while (type_iter_next(&it, &type, NULL));
 
-	struct check_result *res = NULL;
+	return NULL;
+}
 
-	while (type_node) {
-		if (!str_in_sl(type_node->string, sl_head)) {
-			res = make_check_result('W',
-			                        W_ID_UNUSED_REQ,
-			                        "%s %s is listed in require block but not used in interface",
-			                        flavor,
-			                        type_node->string);
-			break;
-		}
-		type_node = type_node->next;
+struct check_result *check_unused_interface(__attribute__((unused)) const struct check_data *data,
+                                            const struct policy_node *node)
+{
+	if (count_references(node->data.str) != 0) {
+		// Called, or not counted
+		return NULL;
 	}
 
-	free_string_list(sl_head);
-	free_string_list(types_to_check);
-	return res;
+	return make_check_result('S', S_ID_UNUSED_IF,
+	                         "%s %s is never called",
+	                         node->flavor == NODE_TEMP_DEF ? "Template" : "Interface",
+	                         node->data.str);
 }
@@ -35,7 +35,9 @@ struct check_result *check_interface_definitions_have_comment(const struct
 /*********************************************
 * Check that all types referenced in interface are listed in its require block
 * (or declared in that template)
-* Called on NODE_AV_RULE, NODE_TT_RULE and NODE_IF_CALL nodes.
+* Called on NODE_AV_RULE, NODE_TT_RULE and NODE_IF_CALL nodes.  The names
+* required and used in the enclosing definition are collected once and kept
+* until another definition is checked or free_interface_names() is called.
 * data - metadata about the file
 * node - the node to check
 * returns NULL if passed or check_result for issue W-002
@@ -47,7 +49,7 @@ struct check_result *check_type_used_but_not_required_in_if(const struct
 
 /*********************************************
 * Check that all types listed in require block are actually used in the interface
-* Called on NODE_DECL nodes
+* Called on NODE_DECL nodes.  Shares the names collected for W-002.
 * data - metadata about the file
 * node - the node to check
 * returns NULL if passed or check_result for issue W-003
@@ -57,4 +59,21 @@ struct check_result *check_type_required_but_not_used_in_if(const struct
                                                             const struct
                                                             policy_node *node);
 
+/*********************************************
+* Free the names collected by W-002 and W-003.  Must be called before the
+* AST they were collected from is freed.
+*********************************************/
+void free_interface_names(void);
+
+/*********************************************
+* Check for interfaces and templates that are never called in the policy.
+* build_reference_counts() must have been run on all the policy files.
+* Called on NODE_INTERFACE_DEF and NODE_TEMP_DEF nodes.
+* data - metadata about the file
+* node - the node to check
+* returns NULL if passed or check_result for issue S-005
+*********************************************/
+struct check_result *check_unused_interface(const struct check_data *data,
+                                            const struct policy_node *node);
+
 #endif
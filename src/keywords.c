@@ -0,0 +1,52 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <string.h>
+
+#include "keywords.h"
+#include "tree.h"
+#include "parse.h"
+
+// The keywords are found with a perfect hash of the same form gperf generates
+// for --key-positions=1,5,$: the length of the word plus a value for its
+// first, fifth (if any) and last characters.  The tables are generated from
+// keywords.gperf by gen_keywords.sh.
+#include "keywords_table.h"
+
+int lookup_keyword(const char *str, size_t len)
+{
+	if (len < MIN_KEYWORD_LENGTH || len > MAX_KEYWORD_LENGTH) {
+		return 0;
+	}
+
+	unsigned int hash = (unsigned int)len;
+	if (len > 4) {
+		hash += keyword_char_values[(unsigned char)str[4]];
+	}
+	hash += keyword_char_values[(unsigned char)str[0]];
+	hash += keyword_char_values[(unsigned char)str[len - 1]];
+
+	if (hash > MAX_KEYWORD_HASH) {
+		return 0;
+	}
+
+	const struct keyword *kw = &keywords[hash];
+	if (kw->name && 0 == strncmp(kw->name, str, len) && kw->name[len] == '\0') {
+		return kw->token;
+	}
+
+	return 0;
+}
@@ -0,0 +1,31 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef KEYWORDS_H
+#define KEYWORDS_H
+
+#include <stddef.h>
+
+/*********************************************
+* Look up a policy language keyword.  The lexer matches keywords with its
+* identifier rule and classifies them here.
+* str - The identifier, which does not need to be NUL terminated
+* len - The length of the identifier
+* returns the parser token of the keyword, or 0 if str is not a keyword
+*********************************************/
+int lookup_keyword(const char *str, size_t len);
+
+#endif
@@ -0,0 +1,84 @@
+// Generated by gen_keywords.sh from keywords.gperf, do not edit
+
+#define MIN_KEYWORD_LENGTH 2
+#define MAX_KEYWORD_LENGTH 16
+#define MAX_KEYWORD_HASH 80
+
+// Characters that are in none of the hashed positions of any keyword are
+// given a value past the end of the table, so that most identifiers are
+// rejected without a string comparison.
+static const unsigned char keyword_char_values[256] = {
+	 81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,
+	 81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,
+	 81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,
+	 81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,
+	 81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,
+	 81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  13,
+	 81,   2,   5,   9,  32,   8,  15,  20,  81,   2,  81,  26,   1,   9,  21,  10,
+	 42,  81,  11,   0,  31,   0,  81,   2,  81,  26,  81,  81,  81,  81,  81,  81,
+	 81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,
+	 81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,
+	 81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,
+	 81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,
+	 81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,
+	 81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,
+	 81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,
+	 81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,  81,
+};
+
+struct keyword {
+	const char *name;
+	int token;
+};
+
+static const struct keyword keywords[MAX_KEYWORD_HASH + 1] = {
+	[7] = { "alias", ALIAS },
+	[10] = { "bool", BOOL },
+	[11] = { "allow", ALLOW },
+	[14] = { "class", CLASS },
+	[16] = { "ifelse", IFELSE },
+	[19] = { "if", IF },
+	[20] = { "else", ELSE },
+	[21] = { "attribute", ATTRIBUTE },
+	[23] = { "role", ROLE },
+	[24] = { "module", MODULE },
+	[26] = { "attribute_role", ATTRIBUTE_ROLE },
+	[27] = { "fs_use_trans", FS_USE_TRANS },
+	[28] = { "require", REQUIRE },
+	[30] = { "interface", INTERFACE },
+	[31] = { "ifndef", IFNDEF },
+	[34] = { "roleattribute", ROLE_ATTRIBUTE },
+	[35] = { "sid", SID },
+	[36] = { "types", TYPES },
+	[37] = { "ifdef", IFDEF },
+	[38] = { "fs_use_xattr", FS_USE_XATTR },
+	[39] = { "gen_user", GEN_USER },
+	[42] = { "typealias", TYPEALIAS },
+	[43] = { "type", TYPE },
+	[44] = { "neverallow", NEVER_ALLOW },
+	[45] = { "auditallow", AUDIT_ALLOW },
+	[46] = { "typebounds", TYPEBOUNDS },
+	[48] = { "template", TEMPLATE },
+	[49] = { "genfscon", GENFSCON },
+	[50] = { "gen_require", GEN_REQUIRE },
+	[52] = { "fs_use_task", FS_USE_TASK },
+	[54] = { "typeattribute", TYPE_ATTRIBUTE },
+	[55] = { "refpolicywarn", REFPOLICYWARN },
+	[56] = { "range_transition", RANGE_TRANSITION },
+	[58] = { "nodecon", NODECON },
+	[60] = { "role_transition", ROLE_TRANSITION },
+	[61] = { "optional_policy", OPTIONAL_POLICY },
+	[62] = { "permissive", PERMISSIVE },
+	[63] = { "type_change", TYPE_CHANGE },
+	[65] = { "netifcon", NETIFCON },
+	[66] = { "type_member", TYPE_MEMBER },
+	[67] = { "define", DEFINE },
+	[68] = { "userdebug_or_eng", USERDEBUG_OR_ENG },
+	[70] = { "gen_tunable", GEN_TUNABLE },
+	[71] = { "gen_context", GEN_CONTEXT },
+	[72] = { "policy_module", POLICY_MODULE },
+	[74] = { "dontaudit", DONT_AUDIT },
+	[76] = { "tunable_policy", TUNABLE_POLICY },
+	[79] = { "portcon", PORTCON },
+	[80] = { "type_transition", TYPE_TRANSITION },
+};
@@ -14,11 +14,11 @@
 * limitations under the License.
 */
 
+#include <errno.h>
 #include <stdio.h>
 #include <getopt.h>
 #include <sys/types.h>
 #include <sys/stat.h>
-#include <fts.h>
 #include <unistd.h>
 #include <sysexits.h>
 
@@ -26,9 +26,13 @@
 #include "parse.h"
 #include "config.h"
 #include "file_list.h"
+#include "discover.h"
 #include "util.h"
 #include "selint_config.h"
 #include "startup.h"
+#include "parallel.h"
+#include "output.h"
+#include "xref.h"
 
 extern int yydebug;
 
@@ -36,6 +40,144 @@ extern int yylex_destroy(void);
 
 extern int verbose_flag;
 
+// Long options without a short equivalent
+enum {
+	XREF_BUILD_OPTION = 256,
+	XREF_QUERY_OPTION,
+	NO_AV_CACHE_OPTION
+};
+
+// Policy files found in the paths given on the command line
+struct discovered_policy {
+	struct policy_file_list *te_files;
+	struct policy_file_list *if_files;
+	struct policy_file_list *fc_files;
+	char *modules_conf_path;
+	char *security_classes_path;
+	char *access_vectors_path;
+	int source_flag;
+};
+
+static void add_discovered_file(const struct discovered_file *file, void *ctx)
+{
+	struct discovered_policy *policy = ctx;
+	size_t name_len = strlen(file->name);
+	const char *suffix = name_len >= 3 ? file->name + name_len - 3 : "";
+
+	if (file->is_dir) {
+		print_if_verbose("Skipping %s which is not a policy file\n", file->path);
+	} else if (!strcmp(suffix, ".te")) {
+		file_list_push_back(policy->te_files,
+		                    make_policy_file(file->path, NULL));
+	} else if (!strcmp(suffix, ".if")) {
+		file_list_push_back(policy->if_files,
+		                    make_policy_file(file->path, NULL));
+		char *mod_name = strndup(file->name, name_len - 3);
+		insert_into_mod_layers_map(mod_name, file->parent_name);
+		free(mod_name);
+	} else if (!strcmp(suffix, ".fc")) {
+		file_list_push_back(policy->fc_files,
+		                    make_policy_file(file->path, NULL));
+	} else if (policy->source_flag && !strcmp(file->name, "modules.conf")) {
+		// TODO: Make modules.conf name configurable
+		free(policy->modules_conf_path);
+		policy->modules_conf_path = strdup(file->path);
+	} else if (policy->source_flag && !strcmp(file->name, "security_classes")) {
+		free(policy->security_classes_path);
+		policy->security_classes_path = strdup(file->path);
+	} else if (policy->source_flag && !strcmp(file->name, "access_vectors")) {
+		free(policy->access_vectors_path);
+		policy->access_vectors_path = strdup(file->path);
+	} else {
+		print_if_verbose("Skipping %s which is not a policy file\n", file->path);
+	}
+}
+
+// Create a directory and any of its parents that are missing, as mkdir -p
+// does.  Returns 0 on success.
+static int make_dirs(char *path, mode_t mode)
+{
+	for (char *sep = strchr(path + 1, '/'); sep; sep = strchr(sep + 1, '/')) {
+		*sep = '\0';
+		int failed = mkdir(path, mode) != 0 && errno != EEXIST;
+		*sep = '/';
+		if (failed) {
+			return -1;
+		}
+	}
+
+	return mkdir(path, mode) != 0 && errno != EEXIST ? -1 : 0;
+}
+
+// Get the path of the access vector cache, under $XDG_CACHE_HOME or
+// ~/.cache, creating its directory if needed.  Returns NULL if there is
+// nowhere to keep it.
+static char *get_av_cache_path(void)
+{
+	const char *cache_home = getenv("XDG_CACHE_HOME");
+	const char *home = getenv("HOME");
+	char *dir;
+
+	if (cache_home && cache_home[0] == '/') {
+		dir = malloc(strlen(cache_home) + sizeof("/selint"));
+		if (!dir) {
+			return NULL;
+		}
+		strcpy(dir, cache_home);
+	} else if (home && home[0] == '/') {
+		dir = malloc(strlen(home) + sizeof("/.cache/selint"));
+		if (!dir) {
+			return NULL;
+		}
+		strcpy(dir, home);
+		strcat(dir, "/.cache");
+	} else {
+		return NULL;
+	}
+	strcat(dir, "/selint");
+	if (make_dirs(dir, 0700) != 0) {
+		free(dir);
+		return NULL;
+	}
+
+	char *path = malloc(strlen(dir) + sizeof("/access_vectors"));
+	if (path) {
+		strcpy(path, dir);
+		strcat(path, "/access_vectors");
+	}
+	free(dir);
+
+	return path;
+}
+
+static void print_xref_site(const struct xref_site *site, __attribute__((unused)) void *ctx)
+{
+	printf("%s:%u: %s (%s)\n", site->filename, site->lineno,
+	       xref_kind_name(site->kind), xref_site_description(site));
+}
+
+// Returns the exit code
+static int run_xref_query(const char *db_path, const char *name)
+{
+	struct xref_db *db;
+
+	enum selint_error res = open_xref_db(db_path, &db);
+	if (res == SELINT_IO_ERROR) {
+		printf("Failed to read cross-reference index %s\n", db_path);
+		return EX_NOINPUT;
+	} else if (res != SELINT_SUCCESS) {
+		printf("%s is not a valid cross-reference index\n", db_path);
+		return EX_DATAERR;
+	}
+
+	if (0 == query_xref_db(db, name, print_xref_site, NULL)) {
+		printf("No references to %s found\n", name);
+	}
+
+	close_xref_db(db);
+	return EX_OK;
+}
+
 static void usage(void)
 {
 
@@ -49,7 +191,11 @@ static void usage(void)
 		"  -e CHECKID, --enable=CHECKID\t\tEnable check with the given ID.\n"\
 		"  -E, --only-enabled\t\t\tOnly run checks that are explicitly enabled with\n"\
 		"\t\t\t\t\tthe --enable option.\n"\
+		"  -F FORMAT, --format=FORMAT\t\tOutput format for findings: text (default),\n"\
+		"\t\t\t\t\tjson (one object per line) or sarif.\n"\
 		"  -h, --help\t\t\t\tDisplay this menu\n"\
+		"  -j JOBS, --jobs=JOBS\t\t\tNumber of threads used for work that can run\n"\
+		"\t\t\t\t\tin parallel.  Defaults to one per CPU.\n"\
 		"  -l LEVEL, --level=LEVEL\t\tOnly list errors with a severity level at or\n"\
 		"\t\t\t\t\tgreater than LEVEL.  Options are C (convention), S (style),\n"\
 		"\t\t\t\t\tW (warning), E (error), F (fatal error).\n"\
@@ -58,7 +204,14 @@ static void usage(void)
 		"  -S, --summary\t\t\t\tDisplay a summary of issues found after running the analysis\n"\
 		"  -r, --recursive\t\t\tScan recursively and check all SELinux policy files found.\n"\
 		"  -v, --verbose\t\t\t\tEnable verbose output\n"\
-		"  -V, --version\t\t\t\tShow version information and exit.\n"
+		"  -V, --version\t\t\t\tShow version information and exit.\n"\
+		"      --no-av-cache\t\t\tRead classes and permissions from selinuxfs\n"\
+		"\t\t\t\t\twithout caching them under ~/.cache/selint.\n"\
+		"      --xref-build=DBFILE\t\tWrite a cross-reference index of the symbols\n"\
+		"\t\t\t\t\tin the given files to DBFILE instead of\n"\
+		"\t\t\t\t\tchecking them.\n"\
+		"      --xref-query=NAME\t\tList where NAME is declared, required and used,\n"\
+		"\t\t\t\t\tusing the index given in place of FILE.\n"
 );
 	/* *INDENT-ON* */
 
@@ -79,6 +232,9 @@ int main(int argc, char **argv)
 	int only_enabled = 0;
 	int exit_code = EX_OK;
 	int summary_flag = 0;
+	const char *xref_db_path = NULL;
+	const char *xref_query_name = NULL;
+	int av_cache_flag = 1;
 
 	struct string_list *config_disabled_checks = NULL;
 	struct string_list *config_enabled_checks = NULL;
@@ -97,14 +253,19 @@ int main(int argc, char **argv)
 			{ "disable",      required_argument, NULL,          'd' },
 			{ "enable",       required_argument, NULL,          'e' },
 			{ "only-enabled", no_argument,       NULL,          'E' },
+			{ "format",       required_argument, NULL,          'F' },
 			{ "help",         no_argument,       NULL,          'h' },
+			{ "jobs",         required_argument, NULL,          'j' },
 			{ "level",        required_argument, NULL,          'l' },
 			{ "modules-conf", required_argument, NULL,          'm' },
+			{ "no-av-cache",  no_argument,       NULL,          NO_AV_CACHE_OPTION },
 			{ "recursive",    no_argument,       NULL,          'r' },
 			{ "source",       no_argument,       NULL,          's' },
 			{ "summary",      no_argument,       NULL,          'S' },
 			{ "version",      no_argument,       NULL,          'V' },
 			{ "verbose",      no_argument,       &verbose_flag, 1   },
+			{ "xref-build",   required_argument, NULL,          XREF_BUILD_OPTION },
+			{ "xref-query",   required_argument, NULL,          XREF_QUERY_OPTION },
 			{ 0,              0,                 0,             0   }
 		};
 
@@ -112,7 +273,7 @@ int main(int argc, char **argv)
 
 		int c = getopt_long(argc,
 		                    argv,
-		                    "c:d:e:Ehl:mrsSVv",
+		                    "c:d:e:EF:hj:l:mrsSVv",
 		                    long_options,
 		                    &option_index);
 
@@ -133,7 +294,6 @@ int main(int argc, char **argv)
 
 		case 'd':
 			// Disable a given check
-			WARN_ON_INVALID_CHECK_ID(optarg, "disabled on command line");
 			if (cl_d_cursor) {
 				cl_d_cursor->next =
 					calloc(1, sizeof(struct string_list));
@@ -148,7 +308,6 @@ int main(int argc, char **argv)
 
 		case 'e':
 			// Enable a given check
-			WARN_ON_INVALID_CHECK_ID(optarg, "enabled on command line");
 			if (cl_e_cursor) {
 				cl_e_cursor->next =
 					calloc(1, sizeof(struct string_list));
@@ -166,11 +325,33 @@ int main(int argc, char **argv)
 			only_enabled = 1;
 			break;
 
+		case 'F':
+			// Select the output format
+			if (SELINT_SUCCESS != output_set_format(optarg)) {
+				printf("Invalid output format: %s\n", optarg);
+				usage();
+				exit(EX_USAGE);
+			}
+			break;
+
 		case 'h':
 			// Display usage info and exit
 			usage();
 			exit(0);
 
+		case 'j': {
+			// Set the number of threads
+			char *end;
+			unsigned long jobs = strtoul(optarg, &end, 10);
+			if (*optarg == '\0' || *end != '\0' || jobs == 0 || jobs > 1024) {
+				printf("Invalid number of jobs: %s\n", optarg);
+				usage();
+				exit(EX_USAGE);
+			}
+			set_parallel_jobs((unsigned int)jobs);
+			break;
+		}
+
 		case 'l':
 			// Set the severity level
 			severity = optarg[0];
@@ -206,6 +387,21 @@ int main(int argc, char **argv)
 			verbose_flag = 1;
 			break;
 
+		case XREF_BUILD_OPTION:
+			// Write a cross-reference index instead of checking
+			xref_db_path = optarg;
+			break;
+
+		case XREF_QUERY_OPTION:
+			// Look a name up in a cross-reference index
+			xref_query_name = optarg;
+			break;
+
+		case NO_AV_CACHE_OPTION:
+			// Do not read or write the access vector cache
+			av_cache_flag = 0;
+			break;
+
 		case '?':
 			usage();
 			exit(EX_USAGE);
@@ -213,6 +409,33 @@ int main(int argc, char **argv)
 
 	}
 
+	if (output_get_format() != OUTPUT_FORMAT_TEXT) {
+		// Keep stdout machine readable
+		if (SELINT_SUCCESS != output_redirect_messages()) {
+			printf("Failed to redirect messages to stderr\n");
+			exit(EX_OSERR);
+		}
+	}
+
+	if (xref_query_name) {
+		if (xref_db_path || optind + 1 != argc) {
+			usage();
+			exit(EX_USAGE);
+		}
+		exit(run_xref_query(argv[optind], xref_query_name));
+	}
+
+	struct string_list *cl_check_id = cl_disabled_checks;
+	while (cl_check_id) {
+		WARN_ON_INVALID_CHECK_ID(cl_check_id->string, "disabled on command line");
+		cl_check_id = cl_check_id->next;
+	}
+	cl_check_id = cl_enabled_checks;
+	while (cl_check_id) {
+		WARN_ON_INVALID_CHECK_ID(cl_check_id->string, "enabled on command line");
+		cl_check_id = cl_check_id->next;
+	}
+
 	print_if_verbose("Verbose mode enabled\n");
 
 	if (source_flag) {
@@ -285,52 +508,45 @@ int main(int argc, char **argv)
 
 	paths[i] = NULL;
 
-	FTS *ftsp = fts_open(paths, FTS_PHYSICAL | FTS_NOSTAT, NULL);
-
-	FTSENT *file = fts_read(ftsp);
-
-	char *modules_conf_path = NULL;
-
-	while (file) {
-
-		char *suffix = file->fts_path + file->fts_pathlen - 3;
-
-		if (!strcmp(suffix, ".te")) {
-			file_list_push_back(te_files,
-			                    make_policy_file(file->fts_path,
-			                                     NULL));
-		} else if (!strcmp(suffix, ".if")) {
-			file_list_push_back(if_files,
-			                    make_policy_file(file->fts_path,
-			                                     NULL));
-			char *mod_name = strdup(file->fts_name);
-			mod_name[file->fts_namelen - 3] = '\0';
-			insert_into_mod_layers_map(mod_name, file->fts_parent->fts_name);
-			free(mod_name);
-		} else if (!strcmp(suffix, ".fc")) {
-			file_list_push_back(fc_files,
-			                    make_policy_file(file->fts_path,
-			                                     NULL));
-		} else if (source_flag
-		           && !strcmp(file->fts_name, "modules.conf")) {
-			// TODO: Make modules.conf name configurable
-			modules_conf_path = strdup(file->fts_path);
-		} else {
-			print_if_verbose(
-				"Skipping %s which is not a policy file\n",
-				file->fts_path);
-			if (!recursive_scan) {
-				fts_set(ftsp, file, FTS_SKIP);
-			}
-		}
+	struct discovered_policy discovered = { te_files, if_files, fc_files, NULL,
+		                                NULL, NULL, source_flag };
 
-		file = fts_read(ftsp);
+	if (SELINT_SUCCESS != discover_files(paths, recursive_scan,
+	                                     add_discovered_file, &discovered)) {
+		printf("Failed to search for policy files\n");
+		exit(EX_OSERR);
 	}
 
-	fts_close(ftsp);
+	char *modules_conf_path = discovered.modules_conf_path;
 
 	free(paths);
 
+	if (xref_db_path) {
+		free(modules_conf_path);
+		free(discovered.security_classes_path);
+		free(discovered.access_vectors_path);
+
+		enum selint_error res = run_xref_build(te_files, if_files, fc_files, xref_db_path);
+		if (res == SELINT_PARSE_ERROR) {
+			printf("Error during parsing\n");
+			exit_code = EX_SOFTWARE;
+		} else if (res != SELINT_SUCCESS) {
+			printf("Failed to write cross-reference index %s: %d\n", xref_db_path, res);
+			exit_code = EX_CANTCREAT;
+		}
+
+		yylex_destroy();
+		free_file_list(te_files);
+		free_file_list(if_files);
+		free_file_list(fc_files);
+		free_file_list(context_files);
+		free_string_list(config_enabled_checks);
+		free_string_list(config_disabled_checks);
+		free_string_list(cl_enabled_checks);
+		free_string_list(cl_disabled_checks);
+		return exit_code;
+	}
+
 	struct checks *ck = register_checks(severity,
 	                                    config_enabled_checks,
 	                                    config_disabled_checks,
@@ -345,11 +561,23 @@ int main(int argc, char **argv)
 		free_file_list(fc_files);
 		free_file_list(context_files);
 		free(modules_conf_path);
+		free(discovered.security_classes_path);
+		free(discovered.access_vectors_path);
 		return EX_CONFIG;
 	}
 	// Load object classes and permissions
 	if (source_flag) {
-		load_access_vectors_source();
+		if (discovered.security_classes_path && discovered.access_vectors_path) {
+			enum selint_error res =
+				load_access_vectors_source(discovered.security_classes_path,
+				                           discovered.access_vectors_path);
+			if (res != SELINT_SUCCESS) {
+				printf("Error loading access vectors: %d\n", res);
+			} else {
+				print_if_verbose("Loaded access vectors from %s\n",
+				                 discovered.access_vectors_path);
+			}
+		}
 		if (modules_conf_path) {
 			enum selint_error res =
 				load_modules_source(modules_conf_path);
@@ -363,7 +591,11 @@ int main(int argc, char **argv)
 			printf("Failed to locate modules.conf file.\n");
 		}
 	} else {
-		load_access_vectors_normal("/sys/fs/selinux/class");    // TODO
+		char *av_cache_path = av_cache_flag ? get_av_cache_path() : NULL;
+		if (SELINT_SUCCESS != load_access_vectors_cached("/sys/fs/selinux", av_cache_path)) {
+			printf("Error loading access vectors.\n");
+		}
+		free(av_cache_path);
 		load_modules_normal();
 		enum selint_error res = load_devel_headers(context_files);
 		if (res != SELINT_SUCCESS) {
@@ -372,8 +604,12 @@ int main(int argc, char **argv)
 	}
 
 	free(modules_conf_path);
+	free(discovered.security_classes_path);
+	free(discovered.access_vectors_path);
 
+	output_begin();
 	enum selint_error res = run_analysis(ck, te_files, if_files, fc_files, context_files);
+	output_end();
 	switch (res) {
 	case SELINT_SUCCESS:
 		if (summary_flag) {
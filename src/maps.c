@@ -29,6 +29,7 @@ struct bool_hash_elem *transform_map = NULL;
 struct bool_hash_elem *filetrans_map = NULL;
 struct bool_hash_elem *role_if_map = NULL;
 struct template_hash_elem *template_map = NULL;
+struct class_hash_elem *class_perms_map = NULL;
 
 static struct hash_elem *look_up_hash_elem(const char *name, enum decl_flavor flavor)
 {
@@ -362,6 +363,7 @@ static void insert_into_template_map(const char *name, void *new_node,
 		template->name = strdup(name);
 		template->declarations = NULL;
 		template->calls = NULL;
+		template->expanding = 0;
 
 		HASH_ADD_KEYPTR(hh, template_map, template->name,
 		                strlen(template->name), template);
@@ -437,6 +439,122 @@ struct if_call_list *look_up_call_in_template_map(const char *name)
 	}
 }
 
+enum selint_error insert_into_class_perms_map(const char *class_name,
+                                              const char *perm_name,
+                                              int bit)
+{
+	struct class_hash_elem *class_elem = look_up_in_class_perms_map(class_name);
+
+	if (!class_elem) {
+		class_elem = calloc(1, sizeof(struct class_hash_elem));
+		if (!class_elem) {
+			return SELINT_OUT_OF_MEM;
+		}
+		class_elem->name = strdup(class_name);
+		if (!class_elem->name) {
+			free(class_elem);
+			return SELINT_OUT_OF_MEM;
+		}
+		HASH_ADD_KEYPTR(hh, class_perms_map, class_elem->name,
+		                strlen(class_elem->name), class_elem);
+	}
+
+	if (!perm_name) {
+		return SELINT_SUCCESS;
+	}
+
+	int existing = look_up_perm_bit(class_elem, perm_name);
+	if (existing != -1) {
+		// Listed again, possibly by a common the class inherits
+		return (bit == -1 || bit == existing) ? SELINT_SUCCESS : SELINT_BAD_ARG;
+	}
+
+	if (bit == -1) {
+		bit = (int)class_elem->perm_count;
+	}
+	if (bit < 0 || bit >= MAX_CLASS_PERMS || class_elem->perms[bit]) {
+		return SELINT_BAD_ARG;
+	}
+
+	struct perm_hash_elem *perm = malloc(sizeof(struct perm_hash_elem));
+	if (!perm) {
+		return SELINT_OUT_OF_MEM;
+	}
+	perm->name = strdup(perm_name);
+	if (!perm->name) {
+		free(perm);
+		return SELINT_OUT_OF_MEM;
+	}
+	perm->bit = (unsigned int)bit;
+	HASH_ADD_KEYPTR(hh, class_elem->perm_bits, perm->name, strlen(perm->name), perm);
+
+	class_elem->perms[bit] = perm->name;
+	if ((unsigned int)bit >= class_elem->perm_count) {
+		class_elem->perm_count = (unsigned int)bit + 1;
+	}
+
+	return SELINT_SUCCESS;
+}
+
+struct class_hash_elem *look_up_in_class_perms_map(const char *class_name)
+{
+
+	struct class_hash_elem *class_elem;
+
+	HASH_FIND(hh, class_perms_map, class_name, strlen(class_name), class_elem);
+
+	return class_elem;
+}
+
+int look_up_perm_bit(const struct class_hash_elem *class_elem, const char *perm_name)
+{
+
+	struct perm_hash_elem *perm_bits = class_elem->perm_bits;
+	struct perm_hash_elem *perm;
+
+	HASH_FIND(hh, perm_bits, perm_name, strlen(perm_name), perm);
+
+	return perm ? (int)perm->bit : -1;
+}
+
+uint64_t make_perm_mask(const struct class_hash_elem *class_elem,
+                        const struct string_list *perms,
+                        const char **unknown)
+{
+	uint64_t all = 0;
+	uint64_t mask = 0;
+	int complement = 0;
+
+	for (unsigned int i = 0; i < class_elem->perm_count; i++) {
+		if (class_elem->perms[i]) {
+			all |= UINT64_C(1) << i;
+		}
+	}
+
+	*unknown = NULL;
+
+	for (const struct string_list *cur = perms; cur; cur = cur->next) {
+		if (0 == strcmp(cur->string, "~")) {
+			complement = 1;
+		} else if (0 == strcmp(cur->string, "*")) {
+			mask = all;
+		} else {
+			int bit = look_up_perm_bit(class_elem, cur->string);
+			if (bit == -1) {
+				// Names that are no permission at all are usually
+				// permission set macros, which are not expanded
+				if (!*unknown && look_up_in_decl_map(cur->string, DECL_PERM)) {
+					*unknown = cur->string;
+				}
+			} else {
+				mask |= UINT64_C(1) << bit;
+			}
+		}
+	}
+
+	return complement ? all & ~mask : mask;
+}
+
 #define FREE_MAP(mn) HASH_ITER(hh_ ## mn, mn ## _map, cur_decl, tmp_decl) { \
 		HASH_DELETE(hh_ ## mn, mn ## _map, cur_decl); \
 		free(cur_decl->key); \
@@ -490,4 +608,18 @@ void free_all_maps()
 		free_if_call_list(cur_template->calls);
 		free(cur_template);
 	}
+
+	struct class_hash_elem *cur_class, *tmp_class;
+	struct perm_hash_elem *cur_perm, *tmp_perm;
+
+	HASH_ITER(hh, class_perms_map, cur_class, tmp_class) {
+		HASH_DELETE(hh, class_perms_map, cur_class);
+		HASH_ITER(hh, cur_class->perm_bits, cur_perm, tmp_perm) {
+			HASH_DELETE(hh, cur_class->perm_bits, cur_perm);
+			free(cur_perm->name);
+			free(cur_perm);
+		}
+		free(cur_class->name);
+		free(cur_class);
+	}
 }
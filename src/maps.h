@@ -39,6 +39,30 @@ struct template_hash_elem {
 	char *name;
 	struct decl_list *declarations;
 	struct if_call_list *calls;
+	// Set while add_template_declarations() is expanding the template
+	int expanding;
+	UT_hash_handle hh;
+};
+
+// Permission masks are 64 bits wide.  The kernel limits classes to 32
+// permissions, including inherited ones.
+#define MAX_CLASS_PERMS 64
+
+struct perm_hash_elem {
+	char *name;
+	unsigned int bit;
+	UT_hash_handle hh;
+};
+
+// An object class and its permissions.  A set of permissions of the class is
+// a mask with bit (1 << bit) set for each permission.
+struct class_hash_elem {
+	char *name;
+	// Permission names, indexed by bit.  Unused bits are NULL.
+	char *perms[MAX_CLASS_PERMS];
+	// One more than the highest bit in use
+	unsigned int perm_count;
+	struct perm_hash_elem *perm_bits;
 	UT_hash_handle hh;
 };
 
@@ -87,6 +111,27 @@ struct decl_list *look_up_decl_in_template_map(const char *name);
 
 struct if_call_list *look_up_call_in_template_map(const char *name);
 
+// Add a permission to a class, creating the class if needed.  perm_name may be
+// NULL to only create the class, and bit -1 selects the next unused bit.
+// Returns SELINT_BAD_ARG if the bit is out of range or already in use.
+enum selint_error insert_into_class_perms_map(const char *class_name,
+                                              const char *perm_name,
+                                              int bit);
+
+struct class_hash_elem *look_up_in_class_perms_map(const char *class_name);
+
+// Returns the bit of the permission in the class, or -1 if it has no such
+// permission
+int look_up_perm_bit(const struct class_hash_elem *class_elem, const char *perm_name);
+
+// Convert the permissions of an av rule into a mask over the class, applying ~
+// and * within the permissions of the class.  unknown is set to the first
+// permission of some other class that this class does not have, or NULL.
+// Other names, such as permission set macros, are left out of the mask.
+uint64_t make_perm_mask(const struct class_hash_elem *class_elem,
+                        const struct string_list *perms,
+                        const char **unknown);
+
 unsigned int decl_map_count(enum decl_flavor flavor);
 
 void free_all_maps(void);
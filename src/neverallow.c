@@ -0,0 +1,555 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <uthash.h>
+
+#include "neverallow.h"
+#include "maps.h"
+#include "template.h"
+#include "type_index.h"
+
+// Neverallow rules are kept in the form they are written in, as sets of
+// source and target types, object classes and permissions.  An allow rule
+// violates a neverallow rule if the two have a source type, a target type
+// (taking self into account), a class and a permission in common.  That is
+// the same answer as expanding both rules into (source, target, class)
+// permission masks, but each test is a handful of word-parallel ANDs
+// instead of a walk over every expanded tuple.  Permissions of classes in
+// the class table are compared by their bits in the class, and other
+// permissions by name.
+
+#define BITS_PER_WORD 64
+#define WORDS(count) (((count) + BITS_PER_WORD - 1) / BITS_PER_WORD)
+
+struct name_elem {
+	char *name;
+	unsigned int id;
+	UT_hash_handle hh;
+};
+
+// A set of object classes or permissions, over the names used in neverallow
+// rules
+struct name_set {
+	uint64_t *words;
+	// The set holds every name except those in words
+	int complement;
+	// The set holds a name that is in no neverallow rule
+	int has_other;
+};
+
+struct neverallow_rule {
+	const char *filename;
+	unsigned int lineno;
+	const struct av_rule_data *av_data;
+	struct type_set *sources;
+	struct type_set *targets;
+	int target_self;
+	struct name_set classes;
+	struct name_set perms;
+};
+
+static struct name_elem *class_ids = NULL;
+static struct name_elem *perm_ids = NULL;
+static unsigned int class_count = 0;
+static unsigned int perm_count = 0;
+static struct neverallow_rule *rules = NULL;
+static unsigned int rule_count = 0;
+// The allow rules of interfaces and templates, checked where they are called
+static struct def_statements *allow_defs = NULL;
+
+// Space for the allow rule being checked
+static struct type_set *allow_sources = NULL;
+static struct type_set *allow_targets = NULL;
+static struct type_set *common_sources = NULL;
+static struct type_set *excluded_types = NULL;
+static struct name_set allow_classes;
+static struct name_set allow_perms;
+
+static struct name_elem *find_name(struct name_elem *map, const char *name)
+{
+	struct name_elem *elem;
+
+	HASH_FIND(hh, map, name, strlen(name), elem);
+
+	return elem;
+}
+
+static enum selint_error intern_names(struct name_elem **map, unsigned int *count,
+                                      const struct string_list *names)
+{
+	for (const struct string_list *cur = names; cur; cur = cur->next) {
+		if (0 == strcmp(cur->string, "~") || 0 == strcmp(cur->string, "*") ||
+		    find_name(*map, cur->string)) {
+			continue;
+		}
+
+		struct name_elem *elem = malloc(sizeof(struct name_elem));
+		if (!elem) {
+			return SELINT_OUT_OF_MEM;
+		}
+		elem->name = strdup(cur->string);
+		if (!elem->name) {
+			free(elem);
+			return SELINT_OUT_OF_MEM;
+		}
+		elem->id = (*count)++;
+		HASH_ADD_KEYPTR(hh, *map, elem->name, strlen(elem->name), elem);
+	}
+
+	return SELINT_SUCCESS;
+}
+
+static void fill_name_set(struct name_set *set, unsigned int word_count,
+                          struct name_elem *map, const struct string_list *names)
+{
+	int all = 0;
+
+	memset(set->words, 0, word_count * sizeof(uint64_t));
+	set->complement = 0;
+	set->has_other = 0;
+
+	for (const struct string_list *cur = names; cur; cur = cur->next) {
+		if (0 == strcmp(cur->string, "~")) {
+			set->complement = 1;
+		} else if (0 == strcmp(cur->string, "*")) {
+			all = 1;
+		} else {
+			const struct name_elem *elem = find_name(map, cur->string);
+			if (elem) {
+				set->words[elem->id / BITS_PER_WORD] |=
+					UINT64_C(1) << (elem->id % BITS_PER_WORD);
+			} else {
+				set->has_other = 1;
+			}
+		}
+	}
+
+	if (all) {
+		memset(set->words, 0, word_count * sizeof(uint64_t));
+		set->complement = 1;
+		set->has_other = 0;
+	}
+}
+
+static int name_sets_intersect(const struct name_set *a, const struct name_set *b,
+                               unsigned int word_count)
+{
+	if (a->complement && b->complement) {
+		// Neither can hold every name there is
+		return 1;
+	}
+	if (a->complement) {
+		const struct name_set *tmp = a;
+		a = b;
+		b = tmp;
+	}
+
+	uint64_t found = 0;
+	if (!b->complement) {
+		// Names in no neverallow rule cannot be in both
+		for (unsigned int i = 0; i < word_count; i++) {
+			found |= a->words[i] & b->words[i];
+		}
+	} else {
+		if (a->has_other) {
+			return 1;
+		}
+		for (unsigned int i = 0; i < word_count; i++) {
+			found |= a->words[i] & ~b->words[i];
+		}
+	}
+
+	return found != 0;
+}
+
+static int name_set_has(const struct name_set *set, struct name_elem *map,
+                        const char *name)
+{
+	const struct name_elem *elem = find_name(map, name);
+	if (!elem) {
+		return set->complement;
+	}
+
+	int has = (set->words[elem->id / BITS_PER_WORD] >> (elem->id % BITS_PER_WORD)) & 1;
+
+	return set->complement ? !has : has;
+}
+
+// Whether a list of permissions names one that is not a permission of the
+// class, such as a permission set macro
+static int has_unresolved_perm(const struct class_hash_elem *class_elem,
+                               const struct string_list *perms)
+{
+	for (const struct string_list *cur = perms; cur; cur = cur->next) {
+		if (0 != strcmp(cur->string, "~") && 0 != strcmp(cur->string, "*") &&
+		    look_up_perm_bit(class_elem, cur->string) == -1) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+// Check whether an allow rule and a neverallow rule have a permission of a
+// class in common.  allow_classes and allow_perms must hold the allow rule.
+static int perms_intersect(const struct av_rule_data *allow,
+                           const struct neverallow_rule *rule)
+{
+	if (!name_sets_intersect(&allow_classes, &rule->classes, WORDS(class_count))) {
+		return 0;
+	}
+
+	int by_name = 0;
+	for (const struct string_list *cur = allow->object_classes; cur; cur = cur->next) {
+		if (0 == strcmp(cur->string, "~") || 0 == strcmp(cur->string, "*")) {
+			// The classes are not listed
+			by_name = 1;
+			break;
+		}
+		if (!name_set_has(&rule->classes, class_ids, cur->string)) {
+			continue;
+		}
+
+		const struct class_hash_elem *class_elem = look_up_in_class_perms_map(cur->string);
+		if (!class_elem) {
+			by_name = 1;
+			continue;
+		}
+
+		const char *unknown;
+		if (make_perm_mask(class_elem, allow->perms, &unknown) &
+		    make_perm_mask(class_elem, rule->av_data->perms, &unknown)) {
+			return 1;
+		}
+		if (has_unresolved_perm(class_elem, allow->perms) ||
+		    has_unresolved_perm(class_elem, rule->av_data->perms)) {
+			by_name = 1;
+		}
+	}
+
+	return by_name && name_sets_intersect(&allow_perms, &rule->perms, WORDS(perm_count));
+}
+
+// Fill set with the types in names, which may use ~, * and -type.  If self is
+// not NULL, it is set if names include self.
+static void fill_type_set(struct type_set *set, const struct string_list *names,
+                          int *self)
+{
+	int complement = 0;
+	int all = 0;
+	int excluded = 0;
+
+	memset(set->words, 0, set->word_count * sizeof(uint64_t));
+	if (self) {
+		*self = 0;
+	}
+
+	for (const struct string_list *cur = names; cur; cur = cur->next) {
+		if (0 == strcmp(cur->string, "~")) {
+			complement = 1;
+		} else if (0 == strcmp(cur->string, "*")) {
+			all = 1;
+		} else if (cur->string[0] == '-') {
+			excluded = 1;
+		} else if (self && 0 == strcmp(cur->string, "self")) {
+			*self = 1;
+		} else {
+			type_set_add_name(set, cur->string);
+		}
+	}
+
+	if (all) {
+		memset(set->words, 0, set->word_count * sizeof(uint64_t));
+		type_set_complement(set);
+	}
+
+	if (excluded) {
+		memset(excluded_types->words, 0, excluded_types->word_count * sizeof(uint64_t));
+		for (const struct string_list *cur = names; cur; cur = cur->next) {
+			if (cur->string[0] == '-') {
+				type_set_add_name(excluded_types, cur->string + 1);
+			}
+		}
+		type_set_subtract(set, excluded_types);
+	}
+
+	if (complement) {
+		type_set_complement(set);
+	}
+}
+
+static int is_allow_rule(const struct policy_node *node)
+{
+	return node->flavor == NODE_AV_RULE &&
+	       node->data.av_data->flavor == AV_RULE_ALLOW;
+}
+
+static int is_indexed_neverallow(const struct policy_node *node)
+{
+	return node->flavor == NODE_AV_RULE &&
+	       node->data.av_data->flavor == AV_RULE_NEVERALLOW &&
+	       !(node->scope & (SCOPE_INTERFACE | SCOPE_TEMPLATE));
+}
+
+enum selint_error build_neverallow_index(const struct policy_file_list *files,
+                                         const struct policy_file_list *if_files)
+{
+	enum selint_error res = SELINT_SUCCESS;
+
+	free_neverallow_index();
+
+	// Find the names of the classes and permissions in neverallow rules
+	unsigned int count = 0;
+	for (const struct policy_file_node *file = files->head;
+	     file && res == SELINT_SUCCESS;
+	     file = file->next) {
+		for (const struct policy_node *node = file->file->ast;
+		     node && res == SELINT_SUCCESS;
+		     node = dfs_next(node)) {
+			if (is_indexed_neverallow(node)) {
+				count++;
+				res = intern_names(&class_ids, &class_count,
+				                   node->data.av_data->object_classes);
+				if (res == SELINT_SUCCESS) {
+					res = intern_names(&perm_ids, &perm_count,
+					                   node->data.av_data->perms);
+				}
+			}
+		}
+	}
+
+	if (res != SELINT_SUCCESS || count == 0) {
+		free_neverallow_index();
+		return res;
+	}
+
+	res = build_type_index(files, if_files);
+	if (res != SELINT_SUCCESS) {
+		free_neverallow_index();
+		return res;
+	}
+
+	rules = calloc(count, sizeof(struct neverallow_rule));
+	allow_sources = make_type_set();
+	allow_targets = make_type_set();
+	common_sources = make_type_set();
+	excluded_types = make_type_set();
+	allow_classes.words = calloc(WORDS(class_count), sizeof(uint64_t));
+	allow_perms.words = calloc(WORDS(perm_count), sizeof(uint64_t));
+	if (!rules || !allow_sources || !allow_targets || !common_sources ||
+	    !excluded_types || !allow_classes.words || !allow_perms.words) {
+		free_neverallow_index();
+		return SELINT_OUT_OF_MEM;
+	}
+
+	for (const struct policy_file_node *file = files->head; file; file = file->next) {
+		const char *filename = strrchr(file->file->filename, '/');
+		filename = filename ? filename + 1 : file->file->filename;
+
+		for (const struct policy_node *node = file->file->ast; node; node = dfs_next(node)) {
+			if (!is_indexed_neverallow(node)) {
+				continue;
+			}
+			const struct av_rule_data *av_data = node->data.av_data;
+			struct neverallow_rule *rule = &rules[rule_count++];
+
+			rule->filename = filename;
+			rule->lineno = node->lineno;
+			rule->av_data = av_data;
+			rule->sources = make_type_set();
+			rule->targets = make_type_set();
+			rule->classes.words = calloc(WORDS(class_count), sizeof(uint64_t));
+			rule->perms.words = calloc(WORDS(perm_count), sizeof(uint64_t));
+			if (!rule->sources || !rule->targets || !rule->classes.words ||
+			    !rule->perms.words) {
+				free_neverallow_index();
+				return SELINT_OUT_OF_MEM;
+			}
+
+			fill_type_set(rule->sources, av_data->sources, NULL);
+			fill_type_set(rule->targets, av_data->targets, &rule->target_self);
+			fill_name_set(&rule->classes, WORDS(class_count), class_ids,
+			              av_data->object_classes);
+			fill_name_set(&rule->perms, WORDS(perm_count), perm_ids, av_data->perms);
+		}
+	}
+
+	const struct policy_file_list *lists[] = { if_files, files };
+	for (unsigned int i = 0; i < 2; i++) {
+		for (const struct policy_file_node *file = lists[i]->head; file; file = file->next) {
+			res = index_def_statements(&allow_defs, file->file->ast, is_allow_rule);
+			if (res != SELINT_SUCCESS) {
+				free_neverallow_index();
+				return res;
+			}
+		}
+	}
+
+	return SELINT_SUCCESS;
+}
+
+int find_violated_neverallow(const struct av_rule_data *allow,
+                             const char **filename, unsigned int *lineno)
+{
+	int types_filled = 0;
+	int allow_self = 0;
+
+	if (rule_count == 0) {
+		return 0;
+	}
+
+	fill_name_set(&allow_classes, WORDS(class_count), class_ids, allow->object_classes);
+	fill_name_set(&allow_perms, WORDS(perm_count), perm_ids, allow->perms);
+
+	for (unsigned int i = 0; i < rule_count; i++) {
+		const struct neverallow_rule *rule = &rules[i];
+
+		if (!perms_intersect(allow, rule)) {
+			continue;
+		}
+
+		// Only expand the types once a rule covers the class and permissions
+		if (!types_filled) {
+			fill_type_set(allow_sources, allow->sources, NULL);
+			fill_type_set(allow_targets, allow->targets, &allow_self);
+			types_filled = 1;
+		}
+
+		if (!type_set_intersects(allow_sources, rule->sources)) {
+			continue;
+		}
+
+		memcpy(common_sources->words, allow_sources->words,
+		       allow_sources->word_count * sizeof(uint64_t));
+		type_set_intersect(common_sources, rule->sources);
+
+		// Allowed (source, target) pairs are sources x targets, plus (s, s)
+		// for each source with self, and the same holds for forbidden pairs
+		if (type_set_intersects(allow_targets, rule->targets) ||
+		    (rule->target_self && type_set_intersects(common_sources, allow_targets)) ||
+		    (allow_self && (rule->target_self ||
+		                    type_set_intersects(common_sources, rule->targets)))) {
+			*filename = rule->filename;
+			*lineno = rule->lineno;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+struct call_search {
+	const char *filename;
+	unsigned int lineno;
+	int found;
+};
+
+static enum selint_error check_expanded_allow(const struct policy_node *node,
+                                              struct string_list *args,
+                                              void *ctx)
+{
+	struct call_search *search = ctx;
+	const struct av_rule_data *orig = node->data.av_data;
+	struct av_rule_data allow;
+
+	if (search->found || !orig->sources || !orig->targets ||
+	    !orig->object_classes || !orig->perms) {
+		return SELINT_SUCCESS;
+	}
+
+	memset(&allow, 0, sizeof(struct av_rule_data));
+	allow.flavor = AV_RULE_ALLOW;
+	allow.sources = replace_m4_list(args, orig->sources);
+	allow.targets = replace_m4_list(args, orig->targets);
+	allow.object_classes = replace_m4_list(args, orig->object_classes);
+	allow.perms = replace_m4_list(args, orig->perms);
+
+	// Parameters that could not be replaced, such as $*, leave NULL names
+	if (allow.sources && allow.targets && allow.object_classes && allow.perms &&
+	    !args_have_param(allow.sources) && !args_have_param(allow.targets) &&
+	    !args_have_param(allow.object_classes) && !args_have_param(allow.perms)) {
+		search->found = find_violated_neverallow(&allow, &search->filename,
+		                                         &search->lineno);
+	}
+
+	free_string_list(allow.sources);
+	free_string_list(allow.targets);
+	free_string_list(allow.object_classes);
+	free_string_list(allow.perms);
+
+	return SELINT_SUCCESS;
+}
+
+int find_call_violating_neverallow(const struct if_call_data *call,
+                                   const char **filename, unsigned int *lineno)
+{
+	struct call_search search = { NULL, 0, 0 };
+
+	if (rule_count == 0 || args_have_param(call->args)) {
+		return 0;
+	}
+
+	expand_def_call(allow_defs, call->name, call->args, check_expanded_allow, &search);
+	if (search.found) {
+		*filename = search.filename;
+		*lineno = search.lineno;
+	}
+
+	return search.found;
+}
+
+static void free_name_map(struct name_elem **map)
+{
+	struct name_elem *cur, *tmp;
+
+	HASH_ITER(hh, *map, cur, tmp) {
+		HASH_DEL(*map, cur);
+		free(cur->name);
+		free(cur);
+	}
+}
+
+void free_neverallow_index(void)
+{
+	for (unsigned int i = 0; i < rule_count; i++) {
+		free_type_set(rules[i].sources);
+		free_type_set(rules[i].targets);
+		free(rules[i].classes.words);
+		free(rules[i].perms.words);
+	}
+	free(rules);
+	rules = NULL;
+	rule_count = 0;
+	free_def_statements(&allow_defs);
+
+	free_type_set(allow_sources);
+	free_type_set(allow_targets);
+	free_type_set(common_sources);
+	free_type_set(excluded_types);
+	allow_sources = allow_targets = common_sources = excluded_types = NULL;
+	free(allow_classes.words);
+	free(allow_perms.words);
+	allow_classes.words = allow_perms.words = NULL;
+
+	free_name_map(&class_ids);
+	free_name_map(&perm_ids);
+	class_count = 0;
+	perm_count = 0;
+
+	free_type_index();
+}
@@ -0,0 +1,70 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef NEVERALLOW_H
+#define NEVERALLOW_H
+
+#include "file_list.h"
+#include "selint_error.h"
+#include "tree.h"
+
+/*********************************************
+* Index the neverallow rules in a list of files, along with the types and
+* attributes they are checked against (see build_type_index()), replacing
+* any previous index.  Neverallow rules in interfaces and templates are
+* ignored, and their allow rules are kept for find_call_violating_neverallow().
+* files - The files to index
+* if_files - The interface files, for the attributes assigned in interfaces
+* and templates
+* returns SELINT_SUCCESS or SELINT_OUT_OF_MEM
+*********************************************/
+enum selint_error build_neverallow_index(const struct policy_file_list *files,
+                                         const struct policy_file_list *if_files);
+
+/*********************************************
+* Find a neverallow rule that forbids some of the access an allow rule
+* grants.  Attributes are expanded to their member types, and names that
+* are not in the index are taken to match nothing.  The permissions of
+* classes in the class perms map are compared within the class, so that ~
+* and * cover the permissions the class has.  Other permissions are compared
+* by name, so permission set macros only match the same macro.  Not safe to
+* call from several threads at once.
+* allow - The allow rule to check
+* filename - Set to the name of the file the neverallow rule is in
+* lineno - Set to the line the neverallow rule is on
+* returns 1 if a violated rule was found, and 0 otherwise
+*********************************************/
+int find_violated_neverallow(const struct av_rule_data *allow,
+                             const char **filename, unsigned int *lineno);
+
+/*********************************************
+* Find a neverallow rule that forbids some of the access granted by the allow
+* rules of an interface or template, and of the interfaces and templates it
+* calls, with the arguments of a call substituted for their parameters.
+* Calls passing on parameters are not checked, as their arguments are not
+* known until the interface they are in is called.  Not safe to call from
+* several threads at once.
+* call - The call to check
+* filename - Set to the name of the file the neverallow rule is in
+* lineno - Set to the line the neverallow rule is on
+* returns 1 if a violated rule was found, and 0 otherwise
+*********************************************/
+int find_call_violating_neverallow(const struct if_call_data *call,
+                                   const char **filename, unsigned int *lineno);
+
+void free_neverallow_index(void);
+
+#endif
@@ -205,7 +205,11 @@ const char *get_section(const struct policy_node *node)
 	case NODE_OPTIONAL_POLICY:
 	case NODE_OPTIONAL_ELSE:
 	case NODE_TUNABLE_POLICY:
+	case NODE_TUNABLE_ELSE:
 	case NODE_IFDEF:
+	case NODE_IFDEF_ELSE:
+	case NODE_BOOLEAN_POLICY:
+	case NODE_BOOLEAN_ELSE:
 		return get_section(node->first_child);
 	case NODE_M4_ARG:
 		return "_non_ordered"; //TODO
@@ -240,6 +244,7 @@ const char *get_section(const struct policy_node *node)
 	case NODE_GEN_REQ:
 		return "_non_ordered"; // Not in style guide
 	case NODE_PERMISSIVE:
+	case NODE_CONTEXT_STMT:
 		return "_non_ordered"; // Not in style guide
 	case NODE_FC_ENTRY:
 		return NULL;           // fc files only
@@ -305,21 +310,19 @@ static int is_own_module_rule(const struct policy_node *node)
 			return 0;
 		}
 	}
-	struct string_list *types = get_types_in_node(node);
-	struct string_list *cur = types;
-	while (cur) {
-		char *module_of_type_or_attr = look_up_in_decl_map(cur->string, DECL_TYPE);
+	struct type_iter it;
+	const char *type;
+	type_iter_init(&it, node);
+	while (type_iter_next(&it, &type, NULL)) {
+		char *module_of_type_or_attr = look_up_in_decl_map(type, DECL_TYPE);
 		if (!module_of_type_or_attr) {
-			module_of_type_or_attr = look_up_in_decl_map(cur->string, DECL_ATTRIBUTE);
+			module_of_type_or_attr = look_up_in_decl_map(type, DECL_ATTRIBUTE);
 		}
 		if (module_of_type_or_attr &&
 		    0 != strcmp(module_of_type_or_attr, current_mod)) {
-			free_string_list(types);
 			return 0;
 		}
-		cur = cur->next;
 	}
-	free_string_list(types);
 	// This assumes that not found strings are not types from other modules.
 	// This is probably necessary because we'll find strings like "file" or
 	// "read_file_perms" for example.  However, in normal mode without context
@@ -370,38 +373,27 @@ static int is_system_layer_if_call(const struct policy_node *node)
 	return check_call_layer(node, "system");
 }
 
+// Whether the node is, or is nested in, a block with any of the given scopes
+static int has_scope(const struct policy_node *node, unsigned int scope)
+{
+	return ((node->scope | get_block_scope(node->flavor)) & scope) ? 1 : 0;
+}
+
 int is_optional(const struct policy_node *node)
 {
-	while (node) {
-		if (node->flavor == NODE_OPTIONAL_POLICY ||
-		    node->flavor == NODE_OPTIONAL_ELSE) {
-			return 1;
-		}
-		node = node->parent;
-	}
-	return 0;
+	return has_scope(node, SCOPE_OPTIONAL | SCOPE_OPTIONAL_ELSE);
 }
 
+// Conditional blocks on booleans are ordered with tunable_policy blocks, which
+// are conditional blocks on tunables
 int is_tunable(const struct policy_node *node)
 {
-	while (node) {
-		if (node->flavor == NODE_TUNABLE_POLICY) {
-			return 1;
-		}
-		node = node->parent;
-	}
-	return 0;
+	return has_scope(node, SCOPE_TUNABLE | SCOPE_BOOLEAN);
 }
 
 int is_in_ifdef(const struct policy_node *node)
 {
-	while (node) {
-		if (node->flavor == NODE_IFDEF) {
-			return 1;
-		}
-		node = node->parent;
-	}
-	return 0;
+	return has_scope(node, SCOPE_IFDEF);
 }
 
 enum local_subsection get_local_subsection(const struct policy_node *node)
@@ -0,0 +1,442 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "output.h"
+
+static char default_data[OUTPUT_BUFFER_SIZE];
+
+static struct output_buffer default_buffer = {
+	default_data, 0, OUTPUT_BUFFER_SIZE, 1, 0
+};
+
+static __thread struct output_buffer *thread_buffer;
+
+static enum output_format format = OUTPUT_FORMAT_TEXT;
+
+// Where findings are written.  Differs from STDOUT_FILENO after
+// output_redirect_messages().
+static int out_fd = STDOUT_FILENO;
+
+// Whether a finding has been written in the current SARIF log.  Every SARIF
+// result is preceded by a comma, which is dropped for the first one.
+static int sarif_results_written;
+
+#define SARIF_HEADER "{\"version\":\"2.1.0\","\
+	"\"$schema\":\"https://json.schemastore.org/sarif-2.1.0.json\","\
+	"\"runs\":[{\"tool\":{\"driver\":{\"name\":\"SELint\","\
+	"\"version\":\"" VERSION "\"}},\"results\":[\n"
+
+#define SARIF_FOOTER "]}]}\n"
+
+enum selint_error output_set_format(const char *name)
+{
+	if (0 == strcmp(name, "text")) {
+		format = OUTPUT_FORMAT_TEXT;
+	} else if (0 == strcmp(name, "json")) {
+		format = OUTPUT_FORMAT_JSON;
+	} else if (0 == strcmp(name, "sarif")) {
+		format = OUTPUT_FORMAT_SARIF;
+	} else {
+		return SELINT_BAD_ARG;
+	}
+	return SELINT_SUCCESS;
+}
+
+enum output_format output_get_format(void)
+{
+	return format;
+}
+
+enum selint_error output_redirect_messages(void)
+{
+	fflush(stdout);
+
+	int fd = dup(STDOUT_FILENO);
+	if (fd < 0) {
+		return SELINT_IO_ERROR;
+	}
+	if (dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+		close(fd);
+		return SELINT_IO_ERROR;
+	}
+	out_fd = fd;
+
+	return SELINT_SUCCESS;
+}
+
+struct output_buffer *make_output_buffer(int autoflush)
+{
+	struct output_buffer *buf = malloc(sizeof(struct output_buffer));
+
+	if (!buf) {
+		return NULL;
+	}
+
+	buf->data = malloc(OUTPUT_BUFFER_SIZE);
+	if (!buf->data) {
+		free(buf);
+		return NULL;
+	}
+	buf->len = 0;
+	buf->cap = OUTPUT_BUFFER_SIZE;
+	buf->autoflush = autoflush;
+	buf->results = 0;
+
+	return buf;
+}
+
+void output_set_thread_buffer(struct output_buffer *buf)
+{
+	thread_buffer = buf;
+}
+
+struct output_buffer *output_get_thread_buffer(void)
+{
+	if (thread_buffer) {
+		return thread_buffer;
+	}
+	return &default_buffer;
+}
+
+static void write_all(const char *data, size_t len)
+{
+	while (len > 0) {
+		ssize_t written = write(out_fd, data, len);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			// Nowhere to report this.  Drop the output like stdio would.
+			return;
+		}
+		data += written;
+		len -= written;
+	}
+}
+
+void output_buffer_flush(struct output_buffer *buf)
+{
+	const char *data = buf->data;
+	size_t len = buf->len;
+
+	if (format == OUTPUT_FORMAT_SARIF && buf->results) {
+		if (!sarif_results_written && len && data[0] == ',') {
+			data++;
+			len--;
+		}
+		sarif_results_written = 1;
+	}
+
+	fflush(stdout);
+	write_all(data, len);
+	buf->len = 0;
+	buf->results = 0;
+}
+
+void output_begin(void)
+{
+	if (format == OUTPUT_FORMAT_SARIF) {
+		sarif_results_written = 0;
+		output_append(&default_buffer, SARIF_HEADER, strlen(SARIF_HEADER));
+		// Flush now so that the first result starts a buffer
+		output_buffer_flush(&default_buffer);
+	}
+}
+
+void output_end(void)
+{
+	if (format == OUTPUT_FORMAT_SARIF) {
+		output_append(&default_buffer, SARIF_FOOTER, strlen(SARIF_FOOTER));
+	}
+	output_buffer_flush(&default_buffer);
+}
+
+void output_flush(void)
+{
+	output_buffer_flush(output_get_thread_buffer());
+}
+
+// Make room for at least len more bytes.  Returns 0 if they do not fit and
+// should be written directly instead.
+static int reserve(struct output_buffer *buf, size_t len)
+{
+	if (buf->len + len <= buf->cap) {
+		return 1;
+	}
+
+	if (buf->autoflush) {
+		output_buffer_flush(buf);
+		return len <= buf->cap;
+	}
+
+	size_t new_cap = buf->cap;
+	while (new_cap < buf->len + len) {
+		new_cap *= 2;
+	}
+	char *new_data = realloc(buf->data, new_cap);
+	if (!new_data) {
+		return 0;
+	}
+	buf->data = new_data;
+	buf->cap = new_cap;
+	return 1;
+}
+
+void output_append(struct output_buffer *buf, const char *str, size_t len)
+{
+	if (!reserve(buf, len)) {
+		// Only reachable for autoflush buffers (already flushed) or when out
+		// of memory, in which case ordering no longer matters
+		write_all(str, len);
+		return;
+	}
+	memcpy(buf->data + buf->len, str, len);
+	buf->len += len;
+}
+
+// Format value right aligned in a field of at least width characters, padded
+// with pad.  Returns the number of characters written to out, which must
+// have room for width or 10 characters, whichever is larger.
+static size_t format_uint(char *out, unsigned int value, unsigned int width,
+                          char pad)
+{
+	char digits[10];
+	size_t count = 0;
+
+	do {
+		digits[count++] = '0' + value % 10;
+		value /= 10;
+	} while (value);
+
+	size_t len = 0;
+	while (width > count) {
+		out[len++] = pad;
+		width--;
+	}
+	while (count) {
+		out[len++] = digits[--count];
+	}
+	return len;
+}
+
+// Write a finding in the text format to out, which must have room for it
+// (see output_append_result()).  Returns the number of characters written.
+static size_t format_text_result(char *out, const struct check_result *res,
+                                 const char *filename, size_t filename_len,
+                                 const char *message, size_t message_len)
+{
+	const unsigned int padding = filename_len < 18 ? 18 - filename_len : 0;
+	char *start = out;
+
+	memcpy(out, filename, filename_len);
+	out += filename_len;
+	*out++ = ':';
+	out += format_uint(out, res->lineno, padding, ' ');
+	memcpy(out, ": (", 3);
+	out += 3;
+	*out++ = res->severity;
+	memcpy(out, "): ", 3);
+	out += 3;
+	memcpy(out, message, message_len);
+	out += message_len;
+	memcpy(out, " (", 2);
+	out += 2;
+	*out++ = res->severity;
+	*out++ = '-';
+	out += format_uint(out, res->check_id, 3, '0');
+	*out++ = ')';
+	*out++ = '\n';
+
+	return out - start;
+}
+
+#define APPEND_LITERAL(out, lit) \
+	memcpy(out, lit, sizeof(lit) - 1); \
+	out += sizeof(lit) - 1
+
+// Write str as the contents of a JSON string (without the quotes).  out must
+// have room for 6 * len characters.  Returns the number of characters written.
+static size_t json_escape(char *out, const char *str, size_t len)
+{
+	static const char hex[] = "0123456789abcdef";
+	char *start = out;
+
+	for (size_t i = 0; i < len; i++) {
+		unsigned char c = str[i];
+		switch (c) {
+		case '"':
+		case '\\':
+			*out++ = '\\';
+			*out++ = c;
+			break;
+		case '\n':
+			*out++ = '\\';
+			*out++ = 'n';
+			break;
+		case '\t':
+			*out++ = '\\';
+			*out++ = 't';
+			break;
+		default:
+			if (c < 0x20) {
+				APPEND_LITERAL(out, "\\u00");
+				*out++ = hex[c >> 4];
+				*out++ = hex[c & 0xf];
+			} else {
+				*out++ = c;
+			}
+		}
+	}
+
+	return out - start;
+}
+
+// Write "S-001" style check id.  out must have room for 12 characters.
+static size_t format_check_id(char *out, const struct check_result *res)
+{
+	out[0] = res->severity;
+	out[1] = '-';
+	return 2 + format_uint(out + 2, res->check_id, 3, '0');
+}
+
+static size_t format_json_result(char *out, const struct check_result *res,
+                                 const char *filename, size_t filename_len,
+                                 const char *message, size_t message_len)
+{
+	char *start = out;
+
+	APPEND_LITERAL(out, "{\"filename\":\"");
+	out += json_escape(out, filename, filename_len);
+	APPEND_LITERAL(out, "\",\"lineno\":");
+	out += format_uint(out, res->lineno, 0, ' ');
+	APPEND_LITERAL(out, ",\"severity\":\"");
+	*out++ = res->severity;
+	APPEND_LITERAL(out, "\",\"check_id\":\"");
+	out += format_check_id(out, res);
+	APPEND_LITERAL(out, "\",\"message\":\"");
+	out += json_escape(out, message, message_len);
+	APPEND_LITERAL(out, "\"}\n");
+
+	return out - start;
+}
+
+static const char *sarif_level(char severity)
+{
+	switch (severity) {
+	case 'C':
+	case 'S':
+		return "note";
+	case 'W':
+		return "warning";
+	default:
+		return "error";
+	}
+}
+
+static size_t format_sarif_result(char *out, const struct check_result *res,
+                                  const char *filename, size_t filename_len,
+                                  const char *message, size_t message_len)
+{
+	char *start = out;
+	const char *level = sarif_level(res->severity);
+
+	// Every result is preceded by a comma (see output_buffer_flush())
+	APPEND_LITERAL(out, ",{\"ruleId\":\"");
+	out += format_check_id(out, res);
+	APPEND_LITERAL(out, "\",\"level\":\"");
+	memcpy(out, level, strlen(level));
+	out += strlen(level);
+	APPEND_LITERAL(out, "\",\"message\":{\"text\":\"");
+	out += json_escape(out, message, message_len);
+	APPEND_LITERAL(out, "\"},\"locations\":[{\"physicalLocation\":{"
+	               "\"artifactLocation\":{\"uri\":\"");
+	out += json_escape(out, filename, filename_len);
+	APPEND_LITERAL(out, "\"},\"region\":{\"startLine\":");
+	out += format_uint(out, res->lineno, 0, ' ');
+	APPEND_LITERAL(out, "}}}]}\n");
+
+	return out - start;
+}
+
+static size_t format_result(char *out, const struct check_result *res,
+                            const char *filename, size_t filename_len,
+                            const char *message, size_t message_len)
+{
+	switch (format) {
+	case OUTPUT_FORMAT_JSON:
+		return format_json_result(out, res, filename, filename_len,
+		                          message, message_len);
+	case OUTPUT_FORMAT_SARIF:
+		return format_sarif_result(out, res, filename, filename_len,
+		                           message, message_len);
+	default:
+		return format_text_result(out, res, filename, filename_len,
+		                          message, message_len);
+	}
+}
+
+void output_append_result(struct output_buffer *buf,
+                          const struct check_result *res,
+                          const char *filename)
+{
+	// printf() used to print a missing message as "(null)"
+	const char *message = res->message ? res->message : "(null)";
+	const size_t filename_len = strlen(filename);
+	const size_t message_len = strlen(message);
+
+	// Text: filename ":" lineno ": (S): " message " (S-" id ")\n", where
+	// lineno is padded to 18 characters minus the length of the filename.
+	// The JSON formats escape the strings to at most six times their length
+	// and add less than 256 characters of syntax.
+	size_t max_len;
+	if (format == OUTPUT_FORMAT_TEXT) {
+		max_len = filename_len + 1 + 18 + 10 + 7 + message_len + 4 + 10 + 2;
+	} else {
+		max_len = 6 * (filename_len + message_len) + 256;
+	}
+
+	if (reserve(buf, max_len)) {
+		buf->len += format_result(buf->data + buf->len, res, filename,
+		                          filename_len, message, message_len);
+		buf->results++;
+		return;
+	}
+
+	// Larger than the whole buffer
+	struct output_buffer tmp = { malloc(max_len), 0, max_len, 0, 1 };
+	if (tmp.data) {
+		tmp.len = format_result(tmp.data, res, filename, filename_len,
+		                        message, message_len);
+		output_buffer_flush(&tmp);
+		free(tmp.data);
+	}
+}
+
+void free_output_buffer(struct output_buffer *to_free)
+{
+	if (!to_free || to_free == &default_buffer) {
+		return;
+	}
+	free(to_free->data);
+	free(to_free);
+}
@@ -0,0 +1,138 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stddef.h>
+
+#include "check_hooks.h"
+#include "selint_error.h"
+
+// Size at which an autoflush buffer is written out
+#define OUTPUT_BUFFER_SIZE (64 * 1024)
+
+enum output_format {
+	// [filename]:[lineno]: ([SEVERITY]): [MESSAGE] ([ID])
+	OUTPUT_FORMAT_TEXT,
+	// One JSON object per finding and line
+	OUTPUT_FORMAT_JSON,
+	// A single SARIF 2.1.0 log, streamed as findings are reported
+	OUTPUT_FORMAT_SARIF
+};
+
+struct output_buffer {
+	char *data;
+	size_t len;
+	size_t cap;
+	// If set, the buffer is written to stdout whenever it fills up.
+	// Otherwise it grows until output_buffer_flush() is called, so that
+	// the owner controls when (and in which order) its output appears.
+	int autoflush;
+	// Number of findings appended since the last flush
+	unsigned int results;
+};
+
+/*********************************************
+* Select the format findings are written in
+* name - One of "text", "json" or "sarif"
+* returns SELINT_SUCCESS or SELINT_BAD_ARG for an unknown format
+*********************************************/
+enum selint_error output_set_format(const char *name);
+
+/*********************************************
+* Get the format findings are written in
+*********************************************/
+enum output_format output_get_format(void);
+
+/*********************************************
+* Keep stdout for findings only.  Findings continue to be written to the
+* original stdout, while anything else printed to stdout (status messages,
+* the summary) goes to stderr instead.  Used by the machine readable formats.
+* returns SELINT_SUCCESS or SELINT_IO_ERROR
+*********************************************/
+enum selint_error output_redirect_messages(void);
+
+/*********************************************
+* Write anything that must precede the first finding in the current format
+*********************************************/
+void output_begin(void);
+
+/*********************************************
+* Write anything that must follow the last finding in the current format,
+* and flush the default buffer
+*********************************************/
+void output_end(void);
+
+/*********************************************
+* Allocate an empty output buffer
+* autoflush - Whether to write the buffer to stdout when it fills up
+* returns the new buffer or NULL on allocation failure
+*********************************************/
+struct output_buffer *make_output_buffer(int autoflush);
+
+/*********************************************
+* Select the buffer that findings reported from the calling thread are
+* appended to.  Passing NULL selects the process wide default buffer, which
+* is flushed automatically when full.
+* buf - The buffer to use for the calling thread
+*********************************************/
+void output_set_thread_buffer(struct output_buffer *buf);
+
+/*********************************************
+* Get the buffer findings from the calling thread are appended to
+* returns the thread buffer if one was set, or the default buffer
+*********************************************/
+struct output_buffer *output_get_thread_buffer(void);
+
+/*********************************************
+* Append a finding to a buffer in the current format
+* buf - The buffer to append to
+* res - The check result to format
+* filename - The name of the file the result is in
+*********************************************/
+void output_append_result(struct output_buffer *buf,
+                          const struct check_result *res,
+                          const char *filename);
+
+/*********************************************
+* Append raw bytes to a buffer
+* buf - The buffer to append to
+* str - The bytes to append
+* len - The number of bytes to append
+*********************************************/
+void output_append(struct output_buffer *buf, const char *str, size_t len);
+
+/*********************************************
+* Write the contents of a buffer to stdout and empty it.  Anything pending
+* in stdio's own stdout buffer is written first so that ordering with
+* printf() output is preserved.  Calls must not run concurrently.
+* buf - The buffer to flush
+*********************************************/
+void output_buffer_flush(struct output_buffer *buf);
+
+/*********************************************
+* Flush the buffer of the calling thread (see output_get_thread_buffer())
+*********************************************/
+void output_flush(void);
+
+/*********************************************
+* Free an output buffer.  Any contents that have not been flushed are lost.
+* to_free - The buffer to free
+*********************************************/
+void free_output_buffer(struct output_buffer *to_free);
+
+#endif
@@ -0,0 +1,190 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "parallel.h"
+
+static unsigned int parallel_jobs;
+
+struct parallel_run {
+	unsigned int count;
+	unsigned int next;
+	void (*fn)(void *ctx, unsigned int item);
+	void *ctx;
+	// How many workers may still join the run
+	unsigned int open_slots;
+};
+
+// Workers are started the first time they are needed and then wait for
+// further runs, so repeated calls do not pay for thread creation.  All of the
+// pool state is protected by pool_lock.
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pool_idle = PTHREAD_COND_INITIALIZER;
+static pthread_t *pool_workers;
+static unsigned int pool_size;
+static struct parallel_run *pool_run;
+static uintptr_t pool_generation;
+static unsigned int pool_busy;
+static int pool_in_use;
+static int pool_stopping;
+
+void set_parallel_jobs(unsigned int jobs)
+{
+	parallel_jobs = jobs;
+}
+
+unsigned int get_parallel_jobs(void)
+{
+	if (parallel_jobs == 0) {
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		parallel_jobs = (cpus > 0) ? (unsigned int)cpus : 1;
+	}
+	return parallel_jobs;
+}
+
+static void run_items(struct parallel_run *run)
+{
+	unsigned int item;
+
+	while ((item = __atomic_fetch_add(&run->next, 1, __ATOMIC_RELAXED)) < run->count) {
+		run->fn(run->ctx, item);
+	}
+}
+
+static void *pool_worker(void *arg)
+{
+	// The generation current when the worker was created, so that it joins
+	// the run it was started for
+	uintptr_t seen = (uintptr_t)arg;
+
+	pthread_mutex_lock(&pool_lock);
+	while (1) {
+		while (!pool_stopping && seen == pool_generation) {
+			pthread_cond_wait(&pool_wake, &pool_lock);
+		}
+		if (pool_stopping) {
+			break;
+		}
+		seen = pool_generation;
+
+		struct parallel_run *run = pool_run;
+		if (!run || run->open_slots == 0) {
+			continue;
+		}
+		run->open_slots--;
+		pool_busy++;
+		pthread_mutex_unlock(&pool_lock);
+
+		run_items(run);
+
+		pthread_mutex_lock(&pool_lock);
+		if (--pool_busy == 0) {
+			pthread_cond_signal(&pool_idle);
+		}
+	}
+	pthread_mutex_unlock(&pool_lock);
+
+	return NULL;
+}
+
+void stop_parallel_jobs(void)
+{
+	pthread_mutex_lock(&pool_lock);
+	pool_stopping = 1;
+	pthread_cond_broadcast(&pool_wake);
+	pthread_mutex_unlock(&pool_lock);
+
+	for (unsigned int i = 0; i < pool_size; i++) {
+		pthread_join(pool_workers[i], NULL);
+	}
+	free(pool_workers);
+	pool_workers = NULL;
+	pool_size = 0;
+	pool_stopping = 0;
+}
+
+// Called with pool_lock held
+static void grow_pool(unsigned int size)
+{
+	if (size <= pool_size) {
+		return;
+	}
+
+	pthread_t *workers = realloc(pool_workers, size * sizeof(pthread_t));
+	if (!workers) {
+		return;
+	}
+	pool_workers = workers;
+
+	static int stop_at_exit;
+	if (!stop_at_exit) {
+		atexit(stop_parallel_jobs);
+		stop_at_exit = 1;
+	}
+
+	while (pool_size < size &&
+	       0 == pthread_create(&pool_workers[pool_size], NULL, pool_worker,
+	                           (void *)pool_generation)) {
+		pool_size++;
+	}
+}
+
+void run_in_parallel(unsigned int count,
+                     void (*fn)(void *ctx, unsigned int item),
+                     void *ctx)
+{
+	struct parallel_run run = { count, 0, fn, ctx, 0 };
+	unsigned int threads = get_parallel_jobs();
+
+	if (threads > count) {
+		threads = count;
+	}
+
+	pthread_mutex_lock(&pool_lock);
+	// A call from inside fn, or from a second thread, runs on its own
+	// rather than waiting for the workers
+	if (threads <= 1 || pool_in_use) {
+		pthread_mutex_unlock(&pool_lock);
+		run_items(&run);
+		return;
+	}
+	pool_in_use = 1;
+
+	grow_pool(threads - 1);
+	run.open_slots = (pool_size < threads - 1) ? pool_size : threads - 1;
+	pool_run = &run;
+	pool_generation++;
+	pthread_cond_broadcast(&pool_wake);
+	pthread_mutex_unlock(&pool_lock);
+
+	// Whatever the workers do not get to is done here
+	run_items(&run);
+
+	pthread_mutex_lock(&pool_lock);
+	// No worker may join once the run is withdrawn, so waiting for the busy
+	// ones is enough
+	pool_run = NULL;
+	while (pool_busy > 0) {
+		pthread_cond_wait(&pool_idle, &pool_lock);
+	}
+	pool_in_use = 0;
+	pthread_mutex_unlock(&pool_lock);
+}
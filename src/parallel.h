@@ -0,0 +1,52 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+/*********************************************
+* Set the number of threads used for work that can run in parallel
+* jobs - The number of threads, or 0 for one per online CPU
+*********************************************/
+void set_parallel_jobs(unsigned int jobs);
+
+/*********************************************
+* Get the number of threads used for work that can run in parallel
+* returns at least 1
+*********************************************/
+unsigned int get_parallel_jobs(void);
+
+/*********************************************
+* Call fn(ctx, item) for every item from 0 to count - 1, spread over up to
+* get_parallel_jobs() threads including the calling one.  Items are started
+* in increasing order, but may finish in any order.  Returns once every call
+* has returned.  The other threads are started on first use and kept for
+* later calls.
+* count - The number of items
+* fn - The function to call for each item
+* ctx - Passed to every call of fn
+*********************************************/
+void run_in_parallel(unsigned int count,
+                     void (*fn)(void *ctx, unsigned int item),
+                     void *ctx);
+
+/*********************************************
+* Stop the threads kept by run_in_parallel().  Called at exit, and safe to
+* call at any time no run is in progress; later runs start new threads.
+*********************************************/
+void stop_parallel_jobs(void);
+
+#endif
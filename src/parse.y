@@ -49,6 +49,7 @@
 %token <symbol> SYMBOL;
 %token <string> VERSION_NO;
 %token <string> SELINT_COMMAND;
+%token <string> SELINT_FILE_COMMAND;
 
 %destructor { free($$); } STRING
 %destructor { free($$); } NUM_STRING
@@ -57,6 +58,7 @@
 %destructor { free($$); } NUMBER
 %destructor { free($$); } QUOTED_STRING
 %destructor { free($$); } VERSION_NO
+%destructor { free($$); } SELINT_FILE_COMMAND
 
 %token POLICY_MODULE;
 %token MODULE;
@@ -131,6 +133,8 @@
 %type<sl> string_list
 %type<sl> comma_string_list
 %type<sl> strings
+%type<sl> context
+%type<sl> raw_context
 %type<string> sl_item
 %type<sl> arg
 %type<sl> args
@@ -171,6 +175,9 @@ comments:
 comment:
 	COMMENT	{ if (!cur) { cur = ast; }
 	          insert_comment(&cur, yylineno); }
+	|
+	SELINT_FILE_COMMAND { if (!cur) { cur = ast; }
+	                      insert_comment(&cur, yylineno); save_command(cur, $1); free($1); }
 	;
 
 
@@ -248,6 +255,8 @@ bare_line:
 	SEMICOLON { insert_semicolon(&cur, yylineno); }
 	|
 	COMMENT
+	|
+	SELINT_FILE_COMMAND { save_command(cur, $1); free($1); }
 	// Would like to do error recovery, but the best strategy seems to be to skip
 	// to next newline, which lex doesn't give us right now.
 	// Also, we would need to know in yyerror whether the error was recoverable
@@ -279,10 +288,7 @@ type_declaration:
 	TYPE STRING ALIAS STRING COMMA comma_string_list SEMICOLON {
 				insert_declaration(&cur, DECL_TYPE, $2, NULL, yylineno);
 				free($2);
-				struct string_list *tmp = calloc(1, sizeof(struct string_list));
-				tmp->string = $4;
-				tmp->next = $6;
-				insert_aliases(&cur, tmp, DECL_TYPE, yylineno); }
+				insert_aliases(&cur, sl_concat(sl_array_append(NULL, $4), $6), DECL_TYPE, yylineno); }
 	;
 
 attribute_declaration:
@@ -327,23 +333,17 @@ av_type:
 string_list:
 	OPEN_CURLY strings CLOSE_CURLY { $$ = $2; }
 	|
-	TILDA string_list { $$ = calloc(1, sizeof(struct string_list));
-			$$->string = strdup("~");
-			$$->next = $2; }
+	TILDA string_list { $$ = sl_concat(sl_array_append(NULL, strdup("~")), $2); }
 	|
-	sl_item { $$ = calloc(1, sizeof(struct string_list)); $$->string = $1; $$->next = NULL; }
+	sl_item { $$ = sl_array_append(NULL, $1); }
 	|
-	STAR { $$ = calloc(1, sizeof(struct string_list)); $$->string = strdup("*"); $$->next = NULL; }
+	STAR { $$ = sl_array_append(NULL, strdup("*")); }
 	;
 
 strings:
-	strings sl_item { struct string_list *current = $1; while (current->next) { current = current->next; }
-			current->next = calloc(1, sizeof(struct string_list));
-			current->next->string = strdup($2);
-			current->next->next = NULL;
-			free($2); }
+	strings sl_item { $$ = sl_array_append($1, $2); }
 	|
-	sl_item { $$ = calloc(1, sizeof(struct string_list)); $$->string = $1; $$->next = NULL; }
+	sl_item { $$ = sl_array_append(NULL, $1); }
 	;
 
 sl_item:
@@ -359,13 +359,9 @@ sl_item:
 	;
 
 comma_string_list:
-	comma_string_list COMMA STRING { struct string_list *current = $1; while (current->next) { current = current->next; }
-					current->next = calloc(1, sizeof(struct string_list));
-					current->next->string = strdup($3);
-					current->next->next = NULL;
-					free($3); }
+	comma_string_list COMMA STRING { $$ = sl_array_append($1, $3); }
 	|
-	STRING { $$ = calloc(1, sizeof(struct string_list)); $$->string = strdup($1); $$->next = NULL; free($1); }
+	STRING { $$ = sl_array_append(NULL, $1); }
 	;
 
 role_allow:
@@ -436,7 +432,8 @@ require:
 	BACKTICK lines SINGLE_QUOTE CLOSE_PAREN { end_gen_require(&cur); }
 	|
 	gen_require_begin
-	BACKTICK SELINT_COMMAND lines SINGLE_QUOTE CLOSE_PAREN { end_gen_require(&cur); save_command(cur, $3); free($3); }
+	BACKTICK SELINT_COMMAND { save_command(cur->parent, $3); free($3); }
+	lines SINGLE_QUOTE CLOSE_PAREN { end_gen_require(&cur); }
 	|
 	// TODO: This is bad and should be checked
 	gen_require_begin
@@ -470,8 +467,14 @@ m4_call:
 	;
 
 ifdef:
-	if_or_ifn OPEN_PAREN BACKTICK STRING SINGLE_QUOTE COMMA { begin_ifdef(&cur, yylineno); }
-	m4_args CLOSE_PAREN { end_ifdef(&cur); free($4); }
+	ifdef_open m4_argument CLOSE_PAREN { end_ifdef(&cur); }
+	|
+	ifdef_open m4_argument COMMA { end_ifdef(&cur); begin_ifdef_else(&cur, yylineno); }
+	m4_args CLOSE_PAREN { end_ifdef_else(&cur); }
+	;
+
+ifdef_open:
+	if_or_ifn OPEN_PAREN BACKTICK STRING SINGLE_QUOTE COMMA { begin_ifdef(&cur, yylineno); free($4); }
 	;
 
 if_or_ifn:
@@ -480,11 +483,18 @@ if_or_ifn:
 	IFNDEF;
 
 tunable:
+	tunable_open m4_argument CLOSE_PAREN { end_tunable_policy(&cur); }
+	|
+	tunable_open m4_argument COMMA { end_tunable_policy(&cur); begin_tunable_else(&cur, yylineno); }
+	m4_args CLOSE_PAREN { end_tunable_else(&cur); }
+	;
+
+tunable_open:
 	TUNABLE_POLICY OPEN_PAREN BACKTICK { begin_tunable_policy(&cur, yylineno); }
-	condition SINGLE_QUOTE COMMA m4_args CLOSE_PAREN { end_tunable_policy(&cur); }
+	condition SINGLE_QUOTE COMMA
 	|
 	TUNABLE_POLICY OPEN_PAREN { begin_tunable_policy(&cur, yylineno); }
-	condition COMMA m4_args CLOSE_PAREN { end_tunable_policy(&cur); }
+	condition COMMA
 	;
 
 gen_tunable:
@@ -571,19 +581,14 @@ arg:
 args:
 	arg
 	|
-	args COMMA arg
-	{ struct string_list *current = $1;
-	while (current->next) { current = current->next; }
-	current->next = $3;
-	$$ = $1; }
+	args COMMA arg { $$ = sl_concat($1, $3); }
 	|
 	args sl_item
-	{ struct string_list *current = $1;
-	while (current->next) { current = current->next; }
-	current->next = calloc(1, sizeof(struct string_list));
-	current->next->string = $2;
-	current->next->has_incorrect_space = 1;
-	$$ = $1; }
+	{ struct string_list *space = sl_array_append(NULL, $2);
+	if (space) {
+		space->has_incorrect_space = 1;
+	}
+	$$ = sl_concat($1, space); }
 	;
 
 mls_range:
@@ -614,24 +619,29 @@ mls_component:
 	;
 
 cond_expr:
-	IF OPEN_PAREN condition CLOSE_PAREN OPEN_CURLY lines CLOSE_CURLY
+	cond_block
 	|
-	IF OPEN_PAREN condition CLOSE_PAREN OPEN_CURLY lines CLOSE_CURLY
-	ELSE OPEN_CURLY lines CLOSE_CURLY
+	cond_block ELSE OPEN_CURLY { begin_boolean_else(&cur, yylineno); }
+	lines CLOSE_CURLY { end_boolean_else(&cur); }
+	;
+
+cond_block:
+	IF OPEN_PAREN condition CLOSE_PAREN OPEN_CURLY { begin_boolean_policy(&cur, yylineno); }
+	lines CLOSE_CURLY { end_boolean_policy(&cur); }
 	;
 
 genfscon:
-	GENFSCON STRING STRING context { free($2); free($3); }
+	GENFSCON STRING STRING context { insert_context_statement(&cur, $4, yylineno); free($2); free($3); }
 	|
-	GENFSCON NUM_STRING STRING context { free($2); free($3); }
+	GENFSCON NUM_STRING STRING context { insert_context_statement(&cur, $4, yylineno); free($2); free($3); }
 	;
 
 sid:
-	SID STRING context { free($2); }
+	SID STRING context { insert_context_statement(&cur, $3, yylineno); free($2); }
 	;
 
 portcon:
-	PORTCON STRING port_range context { free($2); }
+	PORTCON STRING port_range context { insert_context_statement(&cur, $4, yylineno); free($2); }
 	;
 
 port_range:
@@ -645,11 +655,11 @@ port_range:
 	;
 
 netifcon:
-	NETIFCON STRING context context { free($2); }
+	NETIFCON STRING context context { insert_context_statement(&cur, sl_concat($3, $4), yylineno); free($2); }
 	;
 
 nodecon:
-	NODECON two_ip_addrs context
+	NODECON two_ip_addrs context { insert_context_statement(&cur, $3, yylineno); }
 	;
 
 two_ip_addrs:
@@ -659,11 +669,11 @@ two_ip_addrs:
 	;
 
 fs_use:
-	FS_USE_TRANS STRING context SEMICOLON { free($2); }
+	FS_USE_TRANS STRING context SEMICOLON { insert_context_statement(&cur, $3, yylineno); free($2); }
 	|
-	FS_USE_XATTR STRING context SEMICOLON { free($2); }
+	FS_USE_XATTR STRING context SEMICOLON { insert_context_statement(&cur, $3, yylineno); free($2); }
 	|
-	FS_USE_TASK STRING context SEMICOLON { free($2); }
+	FS_USE_TASK STRING context SEMICOLON { insert_context_statement(&cur, $3, yylineno); free($2); }
 	;
 
 define:
@@ -677,19 +687,19 @@ gen_user:
 context:
 	raw_context
 	|
-	GEN_CONTEXT OPEN_PAREN raw_context CLOSE_PAREN
+	GEN_CONTEXT OPEN_PAREN raw_context CLOSE_PAREN { $$ = $3; }
 	|
-	GEN_CONTEXT OPEN_PAREN raw_context COMMA mls_range CLOSE_PAREN { free($5); }
+	GEN_CONTEXT OPEN_PAREN raw_context COMMA mls_range CLOSE_PAREN { $$ = $3; free($5); }
 	|
-	GEN_CONTEXT OPEN_PAREN raw_context COMMA mls_range COMMA mls_range CLOSE_PAREN { free($5); free($7); }
+	GEN_CONTEXT OPEN_PAREN raw_context COMMA mls_range COMMA mls_range CLOSE_PAREN { $$ = $3; free($5); free($7); }
 	|
-	GEN_CONTEXT OPEN_PAREN raw_context COMMA mls_range COMMA CLOSE_PAREN { free($5); }
+	GEN_CONTEXT OPEN_PAREN raw_context COMMA mls_range COMMA CLOSE_PAREN { $$ = $3; free($5); }
 	;
 
 raw_context:
-	STRING COLON STRING COLON STRING { free($1); free($3); free($5); }
+	STRING COLON STRING COLON STRING { $$ = sl_array_append(sl_array_append(sl_array_append(NULL, $1), $3), $5); }
 	|
-	STRING COLON STRING COLON STRING COLON mls_range { free($1); free($3); free($5); free($7); }
+	STRING COLON STRING COLON STRING COLON mls_range { $$ = sl_array_append(sl_array_append(sl_array_append(NULL, $1), $3), $5); free($7); }
 	;
 
 permissive:
@@ -720,6 +730,8 @@ if_line:
 	interface_def
 	|
 	COMMENT { insert_comment(&cur, yylineno); }
+	|
+	SELINT_FILE_COMMAND { insert_comment(&cur, yylineno); save_command(cur, $1); free($1); }
 	;
 
 interface_def:
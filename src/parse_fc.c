@@ -24,104 +24,214 @@
 // "gen_context("
 #define GEN_CONTEXT_LEN 12
 
-struct fc_entry *parse_fc_line(char *line)
+// A part of a line, from start up to but not including end
+struct span {
+	const char *start;
+	const char *end;
+};
+
+// Token delimiters, as tables indexed by character.  NUL ends a token as
+// well, since parse_fc_line() and parse_context() take C strings.
+static const char whitespace_delims[256] = { [0] = 1, [' '] = 1, ['\t'] = 1 };
+static const char comma_delims[256] = { [0] = 1, [','] = 1 };
+static const char colon_delims[256] = { [0] = 1, [':'] = 1 };
+
+// Find the next token in [*pos, end) that is delimited by the characters in
+// delims, skipping empty tokens the same way strtok() does, and advance *pos
+// past it.  Returns 0 if there are no more tokens.
+static int next_token(const char **pos, const char *end, const char *delims,
+                      struct span *token)
 {
-	char whitespace[] = " \t";
+	const unsigned char *cur = (const unsigned char *)*pos;
+	const unsigned char *stop = (const unsigned char *)end;
 
-	struct fc_entry *out = malloc(sizeof(struct fc_entry));
+	while (cur < stop && *cur != '\0' && delims[*cur]) {
+		cur++;
+	}
+	if (cur == stop || *cur == '\0') {
+		*pos = (const char *)cur;
+		return 0;
+	}
+
+	token->start = (const char *)cur;
+	while (cur < stop && !delims[*cur]) {
+		cur++;
+	}
+	token->end = (const char *)cur;
+	*pos = (const char *)((cur < stop && *cur != '\0') ? cur + 1 : cur);
+
+	return 1;
+}
+
+static char *span_dup(const struct span *span)
+{
+	return strndup(span->start, (size_t)(span->end - span->start));
+}
+
+static const char *span_chr(const struct span *span, char c)
+{
+	return memchr(span->start, c, (size_t)(span->end - span->start));
+}
+
+static void trim_leading_whitespace(struct span *span)
+{
+	while (span->start < span->end &&
+	       (*span->start == ' ' || *span->start == '\t')) {
+		span->start++;
+	}
+}
+
+static int starts_with(const char *line, size_t len, const char *prefix)
+{
+	size_t prefix_len = strlen(prefix);
 
-	memset(out, 0, sizeof(struct fc_entry));
+	return len >= prefix_len && 0 == strncmp(line, prefix, prefix_len);
+}
+
+static int span_eq(const struct span *span, const char *str)
+{
+	size_t len = strlen(str);
+
+	return (size_t)(span->end - span->start) == len &&
+	       0 == memcmp(span->start, str, len);
+}
 
-	char *orig_line = strdup(line); // If the object class is ommitted, we need to revert
+static struct sel_context *parse_context_span(const struct span *context_str)
+{
+
+	if (span_chr(context_str, '(')) {
+		return NULL;
+	}
 
-	char *pos = strtok(line, whitespace);
+	struct sel_context *context = calloc(1, sizeof(struct sel_context));
+	if (!context) {
+		return NULL;
+	}
 
-	out->path = strdup(pos);
+	const char *pos = context_str->start;
+	struct span part;
 
-	pos = strtok(NULL, whitespace);
+	// User
+	if (!next_token(&pos, context_str->end, colon_delims, &part)) {
+		goto cleanup;
+	}
+	context->user = span_dup(&part);
 
-	if (pos == NULL) {
+	// Role
+	if (!next_token(&pos, context_str->end, colon_delims, &part)) {
 		goto cleanup;
 	}
+	context->role = span_dup(&part);
 
-	if (pos[0] == '-') {
-		if (pos[2] != '\0') {
-			goto cleanup;
-		}
-		out->obj = pos[1];
-		pos = strtok(NULL, whitespace);
-		if (pos == NULL) {
+	// Type
+	if (!next_token(&pos, context_str->end, colon_delims, &part)) {
+		goto cleanup;
+	}
+	context->type = span_dup(&part);
+
+	if (next_token(&pos, context_str->end, colon_delims, &part)) {
+		context->range = span_dup(&part);
+		if (next_token(&pos, context_str->end, colon_delims, &part)) {
 			goto cleanup;
 		}
 	}
-	// pos points to the start of the context, but spaces in the context may have been
-	// overwitten by strtok
-	strcpy(line, orig_line);
 
-	if (strncmp("gen_context(", pos, GEN_CONTEXT_LEN) == 0) {
-		pos += GEN_CONTEXT_LEN; // Next character
-		char *context_part = strtok(pos, ",");
-		if (context_part == NULL) {
+	return context;
+
+cleanup:
+	free_sel_context(context);
+	return NULL;
+}
+
+// Parse the fc entry in [line, end).  A trailing newline, if any, is part of
+// the line.
+static struct fc_entry *parse_fc_span(const char *line, const char *end)
+{
+	const char *pos = line;
+	struct span token;
+
+	if (!next_token(&pos, end, whitespace_delims, &token)) {
+		return NULL;
+	}
+
+	struct fc_entry *out = calloc(1, sizeof(struct fc_entry));
+	if (!out) {
+		return NULL;
+	}
+
+	out->path = span_dup(&token);
+
+	if (!next_token(&pos, end, whitespace_delims, &token)) {
+		goto cleanup;
+	}
+
+	if (token.start[0] == '-') {
+		if (token.end - token.start != 2) {
 			goto cleanup;
 		}
-
-		char *maybe_s = strtok(NULL, ",");
-		if (maybe_s == NULL) {
+		out->obj = token.start[1];
+		if (!next_token(&pos, end, whitespace_delims, &token)) {
 			goto cleanup;
 		}
-		char *maybe_c = strtok(NULL, ",");
-		int i = 0;
-		while (maybe_s[i] != '\0' && maybe_s[i] != ')') {
-			i++;
+	}
+	// The context runs from its first token to the end of the line,
+	// including any whitespace in it
+	struct span context_str = { token.start, end };
+
+	if ((size_t)(end - token.start) >= GEN_CONTEXT_LEN &&
+	    strncmp("gen_context(", token.start, GEN_CONTEXT_LEN) == 0) {
+		pos = token.start + GEN_CONTEXT_LEN;
+		struct span context_part, maybe_s, maybe_c;
+		if (!next_token(&pos, end, comma_delims, &context_part)) {
+			goto cleanup;
 		}
-		if (maybe_s[i] == '\0') {
-			if (!maybe_c) {
-				// Missing closing paren
-				goto cleanup;
-			}
+		if (!next_token(&pos, end, comma_delims, &maybe_s)) {
+			goto cleanup;
+		}
+		int has_c = next_token(&pos, end, comma_delims, &maybe_c);
+
+		const char *close = span_chr(&maybe_s, ')');
+		if (!close && !has_c) {
+			// Missing closing paren
+			goto cleanup;
 		}
-		maybe_s[i] = '\0';
-		while (maybe_s[0] != '\0'
-		       && (maybe_s[0] == ' ' || maybe_s[0] == '\t')) {
-			// trim beginning whitespace
-			maybe_s++;
+		if (close) {
+			maybe_s.end = close;
 		}
+		trim_leading_whitespace(&maybe_s);
 
-		if (maybe_c) {
-			while (maybe_c[i] != '\0' && maybe_c[i] != ')') {
-				i++;
-			}
-			if (maybe_c[i] == '\0') {
+		if (has_c) {
+			close = span_chr(&maybe_c, ')');
+			if (!close) {
 				// Missing closing paren
 				goto cleanup;
 			}
-			maybe_c[i] = '\0';
-			while (maybe_c[0] != '\0'
-			       && (maybe_c[0] == ' ' || maybe_c[0] == '\t')) {
-				// trim beginning whitespace
-				maybe_c++;
-			}
+			maybe_c.end = close;
+			trim_leading_whitespace(&maybe_c);
 		}
 
-		out->context = parse_context(context_part);
+		out->context = parse_context_span(&context_part);
 		if (out->context == NULL) {
 			goto cleanup;
 		}
 		out->context->has_gen_context = 1;
-		if (maybe_c) {
-			out->context->range =
-				malloc(strlen(maybe_s) + 1 + strlen(maybe_c) + 1);
-			strcpy(out->context->range, maybe_s);
-			strcat(out->context->range, ":");
-			strcat(out->context->range, maybe_c);
+		free(out->context->range);
+		if (has_c) {
+			size_t s_len = (size_t)(maybe_s.end - maybe_s.start);
+			size_t c_len = (size_t)(maybe_c.end - maybe_c.start);
+			out->context->range = malloc(s_len + 1 + c_len + 1);
+			memcpy(out->context->range, maybe_s.start, s_len);
+			out->context->range[s_len] = ':';
+			memcpy(out->context->range + s_len + 1, maybe_c.start, c_len);
+			out->context->range[s_len + 1 + c_len] = '\0';
 		} else {
-			out->context->range = strdup(maybe_s);
+			out->context->range = span_dup(&maybe_s);
 		}
-	} else if (strcmp("<<none>>\n", pos) == 0
-	           || strcmp("<<none>>\r\n", pos) == 0) {
+	} else if (span_eq(&context_str, "<<none>>\n")
+	           || span_eq(&context_str, "<<none>>\r\n")) {
 		out->context = NULL;
 	} else {
-		out->context = parse_context(pos);
+		out->context = parse_context_span(&context_str);
 		if (out->context == NULL) {
 			goto cleanup;
 		}
@@ -129,65 +239,235 @@ struct fc_entry *parse_fc_line(char *line)
 
 	}
 
-	free(orig_line);
 	return out;
 
 cleanup:
-	free(orig_line);
 	free_fc_entry(out);
 	return NULL;
 }
 
-struct sel_context *parse_context(char *context_str)
+struct fc_entry *parse_fc_line(const char *line)
 {
+	return parse_fc_span(line, line + strlen(line));
+}
 
-	if (strchr(context_str, '(')) {
-		return NULL;
+struct sel_context *parse_context(const char *context_str)
+{
+	struct span span = { context_str, context_str + strlen(context_str) };
+
+	return parse_context_span(&span);
+}
+
+enum m4_line {
+	M4_NONE,        // Not an m4 construct
+	M4_OPEN,        // Opens an ifdef or ifndef block
+	M4_ELSE,        // Starts the branch of the innermost block taken otherwise
+	M4_CLOSE,       // Closes the innermost block
+	M4_OTHER        // Another m4 construct, such as a block on a single line
+};
+
+static enum m4_line classify_m4_line(const char *line, size_t len)
+{
+	if (starts_with(line, len, "ifdef") || starts_with(line, len, "ifndef")) {
+		for (size_t i = 0; i + 1 < len; i++) {
+			if (line[i] == '\'' && line[i + 1] == ')') {
+				return M4_OTHER;
+			}
+		}
+		return M4_OPEN;
+	}
+	if (starts_with(line, len, "')")) {
+		return M4_CLOSE;
+	}
+	if (starts_with(line, len, "', `") || starts_with(line, len, "',`")) {
+		return M4_ELSE;
 	}
 
-	struct sel_context *context = malloc(sizeof(struct sel_context));
-	memset(context, 0, sizeof(struct sel_context));
-	// User
-	char *pos = strtok(context_str, ":");
+	return M4_NONE;
+}
 
-	if (pos == NULL) {
-		goto cleanup;
+int fc_conditional_depth_change(const char *line, size_t len)
+{
+	switch (classify_m4_line(line, len)) {
+	case M4_OPEN:
+		return 1;
+	case M4_CLOSE:
+		return -1;
+	default:
+		return 0;
 	}
+}
 
-	context->user = strdup(pos);
+// An ifdef or ifndef block enclosing the line being parsed
+struct fc_condition {
+	// NULL if the condition could not be read
+	char *name;
+	// Whether the current branch is taken when the condition is defined
+	int defined;
+};
+
+// The blocks enclosing the line being parsed, innermost last
+struct fc_conditions {
+	struct fc_condition *blocks;
+	unsigned int count;
+	unsigned int cap;
+};
+
+// Read the condition of an ifdef or ifndef line, as in ifdef(`name',`
+static char *condition_name(const char *line, size_t len)
+{
+	const char *start = memchr(line, '`', len);
 
-	// Role
-	pos = strtok(NULL, ":");
+	if (!start) {
+		return NULL;
+	}
+	start++;
+	const char *end = memchr(start, '\'', (size_t)(line + len - start));
+	if (!end || end == start) {
+		return NULL;
+	}
 
-	if (pos == NULL) {
-		goto cleanup;
+	return strndup(start, (size_t)(end - start));
+}
+
+// Update the enclosing blocks for an m4 line.  Returns 0 on allocation
+// failure.
+static int update_conditions(struct fc_conditions *conds, enum m4_line kind,
+                             const char *line, size_t len)
+{
+	switch (kind) {
+	case M4_OPEN:
+		if (conds->count == conds->cap) {
+			unsigned int new_cap = conds->cap ? conds->cap * 2 : 4;
+			struct fc_condition *grown =
+				realloc(conds->blocks, new_cap * sizeof(struct fc_condition));
+			if (!grown) {
+				return 0;
+			}
+			conds->blocks = grown;
+			conds->cap = new_cap;
+		}
+		struct fc_condition *cond = &conds->blocks[conds->count++];
+		cond->name = condition_name(line, len);
+		cond->defined = starts_with(line, len, "ifdef");
+		break;
+	case M4_ELSE:
+		if (conds->count > 0) {
+			conds->blocks[conds->count - 1].defined ^= 1;
+		}
+		break;
+	case M4_CLOSE:
+		// Closing quotes of unknown blocks are ignored
+		if (conds->count > 0) {
+			free(conds->blocks[--conds->count].name);
+		}
+		break;
+	default:
+		break;
 	}
 
-	context->role = strdup(pos);
+	return 1;
+}
 
-	// Type
-	pos = strtok(NULL, ":");
+static void free_conditions(struct fc_conditions *conds)
+{
+	for (unsigned int i = 0; i < conds->count; i++) {
+		free(conds->blocks[i].name);
+	}
+	free(conds->blocks);
+}
 
-	if (pos == NULL) {
-		goto cleanup;
+// Record the branches enclosing an entry on it.  Returns 0 on allocation
+// failure.
+static int set_entry_conditions(struct fc_entry *entry,
+                                const struct fc_conditions *conds)
+{
+	for (unsigned int i = 0; i < conds->count; i++) {
+		const struct fc_condition *cond = &conds->blocks[i];
+		if (!cond->name) {
+			continue;
+		}
+		size_t name_len = strlen(cond->name);
+		char *str = malloc(name_len + 2);
+		if (!str) {
+			return 0;
+		}
+		char *pos = str;
+		if (!cond->defined) {
+			*pos++ = '!';
+		}
+		memcpy(pos, cond->name, name_len + 1);
+		entry->conditions = sl_array_append(entry->conditions, str);
+		if (!entry->conditions) {
+			return 0;
+		}
 	}
 
-	context->type = strdup(pos);
+	return 1;
+}
 
-	pos = strtok(NULL, ":");
+// Parse one line of an fc file, of len bytes including any trailing newline,
+// and insert it after cur unless it is skipped.  conds holds the ifdef and
+// ifndef blocks enclosing the line, and is updated for m4 lines.  Returns the
+// last node, or NULL on allocation failure.
+static struct policy_node *insert_fc_line(struct policy_node *cur,
+                                          struct fc_conditions *conds,
+                                          const char *line, size_t len,
+                                          unsigned int lineno)
+{
+	if (len <= 1 || line[0] == '#') {
+		return cur;
+	}
+	// Skip over m4 constructs, keeping track of the blocks they open
+	enum m4_line kind = classify_m4_line(line, len);
+	if (kind != M4_NONE) {
+		return update_conditions(conds, kind, line, len) ? cur : NULL;
+	}
+	// TODO: Right now whitespace parses as an error
+	// We may want to detect it and report a lower severity issue
 
-	if (pos) {
-		context->range = strdup(pos);
-		if (strtok(NULL, ":")) {
-			goto cleanup;
+	struct fc_entry *entry = parse_fc_span(line, line + len);
+	enum node_flavor flavor;
+	if (entry == NULL) {
+		flavor = NODE_ERROR;
+	} else {
+		flavor = NODE_FC_ENTRY;
+		if (!set_entry_conditions(entry, conds)) {
+			free_fc_entry(entry);
+			return NULL;
 		}
 	}
 
-	return context;
+	union node_data nd;
+	nd.fc_data = entry;
+	if (insert_policy_node_next(cur, flavor, nd, lineno) !=
+	    SELINT_SUCCESS) {
+		if (entry) {
+			free_fc_entry(entry);
+		}
+		return NULL;
+	}
 
-cleanup:
-	free_sel_context(context);
-	return NULL;
+	return cur->next;
+}
+
+struct policy_node *parse_fc_lines(struct policy_node *prev, const char *start,
+                                   const char *end, unsigned int first_lineno)
+{
+	const char *next_line;
+	unsigned int lineno = first_lineno;
+	struct fc_conditions conds = { NULL, 0, 0 };
+
+	for (const char *line = start; line < end && prev; line = next_line) {
+		const char *newline = memchr(line, '\n', (size_t)(end - line));
+		next_line = newline ? newline + 1 : end;
+
+		prev = insert_fc_line(prev, &conds, line, (size_t)(next_line - line), lineno);
+		lineno++;
+	}
+	free_conditions(&conds);
+
+	return prev;
 }
 
 struct policy_node *parse_fc_file(const char *filename)
@@ -198,55 +478,31 @@ struct policy_node *parse_fc_file(const char *filename)
 		return NULL;
 	}
 
-	struct policy_node *head = malloc(sizeof(struct policy_node));
-	memset(head, 0, sizeof(struct policy_node));
+	struct policy_node *head = calloc(1, sizeof(struct policy_node));
 	head->flavor = NODE_FC_FILE;
 
 	struct policy_node *cur = head;
 
+	// The line buffer is reused for every line, since entries are parsed
+	// into copies
 	char *line = NULL;
+	struct fc_conditions conds = { NULL, 0, 0 };
 
 	ssize_t len_read = 0;
 	size_t buf_len = 0;
 	unsigned int lineno = 0;
 	while ((len_read = getline(&line, &buf_len, fd)) != -1) {
 		lineno++;
-		if (len_read <= 1 || line[0] == '#') {
-			continue;
-		}
-		// Skip over m4 constructs
-		if (strncmp(line, "ifdef", 5) == 0 ||
-		    strncmp(line, "ifndef", 6) == 0 ||
-		    strncmp(line, "')", 2) == 0 ||
-		    strncmp(line, "', `", 4) == 0 ||
-		    strncmp(line, "',`", 3) == 0) {
-
-			continue;
-		}
-		// TODO: Right now whitespace parses as an error
-		// We may want to detect it and report a lower severity issue
-
-		struct fc_entry *entry = parse_fc_line(line);
-		enum node_flavor flavor;
-		if (entry == NULL) {
-			flavor = NODE_ERROR;
-		} else {
-			flavor = NODE_FC_ENTRY;
-		}
-
-		union node_data nd;
-		nd.fc_data = entry;
-		if (insert_policy_node_next(cur, flavor, nd, lineno) !=
-		    SELINT_SUCCESS) {
+		cur = insert_fc_line(cur, &conds, line, (size_t)len_read, lineno);
+		if (!cur) {
 			free_policy_node(head);
+			free_conditions(&conds);
+			free(line);
 			fclose(fd);
 			return NULL;
 		}
-		cur = cur->next;
-		free(line);
-		line = NULL;
-		buf_len = 0;
 	}
+	free_conditions(&conds);
 	free(line);             // getline alloc must be freed even if getline failed
 	fclose(fd);
 
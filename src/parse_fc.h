@@ -17,13 +17,38 @@
 #ifndef PARSE_FC_H
 #define PARSE_FC_H
 
+#include <stddef.h>
+
 #include "tree.h"
 
-// Takes in a null terminated string that is an fc entry and populates an fc_entry struct
-struct fc_entry *parse_fc_line(char *line);
+// Takes in a null terminated string that is an fc entry and populates an fc_entry struct.
+// The line is not modified, and no state is kept between calls.
+struct fc_entry *parse_fc_line(const char *line);
 
-struct sel_context *parse_context(char *context_str);
+struct sel_context *parse_context(const char *context_str);
 
 // Parse an fc file and return a pointer to an abstract syntax tree representing the file
 struct policy_node *parse_fc_file(const char *filename);
+
+/*********************************************
+* How a line of an fc file changes the nesting of ifdef and ifndef blocks
+* line - The line, which need not be NUL terminated
+* len - The length of the line
+* returns 1 if the line opens a block, -1 if it closes one, and 0 otherwise
+*********************************************/
+int fc_conditional_depth_change(const char *line, size_t len);
+
+/*********************************************
+* Parse part of the contents of an fc file, as parse_fc_file() would.  The
+* part must not start inside an ifdef or ifndef block, as the conditions of
+* blocks opened before it are not known.
+* prev - The node to insert the parsed entries after
+* start - The first line to parse
+* end - The end of the last line to parse
+* first_lineno - The line number of the first line
+* returns the last node inserted, prev if nothing was inserted, or NULL on
+* allocation failure
+*********************************************/
+struct policy_node *parse_fc_lines(struct policy_node *prev, const char *start,
+                                   const char *end, unsigned int first_lineno);
 #endif
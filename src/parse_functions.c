@@ -18,6 +18,7 @@
 #include <string.h>
 
 #include "parse_functions.h"
+#include "check_hooks.h"
 #include "selint_error.h"
 #include "tree.h"
 #include "template.h"
@@ -355,7 +356,7 @@ enum selint_error insert_interface_call(struct policy_node **cur, const char *if
 	if (template_name) {
 		insert_call_into_template_map(template_name, if_data);
 	} else {
-		add_template_declarations(if_name, args, NULL, module_name);
+		add_template_declarations(if_name, args, module_name);
 	}
 
 	if (0 == strcmp(if_name, "filetrans_pattern") &&
@@ -380,6 +381,26 @@ enum selint_error insert_interface_call(struct policy_node **cur, const char *if
 	return SELINT_SUCCESS;
 }
 
+enum selint_error insert_context_statement(struct policy_node **cur,
+                                           struct string_list *names,
+                                           unsigned int lineno)
+{
+	union node_data nd;
+
+	nd.sl_data = names;
+	enum selint_error ret = insert_policy_node_next(*cur,
+	                                                NODE_CONTEXT_STMT,
+	                                                nd,
+	                                                lineno);
+	if (ret != SELINT_SUCCESS) {
+		free_string_list(names);
+		return ret;
+	}
+
+	*cur = (*cur)->next;
+	return SELINT_SUCCESS;
+}
+
 enum selint_error insert_permissive_statement(struct policy_node **cur,
                                               const char *domain, unsigned int lineno)
 {
@@ -496,6 +517,39 @@ enum selint_error end_tunable_policy(struct policy_node **cur)
 	return end_block(cur, NODE_TUNABLE_POLICY);
 }
 
+enum selint_error begin_tunable_else(struct policy_node **cur,
+                                     unsigned int lineno)
+{
+	return begin_block(cur, NODE_TUNABLE_ELSE, (char *)NULL, lineno);
+}
+
+enum selint_error end_tunable_else(struct policy_node **cur)
+{
+	return end_block(cur, NODE_TUNABLE_ELSE);
+}
+
+enum selint_error begin_boolean_policy(struct policy_node **cur,
+                                       unsigned int lineno)
+{
+	return begin_block(cur, NODE_BOOLEAN_POLICY, (char *)NULL, lineno);
+}
+
+enum selint_error end_boolean_policy(struct policy_node **cur)
+{
+	return end_block(cur, NODE_BOOLEAN_POLICY);
+}
+
+enum selint_error begin_boolean_else(struct policy_node **cur,
+                                     unsigned int lineno)
+{
+	return begin_block(cur, NODE_BOOLEAN_ELSE, (char *)NULL, lineno);
+}
+
+enum selint_error end_boolean_else(struct policy_node **cur)
+{
+	return end_block(cur, NODE_BOOLEAN_ELSE);
+}
+
 enum selint_error begin_interface_def(struct policy_node **cur,
                                       enum node_flavor flavor, const char *name,
                                       unsigned int lineno)
@@ -561,6 +615,16 @@ enum selint_error end_ifdef(struct policy_node **cur)
 	return end_block(cur, NODE_IFDEF);
 }
 
+enum selint_error begin_ifdef_else(struct policy_node **cur, unsigned int lineno)
+{
+	return begin_block(cur, NODE_IFDEF_ELSE, (char *)NULL, lineno);
+}
+
+enum selint_error end_ifdef_else(struct policy_node **cur)
+{
+	return end_block(cur, NODE_IFDEF_ELSE);
+}
+
 enum selint_error save_command(struct policy_node *cur, const char *comm)
 {
 	if (comm == NULL || cur == NULL) {
@@ -573,12 +637,34 @@ enum selint_error save_command(struct policy_node *cur, const char *comm)
 		return SELINT_PARSE_ERROR;
 	}
 	comm += strlen("selint-");
-	if (0 == strncmp("disable:", comm, 8)) {
-		cur->exceptions = strdup(comm + strlen("disable:"));
+	if (0 == strncmp("disable-file:", comm, 13)) {
+		comm += strlen("disable-file:");
+		// File wide exceptions are saved on the head of the file
+		while (cur->parent) {
+			cur = cur->parent;
+		}
+		while (cur->prev) {
+			cur = cur->prev;
+		}
+	} else if (0 == strncmp("disable:", comm, 8)) {
+		comm += strlen("disable:");
 	} else {
 		return SELINT_PARSE_ERROR;
 	}
 
+	while (*comm != '\0' && *comm != '\n') {
+		unsigned int index = check_index(comm);
+		// Ids that are not checks can't be reported, so there is nothing
+		// to disable
+		if (index != CHECK_INDEX_INVALID) {
+			cur->exceptions |= CHECK_BIT(index);
+		}
+		comm += strcspn(comm, ",\n");
+		if (*comm == ',') {
+			comm++;
+		}
+	}
+
 	return SELINT_SUCCESS;
 }
 
@@ -179,6 +179,22 @@ enum selint_error insert_interface_call(struct policy_node **cur, const char *if
                                         struct string_list *args,
                                         unsigned int lineno);
 
+/**********************************
+* insert_context_statement
+* Add a node for a genfscon, sid, portcon, netifcon, nodecon or fs_use_*
+* statement at the next node in the tree.
+* cur (in, out) - The current spot in the tree.  Will be updated to point to
+* the new node
+* names (in) - The user, role and type of each context in the statement.  The
+* node takes ownership of the list.
+* lineno (in) - The line number
+*
+* Returns - SELINT error code
+**********************************/
+enum selint_error insert_context_statement(struct policy_node **cur,
+                                           struct string_list *names,
+                                           unsigned int lineno);
+
 enum selint_error insert_permissive_statement(struct policy_node **cur,
                                               const char *domain,
                                               unsigned int lineno);
@@ -239,6 +255,33 @@ enum selint_error begin_tunable_policy(struct policy_node **cur,
 
 enum selint_error end_tunable_policy(struct policy_node **cur);
 
+/**********************************
+* begin_tunable_else / end_tunable_else
+* Open and close the block for the arguments of a tunable_policy after the
+* first, which apply when the tunable is false.  The block is the next node
+* after the tunable_policy node, as for begin_optional_else.
+**********************************/
+enum selint_error begin_tunable_else(struct policy_node **cur,
+                                     unsigned int lineno);
+
+enum selint_error end_tunable_else(struct policy_node **cur);
+
+/**********************************
+* begin_boolean_policy / end_boolean_policy
+* begin_boolean_else / end_boolean_else
+* Open and close the blocks of a conditional statement on booleans, and of
+* its else branch, which is the next node after the if block.
+**********************************/
+enum selint_error begin_boolean_policy(struct policy_node **cur,
+                                       unsigned int lineno);
+
+enum selint_error end_boolean_policy(struct policy_node **cur);
+
+enum selint_error begin_boolean_else(struct policy_node **cur,
+                                     unsigned int lineno);
+
+enum selint_error end_boolean_else(struct policy_node **cur);
+
 enum selint_error begin_interface_def(struct policy_node **cur,
                                       enum node_flavor flavor, const char *name,
                                       unsigned int lineno);
@@ -258,12 +301,25 @@ enum selint_error begin_ifdef(struct policy_node **cur, unsigned int lineno);
 
 enum selint_error end_ifdef(struct policy_node **cur);
 
+/**********************************
+* begin_ifdef_else / end_ifdef_else
+* Open and close the block for the arguments of an ifdef or ifndef after the
+* first, which apply when the condition does not hold.  The block is the
+* next node after the ifdef node, as for begin_optional_else.
+**********************************/
+enum selint_error begin_ifdef_else(struct policy_node **cur, unsigned int lineno);
+
+enum selint_error end_ifdef_else(struct policy_node **cur);
+
 /**********************************
 * save_command
 * Save an selint control command in the tree.  These go at the end of lines
-* and modify selint behavior while checking that line.
+* and modify selint behavior while checking that line.  On a line opening a
+* block they apply to the whole block.
 * Current commands are:
-* - selint-disable:[check-id]
+* - selint-disable:[check-id](,[check-id])*
+* - selint-disable-file:[check-id](,[check-id])*, which is saved on the head
+* of the file and applies to all of it once parsing is done
 * cur (in) - The current spot in the tree.  Will be modified with information
 * about the command
 * comm (in) - What command string was in the comment
@@ -0,0 +1,496 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <uthash.h>
+
+#include "redundant.h"
+
+// Every av rule is split into the (flavor, source, target, class) keys it
+// grants permissions on, and a hash table maps each key to the rules that
+// grant on it.  A rule is covered by another if that rule is listed under
+// each of its keys with a superset of its permissions, so checking a rule
+// only needs lookups of its own keys rather than comparing it with every
+// other rule.  Names are interned to ids first, so keys are fixed size and
+// comparing the keys of two rules does not allocate.
+
+#define BITS_PER_WORD 64
+#define WORDS(count) (((count) + BITS_PER_WORD - 1) / BITS_PER_WORD)
+
+struct name_elem {
+	char *name;
+	unsigned int id;
+	UT_hash_handle hh;
+};
+
+struct indexed_rule {
+	const struct policy_node *node;
+	const char *filename;
+	// Position of the rule in the policy
+	unsigned int seq;
+	// Ids of the distinct keys the rule grants on, in increasing order
+	unsigned int *key_ids;
+	unsigned int key_count;
+	uint64_t *perms;
+};
+
+// Types and attributes, and classes, by name id
+struct rule_key {
+	uint32_t flavor;
+	uint32_t source;
+	uint32_t target;
+	uint32_t class;
+};
+
+struct rule_key_elem {
+	struct rule_key key;
+	unsigned int id;
+	// Rules granting on this key, in policy order
+	struct indexed_rule **rules;
+	unsigned int rule_count;
+	unsigned int rule_cap;
+	UT_hash_handle hh;
+};
+
+static struct name_elem *perm_ids = NULL;
+static unsigned int perm_count = 0;
+// Names used as sources, targets and classes
+static struct name_elem *name_ids = NULL;
+static unsigned int name_count = 0;
+static struct indexed_rule *rules = NULL;
+static unsigned int rule_count = 0;
+static struct rule_key_elem *keys = NULL;
+static unsigned int key_count = 0;
+
+// Whether a list only holds plain names
+static int is_plain_list(const struct string_list *names)
+{
+	for (const struct string_list *cur = names; cur; cur = cur->next) {
+		if (0 == strcmp(cur->string, "~") || 0 == strcmp(cur->string, "*") ||
+		    cur->string[0] == '-') {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static int is_indexed_rule(const struct policy_node *node)
+{
+	if (node->flavor != NODE_AV_RULE ||
+	    node->scope & (SCOPE_REQUIRE | SCOPE_INTERFACE | SCOPE_TEMPLATE)) {
+		return 0;
+	}
+
+	const struct av_rule_data *av_data = node->data.av_data;
+
+	return av_data->flavor != AV_RULE_NEVERALLOW &&
+	       is_plain_list(av_data->sources) &&
+	       is_plain_list(av_data->targets) &&
+	       is_plain_list(av_data->object_classes) &&
+	       is_plain_list(av_data->perms);
+}
+
+static struct name_elem *find_name(struct name_elem *map, const char *name)
+{
+	struct name_elem *elem;
+
+	HASH_FIND_STR(map, name, elem);
+
+	return elem;
+}
+
+static enum selint_error intern_names(struct name_elem **map, unsigned int *count,
+                                      const struct string_list *names)
+{
+	for (const struct string_list *cur = names; cur; cur = cur->next) {
+		if (find_name(*map, cur->string)) {
+			continue;
+		}
+
+		struct name_elem *elem = malloc(sizeof(struct name_elem));
+		if (!elem) {
+			return SELINT_OUT_OF_MEM;
+		}
+		elem->name = strdup(cur->string);
+		if (!elem->name) {
+			free(elem);
+			return SELINT_OUT_OF_MEM;
+		}
+		elem->id = (*count)++;
+		HASH_ADD_KEYPTR(hh, *map, elem->name, strlen(elem->name), elem);
+	}
+
+	return SELINT_SUCCESS;
+}
+
+static enum selint_error intern_rule_names(const struct av_rule_data *av_data)
+{
+	enum selint_error res = intern_names(&perm_ids, &perm_count, av_data->perms);
+
+	if (res == SELINT_SUCCESS) {
+		res = intern_names(&name_ids, &name_count, av_data->sources);
+	}
+	if (res == SELINT_SUCCESS) {
+		res = intern_names(&name_ids, &name_count, av_data->targets);
+	}
+	if (res == SELINT_SUCCESS) {
+		res = intern_names(&name_ids, &name_count, av_data->object_classes);
+	}
+
+	return res;
+}
+
+// Fill in a key from names.  Returns 0 if a name has no id, in which case no
+// rule grants on the key.
+static int make_key(struct rule_key *key, enum av_rule_flavor flavor,
+                    const char *source, const char *target, const char *class)
+{
+	const struct name_elem *source_elem = find_name(name_ids, source);
+	const struct name_elem *target_elem = find_name(name_ids, target);
+	const struct name_elem *class_elem = find_name(name_ids, class);
+
+	if (!source_elem || !target_elem || !class_elem) {
+		return 0;
+	}
+
+	key->flavor = (uint32_t)flavor;
+	key->source = source_elem->id;
+	key->target = target_elem->id;
+	key->class = class_elem->id;
+
+	return 1;
+}
+
+static struct rule_key_elem *find_key(const struct rule_key *key)
+{
+	struct rule_key_elem *elem;
+
+	HASH_FIND(hh, keys, key, sizeof(struct rule_key), elem);
+
+	return elem;
+}
+
+static struct rule_key_elem *find_or_add_key(const struct rule_key *key)
+{
+	struct rule_key_elem *elem = find_key(key);
+
+	if (!elem) {
+		elem = calloc(1, sizeof(struct rule_key_elem));
+		if (!elem) {
+			return NULL;
+		}
+		elem->key = *key;
+		elem->id = key_count++;
+		HASH_ADD(hh, keys, key, sizeof(struct rule_key), elem);
+	}
+
+	return elem;
+}
+
+static int add_rule_to_key(struct indexed_rule *rule, struct rule_key_elem *elem)
+{
+	if (elem->rule_count == elem->rule_cap) {
+		unsigned int cap = elem->rule_cap ? elem->rule_cap * 2 : 2;
+		struct indexed_rule **grown = realloc(elem->rules, cap * sizeof(struct indexed_rule *));
+		if (!grown) {
+			return 0;
+		}
+		elem->rules = grown;
+		elem->rule_cap = cap;
+	}
+	elem->rules[elem->rule_count++] = rule;
+
+	return 1;
+}
+
+static int compare_key_elems(const void *a, const void *b)
+{
+	unsigned int id_a = (*(struct rule_key_elem * const *)a)->id;
+	unsigned int id_b = (*(struct rule_key_elem * const *)b)->id;
+
+	return (id_a > id_b) - (id_a < id_b);
+}
+
+static unsigned int list_length(const struct string_list *list)
+{
+	unsigned int length = 0;
+
+	for (; list; list = list->next) {
+		length++;
+	}
+
+	return length;
+}
+
+static enum selint_error index_rule(struct indexed_rule *rule)
+{
+	const struct av_rule_data *av_data = rule->node->data.av_data;
+
+	for (const struct string_list *cur = av_data->perms; cur; cur = cur->next) {
+		unsigned int id = find_name(perm_ids, cur->string)->id;
+		rule->perms[id / BITS_PER_WORD] |= UINT64_C(1) << (id % BITS_PER_WORD);
+	}
+
+	size_t max_keys = (size_t)list_length(av_data->sources) *
+	                  list_length(av_data->targets) *
+	                  list_length(av_data->object_classes);
+	if (max_keys == 0) {
+		return SELINT_SUCCESS;
+	}
+	struct rule_key_elem **elems = malloc(max_keys * sizeof(struct rule_key_elem *));
+	rule->key_ids = malloc(max_keys * sizeof(unsigned int));
+	if (!elems || !rule->key_ids) {
+		free(elems);
+		return SELINT_OUT_OF_MEM;
+	}
+
+	size_t found = 0;
+	for (const struct string_list *source = av_data->sources; source; source = source->next) {
+		for (const struct string_list *target = av_data->targets; target; target = target->next) {
+			for (const struct string_list *class = av_data->object_classes; class; class = class->next) {
+				struct rule_key key;
+				make_key(&key, av_data->flavor, source->string,
+				         target->string, class->string);
+				elems[found] = find_or_add_key(&key);
+				if (!elems[found]) {
+					free(elems);
+					return SELINT_OUT_OF_MEM;
+				}
+				found++;
+			}
+		}
+	}
+
+	// A name listed twice gives the same key twice
+	qsort(elems, found, sizeof(struct rule_key_elem *), compare_key_elems);
+	enum selint_error res = SELINT_SUCCESS;
+	for (size_t i = 0; i < found && res == SELINT_SUCCESS; i++) {
+		if (i > 0 && elems[i] == elems[i - 1]) {
+			continue;
+		}
+		rule->key_ids[rule->key_count++] = elems[i]->id;
+		if (!add_rule_to_key(rule, elems[i])) {
+			res = SELINT_OUT_OF_MEM;
+		}
+	}
+	free(elems);
+
+	return res;
+}
+
+enum selint_error build_redundant_rule_index(const struct policy_file_list *files)
+{
+	enum selint_error res = SELINT_SUCCESS;
+
+	free_redundant_rule_index();
+
+	unsigned int count = 0;
+	for (const struct policy_file_node *file = files->head;
+	     file && res == SELINT_SUCCESS;
+	     file = file->next) {
+		for (const struct policy_node *node = file->file->ast;
+		     node && res == SELINT_SUCCESS;
+		     node = dfs_next(node)) {
+			if (is_indexed_rule(node)) {
+				count++;
+				res = intern_rule_names(node->data.av_data);
+			}
+		}
+	}
+
+	if (res != SELINT_SUCCESS || count == 0) {
+		free_redundant_rule_index();
+		return res;
+	}
+
+	rules = calloc(count, sizeof(struct indexed_rule));
+	if (!rules) {
+		free_redundant_rule_index();
+		return SELINT_OUT_OF_MEM;
+	}
+
+	for (const struct policy_file_node *file = files->head; file; file = file->next) {
+		const char *filename = strrchr(file->file->filename, '/');
+		filename = filename ? filename + 1 : file->file->filename;
+
+		for (const struct policy_node *node = file->file->ast; node; node = dfs_next(node)) {
+			if (!is_indexed_rule(node)) {
+				continue;
+			}
+			struct indexed_rule *rule = &rules[rule_count];
+
+			rule->node = node;
+			rule->filename = filename;
+			rule->seq = rule_count++;
+			rule->perms = calloc(WORDS(perm_count), sizeof(uint64_t));
+			if (!rule->perms || SELINT_SUCCESS != index_rule(rule)) {
+				free_redundant_rule_index();
+				return SELINT_OUT_OF_MEM;
+			}
+		}
+	}
+
+	return SELINT_SUCCESS;
+}
+
+// Whether other applies everywhere rule does: other is outside of any block,
+// or in a block that contains rule.  Else branches are separate blocks that
+// follow the block of the first branch, so neither branch contains the other.
+static int applies_to(const struct indexed_rule *other, const struct indexed_rule *rule)
+{
+	const struct policy_node *block = other->node->parent;
+
+	if (!block) {
+		return 1;
+	}
+
+	for (const struct policy_node *cur = rule->node->parent; cur; cur = cur->parent) {
+		if (cur == block) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+// Whether other grants on every key of rule
+static int has_keys_of(const struct indexed_rule *other, const struct indexed_rule *rule)
+{
+	if (other->key_count < rule->key_count) {
+		return 0;
+	}
+
+	// Both lists are in increasing order
+	unsigned int j = 0;
+	for (unsigned int i = 0; i < rule->key_count; i++) {
+		while (j < other->key_count && other->key_ids[j] < rule->key_ids[i]) {
+			j++;
+		}
+		if (j == other->key_count || other->key_ids[j] != rule->key_ids[i]) {
+			return 0;
+		}
+		j++;
+	}
+
+	return 1;
+}
+
+// Whether other grants every permission of rule on the keys of rule.  Of two
+// copies of a rule, the one that applies in fewer places or else comes later
+// is the one covered.
+static int covers(const struct indexed_rule *other, const struct indexed_rule *rule)
+{
+	int equal = 1;
+
+	for (unsigned int i = 0; i < WORDS(perm_count); i++) {
+		if (rule->perms[i] & ~other->perms[i]) {
+			return 0;
+		}
+		if (rule->perms[i] != other->perms[i]) {
+			equal = 0;
+		}
+	}
+
+	if (!applies_to(other, rule) || !has_keys_of(other, rule)) {
+		return 0;
+	}
+
+	// other has the keys of rule, so the same number of keys means the same keys
+	return !equal || other->key_count > rule->key_count ||
+	       !applies_to(rule, other) || other->seq < rule->seq;
+}
+
+int find_covering_rule(const struct policy_node *node,
+                       const char **filename, unsigned int *lineno)
+{
+	if (rule_count == 0 || !is_indexed_rule(node)) {
+		return 0;
+	}
+
+	const struct av_rule_data *av_data = node->data.av_data;
+	struct rule_key key;
+	if (!make_key(&key, av_data->flavor, av_data->sources->string,
+	              av_data->targets->string, av_data->object_classes->string)) {
+		return 0;
+	}
+	const struct rule_key_elem *elem = find_key(&key);
+	if (!elem) {
+		return 0;
+	}
+
+	// Any covering rule is also listed under the first key of the rule
+	const struct indexed_rule *rule = NULL;
+	for (unsigned int i = 0; i < elem->rule_count; i++) {
+		if (elem->rules[i]->node == node) {
+			rule = elem->rules[i];
+			break;
+		}
+	}
+	if (!rule) {
+		return 0;
+	}
+
+	for (unsigned int i = 0; i < elem->rule_count; i++) {
+		const struct indexed_rule *other = elem->rules[i];
+		if (other == rule || !covers(other, rule)) {
+			continue;
+		}
+		*filename = other->filename;
+		*lineno = other->node->lineno;
+		return 1;
+	}
+
+	return 0;
+}
+
+static void free_names(struct name_elem **map)
+{
+	struct name_elem *cur, *tmp;
+
+	HASH_ITER(hh, *map, cur, tmp) {
+		HASH_DEL(*map, cur);
+		free(cur->name);
+		free(cur);
+	}
+}
+
+void free_redundant_rule_index(void)
+{
+	struct rule_key_elem *cur_key, *tmp_key;
+
+	HASH_ITER(hh, keys, cur_key, tmp_key) {
+		HASH_DEL(keys, cur_key);
+		free(cur_key->rules);
+		free(cur_key);
+	}
+	key_count = 0;
+
+	for (unsigned int i = 0; i < rule_count; i++) {
+		free(rules[i].perms);
+		free(rules[i].key_ids);
+	}
+	free(rules);
+	rules = NULL;
+	rule_count = 0;
+
+	free_names(&perm_ids);
+	perm_count = 0;
+	free_names(&name_ids);
+	name_count = 0;
+}
@@ -0,0 +1,53 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REDUNDANT_H
+#define REDUNDANT_H
+
+#include "file_list.h"
+#include "selint_error.h"
+#include "tree.h"
+
+/*********************************************
+* Index the allow, auditallow and dontaudit rules in a list of files by
+* (flavor, source, target, class), replacing any previous index.  Rules in
+* interfaces and templates, and rules using ~, * or -name in their types or
+* classes, are not indexed.
+* files - The files to index
+* returns SELINT_SUCCESS or SELINT_OUT_OF_MEM
+*********************************************/
+enum selint_error build_redundant_rule_index(const struct policy_file_list *files);
+
+/*********************************************
+* Find another indexed rule that grants everything an av rule does.  The
+* other rule must have the same flavor, cover every (source, target, class)
+* of the rule with at least its permissions, and apply whenever the rule
+* does, so rules in an optional, ifdef, tunable_policy or boolean block only
+* cover rules in the same block.  The else branch of each of those is a
+* block of its own, so rules in one branch never cover rules in the other.
+* Of two identical rules, only the later one is covered.
+* Types, classes and permissions are compared by name.
+* node - The NODE_AV_RULE node to check
+* filename - Set to the name of the file the covering rule is in
+* lineno - Set to the line the covering rule is on
+* returns 1 if a covering rule was found, and 0 otherwise
+*********************************************/
+int find_covering_rule(const struct policy_node *node,
+                       const char **filename, unsigned int *lineno);
+
+void free_redundant_rule_index(void);
+
+#endif
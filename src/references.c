@@ -0,0 +1,387 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <uthash.h>
+
+#include "references.h"
+#include "template.h"
+
+struct symbol_elem {
+	char *name;
+	unsigned int id;
+	UT_hash_handle hh;
+};
+
+// What a call to an interface or template can refer to besides the names
+// written out in its body
+struct def_body {
+	// Names in the body built from the parameters, such as $1_t
+	const char **patterns;
+	unsigned int pattern_count;
+	unsigned int pattern_capacity;
+	// Calls in the body passing on the parameters
+	const struct if_call_data **calls;
+	unsigned int call_count;
+	unsigned int call_capacity;
+};
+
+static struct symbol_elem *symbol_ids = NULL;
+static unsigned int symbol_count = 0;
+static unsigned int symbol_capacity = 0;
+// All indexed by symbol id
+static unsigned int *reference_counts = NULL;
+static unsigned int *role_declarations = NULL;
+static struct def_body *bodies = NULL;
+static unsigned char *expanding = NULL;
+
+static int look_up_id(const char *name)
+{
+	struct symbol_elem *elem;
+
+	HASH_FIND(hh, symbol_ids, name, strlen(name), elem);
+	return elem ? (int)elem->id : -1;
+}
+
+static int grow_array(void **array, size_t elem_size, unsigned int old_count,
+                      unsigned int new_count)
+{
+	char *grown = realloc(*array, new_count * elem_size);
+	if (!grown) {
+		return 0;
+	}
+	memset(grown + old_count * elem_size, 0, (new_count - old_count) * elem_size);
+	*array = grown;
+	return 1;
+}
+
+// Returns the id of name, adding it if needed, or -1 if out of memory
+static int add_symbol(const char *name)
+{
+	int id = look_up_id(name);
+	if (id != -1) {
+		return id;
+	}
+
+	if (symbol_count == symbol_capacity) {
+		unsigned int capacity = symbol_capacity ? symbol_capacity * 2 : 256;
+		if (!grow_array((void **)&reference_counts, sizeof(unsigned int),
+		                symbol_capacity, capacity) ||
+		    !grow_array((void **)&role_declarations, sizeof(unsigned int),
+		                symbol_capacity, capacity) ||
+		    !grow_array((void **)&bodies, sizeof(struct def_body),
+		                symbol_capacity, capacity) ||
+		    !grow_array((void **)&expanding, sizeof(unsigned char),
+		                symbol_capacity, capacity)) {
+			return -1;
+		}
+		symbol_capacity = capacity;
+	}
+
+	struct symbol_elem *elem = malloc(sizeof(struct symbol_elem));
+	if (!elem) {
+		return -1;
+	}
+	elem->name = strdup(name);
+	if (!elem->name) {
+		free(elem);
+		return -1;
+	}
+	elem->id = symbol_count++;
+	HASH_ADD_KEYPTR(hh, symbol_ids, elem->name, strlen(elem->name), elem);
+
+	return (int)elem->id;
+}
+
+static void visit_list(const struct string_list *names,
+                       void (*visit)(const char *name, void *ctx), void *ctx)
+{
+	for (; names; names = names->next) {
+		visit(names->string, ctx);
+	}
+}
+
+// Call visit on every name a node refers to
+static void visit_references(const struct policy_node *node,
+                             void (*visit)(const char *name, void *ctx), void *ctx)
+{
+	struct type_iter it;
+	const char *name;
+
+	switch (node->flavor) {
+	case NODE_DECL:
+		// The name is declared, not referred to
+		visit_list(node->data.d_data->attrs, visit, ctx);
+		break;
+	case NODE_IF_CALL:
+		visit(node->data.ic_data->name, ctx);
+		visit_list(node->data.ic_data->args, visit, ctx);
+		break;
+	case NODE_TYPE_ALIAS:
+	case NODE_PERMISSIVE:
+		visit(node->data.str, ctx);
+		break;
+	case NODE_CONTEXT_STMT:
+		visit_list(node->data.sl_data, visit, ctx);
+		break;
+	case NODE_FC_ENTRY:
+		if (node->data.fc_data->context && node->data.fc_data->context->type) {
+			visit(node->data.fc_data->context->type, ctx);
+		}
+		break;
+	case NODE_RT_RULE:
+		visit_list(node->data.rt_data->sources, visit, ctx);
+		visit_list(node->data.rt_data->targets, visit, ctx);
+		if (node->data.rt_data->default_role) {
+			visit(node->data.rt_data->default_role, ctx);
+		}
+		break;
+	case NODE_AV_RULE:
+	case NODE_TT_RULE:
+	case NODE_ROLE_ALLOW:
+	case NODE_TYPE_ATTRIBUTE:
+		type_iter_init(&it, node);
+		while (type_iter_next(&it, &name, NULL)) {
+			visit(name, ctx);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+static void count_reference(const char *name, __attribute__((unused)) void *ctx)
+{
+	int id = name ? look_up_id(name) : -1;
+
+	if (id != -1) {
+		reference_counts[id]++;
+	}
+}
+
+static int has_param(const char *name)
+{
+	return name && strchr(name, '$') != NULL;
+}
+
+struct body_ctx {
+	struct def_body *body;
+	int out_of_mem;
+};
+
+static void add_pattern(const char *name, void *ctx)
+{
+	struct body_ctx *bctx = ctx;
+	struct def_body *body = bctx->body;
+
+	if (!has_param(name)) {
+		return;
+	}
+	if (body->pattern_count == body->pattern_capacity) {
+		unsigned int capacity = body->pattern_capacity ? body->pattern_capacity * 2 : 8;
+		const char **grown = realloc(body->patterns, capacity * sizeof(const char *));
+		if (!grown) {
+			bctx->out_of_mem = 1;
+			return;
+		}
+		body->patterns = grown;
+		body->pattern_capacity = capacity;
+	}
+	body->patterns[body->pattern_count++] = name;
+}
+
+static int add_call(struct def_body *body, const struct if_call_data *call)
+{
+	if (body->call_count == body->call_capacity) {
+		unsigned int capacity = body->call_capacity ? body->call_capacity * 2 : 8;
+		const struct if_call_data **grown =
+			realloc(body->calls, capacity * sizeof(const struct if_call_data *));
+		if (!grown) {
+			return 0;
+		}
+		body->calls = grown;
+		body->call_capacity = capacity;
+	}
+	body->calls[body->call_count++] = call;
+	return 1;
+}
+
+// Give ids to the declarations and definitions in a file, and record what
+// the bodies of the interfaces and templates refer to through their
+// parameters
+static enum selint_error index_file(const struct policy_node *ast)
+{
+	int def = -1;
+
+	for (const struct policy_node *node = ast; node; node = dfs_next(node)) {
+		if (node->flavor == NODE_INTERFACE_DEF || node->flavor == NODE_TEMP_DEF) {
+			def = add_symbol(node->data.str);
+			if (def == -1) {
+				return SELINT_OUT_OF_MEM;
+			}
+			continue;
+		}
+		if (!(node->scope & (SCOPE_INTERFACE | SCOPE_TEMPLATE))) {
+			def = -1;
+		}
+
+		if (node->flavor == NODE_DECL && !is_in_require(node) &&
+		    (node->data.d_data->flavor == DECL_TYPE ||
+		     node->data.d_data->flavor == DECL_ATTRIBUTE ||
+		     node->data.d_data->flavor == DECL_ROLE) &&
+		    !has_param(node->data.d_data->name)) {
+			int id = add_symbol(node->data.d_data->name);
+			if (id == -1) {
+				return SELINT_OUT_OF_MEM;
+			}
+			if (node->data.d_data->flavor == DECL_ROLE) {
+				role_declarations[id]++;
+			}
+		}
+
+		if (def == -1 || is_in_require(node)) {
+			continue;
+		}
+		if (node->flavor == NODE_IF_CALL) {
+			if (args_have_param(node->data.ic_data->args) &&
+			    !add_call(&bodies[def], node->data.ic_data)) {
+				return SELINT_OUT_OF_MEM;
+			}
+			continue;
+		}
+		struct body_ctx bctx = { &bodies[def], 0 };
+		visit_references(node, add_pattern, &bctx);
+		if (bctx.out_of_mem) {
+			return SELINT_OUT_OF_MEM;
+		}
+	}
+
+	return SELINT_SUCCESS;
+}
+
+// Count the references made by calling the interface or template with the
+// given id with args
+static void expand_call(int id, struct string_list *args)
+{
+	if (id == -1 || expanding[id]) {
+		return;
+	}
+	const struct def_body *body = &bodies[id];
+	if (body->pattern_count == 0 && body->call_count == 0) {
+		return;
+	}
+	expanding[id] = 1;
+
+	for (unsigned int i = 0; i < body->pattern_count; i++) {
+		char *name = replace_m4(body->patterns[i], args);
+		count_reference(name, NULL);
+		free(name);
+	}
+
+	for (unsigned int i = 0; i < body->call_count; i++) {
+		struct string_list *new_args = replace_m4_list(args, body->calls[i]->args);
+		visit_list(new_args, count_reference, NULL);
+		expand_call(look_up_id(body->calls[i]->name), new_args);
+		free_string_list(new_args);
+	}
+
+	expanding[id] = 0;
+}
+
+static void count_file(const struct policy_node *ast)
+{
+	for (const struct policy_node *node = ast; node; node = dfs_next(node)) {
+		if (is_in_require(node)) {
+			continue;
+		}
+		visit_references(node, count_reference, NULL);
+		// Calls passing on parameters are expanded with the interface or
+		// template they are in
+		if (node->flavor == NODE_IF_CALL &&
+		    !args_have_param(node->data.ic_data->args)) {
+			expand_call(look_up_id(node->data.ic_data->name),
+			            node->data.ic_data->args);
+		}
+	}
+}
+
+enum selint_error build_reference_counts(const struct policy_file_list *te_files,
+                                         const struct policy_file_list *if_files,
+                                         const struct policy_file_list *fc_files)
+{
+	const struct policy_file_list *lists[] = { te_files, if_files, fc_files };
+
+	free_reference_counts();
+
+	for (unsigned int i = 0; i < 2; i++) {
+		for (const struct policy_file_node *cur = lists[i]->head; cur; cur = cur->next) {
+			enum selint_error res = index_file(cur->file->ast);
+			if (res != SELINT_SUCCESS) {
+				free_reference_counts();
+				return res;
+			}
+		}
+	}
+
+	for (unsigned int i = 0; i < 3; i++) {
+		for (const struct policy_file_node *cur = lists[i]->head; cur; cur = cur->next) {
+			count_file(cur->file->ast);
+		}
+	}
+
+	// Roles are declared again to add types to them
+	for (unsigned int id = 0; id < symbol_count; id++) {
+		if (role_declarations[id] > 1) {
+			reference_counts[id] += role_declarations[id] - 1;
+		}
+	}
+
+	return SELINT_SUCCESS;
+}
+
+int count_references(const char *name)
+{
+	int id = look_up_id(name);
+
+	return id == -1 ? -1 : (int)reference_counts[id];
+}
+
+void free_reference_counts(void)
+{
+	struct symbol_elem *elem, *tmp;
+
+	HASH_ITER(hh, symbol_ids, elem, tmp) {
+		HASH_DEL(symbol_ids, elem);
+		free(elem->name);
+		free(elem);
+	}
+
+	for (unsigned int id = 0; id < symbol_count; id++) {
+		free(bodies[id].patterns);
+		free(bodies[id].calls);
+	}
+	free(bodies);
+	free(reference_counts);
+	free(role_declarations);
+	free(expanding);
+	bodies = NULL;
+	reference_counts = NULL;
+	role_declarations = NULL;
+	expanding = NULL;
+	symbol_count = 0;
+	symbol_capacity = 0;
+}
@@ -0,0 +1,47 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef REFERENCES_H
+#define REFERENCES_H
+
+#include "file_list.h"
+#include "selint_error.h"
+
+/*********************************************
+* Count the references to every type, attribute and role declared outside of
+* a require block, and every interface and template defined, in a set of
+* files, replacing any previous counts.  A reference is any use of the name
+* other than its declaration or a require of it, including uses produced by
+* substituting the arguments of an interface or template call into the body
+* of the interface or template.  Later declarations of a role, such as
+* "role system_r types foo_t;", count as references to it.
+* te_files, if_files, fc_files - The parsed files to count in
+* returns SELINT_SUCCESS or SELINT_OUT_OF_MEM
+*********************************************/
+enum selint_error build_reference_counts(const struct policy_file_list *te_files,
+                                         const struct policy_file_list *if_files,
+                                         const struct policy_file_list *fc_files);
+
+/*********************************************
+* Get the number of references to a name counted by build_reference_counts()
+* name - The name of the type, attribute, role, interface or template
+* returns the number of references, or -1 if the name was not declared
+*********************************************/
+int count_references(const char *name);
+
+void free_reference_counts(void);
+
+#endif
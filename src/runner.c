@@ -15,6 +15,7 @@
 */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <libgen.h>
 
@@ -22,12 +23,23 @@
 #include "fc_checks.h"
 #include "if_checks.h"
 #include "te_checks.h"
+#include "output.h"
 #include "parse_fc.h"
+#include "file_loader.h"
+#include "parallel.h"
+#include "neverallow.h"
+#include "redundant.h"
+#include "references.h"
+#include "fc_conflicts.h"
+#include "call_graph.h"
+#include "header_index.h"
+#include "xref.h"
 #include "util.h"
 #include "startup.h"
 
-extern FILE *yyin;
 extern int yyparse(void);
+extern int set_lex_buffer(char *buf, size_t size);
+extern void clear_lex_buffer(void);
 struct policy_node *ast;        // Must be global so the parser can access it
 extern int yylineno;
 extern const char *parsing_filename;
@@ -35,7 +47,25 @@ extern struct policy_node *cur;
 
 #define CHECK_ENABLED(cid) is_check_enabled(cid, config_enabled_checks, config_disabled_checks, cl_enabled_checks, cl_disabled_checks, only_enabled)
 
-struct policy_node *parse_one_file(const char *filename, enum node_flavor flavor)
+// fc files are read in batches of this many files, and split into parts of
+// about FC_PARSE_CHUNK_SIZE bytes that are parsed in parallel
+#define FC_BATCH_FILES 64
+#define FC_PARSE_CHUNK_SIZE (256 * 1024)
+// Number of nodes of an fc file checked as one parallel work item
+#define FC_CHECK_CHUNK_NODES 4096
+
+// File flavors checks can report issues in.  Checks are only dispatched for
+// the files they apply to.
+#define TE_ONLY FILE_MASK(FILE_TE_FILE)
+#define IF_ONLY FILE_MASK(FILE_IF_FILE)
+#define FC_ONLY FILE_MASK(FILE_FC_FILE)
+#define TE_AND_IF (FILE_MASK(FILE_TE_FILE) | FILE_MASK(FILE_IF_FILE))
+
+// Parse a file that has already been read by read_file_for_lexing().  Takes
+// ownership of input, which may be NULL if the file could not be read.
+static struct policy_node *parse_file_contents(const char *filename,
+                                               enum node_flavor flavor,
+                                               char *input, size_t size)
 {
 
 	ast = calloc(1, sizeof(struct policy_node));
@@ -47,24 +77,43 @@ struct policy_node *parse_one_file(const char *filename, enum node_flavor flavor
 	yylineno = 1;
 	free(copy);
 
-	yyin = fopen(filename, "r");
-	if (!yyin) {
+	if (!input || 0 != set_lex_buffer(input, size)) {
 		printf("Error opening %s\n", filename);
+		free(input);
 		free_policy_node(ast);
 		return NULL;
 	}
 	parsing_filename = filename;
-	if (0 != yyparse()) {
+	int parse_ret = yyparse();
+	clear_lex_buffer();
+	free(input);
+	if (0 != parse_ret) {
 		free_policy_node(ast);
 		return NULL;
 	}
-	fclose(yyin);
 	cur = NULL;
 
+	// File wide exceptions were saved on the head while parsing
+	if (ast->exceptions) {
+		for (struct policy_node *node = dfs_next(ast); node; node = dfs_next(node)) {
+			node->exceptions |= ast->exceptions;
+		}
+	}
+
+	ast = flatten_policy_tree(ast);
+
 	// dont run cleanup_parsing until everything is done because it frees the maps
 	return ast;
 }
 
+struct policy_node *parse_one_file(const char *filename, enum node_flavor flavor)
+{
+	size_t size = 0;
+	char *input = read_file_for_lexing(filename, &size);
+
+	return parse_file_contents(filename, flavor, input, size);
+}
+
 int is_check_enabled(const char *check_name,
                      struct string_list *config_enabled_checks,
                      struct string_list *config_disabled_checks,
@@ -116,80 +165,116 @@ struct checks *register_checks(char level,
 	switch (level) {
 	case 'C':
 		if (CHECK_ENABLED("C-001")) {
-			add_check(NODE_TE_FILE, ck, "C-001",
-			          check_te_order);
-			add_check(NODE_DECL, ck, "C-001",
-			          check_te_order);
-			add_check(NODE_AV_RULE, ck, "C-001",
-			          check_te_order);
-			add_check(NODE_IF_CALL, ck, "C-001",
-			          check_te_order);
-			add_check(NODE_TT_RULE, ck, "C-001",
-			          check_te_order);
-			add_check(NODE_CLEANUP, ck, "C-001",
-			          check_te_order);
+			add_check_for_files(TE_ONLY, NODE_TE_FILE, ck, "C-001",
+			                    check_te_order);
+			add_check_for_files(TE_ONLY, NODE_DECL, ck, "C-001",
+			                    check_te_order);
+			add_check_for_files(TE_ONLY, NODE_AV_RULE, ck, "C-001",
+			                    check_te_order);
+			add_check_for_files(TE_ONLY, NODE_IF_CALL, ck, "C-001",
+			                    check_te_order);
+			add_check_for_files(TE_ONLY, NODE_TT_RULE, ck, "C-001",
+			                    check_te_order);
+			add_check_for_files(TE_ONLY, NODE_CLEANUP, ck, "C-001",
+			                    check_te_order);
 		}
 		if (CHECK_ENABLED("C-004")) {
-			add_check(NODE_INTERFACE_DEF, ck, "C-004",
-			          check_interface_definitions_have_comment);
-			add_check(NODE_TEMP_DEF, ck, "C-004",
-			          check_interface_definitions_have_comment);
+			add_check_for_files(TE_AND_IF, NODE_INTERFACE_DEF, ck, "C-004",
+			                    check_interface_definitions_have_comment);
+			add_check_for_files(TE_AND_IF, NODE_TEMP_DEF, ck, "C-004",
+			                    check_interface_definitions_have_comment);
 		}
 		// FALLTHRU
 	case 'S':
 		if (CHECK_ENABLED("S-001")) {
-			add_check(NODE_REQUIRE, ck, "S-001", check_require_block);
-			add_check(NODE_GEN_REQ, ck, "S-001", check_require_block);
+			add_check_for_files(TE_ONLY, NODE_REQUIRE, ck, "S-001", check_require_block);
+			add_check_for_files(TE_ONLY, NODE_GEN_REQ, ck, "S-001", check_require_block);
 		}
 		if (CHECK_ENABLED("S-002")) {
-			add_check(NODE_FC_ENTRY, ck, "S-002",
-			          check_file_context_types_in_mod);
+			add_check_for_files(FC_ONLY, NODE_FC_ENTRY, ck, "S-002",
+			                    check_file_context_types_in_mod);
 		}
 		if (CHECK_ENABLED("S-003")) {
-			add_check(NODE_SEMICOLON, ck, "S-003",
-			          check_useless_semicolon);
+			add_check_for_files(TE_AND_IF, NODE_SEMICOLON, ck, "S-003",
+			                    check_useless_semicolon);
+		}
+		if (CHECK_ENABLED("S-004")) {
+			add_check_for_files(TE_ONLY, NODE_AV_RULE, ck, "S-004",
+			                    check_redundant_av_rule);
+		}
+		if (CHECK_ENABLED("S-005")) {
+			add_check_for_files(TE_AND_IF, NODE_INTERFACE_DEF, ck, "S-005",
+			                    check_unused_interface);
+			add_check_for_files(TE_AND_IF, NODE_TEMP_DEF, ck, "S-005",
+			                    check_unused_interface);
+		}
+		if (CHECK_ENABLED("S-006")) {
+			add_check_for_files(FC_ONLY, NODE_FC_ENTRY, ck, "S-006",
+			                    check_file_context_duplicates);
 		}
 		// FALLTHRU
 	case 'W':
 		if (CHECK_ENABLED("W-001")) {
-			add_check(NODE_AV_RULE, ck, "W-001", check_no_explicit_declaration);
-			add_check(NODE_IF_CALL, ck, "W-001", check_no_explicit_declaration);
-			add_check(NODE_TT_RULE, ck, "W-001", check_no_explicit_declaration);
+			add_check_for_files(TE_ONLY, NODE_AV_RULE, ck, "W-001", check_no_explicit_declaration);
+			add_check_for_files(TE_ONLY, NODE_IF_CALL, ck, "W-001", check_no_explicit_declaration);
+			add_check_for_files(TE_ONLY, NODE_TT_RULE, ck, "W-001", check_no_explicit_declaration);
 		}
 		if (CHECK_ENABLED("W-002")) {
-			add_check(NODE_AV_RULE, ck, "W-002",
-			          check_type_used_but_not_required_in_if);
-			add_check(NODE_IF_CALL, ck, "W-002",
-			          check_type_used_but_not_required_in_if);
-			add_check(NODE_TT_RULE, ck, "W-002",
-			          check_type_used_but_not_required_in_if);
+			add_check_for_files(TE_AND_IF, NODE_AV_RULE, ck, "W-002",
+			                    check_type_used_but_not_required_in_if);
+			add_check_for_files(TE_AND_IF, NODE_IF_CALL, ck, "W-002",
+			                    check_type_used_but_not_required_in_if);
+			add_check_for_files(TE_AND_IF, NODE_TT_RULE, ck, "W-002",
+			                    check_type_used_but_not_required_in_if);
 		}
 		if (CHECK_ENABLED("W-003")) {
-			add_check(NODE_DECL, ck, "W-003",
-			          check_type_required_but_not_used_in_if);
+			add_check_for_files(TE_AND_IF, NODE_DECL, ck, "W-003",
+			                    check_type_required_but_not_used_in_if);
 		}
 		if (CHECK_ENABLED("W-004")) {
-			add_check(NODE_FC_ENTRY, ck, "W-004", check_file_context_regex);
+			add_check_for_files(FC_ONLY, NODE_FC_ENTRY, ck, "W-004", check_file_context_regex);
 		}
 		if (CHECK_ENABLED("W-005")) {
-			add_check(NODE_IF_CALL, ck, "W-005",
-			          check_module_if_call_in_optional);
+			add_check_for_files(TE_AND_IF, NODE_IF_CALL, ck, "W-005",
+			                    check_module_if_call_in_optional);
+		}
+		if (CHECK_ENABLED("W-006")) {
+			add_check_for_files(TE_ONLY, NODE_DECL, ck, "W-006",
+			                    check_unused_declaration);
+		}
+		if (CHECK_ENABLED("W-007")) {
+			add_check_for_files(FC_ONLY, NODE_FC_ENTRY, ck, "W-007",
+			                    check_file_context_shadowed);
 		}
 		// FALLTHRU
 	case 'E':
 		if (CHECK_ENABLED("E-002")) {
-			add_check(NODE_ERROR, ck, "E-002",
-			          check_file_context_error_nodes);
+			add_check_for_files(FC_ONLY, NODE_ERROR, ck, "E-002",
+			                    check_file_context_error_nodes);
 		}
 		if (CHECK_ENABLED("E-003")) {
-			add_check(NODE_FC_ENTRY, ck, "E-003", check_file_context_users);
+			add_check_for_files(FC_ONLY, NODE_FC_ENTRY, ck, "E-003", check_file_context_users);
 		}
 		if (CHECK_ENABLED("E-004")) {
-			add_check(NODE_FC_ENTRY, ck, "E-004", check_file_context_roles);
+			add_check_for_files(FC_ONLY, NODE_FC_ENTRY, ck, "E-004", check_file_context_roles);
 		}
 		if (CHECK_ENABLED("E-005")) {
-			add_check(NODE_FC_ENTRY, ck, "E-005",
-			          check_file_context_types_exist);
+			add_check_for_files(FC_ONLY, NODE_FC_ENTRY, ck, "E-005",
+			                    check_file_context_types_exist);
+		}
+		if (CHECK_ENABLED("E-006")) {
+			add_check_for_files(TE_ONLY, NODE_AV_RULE, ck, "E-006",
+			                    check_allow_violates_neverallow);
+			add_check_for_files(TE_ONLY, NODE_IF_CALL, ck, "E-006",
+			                    check_call_violates_neverallow);
+		}
+		if (CHECK_ENABLED("E-007")) {
+			add_check_for_files(TE_AND_IF, NODE_AV_RULE, ck, "E-007",
+			                    check_perms_in_class);
+		}
+		if (CHECK_ENABLED("E-008")) {
+			add_check_for_files(FC_ONLY, NODE_FC_ENTRY, ck, "E-008",
+			                    check_file_context_conflicts);
 		}
 	case 'F':
 		break;
@@ -198,6 +283,11 @@ struct checks *register_checks(char level,
 		return NULL;
 	}
 
+	if (SELINT_SUCCESS != compile_checks(ck)) {
+		free_checks(ck);
+		return NULL;
+	}
+
 	return ck;
 }
 
@@ -205,38 +295,301 @@ enum selint_error parse_all_files_in_list(struct policy_file_list *files, enum n
 {
 
 	struct policy_file_node *current = files->head;
+	struct file_loader *loader = start_file_loader(files, FILE_LOADER_DEPTH);
 
 	while (current) {
 		print_if_verbose("Parsing %s\n", current->file->filename);
-		current->file->ast = parse_one_file(current->file->filename, flavor);
+		size_t size = 0;
+		char *input = loader ? file_loader_next(loader, &size) :
+		              read_file_for_lexing(current->file->filename, &size);
+		current->file->ast = parse_file_contents(current->file->filename,
+		                                         flavor, input, size);
 		ast = NULL;
 		if (!current->file->ast) {
+			stop_file_loader(loader);
 			return SELINT_PARSE_ERROR;
 		}
 		current = current->next;
 	}
 
+	stop_file_loader(loader);
+
 	return SELINT_SUCCESS;
 
 }
 
-enum selint_error parse_all_fc_files_in_list(struct policy_file_list *files)
+// Parse the definitions in the devel headers that the policy being checked
+// calls, directly or through other header definitions.  The te files are
+// scanned as text, since parsing them needs the templates they call.
+static enum selint_error load_called_headers(struct policy_file_list *te_files,
+                                             struct policy_file_list *if_files,
+                                             struct policy_file_list *context_files)
 {
+	enum selint_error res = index_header_files(context_files);
+	if (res != SELINT_SUCCESS) {
+		return res;
+	}
 
-	struct policy_file_node *current = files->head;
+	for (const struct policy_file_node *file = if_files->head; file; file = file->next) {
+		for (const struct policy_node *node = file->file->ast; node; node = dfs_next(node)) {
+			if (node->flavor != NODE_IF_CALL) {
+				continue;
+			}
+			res = request_header_definition(node->data.ic_data->name);
+			if (res != SELINT_SUCCESS) {
+				return res;
+			}
+		}
+	}
 
-	while (current) {
-		print_if_verbose("Parsing fc file %s\n", current->file->filename);
-		current->file->ast = parse_fc_file(current->file->filename);
+	for (const struct policy_file_node *file = te_files->head; file; file = file->next) {
+		res = request_header_definitions_in_file(file->file->filename);
+		if (res != SELINT_SUCCESS && res != SELINT_IO_ERROR) {
+			return res;
+		}
+	}
+
+	print_if_verbose("Parsing %u definitions from devel headers\n",
+	                 requested_definition_count());
+
+	unsigned int index = 0;
+	for (struct policy_file_node *current = context_files->head; current;
+	     current = current->next, index++) {
+		size_t size = 0;
+		char *input = read_requested_definitions(index, &size);
+		if (!input) {
+			continue;
+		}
+		current->file->ast = parse_file_contents(current->file->filename,
+		                                         NODE_IF_FILE, input, size);
+		ast = NULL;
 		if (!current->file->ast) {
-			return SELINT_PARSE_ERROR;
+			// The definitions may depend on something else in the file
+			print_if_verbose("Parsing all of %s\n", current->file->filename);
+			current->file->ast = parse_one_file(current->file->filename,
+			                                    NODE_IF_FILE);
+			ast = NULL;
+			if (!current->file->ast) {
+				return SELINT_PARSE_ERROR;
+			}
 		}
-		current = current->next;
 	}
 
 	return SELINT_SUCCESS;
 }
 
+// A part of an fc file, parsed on its own
+struct fc_parse_item {
+	const char *start;
+	const char *end;
+	unsigned int first_lineno;
+	// Head of the parsed entries, and the last one, which is NULL on
+	// allocation failure
+	struct policy_node head;
+	struct policy_node *last;
+};
+
+// A batch of fc files being read and parsed
+struct fc_parse_batch {
+	struct policy_file_node *files[FC_BATCH_FILES];
+	char *contents[FC_BATCH_FILES];
+	size_t sizes[FC_BATCH_FILES];
+	struct fc_parse_item *items;
+};
+
+static void read_fc_file(void *ctx, unsigned int item)
+{
+	struct fc_parse_batch *batch = ctx;
+
+	batch->contents[item] = read_file_for_lexing(batch->files[item]->file->filename,
+	                                             &batch->sizes[item]);
+}
+
+static void parse_fc_part(void *ctx, unsigned int item)
+{
+	struct fc_parse_item *part = &((struct fc_parse_batch *)ctx)->items[item];
+
+	part->last = parse_fc_lines(&part->head, part->start, part->end,
+	                            part->first_lineno);
+}
+
+// Free the entries of a part of a file that could not be parsed completely
+static void free_fc_part(struct fc_parse_item *part)
+{
+	struct policy_node *node = part->head.next;
+
+	// fc entries have no children, and freeing them one at a time avoids
+	// recursing through the whole list
+	while (node) {
+		struct policy_node *next = node->next;
+		node->next = NULL;
+		free_policy_node(node);
+		node = next;
+	}
+}
+
+// Split the contents of a file into parts of about FC_PARSE_CHUNK_SIZE bytes
+// at line boundaries outside of ifdef and ifndef blocks, appending them to
+// items and updating count.  Returns SELINT_SUCCESS, or SELINT_OUT_OF_MEM, in
+// which case items is unchanged.
+static enum selint_error split_fc_file(const char *contents, size_t size,
+                                       struct fc_parse_item **items,
+                                       unsigned int *count, unsigned int *cap)
+{
+	// The contents end in two NUL bytes that are not part of the file
+	const char *end = contents + size - 2;
+	const char *start = contents;
+	unsigned int lineno = 1;
+
+	do {
+		const char *split = end;
+		unsigned int part_lines = 0;
+		if ((size_t)(end - start) > FC_PARSE_CHUNK_SIZE) {
+			// Walk the lines to keep track of the blocks they are in
+			int depth = 0;
+			split = start;
+			while (split < end &&
+			       (depth > 0 || (size_t)(split - start) < FC_PARSE_CHUNK_SIZE)) {
+				const char *newline = memchr(split, '\n', (size_t)(end - split));
+				const char *next_line = newline ? newline + 1 : end;
+				depth += fc_conditional_depth_change(split, (size_t)(next_line - split));
+				if (depth < 0) {
+					depth = 0;
+				}
+				part_lines += newline != NULL;
+				split = next_line;
+			}
+		} else {
+			for (const char *nl = start; (nl = memchr(nl, '\n', (size_t)(split - nl))); nl++) {
+				part_lines++;
+			}
+		}
+
+		if (*count == *cap) {
+			unsigned int new_cap = *cap ? *cap * 2 : 16;
+			struct fc_parse_item *grown =
+				realloc(*items, new_cap * sizeof(struct fc_parse_item));
+			if (!grown) {
+				return SELINT_OUT_OF_MEM;
+			}
+			*items = grown;
+			*cap = new_cap;
+		}
+		struct fc_parse_item *part = &(*items)[(*count)++];
+		memset(part, 0, sizeof(struct fc_parse_item));
+		part->start = start;
+		part->end = split;
+		part->first_lineno = lineno;
+
+		lineno += part_lines;
+		start = split;
+	} while (start < end);
+
+	return SELINT_SUCCESS;
+}
+
+enum selint_error parse_all_fc_files_in_list(struct policy_file_list *files)
+{
+
+	struct policy_file_node *current = files->head;
+
+	if (get_parallel_jobs() == 1) {
+		// Stream each file through the parser rather than reading it whole
+		while (current) {
+			print_if_verbose("Parsing fc file %s\n", current->file->filename);
+			current->file->ast = flatten_policy_tree(parse_fc_file(current->file->filename));
+			if (!current->file->ast) {
+				return SELINT_PARSE_ERROR;
+			}
+			current = current->next;
+		}
+
+		return SELINT_SUCCESS;
+	}
+
+	struct fc_parse_batch batch;
+	unsigned int cap = 0;
+	enum selint_error ret = SELINT_SUCCESS;
+
+	batch.items = NULL;
+
+	while (current && ret == SELINT_SUCCESS) {
+		unsigned int file_count = 0;
+		while (current && file_count < FC_BATCH_FILES) {
+			print_if_verbose("Parsing fc file %s\n", current->file->filename);
+			batch.files[file_count++] = current;
+			current = current->next;
+		}
+
+		run_in_parallel(file_count, read_fc_file, &batch);
+
+		// Each file starts at this item
+		unsigned int first_item[FC_BATCH_FILES + 1];
+		unsigned int item_count = 0;
+		for (unsigned int i = 0; i < file_count && ret == SELINT_SUCCESS; i++) {
+			first_item[i] = item_count;
+			if (batch.contents[i]) {
+				ret = split_fc_file(batch.contents[i], batch.sizes[i],
+				                    &batch.items, &item_count, &cap);
+			}
+		}
+		first_item[file_count] = item_count;
+
+		if (ret != SELINT_SUCCESS) {
+			// Nothing has been parsed yet
+			for (unsigned int i = 0; i < file_count; i++) {
+				free(batch.contents[i]);
+			}
+			break;
+		}
+
+		run_in_parallel(item_count, parse_fc_part, &batch);
+
+		// Join the parts of each file in order, behind a new head
+		for (unsigned int i = 0; i < file_count; i++) {
+			int parsed = batch.contents[i] != NULL;
+			for (unsigned int j = first_item[i]; j < first_item[i + 1]; j++) {
+				if (!batch.items[j].last) {
+					parsed = 0;
+				}
+			}
+			free(batch.contents[i]);
+
+			if (!parsed) {
+				for (unsigned int j = first_item[i]; j < first_item[i + 1]; j++) {
+					free_fc_part(&batch.items[j]);
+				}
+				ret = SELINT_PARSE_ERROR;
+				continue;
+			}
+
+			struct policy_node *head = calloc(1, sizeof(struct policy_node));
+			if (!head) {
+				for (unsigned int j = first_item[i]; j < first_item[i + 1]; j++) {
+					free_fc_part(&batch.items[j]);
+				}
+				ret = SELINT_OUT_OF_MEM;
+				continue;
+			}
+			head->flavor = NODE_FC_FILE;
+			struct policy_node *tail = head;
+			for (unsigned int j = first_item[i]; j < first_item[i + 1]; j++) {
+				struct fc_parse_item *part = &batch.items[j];
+				if (part->head.next) {
+					tail->next = part->head.next;
+					tail->next->prev = tail;
+					tail = part->last;
+				}
+			}
+			batch.files[i]->file->ast = flatten_policy_tree(head);
+		}
+	}
+
+	free(batch.items);
+
+	return ret;
+}
+
 enum selint_error run_checks_on_one_file(struct checks *ck,
                                          struct check_data *data,
                                          struct policy_node *head)
@@ -244,7 +597,7 @@ enum selint_error run_checks_on_one_file(struct checks *ck,
 	struct policy_node *current = head;
 
 	while (current) {
-		enum selint_error res = call_checks(ck, data, current);
+		enum selint_error res = dispatch_checks(ck, data, current);
 		if (res != SELINT_SUCCESS) {
 			return res;
 		}
@@ -257,13 +610,161 @@ enum selint_error run_checks_on_one_file(struct checks *ck,
 	memset(&cleanup, 0, sizeof(struct policy_node));
 	cleanup.flavor = NODE_CLEANUP;
 
-	return call_checks(ck, data, &cleanup);
+	return dispatch_checks(ck, data, &cleanup);
+}
+
+// Part of an fc file, checked on its own
+struct fc_check_item {
+	struct checks *ck;
+	const struct check_data *data;
+	struct policy_node *first;
+	unsigned int count;
+	// Set on the last part of a file, which runs the cleanup checks
+	int last;
+	struct output_buffer *out;
+	enum selint_error res;
+};
+
+static void check_fc_part(void *ctx, unsigned int item)
+{
+	struct fc_check_item *part = &((struct fc_check_item *)ctx)[item];
+	struct policy_node *node = part->first;
+
+	output_set_thread_buffer(part->out);
+
+	part->res = SELINT_SUCCESS;
+	for (unsigned int i = 0; i < part->count && part->res == SELINT_SUCCESS; i++) {
+		part->res = dispatch_checks(part->ck, part->data, node);
+		node = dfs_next(node);
+	}
+
+	if (part->last && part->res == SELINT_SUCCESS) {
+		struct policy_node cleanup;
+		memset(&cleanup, 0, sizeof(struct policy_node));
+		cleanup.flavor = NODE_CLEANUP;
+		part->res = dispatch_checks(part->ck, part->data, &cleanup);
+	}
+
+	output_set_thread_buffer(NULL);
+}
+
+// Check a batch of parts in parallel, then write out their findings in order
+static enum selint_error check_fc_parts(struct fc_check_item *parts, unsigned int count)
+{
+	enum selint_error res = SELINT_SUCCESS;
+
+	for (unsigned int i = 0; i < count; i++) {
+		parts[i].out = make_output_buffer(0);
+		if (!parts[i].out) {
+			res = SELINT_OUT_OF_MEM;
+		}
+	}
+
+	if (res == SELINT_SUCCESS) {
+		run_in_parallel(count, check_fc_part, parts);
+	}
+
+	for (unsigned int i = 0; i < count; i++) {
+		if (parts[i].out && res == SELINT_SUCCESS) {
+			output_buffer_flush(parts[i].out);
+			res = parts[i].res;
+		}
+		free_output_buffer(parts[i].out);
+	}
+
+	return res;
+}
+
+// fc checks only read state that is shared between files, so unlike the other
+// checks, they can run on several parts of the fc files at once.  Findings are
+// written in the same order as when checking one node at a time.
+static enum selint_error run_all_fc_checks(struct checks *ck,
+                                           struct policy_file_list *files)
+{
+	if (!ck->dispatch) {
+		enum selint_error res = compile_checks(ck);
+		if (res != SELINT_SUCCESS) {
+			return res;
+		}
+	}
+
+	// Anything reported so far comes first
+	output_flush();
+
+	unsigned int batch_size = get_parallel_jobs() * 4;
+	struct fc_check_item *parts = calloc(batch_size, sizeof(struct fc_check_item));
+	if (!parts) {
+		return SELINT_OUT_OF_MEM;
+	}
+
+	// The check data of every file in the list, in order
+	unsigned int file_count = 0;
+	for (struct policy_file_node *file = files->head; file; file = file->next) {
+		file_count++;
+	}
+	struct check_data *data = calloc(file_count ? file_count : 1, sizeof(struct check_data));
+	if (!data) {
+		free(parts);
+		return SELINT_OUT_OF_MEM;
+	}
+
+	enum selint_error res = SELINT_SUCCESS;
+	unsigned int part_count = 0;
+	unsigned int i = 0;
+	for (struct policy_file_node *file = files->head;
+	     file && res == SELINT_SUCCESS;
+	     file = file->next, i++) {
+
+		data[i].flavor = FILE_FC_FILE;
+		data[i].filename = strdup(basename(file->file->filename));
+		data[i].mod_name = strdup(data[i].filename);
+
+		char *suffix_ptr = rindex(data[i].mod_name, '.');
+
+		*suffix_ptr = '\0';
+
+		struct policy_node *node = file->file->ast;
+		do {
+			struct fc_check_item *part = &parts[part_count++];
+			part->ck = ck;
+			part->data = &data[i];
+			part->first = node;
+			part->count = 0;
+			while (node && part->count < FC_CHECK_CHUNK_NODES) {
+				part->count++;
+				node = dfs_next(node);
+			}
+			part->last = (node == NULL);
+
+			if (part_count == batch_size) {
+				res = check_fc_parts(parts, part_count);
+				part_count = 0;
+			}
+		} while (node && res == SELINT_SUCCESS);
+	}
+
+	if (res == SELINT_SUCCESS) {
+		res = check_fc_parts(parts, part_count);
+	}
+
+	for (unsigned int j = 0; j < file_count; j++) {
+		free(data[j].filename);
+		free(data[j].mod_name);
+	}
+	free(data);
+	free(parts);
+
+	return res;
 }
 
 enum selint_error run_all_checks(struct checks *ck, enum file_flavor flavor,
                                  struct policy_file_list *files)
 {
 
+	if (flavor == FILE_FC_FILE && get_parallel_jobs() > 1) {
+		return run_all_fc_checks(ck, files);
+	}
+
 	struct policy_file_node *file = files->head;
 
 	struct check_data data;
@@ -295,6 +796,19 @@ enum selint_error run_all_checks(struct checks *ck, enum file_flavor flavor,
 	return SELINT_SUCCESS;
 }
 
+// Whether a check with the given id is run on nodes of the given flavor
+static int is_check_registered(const struct checks *ck, enum node_flavor flavor,
+                               const char *check_id)
+{
+	for (const struct check_node *check = ck->check_nodes[flavor]; check; check = check->next) {
+		if (0 == strcmp(check->check_id, check_id)) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
 enum selint_error run_analysis(struct checks *ck,
                                struct policy_file_list *te_files,
                                struct policy_file_list *if_files,
@@ -309,13 +823,20 @@ enum selint_error run_analysis(struct checks *ck,
 		goto out;
 	}
 
-	res = parse_all_files_in_list(context_files, NODE_IF_FILE); //TODO: This can eventually
-	                                                            // include te files too
+	res = load_called_headers(te_files, if_files, context_files);
 	if (res != SELINT_SUCCESS) {
 		goto out;
 	}
 
-	mark_transform_interfaces(if_files);
+	res = build_call_graph(if_files);
+	if (res != SELINT_SUCCESS) {
+		goto out;
+	}
+
+	res = mark_transform_interfaces(if_files);
+	if (res != SELINT_SUCCESS) {
+		goto out;
+	}
 
 	res = parse_all_files_in_list(te_files, NODE_TE_FILE);
 	if (res != SELINT_SUCCESS) {
@@ -327,6 +848,38 @@ enum selint_error run_analysis(struct checks *ck,
 		goto out;
 	}
 
+	if (is_check_registered(ck, NODE_AV_RULE, "E-006")) {
+		res = build_neverallow_index(te_files, if_files);
+		if (res != SELINT_SUCCESS) {
+			goto out;
+		}
+	}
+
+	if (is_check_registered(ck, NODE_AV_RULE, "S-004")) {
+		res = build_redundant_rule_index(te_files);
+		if (res != SELINT_SUCCESS) {
+			goto out;
+		}
+	}
+
+	if (is_check_registered(ck, NODE_DECL, "W-006") ||
+	    is_check_registered(ck, NODE_INTERFACE_DEF, "S-005")) {
+		res = build_reference_counts(te_files, if_files, fc_files);
+		if (res != SELINT_SUCCESS) {
+			goto out;
+		}
+	}
+
+	if (is_check_registered(ck, NODE_FC_ENTRY, "S-006") ||
+	    is_check_registered(ck, NODE_FC_ENTRY, "E-008") ||
+	    is_check_registered(ck, NODE_FC_ENTRY, "W-007")) {
+		res = build_fc_conflict_index(fc_files,
+		                              is_check_registered(ck, NODE_FC_ENTRY, "W-007"));
+		if (res != SELINT_SUCCESS) {
+			goto out;
+		}
+	}
+
 	res = run_all_checks(ck, FILE_TE_FILE, te_files);
 	if (res != SELINT_SUCCESS) {
 		goto out;
@@ -342,6 +895,45 @@ enum selint_error run_analysis(struct checks *ck,
 		goto out;
 	}
 
+out:
+	output_flush();
+
+	free_neverallow_index();
+	free_redundant_rule_index();
+	free_call_graph();
+	free_reference_counts();
+	free_interface_names();
+	free_fc_conflict_index();
+	free_header_index();
+	cleanup_parsing();
+
+	return res;
+}
+
+enum selint_error run_xref_build(struct policy_file_list *te_files,
+                                 struct policy_file_list *if_files,
+                                 struct policy_file_list *fc_files,
+                                 const char *db_path)
+{
+	enum selint_error res;
+
+	res = parse_all_files_in_list(if_files, NODE_IF_FILE);
+	if (res != SELINT_SUCCESS) {
+		goto out;
+	}
+
+	res = parse_all_files_in_list(te_files, NODE_TE_FILE);
+	if (res != SELINT_SUCCESS) {
+		goto out;
+	}
+
+	res = parse_all_fc_files_in_list(fc_files);
+	if (res != SELINT_SUCCESS) {
+		goto out;
+	}
+
+	res = write_xref_db(te_files, if_files, fc_files, db_path);
+
 out:
 	cleanup_parsing();
 
@@ -105,6 +105,20 @@ enum selint_error run_analysis(struct checks *ck,
                                struct policy_file_list *fc_files,
                                struct policy_file_list *context_files);
 
+/****************************************************
+* Parse all files and write a cross-reference index of them, instead of
+* running any checks
+* te_files - The list of te files to index
+* if_files - The list of if files to index
+* fc_files - The list of fc files to index
+* db_path - The file to write the index to
+* Returns SELINT_SUCCESS on success or an error code
+****************************************************/
+enum selint_error run_xref_build(struct policy_file_list *te_files,
+                                 struct policy_file_list *if_files,
+                                 struct policy_file_list *fc_files,
+                                 const char *db_path);
+
 /****************************************************
 * Display a summary of the analysis that was just run
 * ck - The checks structure
@@ -18,10 +18,56 @@
 #include <stdio.h>
 
 #include "startup.h"
+#include "av_cache.h"
+#include "call_graph.h"
 #include "maps.h"
 #include "tree.h"
+#include "util.h"
 
-void load_access_vectors_normal(const char *av_path)
+static int is_space(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static char *strip_space(char *str)
+{
+
+	while (is_space(*str)) {
+		str++;
+	}
+
+	char *end = str;
+
+	while (!is_space(*end)) {
+		end++;
+	}
+
+	*end = '\0';
+
+	return str;
+}
+
+// Read the bit of a permission from its file in selinuxfs, which holds the
+// permission's value, counting from 1
+static int read_perm_bit(const char *path)
+{
+	FILE *fd = fopen(path, "r");
+	int value = 0;
+
+	if (!fd) {
+		return -1;
+	}
+	if (fscanf(fd, "%d", &value) != 1) {
+		value = 0;
+	}
+	fclose(fd);
+
+	return value - 1;
+}
+
+// Call fn with each class and permission found under av_path, in the order
+// fts visits them
+static void walk_access_vectors(const char *av_path, av_entry_fn fn, void *ctx)
 {
 
 	const char **paths = calloc(2, sizeof(char *));
@@ -41,13 +87,23 @@ void load_access_vectors_normal(const char *av_path)
 		    && 0 != strcmp(file->fts_name, "perms")) {
 			// Directory being visited the first time
 
-			insert_into_decl_map(file->fts_name, "class",
-			                     DECL_CLASS);
+			fn(ctx, AV_ENTRY_CLASS, NULL, file->fts_name, -1);
 		} else if (file->fts_info == FTS_F
 		           && 0 != strcmp(file->fts_name, "index")) {
 			// File
 
-			insert_into_decl_map(file->fts_name, "perm", DECL_PERM);
+			int bit = -1;
+			if (file->fts_level == 3) {
+				// <class>/perms/<perm>
+				bit = read_perm_bit(file->fts_accpath);
+			}
+			if (bit >= 0) {
+				fn(ctx, AV_ENTRY_CLASS_PERM,
+				   file->fts_parent->fts_parent->fts_name,
+				   file->fts_name, bit);
+			} else {
+				fn(ctx, AV_ENTRY_PERM, NULL, file->fts_name, -1);
+			}
 		}
 		file = fts_read(ftsp);
 	}
@@ -55,37 +111,276 @@ void load_access_vectors_normal(const char *av_path)
 	free(paths);
 }
 
-void load_access_vectors_source()
+static void insert_av_entry(__attribute__((unused)) void *ctx, enum av_entry_kind kind,
+                            const char *class_name, const char *name, int bit)
 {
+	switch (kind) {
+	case AV_ENTRY_CLASS:
+		insert_into_decl_map(name, "class", DECL_CLASS);
+		insert_into_class_perms_map(name, NULL, -1);
+		break;
+	case AV_ENTRY_PERM:
+		insert_into_decl_map(name, "perm", DECL_PERM);
+		break;
+	case AV_ENTRY_CLASS_PERM:
+		insert_into_decl_map(name, "perm", DECL_PERM);
+		insert_into_class_perms_map(class_name, name, bit);
+		break;
+	}
+}
 
+// Insert an entry and save it for the cache
+static void insert_and_cache_av_entry(void *ctx, enum av_entry_kind kind,
+                                      const char *class_name, const char *name, int bit)
+{
+	insert_av_entry(NULL, kind, class_name, name, bit);
+	av_cache_add(ctx, kind, class_name, name, bit);
 }
 
-void load_modules_normal()
+void load_access_vectors_normal(const char *av_path)
 {
+	walk_access_vectors(av_path, insert_av_entry, NULL);
+}
+
+enum selint_error load_access_vectors_cached(const char *selinuxfs_path,
+                                             const char *cache_path)
+{
+	size_t len = strlen(selinuxfs_path) + sizeof("/class");
+	char *av_path = malloc(len);
+	if (!av_path) {
+		return SELINT_OUT_OF_MEM;
+	}
+	snprintf(av_path, len, "%s/class", selinuxfs_path);
+
+	struct av_cache_key key;
+	enum selint_error res = read_av_cache_key(selinuxfs_path, &key);
+	if (res != SELINT_SUCCESS || !cache_path) {
+		load_access_vectors_normal(av_path);
+		free(av_path);
+		return res == SELINT_OUT_OF_MEM ? res : SELINT_SUCCESS;
+	}
+
+	if (SELINT_SUCCESS == replay_av_cache(cache_path, &key, insert_av_entry, NULL)) {
+		print_if_verbose("Loaded access vectors from %s\n", cache_path);
+		free(av_path);
+		return SELINT_SUCCESS;
+	}
 
+	struct av_cache *cache = make_av_cache();
+	if (!cache) {
+		free(av_path);
+		return SELINT_OUT_OF_MEM;
+	}
+	walk_access_vectors(av_path, insert_and_cache_av_entry, cache);
+	res = write_av_cache(cache, &key, cache_path);
+	if (res != SELINT_SUCCESS) {
+		print_if_verbose("Failed to write access vector cache %s: %d\n",
+		                 cache_path, res);
+	}
+
+	free_av_cache(cache);
+	free(av_path);
+	return SELINT_SUCCESS;
 }
 
-static int is_space(char c)
+// Split a flask file (security_classes or access_vectors) into words, with
+// braces as words of their own and comments removed
+static enum selint_error read_flask_words(const char *path, struct string_list **words)
 {
-	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+	FILE *fd = fopen(path, "r");
+
+	if (!fd) {
+		return SELINT_IO_ERROR;
+	}
+
+	struct string_list *head = NULL;
+	struct string_list *tail = NULL;
+	char *line = NULL;
+	size_t buf_len = 0;
+	while (getline(&line, &buf_len, fd) != -1) {
+		char *comment = strchr(line, '#');
+		if (comment) {
+			*comment = '\0';
+		}
+		char *pos = line;
+		while (*pos) {
+			if (is_space(*pos)) {
+				pos++;
+				continue;
+			}
+			size_t len = 1;
+			if (*pos != '{' && *pos != '}') {
+				while (pos[len] && !is_space(pos[len]) &&
+				       pos[len] != '{' && pos[len] != '}') {
+					len++;
+				}
+			}
+			struct string_list *word = calloc(1, sizeof(struct string_list));
+			if (!word) {
+				free(line);
+				fclose(fd);
+				free_string_list(head);
+				return SELINT_OUT_OF_MEM;
+			}
+			word->string = strndup(pos, len);
+			if (tail) {
+				tail->next = word;
+			} else {
+				head = word;
+			}
+			tail = word;
+			pos += len;
+		}
+	}
+	free(line);
+	fclose(fd);
+
+	*words = head;
+	return SELINT_SUCCESS;
 }
 
-static char *strip_space(char *str)
+struct common_perms {
+	const char *name;
+	// The words of the common, from its first permission up to the
+	// closing brace
+	const struct string_list *perms;
+	struct common_perms *next;
+};
+
+static enum selint_error add_class_perm(const char *class_name, const char *perm_name)
 {
+	insert_into_decl_map(perm_name, "perm", DECL_PERM);
 
-	while (is_space(*str)) {
-		str++;
+	return insert_into_class_perms_map(class_name, perm_name, -1);
+}
+
+// Parse the words of an access_vectors file.  Permissions are numbered in
+// the order they are listed, inherited ones first, as the kernel does.
+static enum selint_error load_access_vector_words(const struct string_list *words)
+{
+	enum selint_error res = SELINT_SUCCESS;
+	struct common_perms *commons = NULL;
+	const struct string_list *cur = words;
+
+	while (cur && res == SELINT_SUCCESS) {
+		int is_common = 0 == strcmp(cur->string, "common");
+		if ((!is_common && 0 != strcmp(cur->string, "class")) || !cur->next) {
+			res = SELINT_PARSE_ERROR;
+			break;
+		}
+		const char *name = cur->next->string;
+		cur = cur->next->next;
+
+		if (is_common) {
+			if (!cur || 0 != strcmp(cur->string, "{")) {
+				res = SELINT_PARSE_ERROR;
+				break;
+			}
+			struct common_perms *common = malloc(sizeof(struct common_perms));
+			if (!common) {
+				res = SELINT_OUT_OF_MEM;
+				break;
+			}
+			common->name = name;
+			common->perms = cur->next;
+			common->next = commons;
+			commons = common;
+		} else {
+			res = insert_into_class_perms_map(name, NULL, -1);
+			insert_into_decl_map(name, "class", DECL_CLASS);
+
+			if (cur && 0 == strcmp(cur->string, "inherits")) {
+				if (!cur->next) {
+					res = SELINT_PARSE_ERROR;
+					break;
+				}
+				const struct common_perms *common = commons;
+				while (common && 0 != strcmp(common->name, cur->next->string)) {
+					common = common->next;
+				}
+				if (!common) {
+					res = SELINT_PARSE_ERROR;
+					break;
+				}
+				for (const struct string_list *perm = common->perms;
+				     perm && 0 != strcmp(perm->string, "}") && res == SELINT_SUCCESS;
+				     perm = perm->next) {
+					res = add_class_perm(name, perm->string);
+				}
+				cur = cur->next->next;
+			}
+			if (!cur || 0 != strcmp(cur->string, "{")) {
+				// No permissions of its own
+				continue;
+			}
+		}
+
+		// Skip to the closing brace, adding the permissions of a class
+		for (cur = cur->next;
+		     cur && 0 != strcmp(cur->string, "}") && res == SELINT_SUCCESS;
+		     cur = cur->next) {
+			if (0 == strcmp(cur->string, "{")) {
+				res = SELINT_PARSE_ERROR;
+			} else if (!is_common) {
+				res = add_class_perm(name, cur->string);
+			}
+		}
+		if (!cur && res == SELINT_SUCCESS) {
+			res = SELINT_PARSE_ERROR;
+		} else if (cur) {
+			cur = cur->next;
+		}
 	}
 
-	char *end = str;
+	while (commons) {
+		struct common_perms *next = commons->next;
+		free(commons);
+		commons = next;
+	}
 
-	while (!is_space(*end)) {
-		end++;
+	return res;
+}
+
+enum selint_error load_access_vectors_source(const char *security_classes_path,
+                                             const char *access_vectors_path)
+{
+	struct string_list *words = NULL;
+
+	enum selint_error res = read_flask_words(security_classes_path, &words);
+	if (res != SELINT_SUCCESS) {
+		return res;
 	}
 
-	*end = '\0';
+	// Classes are declared in order with "class <name>"
+	for (const struct string_list *cur = words; cur && res == SELINT_SUCCESS;
+	     cur = cur->next->next) {
+		if (0 != strcmp(cur->string, "class") || !cur->next) {
+			res = SELINT_PARSE_ERROR;
+			break;
+		}
+		insert_into_decl_map(cur->next->string, "class", DECL_CLASS);
+		res = insert_into_class_perms_map(cur->next->string, NULL, -1);
+	}
+	free_string_list(words);
+	if (res != SELINT_SUCCESS) {
+		return res;
+	}
+
+	words = NULL;
+	res = read_flask_words(access_vectors_path, &words);
+	if (res != SELINT_SUCCESS) {
+		return res;
+	}
+
+	res = load_access_vector_words(words);
+	free_string_list(words);
+
+	return res;
+}
+
+void load_modules_normal()
+{
 
-	return str;
 }
 
 enum selint_error load_modules_source(const char *modules_conf_path)
@@ -137,35 +432,51 @@ enum selint_error load_modules_source(const char *modules_conf_path)
 	return SELINT_SUCCESS;
 }
 
-static int mark_transform_interfaces_one_file(struct policy_node *ast) {
-	int marked_transform = 0;
-	struct policy_node *cur = ast;
-	while (cur) {
-		if (cur->flavor == NODE_INTERFACE_DEF &&
-		    cur->first_child &&
-		    !is_transform_if(cur->data.str)) {
-			struct policy_node *child = cur->first_child;
-			while (child &&
-			       (child->flavor == NODE_START_BLOCK ||
-			        child->flavor == NODE_REQUIRE ||
-			        child->flavor == NODE_GEN_REQ)) {
-				child = child->next;
-			}
-			if (!child) {
-				// Nothing in interface besides possibly require
-				cur = dfs_next(cur);
-				continue;
-			}
-			if (child->flavor == NODE_IF_CALL) {
-				if (is_transform_if(child->data.ic_data->name)) {
-					mark_transform_if(cur->data.str);
-					marked_transform = 1;
-				}
-			}
+struct transform_candidate {
+	const char *if_name;
+	const char *first_call;
+	unsigned int component;
+};
+
+static int compare_candidates(const void *left, const void *right)
+{
+	const struct transform_candidate *l = left;
+	const struct transform_candidate *r = right;
+
+	return (l->component > r->component) - (l->component < r->component);
+}
+
+// Find the interfaces in ast that start with an interface call, besides
+// possibly a require.  candidates must have room for every interface in ast.
+static unsigned int find_transform_candidates(const struct policy_node *ast,
+                                              struct transform_candidate *candidates)
+{
+	unsigned int count = 0;
+
+	for (const struct policy_node *cur = ast; cur; cur = dfs_next(cur)) {
+		if (cur->flavor != NODE_INTERFACE_DEF || !cur->first_child) {
+			continue;
+		}
+		const struct policy_node *child = cur->first_child;
+		while (child &&
+		       (child->flavor == NODE_START_BLOCK ||
+		        child->flavor == NODE_REQUIRE ||
+		        child->flavor == NODE_GEN_REQ)) {
+			child = child->next;
 		}
-		cur = dfs_next(cur);
+		if (!child || child->flavor != NODE_IF_CALL) {
+			continue;
+		}
+		int id = call_graph_id(cur->data.str);
+		candidates[count].if_name = cur->data.str;
+		candidates[count].first_call = child->data.ic_data->name;
+		// Interfaces outside the graph go last
+		candidates[count].component = id == -1 ? (unsigned int)-1 :
+		                              call_graph_component((unsigned int)id);
+		count++;
 	}
-	return marked_transform;
+
+	return count;
 }
 
 enum selint_error load_devel_headers(struct policy_file_list *context_files)
@@ -199,17 +510,52 @@ enum selint_error load_devel_headers(struct policy_file_list *context_files)
 
 enum selint_error mark_transform_interfaces(struct policy_file_list *files)
 {
-	struct policy_file_node *cur;
-	int marked_transform;
-	do {
-		marked_transform = 0;
-		cur = files->head;
-		while (cur) {
-			marked_transform = marked_transform ||
-			                   mark_transform_interfaces_one_file(cur->file->ast);
-			cur = cur->next;
+	unsigned int total = 0;
+
+	for (const struct policy_file_node *cur = files->head; cur; cur = cur->next) {
+		for (const struct policy_node *node = cur->file->ast; node; node = dfs_next(node)) {
+			if (node->flavor == NODE_INTERFACE_DEF) {
+				total++;
+			}
 		}
-	} while (marked_transform);
+	}
+
+	struct transform_candidate *candidates = malloc((total + 1) * sizeof(struct transform_candidate));
+	if (!candidates) {
+		return SELINT_OUT_OF_MEM;
+	}
+
+	unsigned int count = 0;
+	for (const struct policy_file_node *cur = files->head; cur; cur = cur->next) {
+		count += find_transform_candidates(cur->file->ast, candidates + count);
+	}
+
+	// An interface's first call is to one in its own component or an
+	// earlier one, so visiting the components callees first means only
+	// interfaces that call each other need more than one pass
+	qsort(candidates, count, sizeof(struct transform_candidate), compare_candidates);
+
+	unsigned int begin = 0;
+	while (begin < count) {
+		unsigned int end = begin + 1;
+		while (end < count && candidates[end].component == candidates[begin].component) {
+			end++;
+		}
+		int marked_transform;
+		do {
+			marked_transform = 0;
+			for (unsigned int i = begin; i < end; i++) {
+				if (!is_transform_if(candidates[i].if_name) &&
+				    is_transform_if(candidates[i].first_call)) {
+					mark_transform_if(candidates[i].if_name);
+					marked_transform = 1;
+				}
+			}
+		} while (marked_transform);
+		begin = end;
+	}
+
+	free(candidates);
 
 	return SELINT_SUCCESS;
 }
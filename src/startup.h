@@ -22,7 +22,23 @@
 
 void load_access_vectors_normal(const char *av_path);
 
-void load_access_vectors_source(void);
+/*********************************************
+* Load classes and permissions from selinuxfs as
+* load_access_vectors_normal() does, through a cache.  If the cache at
+* cache_path was written for the policy currently loaded, as told by
+* policyvers and the inode and change time of the class directory, it is
+* read instead of the class directory.  Otherwise the class directory is read and the cache is
+* rewritten.
+* selinuxfs_path - The selinuxfs mount, or a directory standing in for it
+* cache_path - The cache file, or NULL to not use a cache
+* returns SELINT_SUCCESS, even if the cache could not be written, or
+* SELINT_OUT_OF_MEM
+*********************************************/
+enum selint_error load_access_vectors_cached(const char *selinuxfs_path,
+                                             const char *cache_path);
+
+enum selint_error load_access_vectors_source(const char *security_classes_path,
+                                             const char *access_vectors_path);
 
 void load_modules_normal(void);
 
@@ -30,6 +46,7 @@ enum selint_error load_modules_source(const char *modules_conf_path);
 
 enum selint_error load_devel_headers(struct policy_file_list *context_files);
 
+// Expects build_call_graph() to have been run on the same files
 enum selint_error mark_transform_interfaces(struct policy_file_list *files);
 
 #endif
@@ -14,6 +14,7 @@
 * limitations under the License.
 */
 
+#include <assert.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -36,38 +37,116 @@ int str_in_sl(const char *str, struct string_list *sl)
 
 struct string_list *copy_string_list(struct string_list *sl)
 {
-	if (!sl) {
-		return NULL;
-	}
-	struct string_list *ret = malloc(sizeof(struct string_list));
-	struct string_list *cur = ret;
+	struct string_list *ret = NULL;
 
 	while (sl) {
-		cur->string = strdup(sl->string);
-		cur->has_incorrect_space = sl->has_incorrect_space;
-
-		if (sl->next) {
-			cur->next = malloc(sizeof(struct string_list));
-		} else {
-			cur->next = NULL;
+		ret = sl_array_append(ret, strdup(sl->string));
+		if (!ret) {
+			return NULL;
 		}
+		ret[ret->array_len - 1].has_incorrect_space = sl->has_incorrect_space;
 		sl = sl->next;
-		cur = cur->next;
 	}
 	return ret;
 }
 
-void free_string_list(struct string_list *list)
+static int is_array_head(const struct string_list *sl)
+{
+	return sl->in_array && sl->array_len != 0;
+}
+
+// Entries after the first of an array are owned by the first
+static int is_array_interior(const struct string_list *sl)
+{
+	return sl && sl->in_array && sl->array_len == 0;
+}
+
+struct string_list *sl_array_append(struct string_list *sl, char *string)
+{
+	if (sl && !is_array_head(sl)) {
+		return sl_concat(sl, sl_array_append(NULL, string));
+	}
+
+	unsigned int len = sl ? sl->array_len : 0;
+
+	// The capacity is the next power of two, so grow whenever len is one
+	if ((len & (len - 1)) == 0) {
+		unsigned int new_cap = len ? len * 2 : 1;
+		struct string_list *grown = realloc(sl, new_cap * sizeof(struct string_list));
+		if (!grown) {
+			free_string_list(sl);
+			free(string);
+			return NULL;
+		}
+		sl = grown;
+		// The entries may have moved, so relink them
+		for (unsigned int i = 0; i + 1 < len; i++) {
+			sl[i].next = &sl[i + 1];
+		}
+	}
+
+	struct string_list *item = &sl[len];
+	item->string = string;
+	item->next = NULL;
+	item->has_incorrect_space = 0;
+	item->in_array = 1;
+	item->array_len = 0;
+	if (len) {
+		sl[len - 1].next = item;
+	}
+	sl->array_len = len + 1;
+
+	return sl;
+}
+
+struct string_list *sl_concat(struct string_list *first, struct string_list *second)
 {
-	if (list == NULL) {
-		return;
+	assert(!is_array_interior(second));
+
+	if (!first) {
+		return second;
+	}
+
+	if (!is_array_head(first)) {
+		struct string_list *cur = first;
+		while (cur->next) {
+			cur = cur->next;
+		}
+		cur->next = second;
+		return first;
+	}
+
+	for (struct string_list *cur = second; cur; cur = cur->next) {
+		first = sl_array_append(first, cur->string);
+		cur->string = NULL;
+		if (!first) {
+			free_string_list(second);
+			return NULL;
+		}
+		first[first->array_len - 1].has_incorrect_space = cur->has_incorrect_space;
 	}
-	struct string_list *cur = list;
+	free_string_list(second);
 
-	while (cur) {
-		struct string_list *to_free = cur;
-		cur = cur->next;
+	return first;
+}
+
+void free_string_list(struct string_list *list)
+{
+	// Arrays are freed once all of their entries have been walked
+	struct string_list *array = NULL;
+
+	assert(!is_array_interior(list));
+
+	while (list) {
+		struct string_list *to_free = list;
+		list = list->next;
 		free(to_free->string);
-		free(to_free);
+		if (is_array_head(to_free)) {
+			free(array);
+			array = to_free;
+		} else if (!to_free->in_array) {
+			free(to_free);
+		}
 	}
+	free(array);
 }
@@ -17,17 +17,60 @@
 #ifndef STRING_LIST_H
 #define STRING_LIST_H
 
+/**********************************
+* A list of strings, linked through next.
+*
+* Lists made by sl_array_append() and copy_string_list() store their entries
+* contiguously in one allocation, which is owned by the first entry.  Those
+* lists can be walked like any other, but only as a whole can they be
+* freed, concatenated or appended to:
+* - free_string_list() and the second list of sl_concat() must be the head
+*   of such a list, never an entry after it.
+* - An entry must not be unlinked or freed on its own.  Copy the entries to
+*   keep instead.
+* Passing an entry from the middle of an array list to free_string_list() or
+* sl_concat() fails an assertion.
+**********************************/
 struct string_list {
 	char *string;
 	struct string_list *next;
 	int has_incorrect_space;
+	// Set on entries of lists made by sl_array_append()
+	unsigned int in_array : 1;
+	// On the first entry of such a list, the number of entries in it, and 0
+	// on the others
+	unsigned int array_len : 31;
 };
 
 int str_in_sl(const char *str, struct string_list *sl);
 
-// Return an identical copy of sl
+// Return an identical copy of sl, stored as one array
 struct string_list *copy_string_list(struct string_list *sl);
 
+/**********************************
+* Append a string to a list stored as one array
+* sl - NULL to start a new list, or a list returned by this function.  The
+* list may be moved, so the returned pointer must be used afterwards.
+* string - The string to append.  The list takes ownership of it.
+* Returns the head of the list, or NULL if out of memory, in which case sl
+* and string are freed.
+**********************************/
+struct string_list *sl_array_append(struct string_list *sl, char *string);
+
+/**********************************
+* Concatenate two lists.  If first is stored as an array (see
+* sl_array_append()), the strings of second are moved into it and second is
+* freed.  Otherwise second is linked to the end of first.
+* second - The head of a list, which the combined list takes ownership of
+* Returns the head of the combined list
+**********************************/
+struct string_list *sl_concat(struct string_list *first, struct string_list *second);
+
+/**********************************
+* Free a list and its strings
+* list - The head of the list.  Must not be an entry after the first of a
+* list stored as an array.
+**********************************/
 void free_string_list(struct string_list *list);
 
 #endif
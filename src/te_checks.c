@@ -18,6 +18,9 @@
 #include "maps.h"
 #include "tree.h"
 #include "ordering.h"
+#include "neverallow.h"
+#include "redundant.h"
+#include "references.h"
 
 struct check_result *check_te_order(const struct check_data *data,
                                     const struct policy_node *node)
@@ -99,7 +102,7 @@ struct check_result *check_useless_semicolon(__attribute__((unused)) const struc
 
 // Helper for check_no_explicit_declaration.  Returns 1 is there is a require block
 // for type_name earlier in the file, and 0 otherwise
-static int has_require(const struct policy_node *node, char *type_name)
+static int has_require(const struct policy_node *node, const char *type_name)
 {
 	const struct policy_node *cur = node;
 	while (cur) {
@@ -149,32 +152,28 @@ struct check_result *check_no_explicit_declaration(const struct check_data *data
 		return NULL;
 	}
 
-	struct string_list *types = get_types_in_node(node);
-	struct string_list *type = types;
+	struct type_iter it;
+	const char *type;
 
-	while (type) {
-		char *mod_name = look_up_in_decl_map(type->string, DECL_TYPE);
+	type_iter_init(&it, node);
+	while (type_iter_next(&it, &type, NULL)) {
+		char *mod_name = look_up_in_decl_map(type, DECL_TYPE);
 		if (!mod_name) {
 			//Not a type
-			type = type->next;
 			continue;
 		}
 		if (0 != strcmp(data->mod_name, mod_name)) {
 			// It may be required
-			if (!has_require(node, type->string)) {
+			if (!has_require(node, type)) {
 				// We didn't find a require block with this type
-				struct check_result *to_ret = make_check_result('W', W_ID_NO_EXPLICIT_DECL,
-										"No explicit declaration for %s.  You should access it via interface call or use a require block.",
-										type->string);
-				free_string_list(types);
-				return to_ret;
+				return make_check_result('W', W_ID_NO_EXPLICIT_DECL,
+				                         "No explicit declaration for %s.  You should access it via interface call or use a require block.",
+				                         type);
 			}
 			// Otherwise, keep checking other types in this node
 		}
-		type = type->next;
 	}
 
-	free_string_list(types);
 	return NULL;
 }
 
@@ -207,15 +206,122 @@ struct check_result *check_module_if_call_in_optional(const struct check_data
 		return NULL;
 	}
 
-	const struct policy_node *tmp = node;
-
-	while (tmp->parent) {
-		tmp = tmp->parent;
-		if (tmp->flavor == NODE_OPTIONAL_POLICY) {
-			return NULL;
-		}
+	if (node->scope & SCOPE_OPTIONAL) {
+		return NULL;
 	}
 
 	return make_check_result('W', W_ID_IF_CALL_OPTIONAL,
 	                         "Call to interface defined in module should be in optional_policy block");
 }
+
+struct check_result *check_allow_violates_neverallow(__attribute__((unused)) const struct check_data *data,
+                                                     const struct policy_node *node)
+{
+	const struct av_rule_data *av_data = node->data.av_data;
+	const char *filename;
+	unsigned int lineno;
+
+	if (av_data->flavor != AV_RULE_ALLOW) {
+		return NULL;
+	}
+
+	if (!find_violated_neverallow(av_data, &filename, &lineno)) {
+		return NULL;
+	}
+
+	return make_check_result('E', E_ID_NEVERALLOW,
+	                         "Allow rule violates neverallow rule at %s:%u",
+	                         filename, lineno);
+}
+
+struct check_result *check_call_violates_neverallow(__attribute__((unused)) const struct check_data *data,
+                                                    const struct policy_node *node)
+{
+	const char *filename;
+	unsigned int lineno;
+
+	if (node->scope & (SCOPE_INTERFACE | SCOPE_TEMPLATE)) {
+		return NULL;
+	}
+
+	if (!find_call_violating_neverallow(node->data.ic_data, &filename, &lineno)) {
+		return NULL;
+	}
+
+	return make_check_result('E', E_ID_NEVERALLOW,
+	                         "Call to %s grants access that violates neverallow rule at %s:%u",
+	                         node->data.ic_data->name, filename, lineno);
+}
+
+struct check_result *check_redundant_av_rule(__attribute__((unused)) const struct check_data *data,
+                                             const struct policy_node *node)
+{
+	const char *filename;
+	unsigned int lineno;
+
+	if (!find_covering_rule(node, &filename, &lineno)) {
+		return NULL;
+	}
+
+	return make_check_result('S', S_ID_REDUNDANT,
+	                         "Rule is redundant with the rule at %s:%u",
+	                         filename, lineno);
+}
+
+struct check_result *check_perms_in_class(__attribute__((unused)) const struct check_data *data,
+                                          const struct policy_node *node)
+{
+	const struct av_rule_data *av_data = node->data.av_data;
+
+	for (const struct string_list *cur = av_data->object_classes; cur; cur = cur->next) {
+		const struct class_hash_elem *class_elem =
+			look_up_in_class_perms_map(cur->string);
+		if (!class_elem) {
+			// Not loaded, or not a class (e.g. ~, * or a class set macro)
+			continue;
+		}
+
+		const char *unknown;
+		make_perm_mask(class_elem, av_data->perms, &unknown);
+		if (unknown) {
+			return make_check_result('E', E_ID_UNKNOWN_PERM,
+			                         "Permission %s is not defined for class %s",
+			                         unknown, cur->string);
+		}
+	}
+
+	return NULL;
+}
+
+struct check_result *check_unused_declaration(__attribute__((unused)) const struct check_data *data,
+                                              const struct policy_node *node)
+{
+	const char *flavor;
+
+	if (is_in_require(node)) {
+		return NULL;
+	}
+
+	switch (node->data.d_data->flavor) {
+	case DECL_TYPE:
+		flavor = "Type";
+		break;
+	case DECL_ATTRIBUTE:
+		flavor = "Attribute";
+		break;
+	case DECL_ROLE:
+		flavor = "Role";
+		break;
+	default:
+		return NULL;
+	}
+
+	if (count_references(node->data.d_data->name) != 0) {
+		// Used, or not counted
+		return NULL;
+	}
+
+	return make_check_result('W', W_ID_UNUSED_DECL,
+	                         "%s %s is declared but never used",
+	                         flavor, node->data.d_data->name);
+}
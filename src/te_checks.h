@@ -83,4 +83,64 @@ struct check_result *check_module_if_call_in_optional(const struct check_data
                                                       const struct policy_node
                                                       *node);
 
+/*********************************************
+* Check for allow rules granting access that a neverallow rule forbids.
+* The neverallow rules come from the index built by build_neverallow_index().
+* Called on NODE_AV_RULE nodes.
+* data - metadata about the file currently being scanned
+* node - the node to check
+* returns NULL if passed or check_result for issue E-006
+*********************************************/
+struct check_result *check_allow_violates_neverallow(const struct check_data *data,
+                                                     const struct policy_node *node);
+
+/*********************************************
+* Check for interface and template calls whose allow rules, with the
+* arguments of the call substituted, grant access that a neverallow rule
+* forbids.  The neverallow rules come from the index built by
+* build_neverallow_index().
+* Called on NODE_IF_CALL nodes.
+* data - metadata about the file currently being scanned
+* node - the node to check
+* returns NULL if passed or check_result for issue E-006
+*********************************************/
+struct check_result *check_call_violates_neverallow(const struct check_data *data,
+                                                    const struct policy_node *node);
+
+/*********************************************
+* Check for allow, auditallow and dontaudit rules that grant nothing another
+* rule in the policy does not already grant.  The other rules come from the
+* index built by build_redundant_rule_index().
+* Called on NODE_AV_RULE nodes.
+* data - metadata about the file currently being scanned
+* node - the node to check
+* returns NULL if passed or check_result for issue S-004
+*********************************************/
+struct check_result *check_redundant_av_rule(const struct check_data *data,
+                                             const struct policy_node *node);
+
+/*********************************************
+* Check for av rules using a permission the object class does not have.
+* Only classes and permissions loaded from the kernel or the policy source
+* are checked.
+* Called on NODE_AV_RULE nodes.
+* data - metadata about the file currently being scanned
+* node - the node to check
+* returns NULL if passed or check_result for issue E-007
+*********************************************/
+struct check_result *check_perms_in_class(const struct check_data *data,
+                                          const struct policy_node *node);
+
+/*********************************************
+* Check for types, attributes and roles that are declared but never referred
+* to in the policy.  build_reference_counts() must have been run on all the
+* policy files.
+* Called on NODE_DECL nodes.
+* data - metadata about the file currently being scanned
+* node - the node to check
+* returns NULL if passed or check_result for issue W-006
+*********************************************/
+struct check_result *check_unused_declaration(const struct check_data *data,
+                                              const struct policy_node *node);
+
 #endif
@@ -19,6 +19,7 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <math.h>
+#include <uthash.h>
 
 #include "template.h"
 #include "maps.h"
@@ -94,56 +95,170 @@ struct string_list *replace_m4_list(struct string_list *replace_with,
 
 enum selint_error add_template_declarations(const char *template_name,
                                             struct string_list *args,
-                                            struct string_list
-                                            *parent_temp_names, const char *mod_name)
+                                            const char *mod_name)
 {
-	struct string_list *cur = parent_temp_names;
+	struct template_hash_elem *template = look_up_in_template_map(template_name);
 
-	while (cur) {
-		if (strcmp(cur->string, template_name) == 0) {
-			// Loop
-			free_string_list(parent_temp_names);
-			return SELINT_IF_CALL_LOOP;
-		}
-		cur = cur->next;
+	if (!template) {
+		// Not a template, so nothing is declared
+		return SELINT_SUCCESS;
 	}
 
-	cur = calloc(1, sizeof(struct string_list));
-	cur->string = strdup(template_name);
-	cur->next = parent_temp_names;
+	if (template->expanding) {
+		// Loop
+		return SELINT_IF_CALL_LOOP;
+	}
+	template->expanding = 1;
 
-	struct if_call_list *calls =
-		look_up_call_in_template_map(template_name);
+	enum selint_error res = SELINT_SUCCESS;
+	struct if_call_list *calls = template->calls;
 
-	while (calls) {
+	while (calls && res == SELINT_SUCCESS) {
 		struct string_list *new_args =
 			replace_m4_list(args, calls->call->args);
 
-		enum selint_error res =
-			add_template_declarations(calls->call->name, new_args, cur,
-			                          mod_name);
+		res = add_template_declarations(calls->call->name, new_args, mod_name);
 		free_string_list(new_args);
-		if (res != SELINT_SUCCESS) {
-			return res;
-		}
 
 		calls = calls->next;
 	}
 
-	struct decl_list *decls = look_up_decl_in_template_map(template_name);
+	struct decl_list *decls = template->declarations;
 
-	while (decls) {
+	while (decls && res == SELINT_SUCCESS) {
 		char *new_decl = replace_m4(decls->decl->name, args);
 		if (!new_decl) {
-			free(cur->string);
-			free(cur);
-			return SELINT_M4_SUB_FAILURE;
+			res = SELINT_M4_SUB_FAILURE;
+			break;
 		}
 		insert_into_decl_map(new_decl, mod_name, decls->decl->flavor);
 		free(new_decl);
 		decls = decls->next;
 	}
-	free(cur->string);
-	free(cur);
+
+	template->expanding = 0;
+	return res;
+}
+
+struct def_statements {
+	const char *name;
+	const struct policy_node **statements;
+	unsigned int statement_count;
+	unsigned int statement_cap;
+	const struct if_call_data **calls;
+	unsigned int call_count;
+	unsigned int call_cap;
+	int expanding;
+	UT_hash_handle hh;
+};
+
+int args_have_param(const struct string_list *args)
+{
+	for (; args; args = args->next) {
+		// Names containing $ are parameters
+		if (!args->string || strchr(args->string, '$')) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static int grow_array(void **array, size_t elem_size, unsigned int *cap,
+                      unsigned int count)
+{
+	if (count < *cap) {
+		return 1;
+	}
+	unsigned int new_cap = *cap ? *cap * 2 : 8;
+	void *grown = realloc(*array, new_cap * elem_size);
+	if (!grown) {
+		return 0;
+	}
+	*array = grown;
+	*cap = new_cap;
+	return 1;
+}
+
+enum selint_error index_def_statements(struct def_statements **defs,
+                                   const struct policy_node *ast,
+                                   int (*keep)(const struct policy_node *node))
+{
+	struct def_statements *def = NULL;
+
+	for (const struct policy_node *node = ast; node; node = dfs_next(node)) {
+		if (node->flavor == NODE_INTERFACE_DEF || node->flavor == NODE_TEMP_DEF) {
+			HASH_FIND(hh, *defs, node->data.str, strlen(node->data.str), def);
+			if (!def) {
+				def = calloc(1, sizeof(struct def_statements));
+				if (!def) {
+					return SELINT_OUT_OF_MEM;
+				}
+				def->name = node->data.str;
+				HASH_ADD_KEYPTR(hh, *defs, def->name, strlen(def->name), def);
+			}
+			continue;
+		}
+		if (!(node->scope & (SCOPE_INTERFACE | SCOPE_TEMPLATE))) {
+			def = NULL;
+		}
+		if (!def || (node->scope & SCOPE_REQUIRE)) {
+			continue;
+		}
+
+		if (keep(node)) {
+			if (!grow_array((void **)&def->statements, sizeof(struct policy_node *),
+			                &def->statement_cap, def->statement_count)) {
+				return SELINT_OUT_OF_MEM;
+			}
+			def->statements[def->statement_count++] = node;
+		} else if (node->flavor == NODE_IF_CALL &&
+		           args_have_param(node->data.ic_data->args)) {
+			if (!grow_array((void **)&def->calls, sizeof(struct if_call_data *),
+			                &def->call_cap, def->call_count)) {
+				return SELINT_OUT_OF_MEM;
+			}
+			def->calls[def->call_count++] = node->data.ic_data;
+		}
+	}
+
 	return SELINT_SUCCESS;
 }
+
+enum selint_error expand_def_call(struct def_statements *defs, const char *name,
+                                  struct string_list *args,
+                                  def_statement_fn fn, void *ctx)
+{
+	struct def_statements *def;
+
+	HASH_FIND(hh, defs, name, strlen(name), def);
+	if (!def || def->expanding) {
+		return SELINT_SUCCESS;
+	}
+	def->expanding = 1;
+
+	enum selint_error res = SELINT_SUCCESS;
+	for (unsigned int i = 0; i < def->statement_count && res == SELINT_SUCCESS; i++) {
+		res = fn(def->statements[i], args, ctx);
+	}
+	for (unsigned int i = 0; i < def->call_count && res == SELINT_SUCCESS; i++) {
+		struct string_list *new_args = replace_m4_list(args, def->calls[i]->args);
+		res = expand_def_call(defs, def->calls[i]->name, new_args, fn, ctx);
+		free_string_list(new_args);
+	}
+
+	def->expanding = 0;
+
+	return res;
+}
+
+void free_def_statements(struct def_statements **defs)
+{
+	struct def_statements *cur, *tmp;
+
+	HASH_ITER(hh, *defs, cur, tmp) {
+		HASH_DEL(*defs, cur);
+		free(cur->statements);
+		free(cur->calls);
+		free(cur);
+	}
+}
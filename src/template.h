@@ -22,6 +22,17 @@
 #include "selint_error.h"
 #include "tree.h"
 
+// The statements of an interface or template that a caller is interested in,
+// along with the calls in it that pass on its parameters
+struct def_statements;
+
+// Called on each statement of an expanded interface or template, with the
+// arguments to substitute for its parameters.  Anything other than
+// SELINT_SUCCESS stops the expansion and is passed on.
+typedef enum selint_error (*def_statement_fn)(const struct policy_node *node,
+                                               struct string_list *args,
+                                               void *ctx);
+
 /* Replace bash style arguments with a string */
 char *replace_m4(const char *orig, struct string_list *args);
 
@@ -30,9 +41,33 @@ char *replace_m4(const char *orig, struct string_list *args);
 struct string_list *replace_m4_list(struct string_list *replace_with,
                                     struct string_list *replace_from);
 
+/* Add the declarations of a template, and of the templates it calls, to the
+ * declaration maps, substituting args for the template's parameters.  Returns
+ * SELINT_IF_CALL_LOOP if the template ends up calling itself. */
 enum selint_error add_template_declarations(const char *template_name,
                                             struct string_list *args,
-                                            struct string_list
-                                            *parent_temp_names, const char *mod_name);
+                                            const char *mod_name);
+
+/* Check whether any of the arguments of a call is, or uses, a parameter of
+ * the interface or template the call is in. */
+int args_have_param(const struct string_list *args);
+
+/* Record the statements of the interfaces and templates in a tree for which
+ * keep() returns 1, and the calls in them that pass on their parameters, in
+ * defs.  Statements in require blocks are left out.  Returns
+ * SELINT_SUCCESS or SELINT_OUT_OF_MEM. */
+enum selint_error index_def_statements(struct def_statements **defs,
+                                   const struct policy_node *ast,
+                                   int (*keep)(const struct policy_node *node));
+
+/* Call fn on each statement recorded for an interface or template, and for
+ * the interfaces and templates it calls with its parameters, substituting
+ * args for the parameters.  Calls back into an interface that is already
+ * being expanded are not followed. */
+enum selint_error expand_def_call(struct def_statements *defs, const char *name,
+                                  struct string_list *args,
+                                  def_statement_fn fn, void *ctx);
+
+void free_def_statements(struct def_statements **defs);
 
 #endif
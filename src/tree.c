@@ -39,9 +39,11 @@ enum selint_error insert_policy_node_child(struct policy_node *parent,
 	to_insert->next = NULL;
 	to_insert->first_child = NULL;
 	to_insert->flavor = flavor;
+	to_insert->storage = NODE_ALLOCATED;
 	to_insert->data = data;
-	to_insert->exceptions = NULL;
+	to_insert->exceptions = parent->exceptions;
 	to_insert->lineno = lineno;
+	to_insert->scope = parent->scope | get_block_scope(parent->flavor);
 
 	if (parent->first_child == NULL) {
 		parent->first_child = to_insert;
@@ -82,10 +84,12 @@ enum selint_error insert_policy_node_next(struct policy_node *prev,
 	to_insert->next = NULL;
 	to_insert->first_child = NULL;
 	to_insert->flavor = flavor;
+	to_insert->storage = NODE_ALLOCATED;
 	to_insert->data = data;
 	to_insert->prev = prev;
-	to_insert->exceptions = NULL;
+	to_insert->exceptions = prev->parent ? prev->parent->exceptions : 0;
 	to_insert->lineno = lineno;
+	to_insert->scope = prev->scope;
 
 	return SELINT_SUCCESS;
 }
@@ -108,8 +112,39 @@ int is_template_call(struct policy_node *node)
 	return 0;
 }
 
+unsigned int get_block_scope(enum node_flavor flavor)
+{
+	switch (flavor) {
+	case NODE_REQUIRE:
+	case NODE_GEN_REQ:
+		return SCOPE_REQUIRE;
+	case NODE_OPTIONAL_POLICY:
+		return SCOPE_OPTIONAL;
+	case NODE_OPTIONAL_ELSE:
+		return SCOPE_OPTIONAL_ELSE;
+	case NODE_TUNABLE_POLICY:
+	case NODE_TUNABLE_ELSE:
+		return SCOPE_TUNABLE;
+	case NODE_IFDEF:
+	case NODE_IFDEF_ELSE:
+		return SCOPE_IFDEF;
+	case NODE_BOOLEAN_POLICY:
+	case NODE_BOOLEAN_ELSE:
+		return SCOPE_BOOLEAN;
+	case NODE_INTERFACE_DEF:
+		return SCOPE_INTERFACE;
+	case NODE_TEMP_DEF:
+		return SCOPE_TEMPLATE;
+	default:
+		return 0;
+	}
+}
+
 char *get_name_if_in_template(struct policy_node *cur)
 {
+	if (!(cur->scope & SCOPE_TEMPLATE)) {
+		return NULL;
+	}
 	while (cur->parent) {
 		cur = cur->parent;
 		if (cur->flavor == NODE_TEMP_DEF) {
@@ -119,94 +154,97 @@ char *get_name_if_in_template(struct policy_node *cur)
 	return NULL;
 }
 
-struct string_list *get_types_in_node(const struct policy_node *node)
+void type_iter_init(struct type_iter *it, const struct policy_node *node)
 {
+	it->node = node;
+	it->part = 0;
+	it->item = NULL;
+}
 
-	struct string_list *ret = NULL;
-	struct string_list *cur = NULL;
-	struct av_rule_data *av_data;
-	struct type_transition_data *tt_data;
-	struct role_transition_data *rt_data;
-	struct declaration_data *d_data;
-	struct if_call_data *ifc_data;
-	struct role_allow_data *ra_data;
-	struct type_attribute_data *ta_data;
+// Get operand number part of a node that holds types, as either a list or a
+// single string.  Returns 0 once there are no more operands.
+static int get_type_operand(const struct policy_node *node, unsigned int part,
+                            const struct string_list **list, const char **str)
+{
+	*list = NULL;
+	*str = NULL;
 
 	switch (node->flavor) {
 	case NODE_AV_RULE:
-		av_data = node->data.av_data;
-		cur = ret = copy_string_list(av_data->sources);
-		if (cur) {
-			while (cur->next) {
-				cur = cur->next;
-			}
-			cur->next = copy_string_list(av_data->targets);
+		if (part == 0) {
+			*list = node->data.av_data->sources;
+		} else if (part == 1) {
+			*list = node->data.av_data->targets;
 		} else {
-			ret = copy_string_list(av_data->targets);
+			return 0;
 		}
-		break;
+		return 1;
 
 	case NODE_TT_RULE:
-		tt_data = node->data.tt_data;
-		cur = ret = copy_string_list(tt_data->sources);
-		if (cur) {
-			while (cur->next) {
-				cur = cur->next;
-			}
-			cur->next = copy_string_list(tt_data->targets);
+		if (part == 0) {
+			*list = node->data.tt_data->sources;
+		} else if (part == 1) {
+			*list = node->data.tt_data->targets;
+		} else if (part == 2) {
+			*str = node->data.tt_data->default_type;
 		} else {
-			cur = ret = copy_string_list(tt_data->targets);
+			return 0;
 		}
-		if (cur) {
-			while (cur->next) {
-				cur = cur->next;
-			}
-			cur->next = calloc(1, sizeof(struct string_list));
-			cur->next->string = strdup(tt_data->default_type);
-		} else {
-			cur = ret = calloc(1, sizeof(struct string_list));
-			cur->string = strdup(tt_data->default_type);
-		}
-		break;
+		return 1;
 
 	case NODE_RT_RULE:
-		rt_data = node->data.rt_data;
-		ret = copy_string_list(rt_data->targets);
-		break;
+		if (part == 0) {
+			*list = node->data.rt_data->targets;
+		} else {
+			return 0;
+		}
+		return 1;
 
 	case NODE_DECL:
-		d_data = node->data.d_data;
-		if (d_data->name) {
-			ret = calloc(1, sizeof(struct string_list));
-			ret->string = strdup(d_data->name);
-			ret->next = copy_string_list(d_data->attrs);
+		if (part == 0) {
+			*str = node->data.d_data->name;
+		} else if (part == 1) {
+			*list = node->data.d_data->attrs;
 		} else {
-			ret = copy_string_list(d_data->attrs);
+			return 0;
 		}
-		break;
+		return 1;
 
 	case NODE_IF_CALL:
-		ifc_data = node->data.ic_data;
-		ret = copy_string_list(ifc_data->args);
-		break;
+		if (part == 0) {
+			*list = node->data.ic_data->args;
+		} else {
+			return 0;
+		}
+		return 1;
 
 	case NODE_ROLE_ALLOW:
-		ra_data = node->data.ra_data;
-		ret = calloc(1, sizeof(struct string_list));
-		ret->string = strdup(ra_data->from);
-		ret->next = calloc(1, sizeof(struct string_list));
-		ret->next->string = strdup(ra_data->to);
-		break;
+		if (part == 0) {
+			*str = node->data.ra_data->from;
+		} else if (part == 1) {
+			*str = node->data.ra_data->to;
+		} else {
+			return 0;
+		}
+		return 1;
+
 	case NODE_TYPE_ATTRIBUTE:
-		ta_data = node->data.ta_data;
-		ret = calloc(1, sizeof(struct string_list));
-		ret->string = strdup(ta_data->type);
-		ret->next = copy_string_list(ta_data->attrs);
-		break;
+		if (part == 0) {
+			*str = node->data.ta_data->type;
+		} else if (part == 1) {
+			*list = node->data.ta_data->attrs;
+		} else {
+			return 0;
+		}
+		return 1;
+
 	case NODE_ALIAS:
-		ret = calloc(1, sizeof(struct string_list));
-		ret->string = strdup(node->data.str);
-		break;
+		if (part == 0) {
+			*str = node->data.str;
+		} else {
+			return 0;
+		}
+		return 1;
 	/*
 	   NODE_M4_CALL,
 	   NODE_OPTIONAL_POLICY,
@@ -219,43 +257,55 @@ struct string_list *get_types_in_node(const struct policy_node *node)
 	   NODE_GEN_REQ,
 	 */
 	default:
-		break;
+		return 0;
 	}
+}
 
-	// Check if any of the types are exclusions
-	cur = ret;
-	while (cur) {
-		if (cur->string[0] == '-') {
-			// memmove is safe for overlapping strings
-			// Length is strlen exactly because it doesn't copy the first
-			// character, but does copy the null terminator
-			memmove(cur->string, cur->string + 1, strlen(cur->string));
+int type_iter_next(struct type_iter *it, const char **name, int *excluded)
+{
+	const char *found = NULL;
+
+	while (!found) {
+		if (it->item) {
+			found = it->item->string;
+			it->item = it->item->next;
+			continue;
+		}
+
+		const struct string_list *list;
+		if (!get_type_operand(it->node, it->part, &list, &found)) {
+			return 0;
 		}
-		cur = cur->next;
+		it->part++;
+		it->item = list;
 	}
 
-	return ret;
+	int is_excluded = (found[0] == '-');
+	if (excluded) {
+		*excluded = is_excluded;
+	}
+	*name = found + is_excluded;
 
+	return 1;
 }
 
-struct string_list *get_types_required(const struct policy_node *node)
+struct string_list *get_types_in_node(const struct policy_node *node)
 {
 	struct string_list *ret = NULL;
-	struct string_list *ret_cursor = NULL;
-
-	struct policy_node *cur = node->first_child;
+	struct string_list *cur = NULL;
+	struct type_iter it;
+	const char *name;
 
-	while (cur) {
-		if (ret_cursor) {
-			ret_cursor->next = get_types_in_node(cur);
+	type_iter_init(&it, node);
+	while (type_iter_next(&it, &name, NULL)) {
+		struct string_list *to_add = calloc(1, sizeof(struct string_list));
+		to_add->string = strdup(name);
+		if (cur) {
+			cur->next = to_add;
 		} else {
-			ret = ret_cursor = get_types_in_node(cur);
+			ret = to_add;
 		}
-		while (ret_cursor && ret_cursor->next) {
-			ret_cursor = ret_cursor->next;
-		}
-
-		cur = cur->next;
+		cur = to_add;
 	}
 
 	return ret;
@@ -263,17 +313,17 @@ struct string_list *get_types_required(const struct policy_node *node)
 
 int is_in_require(const struct policy_node *cur)
 {
-	while (cur->parent) {
-		cur = cur->parent;
-		if (cur->flavor == NODE_GEN_REQ || cur->flavor == NODE_REQUIRE) {
-			return 1;
-		}
-	}
-	return 0;
+	return (cur->scope & SCOPE_REQUIRE) ? 1 : 0;
 }
 
 struct policy_node *dfs_next(const struct policy_node *node)
 {
+	if (node->storage == NODE_FLAT) {
+		return (struct policy_node *)node + 1;
+	} else if (node->storage == NODE_FLAT_LAST) {
+		return NULL;
+	}
+
 	if (node->first_child) {
 		return node->first_child;
 	} else if (node->next) {
@@ -290,12 +340,62 @@ struct policy_node *dfs_next(const struct policy_node *node)
 	}
 }
 
-enum selint_error free_policy_node(struct policy_node *to_free)
+// Map a node of a tree being flattened to its copy in the array.  The old
+// node's next pointer has been overwritten to point at the copy.
+static struct policy_node *flat_copy_of(const struct policy_node *old)
 {
-	if (to_free == NULL) {
-		return SELINT_BAD_ARG;
+	return old ? old->next : NULL;
+}
+
+struct policy_node *flatten_policy_tree(struct policy_node *head)
+{
+	if (!head || head->storage != NODE_ALLOCATED) {
+		return head;
+	}
+
+	size_t count = 0;
+	for (const struct policy_node *node = head; node; node = dfs_next(node)) {
+		count++;
+	}
+
+	struct policy_node *flat = malloc(count * sizeof(struct policy_node));
+	struct policy_node **old = malloc(count * sizeof(struct policy_node *));
+	if (!flat || !old) {
+		free(flat);
+		free(old);
+		return head;
+	}
+
+	size_t i = 0;
+	for (struct policy_node *node = head; node; node = dfs_next(node)) {
+		old[i] = node;
+		flat[i] = *node;
+		i++;
+	}
+
+	for (i = 0; i < count; i++) {
+		old[i]->next = &flat[i];
 	}
 
+	for (i = 0; i < count; i++) {
+		flat[i].parent = flat_copy_of(flat[i].parent);
+		flat[i].next = flat_copy_of(flat[i].next);
+		flat[i].prev = flat_copy_of(flat[i].prev);
+		flat[i].first_child = flat_copy_of(flat[i].first_child);
+		flat[i].storage = (i + 1 < count) ? NODE_FLAT : NODE_FLAT_LAST;
+	}
+
+	for (i = 0; i < count; i++) {
+		free(old[i]);
+	}
+
+	free(old);
+
+	return flat;
+}
+
+static void free_policy_node_data(struct policy_node *to_free)
+{
 	switch (to_free->flavor) {
 	case NODE_AV_RULE:
 		free_av_rule_data(to_free->data.av_data);
@@ -321,15 +421,28 @@ enum selint_error free_policy_node(struct policy_node *to_free)
 	case NODE_TYPE_ATTRIBUTE:
 		free_type_attribute_data(to_free->data.ta_data);
 		break;
+	case NODE_CONTEXT_STMT:
+		free_string_list(to_free->data.sl_data);
+		break;
 	default:
 		if (to_free->data.str != NULL) {
 			free(to_free->data.str);
 		}
 		break;
 	}
+}
 
-	free(to_free->exceptions);
-	to_free->exceptions = NULL;
+enum selint_error free_policy_node(struct policy_node *to_free)
+{
+	if (to_free == NULL) {
+		return SELINT_BAD_ARG;
+	}
+
+	if (to_free->storage != NODE_ALLOCATED) {
+		return free_flat_policy_tree(to_free);
+	}
+
+	free_policy_node_data(to_free);
 
 	free_policy_node(to_free->first_child);
 	to_free->first_child = NULL;
@@ -344,6 +457,23 @@ enum selint_error free_policy_node(struct policy_node *to_free)
 	return SELINT_SUCCESS;
 }
 
+enum selint_error free_flat_policy_tree(struct policy_node *head)
+{
+	// The head of the array is the only node without a parent or a
+	// previous node
+	if (head == NULL || head->storage == NODE_ALLOCATED ||
+	    head->parent || head->prev) {
+		return SELINT_BAD_ARG;
+	}
+
+	for (struct policy_node *node = head; node; node = dfs_next(node)) {
+		free_policy_node_data(node);
+	}
+	free(head);
+
+	return SELINT_SUCCESS;
+}
+
 enum selint_error free_av_rule_data(struct av_rule_data *to_free)
 {
 
@@ -474,6 +604,7 @@ void free_fc_entry(struct fc_entry *to_free)
 	if (to_free->context) {
 		free_sel_context(to_free->context);
 	}
+	free_string_list(to_free->conditions);
 	free(to_free);
 }
 
@@ -17,6 +17,8 @@
 #ifndef TREE_H
 #define TREE_H
 
+#include <stdint.h>
+
 #include "selint_error.h"
 #include "string_list.h"
 
@@ -51,6 +53,13 @@ enum node_flavor {
 	NODE_COMMENT,
 	NODE_EMPTY,
 	NODE_SEMICOLON,         // A semicolon that is not needed to close the previous line
+	// Blocks added after the xref index format was fixed, kept here so that
+	// the flavors stored in existing indexes keep their values
+	NODE_IFDEF_ELSE,        // The branch of an ifdef or ifndef taken otherwise
+	NODE_TUNABLE_ELSE,      // The branch of a tunable_policy taken otherwise
+	NODE_BOOLEAN_POLICY,    // if (condition) { ... }
+	NODE_BOOLEAN_ELSE,      // else { ... } after a NODE_BOOLEAN_POLICY
+	NODE_CONTEXT_STMT,      // genfscon, sid, portcon, netifcon, nodecon or fs_use_*
 	NODE_CLEANUP,           // Called after each file parsing is complete so that checks
 	                        // that register on this node have a way to clean up state
 	NODE_ERROR              // When a parsing error occurs, save an error node in the tree
@@ -144,6 +153,10 @@ struct fc_entry {
 	char *path;
 	char obj;
 	struct sel_context *context;
+	// The ifdef and ifndef branches the entry is in, as the name of the
+	// condition for a branch taken when it is defined, and as the name
+	// prefixed with '!' for one taken when it is not
+	struct string_list *conditions;
 };
 
 struct type_attribute_data {
@@ -160,18 +173,45 @@ union node_data {
 	struct declaration_data *d_data;
 	struct fc_entry *fc_data;
 	struct type_attribute_data *ta_data;
+	// The user, role and type of each context of a NODE_CONTEXT_STMT
+	struct string_list *sl_data;
 	char *str;
 };
 
+// How a node is stored, see flatten_policy_tree()
+enum node_storage {
+	NODE_ALLOCATED = 0,     // Allocated on its own
+	NODE_FLAT,              // In a preorder array, followed by the next node
+	NODE_FLAT_LAST          // The last node of a preorder array
+};
+
+// Kinds of blocks a node can be nested in, see policy_node.scope
+enum node_scope {
+	SCOPE_REQUIRE = 1 << 0,         // require or gen_require
+	SCOPE_OPTIONAL = 1 << 1,        // optional_policy
+	SCOPE_OPTIONAL_ELSE = 1 << 2,   // else branch of an optional_policy
+	SCOPE_TUNABLE = 1 << 3,         // tunable_policy
+	SCOPE_IFDEF = 1 << 4,           // ifdef or ifndef
+	SCOPE_INTERFACE = 1 << 5,       // interface definition
+	SCOPE_TEMPLATE = 1 << 6,        // template definition
+	SCOPE_BOOLEAN = 1 << 7          // if or else block of a boolean
+};
+
 struct policy_node {
 	struct policy_node *parent;
 	struct policy_node *next;
 	struct policy_node *prev;
 	struct policy_node *first_child;
 	enum node_flavor flavor;
+	enum node_storage storage;
 	union node_data data;
-	char *exceptions;
+	// Checks disabled on this node, as a set of CHECK_BIT()s.  Nodes start
+	// out with the exceptions of their enclosing block.
+	uint64_t exceptions;
 	unsigned int lineno;
+	// The node_scope flags of all blocks the node is nested in, set when
+	// the node is inserted
+	unsigned int scope;
 };
 
 enum selint_error insert_policy_node_child(struct policy_node *parent,
@@ -182,14 +222,50 @@ enum selint_error insert_policy_node_next(struct policy_node *prev,
                                           enum node_flavor flavor, union node_data data,
                                           unsigned int lineno);
 
+/**********************************
+* Return the node_scope flag that a block of the given flavor sets on the
+* nodes inside of it, or 0 if the flavor does not open such a block
+**********************************/
+unsigned int get_block_scope(enum node_flavor flavor);
+
 // Returns 1 if the node is a template call, and 0 if not
 int is_template_call(struct policy_node *node);
 
 char *get_name_if_in_template(struct policy_node *cur);
 
-struct string_list *get_types_in_node(const struct policy_node *node);
+// Cursor over the names of types, attributes and roles in a node.  Names are
+// yielded in place from the node's own data, so iterating allocates nothing.
+struct type_iter {
+	const struct policy_node *node;
+	// Which of the node's operands is being walked
+	unsigned int part;
+	// Position in the operand being walked, if it is a list
+	const struct string_list *item;
+};
 
-struct string_list *get_types_required(const struct policy_node *node);
+/**********************************
+* Start iterating over the types in a node
+* it - The iterator to initialize
+* node - The node to iterate over
+**********************************/
+void type_iter_init(struct type_iter *it, const struct policy_node *node);
+
+/**********************************
+* Get the next type in a node
+* it - The iterator
+* name (out) - The name, without any leading '-'.  Points into the node, so
+* it is valid as long as the node is
+* excluded (out) - Set to 1 if the name was preceded by '-', and 0 otherwise.
+* May be NULL.
+* Returns 1 if a name was returned, and 0 at the end of the node
+**********************************/
+int type_iter_next(struct type_iter *it, const char **name, int *excluded);
+
+/**********************************
+* Return a copy of the types in a node, with any leading '-' removed.
+* Callers that only scan the types should use type_iter_next() instead.
+**********************************/
+struct string_list *get_types_in_node(const struct policy_node *node);
 
 /**********************************
 * Return 1 if the node is in a require block
@@ -200,8 +276,37 @@ int is_in_require(const struct policy_node *cur);
 //Return the next node in a depth first search of the tree
 struct policy_node *dfs_next(const struct policy_node *node);
 
+/*********************************************
+* Move a fully parsed tree into a single array holding its nodes in depth
+* first order, so that dfs_next() becomes a step to the adjacent node and
+* full tree walks are linear scans.  The node data is moved over as is.
+* The tree must not have nodes inserted into it afterwards, and it can only
+* be freed as a whole, by passing the returned head to free_policy_node()
+* or free_flat_policy_tree().
+* head - The head of the tree.  On success, its nodes are freed.
+* returns the head of the flattened tree, or head itself if it could not be
+* flattened
+*********************************************/
+struct policy_node *flatten_policy_tree(struct policy_node *head);
+
+/*********************************************
+* Free a node allocated on its own, along with its children and the nodes
+* after it.  The head of a flattened tree is freed with
+* free_flat_policy_tree().
+* to_free - The node to free
+* returns SELINT_SUCCESS, or SELINT_BAD_ARG if to_free is NULL or is a
+* node of a flattened tree other than its head
+*********************************************/
 enum selint_error free_policy_node(struct policy_node *to_free);
 
+/*********************************************
+* Free a tree returned by flatten_policy_tree()
+* head - The head of the flattened tree
+* returns SELINT_SUCCESS, or SELINT_BAD_ARG if head is NULL or is not the
+* head of a flattened tree
+*********************************************/
+enum selint_error free_flat_policy_tree(struct policy_node *head);
+
 enum selint_error free_av_rule_data(struct av_rule_data *to_free);
 
 enum selint_error free_ra_data(struct role_allow_data *to_free);
@@ -0,0 +1,509 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <uthash.h>
+
+#include "type_index.h"
+#include "template.h"
+
+#define BITS_PER_WORD 64
+
+struct index_elem {
+	char *name;
+	unsigned int id;
+	UT_hash_handle hh;
+};
+
+// A type found to be in an attribute while the index is built
+struct membership {
+	unsigned int attr_id;
+	unsigned int type_id;
+};
+
+struct index_builder {
+	struct membership *members;
+	size_t member_count;
+	size_t member_cap;
+	unsigned int type_cap;
+	struct def_statements *defs;
+};
+
+// Types and type aliases, and attributes, by name
+static struct index_elem *type_ids = NULL;
+static struct index_elem *attr_ids = NULL;
+// The name of each type id
+static const char **type_names = NULL;
+static unsigned int type_count = 0;
+static unsigned int attr_count = 0;
+// Words in each set
+static unsigned int index_words = 0;
+// The members of each attribute id, index_words words each
+static uint64_t *attr_members = NULL;
+
+static struct index_elem *find_elem(struct index_elem *map, const char *name)
+{
+	struct index_elem *elem;
+
+	HASH_FIND(hh, map, name, strlen(name), elem);
+
+	return elem;
+}
+
+static struct index_elem *add_elem(struct index_elem **map, const char *name,
+                                   unsigned int id)
+{
+	struct index_elem *elem = malloc(sizeof(struct index_elem));
+	if (!elem) {
+		return NULL;
+	}
+	elem->name = strdup(name);
+	if (!elem->name) {
+		free(elem);
+		return NULL;
+	}
+	elem->id = id;
+	HASH_ADD_KEYPTR(hh, *map, elem->name, strlen(elem->name), elem);
+
+	return elem;
+}
+
+// Get the id of a type, giving it the next id if it is new.
+// Returns -1 on allocation failure.
+static int intern_type(struct index_builder *builder, const char *name)
+{
+	struct index_elem *elem = find_elem(type_ids, name);
+	if (elem) {
+		return (int)elem->id;
+	}
+
+	if (type_count == builder->type_cap) {
+		unsigned int new_cap = builder->type_cap ? builder->type_cap * 2 : 256;
+		const char **names = realloc(type_names, new_cap * sizeof(char *));
+		if (!names) {
+			return -1;
+		}
+		type_names = names;
+		builder->type_cap = new_cap;
+	}
+
+	elem = add_elem(&type_ids, name, type_count);
+	if (!elem) {
+		return -1;
+	}
+	type_names[type_count] = elem->name;
+
+	return (int)type_count++;
+}
+
+// Get the id of an attribute, giving it the next id if it is new.
+// Returns -1 on allocation failure.
+static int intern_attr(const char *name)
+{
+	struct index_elem *elem = find_elem(attr_ids, name);
+	if (elem) {
+		return (int)elem->id;
+	}
+
+	elem = add_elem(&attr_ids, name, attr_count);
+	if (!elem) {
+		return -1;
+	}
+
+	return (int)attr_count++;
+}
+
+static enum selint_error add_alias(struct index_builder *builder,
+                                   const char *alias, const char *type)
+{
+	int type_id = intern_type(builder, type);
+	if (type_id < 0) {
+		return SELINT_OUT_OF_MEM;
+	}
+
+	if (!find_elem(type_ids, alias) && !add_elem(&type_ids, alias, (unsigned int)type_id)) {
+		return SELINT_OUT_OF_MEM;
+	}
+
+	return SELINT_SUCCESS;
+}
+
+static enum selint_error add_members(struct index_builder *builder,
+                                     const char *type,
+                                     const struct string_list *attrs)
+{
+	int type_id = intern_type(builder, type);
+	if (type_id < 0) {
+		return SELINT_OUT_OF_MEM;
+	}
+
+	for (const struct string_list *attr = attrs; attr; attr = attr->next) {
+		if (!attr->string || strchr(attr->string, '$')) {
+			continue;
+		}
+		int attr_id = intern_attr(attr->string);
+		if (attr_id < 0) {
+			return SELINT_OUT_OF_MEM;
+		}
+
+		if (builder->member_count == builder->member_cap) {
+			size_t new_cap = builder->member_cap ? builder->member_cap * 2 : 1024;
+			struct membership *members = realloc(builder->members,
+			                                     new_cap * sizeof(struct membership));
+			if (!members) {
+				return SELINT_OUT_OF_MEM;
+			}
+			builder->members = members;
+			builder->member_cap = new_cap;
+		}
+		builder->members[builder->member_count].attr_id = (unsigned int)attr_id;
+		builder->members[builder->member_count].type_id = (unsigned int)type_id;
+		builder->member_count++;
+	}
+
+	return SELINT_SUCCESS;
+}
+
+// Names containing $ are interface or template parameters
+static int is_param(const char *name)
+{
+	return !name || strchr(name, '$');
+}
+
+static int is_membership_statement(const struct policy_node *node)
+{
+	return node->flavor == NODE_TYPE_ATTRIBUTE ||
+	       (node->flavor == NODE_DECL &&
+	        (node->data.d_data->flavor == DECL_TYPE ||
+	         node->data.d_data->flavor == DECL_ATTRIBUTE));
+}
+
+// Add the members declared by one statement of an interface or template,
+// with the parameters replaced by args
+static enum selint_error expand_statement(const struct policy_node *node,
+                                          struct string_list *args,
+                                          void *ctx)
+{
+	struct index_builder *builder = ctx;
+	const char *orig_name;
+	struct string_list *orig_attrs;
+
+	if (node->flavor == NODE_DECL) {
+		orig_name = node->data.d_data->name;
+		orig_attrs = node->data.d_data->attrs;
+	} else {
+		orig_name = node->data.ta_data->type;
+		orig_attrs = node->data.ta_data->attrs;
+	}
+	if (!orig_name) {
+		return SELINT_SUCCESS;
+	}
+
+	enum selint_error res = SELINT_SUCCESS;
+	char *name = replace_m4(orig_name, args);
+	if (is_param(name)) {
+		free(name);
+		return SELINT_SUCCESS;
+	}
+
+	if (node->flavor == NODE_DECL && node->data.d_data->flavor == DECL_ATTRIBUTE) {
+		if (intern_attr(name) < 0) {
+			res = SELINT_OUT_OF_MEM;
+		}
+	} else {
+		struct string_list *attrs = orig_attrs ? replace_m4_list(args, orig_attrs) : NULL;
+		res = add_members(builder, name, attrs);
+		free_string_list(attrs);
+	}
+	free(name);
+
+	return res;
+}
+
+static enum selint_error index_node(struct index_builder *builder,
+                                    const struct policy_node *node)
+{
+	if (node->scope & SCOPE_REQUIRE) {
+		return SELINT_SUCCESS;
+	}
+
+	// Calls passing on parameters are expanded with the interface or
+	// template they are in
+	if (node->flavor == NODE_IF_CALL) {
+		if (args_have_param(node->data.ic_data->args)) {
+			return SELINT_SUCCESS;
+		}
+		return expand_def_call(builder->defs, node->data.ic_data->name,
+		                       node->data.ic_data->args, expand_statement, builder);
+	}
+
+	if (node->scope & (SCOPE_INTERFACE | SCOPE_TEMPLATE)) {
+		return SELINT_SUCCESS;
+	}
+
+	switch (node->flavor) {
+	case NODE_DECL:
+		if (is_param(node->data.d_data->name)) {
+			break;
+		}
+		if (node->data.d_data->flavor == DECL_TYPE) {
+			return add_members(builder, node->data.d_data->name,
+			                   node->data.d_data->attrs);
+		}
+		if (node->data.d_data->flavor == DECL_ATTRIBUTE &&
+		    intern_attr(node->data.d_data->name) < 0) {
+			return SELINT_OUT_OF_MEM;
+		}
+		break;
+	case NODE_TYPE_ATTRIBUTE:
+		if (!is_param(node->data.ta_data->type)) {
+			return add_members(builder, node->data.ta_data->type,
+			                   node->data.ta_data->attrs);
+		}
+		break;
+	case NODE_ALIAS:
+		// Aliases are children of the type declaration or typealias
+		// statement they name
+		if (is_param(node->data.str) || !node->parent) {
+			break;
+		}
+		if (node->parent->flavor == NODE_DECL &&
+		    node->parent->data.d_data->flavor == DECL_TYPE &&
+		    !is_param(node->parent->data.d_data->name)) {
+			return add_alias(builder, node->data.str,
+			                 node->parent->data.d_data->name);
+		}
+		if (node->parent->flavor == NODE_TYPE_ALIAS &&
+		    !is_param(node->parent->data.str)) {
+			return add_alias(builder, node->data.str, node->parent->data.str);
+		}
+		break;
+	default:
+		break;
+	}
+
+	return SELINT_SUCCESS;
+}
+
+static enum selint_error index_files(struct index_builder *builder,
+                                     const struct policy_file_list *files)
+{
+	enum selint_error res = SELINT_SUCCESS;
+
+	for (const struct policy_file_node *file = files->head;
+	     file && res == SELINT_SUCCESS;
+	     file = file->next) {
+		for (const struct policy_node *node = file->file->ast;
+		     node && res == SELINT_SUCCESS;
+		     node = dfs_next(node)) {
+			res = index_node(builder, node);
+		}
+	}
+
+	return res;
+}
+
+enum selint_error build_type_index(const struct policy_file_list *te_files,
+                                   const struct policy_file_list *if_files)
+{
+	const struct policy_file_list *lists[] = { te_files, if_files };
+	struct index_builder builder;
+	enum selint_error res = SELINT_SUCCESS;
+
+	free_type_index();
+	memset(&builder, 0, sizeof(struct index_builder));
+
+	for (unsigned int i = 0; i < 2 && res == SELINT_SUCCESS; i++) {
+		for (const struct policy_file_node *file = lists[i]->head;
+		     file && res == SELINT_SUCCESS;
+		     file = file->next) {
+			res = index_def_statements(&builder.defs, file->file->ast,
+			                       is_membership_statement);
+		}
+	}
+
+	for (unsigned int i = 0; i < 2 && res == SELINT_SUCCESS; i++) {
+		res = index_files(&builder, lists[i]);
+	}
+
+	if (res == SELINT_SUCCESS) {
+		index_words = (type_count + BITS_PER_WORD - 1) / BITS_PER_WORD;
+		attr_members = calloc((size_t)attr_count * index_words + 1, sizeof(uint64_t));
+		if (!attr_members) {
+			res = SELINT_OUT_OF_MEM;
+		}
+	}
+
+	if (res == SELINT_SUCCESS) {
+		for (size_t i = 0; i < builder.member_count; i++) {
+			const struct membership *m = &builder.members[i];
+			attr_members[(size_t)m->attr_id * index_words + m->type_id / BITS_PER_WORD] |=
+				UINT64_C(1) << (m->type_id % BITS_PER_WORD);
+		}
+	} else {
+		free_type_index();
+	}
+
+	free(builder.members);
+	free_def_statements(&builder.defs);
+
+	return res;
+}
+
+unsigned int type_index_type_count(void)
+{
+	return type_count;
+}
+
+const char *type_index_type_name(unsigned int id)
+{
+	return id < type_count ? type_names[id] : NULL;
+}
+
+struct type_set *make_type_set(void)
+{
+	struct type_set *set = calloc(1, sizeof(struct type_set) +
+	                              index_words * sizeof(uint64_t));
+	if (set) {
+		set->word_count = index_words;
+	}
+
+	return set;
+}
+
+int type_set_add_name(struct type_set *set, const char *name)
+{
+	const struct index_elem *elem = find_elem(type_ids, name);
+	if (elem) {
+		set->words[elem->id / BITS_PER_WORD] |= UINT64_C(1) << (elem->id % BITS_PER_WORD);
+		return 1;
+	}
+
+	elem = find_elem(attr_ids, name);
+	if (elem) {
+		const uint64_t *members = attr_members + (size_t)elem->id * index_words;
+		for (unsigned int i = 0; i < set->word_count; i++) {
+			set->words[i] |= members[i];
+		}
+		return 1;
+	}
+
+	return 0;
+}
+
+void type_set_union(struct type_set *dst, const struct type_set *src)
+{
+	for (unsigned int i = 0; i < dst->word_count; i++) {
+		dst->words[i] |= src->words[i];
+	}
+}
+
+void type_set_intersect(struct type_set *dst, const struct type_set *src)
+{
+	for (unsigned int i = 0; i < dst->word_count; i++) {
+		dst->words[i] &= src->words[i];
+	}
+}
+
+void type_set_subtract(struct type_set *dst, const struct type_set *src)
+{
+	for (unsigned int i = 0; i < dst->word_count; i++) {
+		dst->words[i] &= ~src->words[i];
+	}
+}
+
+void type_set_complement(struct type_set *set)
+{
+	for (unsigned int i = 0; i < set->word_count; i++) {
+		set->words[i] = ~set->words[i];
+	}
+
+	// Clear the bits past the last type
+	if (type_count % BITS_PER_WORD && set->word_count > 0) {
+		set->words[set->word_count - 1] &= ~(~UINT64_C(0) << (type_count % BITS_PER_WORD));
+	}
+}
+
+int type_set_intersects(const struct type_set *a, const struct type_set *b)
+{
+	uint64_t common = 0;
+
+	for (unsigned int i = 0; i < a->word_count; i++) {
+		common |= a->words[i] & b->words[i];
+	}
+
+	return common != 0;
+}
+
+unsigned int type_set_count(const struct type_set *set)
+{
+	unsigned int count = 0;
+
+	for (unsigned int i = 0; i < set->word_count; i++) {
+		count += (unsigned int)__builtin_popcountll(set->words[i]);
+	}
+
+	return count;
+}
+
+int type_set_next(const struct type_set *set, unsigned int from)
+{
+	unsigned int i = from / BITS_PER_WORD;
+
+	if (i >= set->word_count) {
+		return -1;
+	}
+
+	uint64_t word = set->words[i] & (~UINT64_C(0) << (from % BITS_PER_WORD));
+	while (!word) {
+		if (++i == set->word_count) {
+			return -1;
+		}
+		word = set->words[i];
+	}
+
+	return (int)(i * BITS_PER_WORD + (unsigned int)__builtin_ctzll(word));
+}
+
+void free_type_set(struct type_set *to_free)
+{
+	free(to_free);
+}
+
+static void free_index_map(struct index_elem **map)
+{
+	struct index_elem *cur, *tmp;
+
+	HASH_ITER(hh, *map, cur, tmp) {
+		HASH_DEL(*map, cur);
+		free(cur->name);
+		free(cur);
+	}
+}
+
+void free_type_index(void)
+{
+	free_index_map(&type_ids);
+	free_index_map(&attr_ids);
+	free(type_names);
+	type_names = NULL;
+	free(attr_members);
+	attr_members = NULL;
+	type_count = 0;
+	attr_count = 0;
+	index_words = 0;
+}
@@ -0,0 +1,123 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef TYPE_INDEX_H
+#define TYPE_INDEX_H
+
+#include <stdint.h>
+
+#include "file_list.h"
+#include "selint_error.h"
+
+// The index gives every type declared in the policy a dense id, and records
+// the members of every attribute as a bitset over those ids, so that the
+// types a rule covers can be computed with word operations instead of list
+// walks.
+
+// A set of types, one bit per type id
+struct type_set {
+	unsigned int word_count;
+	uint64_t words[];
+};
+
+/*********************************************
+* Build the index from the declarations, aliases and typeattribute
+* statements in lists of files, replacing any previous index.  The type
+* declarations and typeattribute statements of an interface or template are
+* indexed where it is called, with the parameters replaced by the arguments
+* of the call, so that "domain_type(foo_t)" puts foo_t in domain.  Calls
+* with parameters in their arguments are only followed from the call that
+* passes them values.  Statements in require blocks, and names that remain
+* parameters, are ignored.
+* te_files - The te files to index
+* if_files - The if files to index, and to find interfaces and templates in
+* returns SELINT_SUCCESS or SELINT_OUT_OF_MEM
+*********************************************/
+enum selint_error build_type_index(const struct policy_file_list *te_files,
+                                   const struct policy_file_list *if_files);
+
+/*********************************************
+* Get the number of types in the index.  Type ids range from 0 to one less
+* than this.
+*********************************************/
+unsigned int type_index_type_count(void);
+
+/*********************************************
+* Get the name a type was declared with
+* id - The id of the type
+* returns the name, or NULL if there is no such type
+*********************************************/
+const char *type_index_type_name(unsigned int id);
+
+/*********************************************
+* Allocate an empty set sized for the current index
+* returns the set, or NULL on allocation failure
+*********************************************/
+struct type_set *make_type_set(void);
+
+/*********************************************
+* Add a type, or every member of an attribute, to a set
+* set - The set to add to
+* name - The name of a type, type alias or attribute
+* returns 1 if the name is in the index, or 0 if it is not
+*********************************************/
+int type_set_add_name(struct type_set *set, const char *name);
+
+/*********************************************
+* Add every type in src to dst
+*********************************************/
+void type_set_union(struct type_set *dst, const struct type_set *src);
+
+/*********************************************
+* Remove every type that is not in src from dst
+*********************************************/
+void type_set_intersect(struct type_set *dst, const struct type_set *src);
+
+/*********************************************
+* Remove every type in src from dst
+*********************************************/
+void type_set_subtract(struct type_set *dst, const struct type_set *src);
+
+/*********************************************
+* Replace a set with every type in the index that is not in it
+*********************************************/
+void type_set_complement(struct type_set *set);
+
+/*********************************************
+* Check whether two sets have a type in common
+* returns 1 if they do, and 0 otherwise
+*********************************************/
+int type_set_intersects(const struct type_set *a, const struct type_set *b);
+
+/*********************************************
+* Count the types in a set
+*********************************************/
+unsigned int type_set_count(const struct type_set *set);
+
+/*********************************************
+* Find the next type in a set, for iterating over it
+* set - The set to search
+* from - The first id to consider
+* returns the lowest id in the set that is at least from, or -1 if there is
+* none
+*********************************************/
+int type_set_next(const struct type_set *set, unsigned int from);
+
+void free_type_set(struct type_set *to_free);
+
+void free_type_index(void);
+
+#endif
@@ -0,0 +1,668 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <uthash.h>
+
+#include "xref.h"
+#include "parallel.h"
+
+// On disk, an index is a header followed by the arrays below, in order.
+// Names are offsets into the string table at the end, and symbols are
+// sorted by name so that they can be binary searched in place.
+#define XREF_MAGIC "SEXREF1"
+#define NO_DECL_FLAVOR 0xff
+
+struct xref_header {
+	char magic[8];
+	uint32_t file_count;
+	uint32_t symbol_count;
+	uint32_t site_count;
+	uint32_t strings_size;
+};
+
+struct xref_symbol {
+	uint32_t name;
+	uint32_t first_site;
+	uint32_t site_count;
+};
+
+struct xref_disk_site {
+	uint32_t file;
+	uint32_t lineno;
+	uint8_t kind;
+	uint8_t decl_flavor;
+	uint16_t flavor;
+};
+
+struct xref_db {
+	void *map;
+	size_t size;
+	const struct xref_header *header;
+	const uint32_t *files;
+	const struct xref_symbol *symbols;
+	const struct xref_disk_site *sites;
+	const char *strings;
+};
+
+// A site found while scanning a file, naming the symbol in place in the AST
+struct found_site {
+	const char *name;
+	unsigned int lineno;
+	uint8_t kind;
+	uint8_t decl_flavor;
+	uint16_t flavor;
+	// Only kept if the name is declared or required somewhere
+	int weak;
+};
+
+struct file_sites {
+	const struct policy_file *file;
+	struct found_site *sites;
+	unsigned int count;
+	unsigned int capacity;
+	int out_of_mem;
+};
+
+struct symbol {
+	const char *name;
+	uint32_t name_offset;
+	uint32_t site_count;
+	uint32_t next_site;
+	int declared;
+	UT_hash_handle hh;
+};
+
+static int is_symbol_name(const char *name)
+{
+	// Leaves out interface parameters, set operators and the like
+	if (!((name[0] >= 'a' && name[0] <= 'z') ||
+	      (name[0] >= 'A' && name[0] <= 'Z') ||
+	      name[0] == '_')) {
+		return 0;
+	}
+	return strcmp(name, "self") != 0;
+}
+
+static void add_site(struct file_sites *fs, const char *name,
+                     const struct policy_node *node, enum xref_kind kind,
+                     uint8_t decl_flavor, int weak)
+{
+	if (!name || !is_symbol_name(name)) {
+		return;
+	}
+
+	if (fs->count == fs->capacity) {
+		unsigned int capacity = fs->capacity ? fs->capacity * 2 : 64;
+		struct found_site *grown = realloc(fs->sites, capacity * sizeof(struct found_site));
+		if (!grown) {
+			fs->out_of_mem = 1;
+			return;
+		}
+		fs->sites = grown;
+		fs->capacity = capacity;
+	}
+
+	struct found_site *site = &fs->sites[fs->count++];
+	site->name = name;
+	site->lineno = node->lineno;
+	site->kind = (uint8_t)kind;
+	site->decl_flavor = decl_flavor;
+	site->flavor = (uint16_t)node->flavor;
+	site->weak = weak;
+}
+
+static void add_uses(struct file_sites *fs, const struct string_list *names,
+                     const struct policy_node *node, int weak)
+{
+	for (; names; names = names->next) {
+		add_site(fs, names->string, node, XREF_USE, NO_DECL_FLAVOR, weak);
+	}
+}
+
+static void add_type_uses(struct file_sites *fs, const struct policy_node *node)
+{
+	struct type_iter it;
+	const char *name;
+
+	type_iter_init(&it, node);
+	while (type_iter_next(&it, &name, NULL)) {
+		add_site(fs, name, node, XREF_USE, NO_DECL_FLAVOR, 0);
+	}
+}
+
+static void scan_file(void *ctx, unsigned int item)
+{
+	struct file_sites *fs = &((struct file_sites *)ctx)[item];
+
+	for (const struct policy_node *node = fs->file->ast;
+	     node && !fs->out_of_mem;
+	     node = dfs_next(node)) {
+		switch (node->flavor) {
+		case NODE_DECL:
+			add_site(fs, node->data.d_data->name, node,
+			         is_in_require(node) ? XREF_REQUIRE : XREF_DECLARATION,
+			         (uint8_t)node->data.d_data->flavor, 0);
+			add_uses(fs, node->data.d_data->attrs, node, 0);
+			break;
+		case NODE_INTERFACE_DEF:
+		case NODE_TEMP_DEF:
+			add_site(fs, node->data.str, node, XREF_DECLARATION, NO_DECL_FLAVOR, 0);
+			break;
+		case NODE_IF_CALL:
+			add_site(fs, node->data.ic_data->name, node, XREF_USE, NO_DECL_FLAVOR, 0);
+			add_uses(fs, node->data.ic_data->args, node, 1);
+			break;
+		case NODE_FC_ENTRY:
+			if (node->data.fc_data->context) {
+				add_site(fs, node->data.fc_data->context->type, node,
+				         XREF_USE, NO_DECL_FLAVOR, 0);
+			}
+			break;
+		case NODE_AV_RULE:
+			add_type_uses(fs, node);
+			add_uses(fs, node->data.av_data->object_classes, node, 0);
+			break;
+		case NODE_TT_RULE:
+			add_type_uses(fs, node);
+			add_uses(fs, node->data.tt_data->object_classes, node, 0);
+			break;
+		default:
+			add_type_uses(fs, node);
+			break;
+		}
+	}
+}
+
+static unsigned int count_files(const struct policy_file_list *files)
+{
+	unsigned int count = 0;
+
+	for (const struct policy_file_node *cur = files->head; cur; cur = cur->next) {
+		count++;
+	}
+	return count;
+}
+
+struct string_table {
+	char *data;
+	uint32_t size;
+	uint32_t capacity;
+};
+
+// Returns the offset of the copy, or UINT32_MAX if out of memory
+static uint32_t add_string(struct string_table *table, const char *str)
+{
+	size_t len = strlen(str) + 1;
+
+	if (table->size + len > table->capacity) {
+		uint32_t capacity = table->capacity ? table->capacity : 4096;
+		while (table->size + len > capacity) {
+			capacity *= 2;
+		}
+		char *grown = realloc(table->data, capacity);
+		if (!grown) {
+			return UINT32_MAX;
+		}
+		table->data = grown;
+		table->capacity = capacity;
+	}
+
+	uint32_t offset = table->size;
+	memcpy(table->data + offset, str, len);
+	table->size += (uint32_t)len;
+	return offset;
+}
+
+static int compare_symbols(const void *left, const void *right)
+{
+	const struct symbol *l = *(const struct symbol *const *)left;
+	const struct symbol *r = *(const struct symbol *const *)right;
+
+	return strcmp(l->name, r->name);
+}
+
+static struct symbol *find_symbol(struct symbol *symbols, const char *name)
+{
+	struct symbol *found;
+
+	HASH_FIND(hh, symbols, name, strlen(name), found);
+	return found;
+}
+
+static int is_kept(struct symbol *symbols, const struct found_site *site)
+{
+	if (!site->weak) {
+		return 1;
+	}
+	const struct symbol *sym = find_symbol(symbols, site->name);
+	return sym && sym->declared;
+}
+
+// Write the merged sites of every file to out
+static enum selint_error write_sites(FILE *out, struct file_sites *scanned,
+                                     unsigned int file_count)
+{
+	enum selint_error res = SELINT_OUT_OF_MEM;
+	struct symbol *symbols = NULL;
+	struct symbol *sym, *tmp;
+	struct symbol **sorted = NULL;
+	struct xref_disk_site *sites = NULL;
+	struct xref_symbol *disk_symbols = NULL;
+	uint32_t *file_names = NULL;
+	struct string_table strings = { NULL, 0, 0 };
+	uint32_t symbol_count = 0;
+	uint32_t site_count = 0;
+	uint32_t i;
+
+	file_names = malloc((file_count + 1) * sizeof(uint32_t));
+	if (!file_names) {
+		goto out;
+	}
+	for (i = 0; i < file_count; i++) {
+		file_names[i] = add_string(&strings, scanned[i].file->filename);
+		if (file_names[i] == UINT32_MAX) {
+			goto out;
+		}
+	}
+
+	// Find the symbols, then which arguments to interface calls name them
+	for (i = 0; i < file_count; i++) {
+		for (unsigned int j = 0; j < scanned[i].count; j++) {
+			const struct found_site *site = &scanned[i].sites[j];
+			if (site->weak) {
+				continue;
+			}
+			sym = find_symbol(symbols, site->name);
+			if (!sym) {
+				sym = calloc(1, sizeof(struct symbol));
+				if (!sym) {
+					goto out;
+				}
+				sym->name = site->name;
+				HASH_ADD_KEYPTR(hh, symbols, sym->name, strlen(sym->name), sym);
+				symbol_count++;
+			}
+			sym->site_count++;
+			if (site->kind != XREF_USE) {
+				sym->declared = 1;
+			}
+		}
+	}
+	for (i = 0; i < file_count; i++) {
+		for (unsigned int j = 0; j < scanned[i].count; j++) {
+			const struct found_site *site = &scanned[i].sites[j];
+			if (site->weak && is_kept(symbols, site)) {
+				find_symbol(symbols, site->name)->site_count++;
+			}
+		}
+	}
+
+	sorted = malloc((symbol_count + 1) * sizeof(struct symbol *));
+	disk_symbols = malloc((symbol_count + 1) * sizeof(struct xref_symbol));
+	if (!sorted || !disk_symbols) {
+		goto out;
+	}
+	i = 0;
+	HASH_ITER(hh, symbols, sym, tmp) {
+		sorted[i++] = sym;
+	}
+	qsort(sorted, symbol_count, sizeof(struct symbol *), compare_symbols);
+
+	for (i = 0; i < symbol_count; i++) {
+		sym = sorted[i];
+		sym->name_offset = add_string(&strings, sym->name);
+		if (sym->name_offset == UINT32_MAX) {
+			goto out;
+		}
+		sym->next_site = site_count;
+		disk_symbols[i].name = sym->name_offset;
+		disk_symbols[i].first_site = site_count;
+		disk_symbols[i].site_count = sym->site_count;
+		site_count += sym->site_count;
+	}
+
+	sites = malloc((site_count + 1) * sizeof(struct xref_disk_site));
+	if (!sites) {
+		goto out;
+	}
+	for (i = 0; i < file_count; i++) {
+		for (unsigned int j = 0; j < scanned[i].count; j++) {
+			const struct found_site *site = &scanned[i].sites[j];
+			if (!is_kept(symbols, site)) {
+				continue;
+			}
+			sym = find_symbol(symbols, site->name);
+			struct xref_disk_site *disk_site = &sites[sym->next_site++];
+			memset(disk_site, 0, sizeof(struct xref_disk_site));
+			disk_site->file = i;
+			disk_site->lineno = site->lineno;
+			disk_site->kind = site->kind;
+			disk_site->decl_flavor = site->decl_flavor;
+			disk_site->flavor = site->flavor;
+		}
+	}
+
+	struct xref_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, XREF_MAGIC, sizeof(header.magic));
+	header.file_count = file_count;
+	header.symbol_count = symbol_count;
+	header.site_count = site_count;
+	header.strings_size = strings.size;
+
+	res = SELINT_IO_ERROR;
+	if (fwrite(&header, sizeof(header), 1, out) != 1 ||
+	    fwrite(file_names, sizeof(uint32_t), file_count, out) != file_count ||
+	    fwrite(disk_symbols, sizeof(struct xref_symbol), symbol_count, out) != symbol_count ||
+	    fwrite(sites, sizeof(struct xref_disk_site), site_count, out) != site_count ||
+	    fwrite(strings.data, 1, strings.size, out) != strings.size) {
+		goto out;
+	}
+	res = SELINT_SUCCESS;
+
+out:
+	HASH_ITER(hh, symbols, sym, tmp) {
+		HASH_DEL(symbols, sym);
+		free(sym);
+	}
+	free(sorted);
+	free(disk_symbols);
+	free(sites);
+	free(file_names);
+	free(strings.data);
+	return res;
+}
+
+// Write the index to a temporary file next to path and rename it into place,
+// so that a failed write, or a query running meanwhile, never sees a partial
+// index
+static enum selint_error write_db_file(const char *path,
+                                       struct file_sites *scanned,
+                                       unsigned int file_count)
+{
+	size_t len = strlen(path) + sizeof(".XXXXXX");
+	char *tmp_path = malloc(len);
+	if (!tmp_path) {
+		return SELINT_OUT_OF_MEM;
+	}
+	snprintf(tmp_path, len, "%s.XXXXXX", path);
+
+	int fd = mkstemp(tmp_path);
+	if (fd < 0) {
+		free(tmp_path);
+		return SELINT_IO_ERROR;
+	}
+	// mkstemp() creates the file private, but the index is not
+	mode_t mask = umask(0);
+	umask(mask);
+	FILE *out = NULL;
+	if (fchmod(fd, 0666 & ~mask) != 0 || !(out = fdopen(fd, "wb"))) {
+		close(fd);
+		unlink(tmp_path);
+		free(tmp_path);
+		return SELINT_IO_ERROR;
+	}
+
+	enum selint_error res = write_sites(out, scanned, file_count);
+	if (fclose(out) != 0 && res == SELINT_SUCCESS) {
+		res = SELINT_IO_ERROR;
+	}
+	if (res == SELINT_SUCCESS && rename(tmp_path, path) != 0) {
+		res = SELINT_IO_ERROR;
+	}
+	if (res != SELINT_SUCCESS) {
+		unlink(tmp_path);
+	}
+
+	free(tmp_path);
+	return res;
+}
+
+enum selint_error write_xref_db(const struct policy_file_list *te_files,
+                                const struct policy_file_list *if_files,
+                                const struct policy_file_list *fc_files,
+                                const char *path)
+{
+	const struct policy_file_list *lists[] = { te_files, if_files, fc_files };
+	unsigned int file_count = 0;
+
+	for (unsigned int i = 0; i < 3; i++) {
+		file_count += count_files(lists[i]);
+	}
+
+	struct file_sites *scanned = calloc(file_count + 1, sizeof(struct file_sites));
+	if (!scanned) {
+		return SELINT_OUT_OF_MEM;
+	}
+	unsigned int f = 0;
+	for (unsigned int i = 0; i < 3; i++) {
+		for (const struct policy_file_node *cur = lists[i]->head; cur; cur = cur->next) {
+			scanned[f++].file = cur->file;
+		}
+	}
+
+	run_in_parallel(file_count, scan_file, scanned);
+
+	enum selint_error res = SELINT_SUCCESS;
+	for (f = 0; f < file_count; f++) {
+		if (scanned[f].out_of_mem) {
+			res = SELINT_OUT_OF_MEM;
+		}
+	}
+
+	if (res == SELINT_SUCCESS) {
+		res = write_db_file(path, scanned, file_count);
+	}
+
+	for (f = 0; f < file_count; f++) {
+		free(scanned[f].sites);
+	}
+	free(scanned);
+
+	return res;
+}
+
+enum selint_error open_xref_db(const char *path, struct xref_db **db)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return SELINT_IO_ERROR;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		return SELINT_IO_ERROR;
+	}
+	size_t size = (size_t)st.st_size;
+	if (size < sizeof(struct xref_header)) {
+		close(fd);
+		return SELINT_PARSE_ERROR;
+	}
+
+	void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		return SELINT_IO_ERROR;
+	}
+
+	const struct xref_header *header = map;
+	const char *start = map;
+	uint64_t expected = (uint64_t)sizeof(struct xref_header) +
+	                    (uint64_t)header->file_count * sizeof(uint32_t) +
+	                    (uint64_t)header->symbol_count * sizeof(struct xref_symbol) +
+	                    (uint64_t)header->site_count * sizeof(struct xref_disk_site) +
+	                    header->strings_size;
+	if (memcmp(header->magic, XREF_MAGIC, sizeof(header->magic)) != 0 ||
+	    expected != size ||
+	    header->strings_size == 0 ||
+	    start[size - 1] != '\0') {
+		munmap(map, size);
+		return SELINT_PARSE_ERROR;
+	}
+
+	*db = malloc(sizeof(struct xref_db));
+	if (!*db) {
+		munmap(map, size);
+		return SELINT_OUT_OF_MEM;
+	}
+	(*db)->map = map;
+	(*db)->size = size;
+	(*db)->header = header;
+	(*db)->files = (const uint32_t *)(start + sizeof(struct xref_header));
+	(*db)->symbols = (const struct xref_symbol *)((*db)->files + header->file_count);
+	(*db)->sites = (const struct xref_disk_site *)((*db)->symbols + header->symbol_count);
+	(*db)->strings = (const char *)((*db)->sites + header->site_count);
+
+	return SELINT_SUCCESS;
+}
+
+// Offsets read from the file are checked before use, so that a damaged
+// index cannot make a lookup read outside of it
+static const char *get_string(const struct xref_db *db, uint32_t offset)
+{
+	return offset < db->header->strings_size ? db->strings + offset : "";
+}
+
+unsigned int query_xref_db(const struct xref_db *db, const char *name,
+                           void (*callback)(const struct xref_site *site, void *ctx),
+                           void *ctx)
+{
+	uint32_t low = 0;
+	uint32_t high = db->header->symbol_count;
+
+	while (low < high) {
+		uint32_t mid = low + (high - low) / 2;
+		int cmp = strcmp(name, get_string(db, db->symbols[mid].name));
+		if (cmp == 0) {
+			low = mid;
+			break;
+		} else if (cmp < 0) {
+			high = mid;
+		} else {
+			low = mid + 1;
+		}
+	}
+	if (low >= high) {
+		return 0;
+	}
+
+	const struct xref_symbol *sym = &db->symbols[low];
+	if (sym->first_site > db->header->site_count ||
+	    sym->site_count > db->header->site_count - sym->first_site) {
+		return 0;
+	}
+
+	unsigned int found = 0;
+	for (uint32_t i = sym->first_site; i < sym->first_site + sym->site_count; i++) {
+		const struct xref_disk_site *disk_site = &db->sites[i];
+		if (disk_site->file >= db->header->file_count ||
+		    disk_site->kind > XREF_USE ||
+		    disk_site->flavor > NODE_ERROR) {
+			continue;
+		}
+		struct xref_site site;
+		site.filename = get_string(db, db->files[disk_site->file]);
+		site.lineno = disk_site->lineno;
+		site.kind = (enum xref_kind)disk_site->kind;
+		site.flavor = (enum node_flavor)disk_site->flavor;
+		site.decl_flavor = (enum decl_flavor)disk_site->decl_flavor;
+		callback(&site, ctx);
+		found++;
+	}
+
+	return found;
+}
+
+const char *xref_site_description(const struct xref_site *site)
+{
+	if (site->flavor == NODE_DECL) {
+		switch (site->decl_flavor) {
+		case DECL_TYPE:
+			return "type";
+		case DECL_ATTRIBUTE:
+			return "attribute";
+		case DECL_ROLE:
+			return "role";
+		case DECL_USER:
+			return "user";
+		case DECL_CLASS:
+			return "class";
+		case DECL_PERM:
+			return "permission";
+		case DECL_BOOL:
+			return "bool";
+		default:
+			return "declaration";
+		}
+	}
+
+	switch (site->flavor) {
+	case NODE_AV_RULE:
+		return "av rule";
+	case NODE_TT_RULE:
+		return "type rule";
+	case NODE_RT_RULE:
+		return "role transition";
+	case NODE_ROLE_ALLOW:
+		return "role allow";
+	case NODE_ALIAS:
+	case NODE_TYPE_ALIAS:
+		return "alias";
+	case NODE_TYPE_ATTRIBUTE:
+		return "typeattribute";
+	case NODE_INTERFACE_DEF:
+		return "interface";
+	case NODE_TEMP_DEF:
+		return "template";
+	case NODE_IF_CALL:
+		return "interface call";
+	case NODE_FC_ENTRY:
+		return "file context";
+	default:
+		return "statement";
+	}
+}
+
+const char *xref_kind_name(enum xref_kind kind)
+{
+	switch (kind) {
+	case XREF_DECLARATION:
+		return "declaration";
+	case XREF_REQUIRE:
+		return "require";
+	case XREF_USE:
+	default:
+		return "use";
+	}
+}
+
+void close_xref_db(struct xref_db *db)
+{
+	if (!db) {
+		return;
+	}
+	munmap(db->map, db->size);
+	free(db);
+}
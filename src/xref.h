@@ -0,0 +1,92 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef XREF_H
+#define XREF_H
+
+#include "file_list.h"
+#include "selint_error.h"
+#include "tree.h"
+
+enum xref_kind {
+	XREF_DECLARATION,
+	XREF_REQUIRE,
+	XREF_USE
+};
+
+// One place a symbol appears
+struct xref_site {
+	const char *filename;
+	unsigned int lineno;
+	enum xref_kind kind;
+	// The flavor of the node the symbol appears in
+	enum node_flavor flavor;
+	// For NODE_DECL sites, what is declared or required
+	enum decl_flavor decl_flavor;
+};
+
+struct xref_db;
+
+/*********************************************
+* Write a cross-reference index of parsed policy files to disk.  For every
+* type, attribute, role, class, interface and template named in the files,
+* the index lists where it is declared, required and used.  Interface call
+* arguments are only counted as uses of names that are declared or required
+* somewhere in the files.  The files are scanned in parallel.
+* The index is in the byte order of the machine writing it.
+* te_files, if_files, fc_files - The parsed files to index
+* path - The file to write the index to
+* returns SELINT_SUCCESS, SELINT_OUT_OF_MEM or SELINT_IO_ERROR
+*********************************************/
+enum selint_error write_xref_db(const struct policy_file_list *te_files,
+                                const struct policy_file_list *if_files,
+                                const struct policy_file_list *fc_files,
+                                const char *path);
+
+/*********************************************
+* Map an index written by write_xref_db() into memory
+* path - The index file
+* db - Set to the opened index on success
+* returns SELINT_SUCCESS, SELINT_OUT_OF_MEM, SELINT_IO_ERROR if the file
+* could not be read, or SELINT_PARSE_ERROR if it is not a valid index
+*********************************************/
+enum selint_error open_xref_db(const char *path, struct xref_db **db);
+
+/*********************************************
+* Look a symbol up in an index, in time logarithmic in the number of
+* symbols
+* db - The index
+* name - The symbol to look up
+* callback - Called with every site of the symbol, in the order the files
+* were indexed and the order the sites appear in each file
+* ctx - Passed to every call of callback
+* returns the number of sites found
+*********************************************/
+unsigned int query_xref_db(const struct xref_db *db, const char *name,
+                           void (*callback)(const struct xref_site *site, void *ctx),
+                           void *ctx);
+
+/*********************************************
+* Describe where a site is, such as "type" for a type declaration or
+* "av rule" for a use in an allow rule
+*********************************************/
+const char *xref_site_description(const struct xref_site *site);
+
+const char *xref_kind_name(enum xref_kind kind);
+
+void close_xref_db(struct xref_db *db);
+
+#endif
@@ -0,0 +1,178 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../src/av_cache.h"
+
+struct replayed {
+	char text[256];
+	unsigned int count;
+};
+
+static void record_entry(void *ctx, enum av_entry_kind kind,
+                         const char *class_name, const char *name, int bit)
+{
+	struct replayed *out = ctx;
+	size_t len = strlen(out->text);
+
+	snprintf(out->text + len, sizeof(out->text) - len, "%d:%s:%s:%d;",
+	         kind, class_name, name, bit);
+	out->count++;
+}
+
+static void write_file(const char *path, const char *contents)
+{
+	FILE *f = fopen(path, "w");
+
+	ck_assert_ptr_nonnull(f);
+	fputs(contents, f);
+	fclose(f);
+}
+
+START_TEST (test_read_key) {
+	char dir[] = "/tmp/selint_av_cache_XXXXXX";
+	char path[64];
+	struct av_cache_key key;
+
+	ck_assert_ptr_nonnull(mkdtemp(dir));
+	ck_assert_int_eq(SELINT_IO_ERROR, read_av_cache_key(dir, &key));
+
+	snprintf(path, sizeof(path), "%s/policyvers", dir);
+	write_file(path, "33\n");
+	// No class directory
+	ck_assert_int_eq(SELINT_IO_ERROR, read_av_cache_key(dir, &key));
+
+	snprintf(path, sizeof(path), "%s/class", dir);
+	write_file(path, "");
+	ck_assert_int_eq(SELINT_IO_ERROR, read_av_cache_key(dir, &key));
+	unlink(path);
+
+	ck_assert_int_eq(0, mkdir(path, 0700));
+	ck_assert_int_eq(SELINT_SUCCESS, read_av_cache_key(dir, &key));
+	ck_assert_int_eq(33, key.policyvers);
+
+	struct stat st;
+	ck_assert_int_eq(0, stat(path, &st));
+	ck_assert_int_eq(st.st_ino, key.class_ino);
+	ck_assert_int_eq(st.st_ctim.tv_sec, key.class_ctime_sec);
+	ck_assert_int_eq(st.st_ctim.tv_nsec, key.class_ctime_nsec);
+
+	// A new class directory gives a new key
+	char old_path[64];
+	snprintf(old_path, sizeof(old_path), "%s/class.old", dir);
+	ck_assert_int_eq(0, rename(path, old_path));
+	ck_assert_int_eq(0, mkdir(path, 0700));
+	struct av_cache_key reloaded;
+	ck_assert_int_eq(SELINT_SUCCESS, read_av_cache_key(dir, &reloaded));
+	ck_assert_int_ne(key.class_ino, reloaded.class_ino);
+
+	rmdir(old_path);
+	rmdir(path);
+	snprintf(path, sizeof(path), "%s/policyvers", dir);
+	unlink(path);
+	rmdir(dir);
+}
+END_TEST
+
+START_TEST (test_write_and_replay) {
+	char path[] = "/tmp/selint_av_cache_XXXXXX";
+	int fd = mkstemp(path);
+	ck_assert_int_ge(fd, 0);
+	close(fd);
+
+	struct av_cache_key key = { 33, 42, 1000, 5 };
+	struct av_cache *cache = make_av_cache();
+	ck_assert_ptr_nonnull(cache);
+	av_cache_add(cache, AV_ENTRY_CLASS, NULL, "file", -1);
+	av_cache_add(cache, AV_ENTRY_CLASS_PERM, "file", "read", 1);
+	av_cache_add(cache, AV_ENTRY_CLASS_PERM, "file", "write", 2);
+	av_cache_add(cache, AV_ENTRY_PERM, NULL, "stray", -1);
+	ck_assert_int_eq(SELINT_SUCCESS, write_av_cache(cache, &key, path));
+	free_av_cache(cache);
+
+	struct replayed out;
+	memset(&out, 0, sizeof(out));
+	ck_assert_int_eq(SELINT_SUCCESS, replay_av_cache(path, &key, record_entry, &out));
+	ck_assert_int_eq(4, out.count);
+	ck_assert_str_eq("0::file:-1;2:file:read:1;2:file:write:2;1::stray:-1;", out.text);
+
+	// A different policy is loaded
+	memset(&out, 0, sizeof(out));
+	struct av_cache_key other = { 33, 43, 1000, 5 };
+	ck_assert_int_eq(SELINT_PARSE_ERROR, replay_av_cache(path, &other, record_entry, &out));
+	other.class_ino = 42;
+	other.class_ctime_nsec = 6;
+	ck_assert_int_eq(SELINT_PARSE_ERROR, replay_av_cache(path, &other, record_entry, &out));
+	other.class_ctime_nsec = 5;
+	other.policyvers = 34;
+	ck_assert_int_eq(SELINT_PARSE_ERROR, replay_av_cache(path, &other, record_entry, &out));
+	ck_assert_int_eq(0, out.count);
+
+	// A damaged cache
+	struct stat st;
+	ck_assert_int_eq(0, stat(path, &st));
+	ck_assert_int_eq(0, truncate(path, st.st_size - 1));
+	ck_assert_int_eq(SELINT_PARSE_ERROR, replay_av_cache(path, &key, record_entry, &out));
+	write_file(path, "not a cache");
+	ck_assert_int_eq(SELINT_PARSE_ERROR, replay_av_cache(path, &key, record_entry, &out));
+	ck_assert_int_eq(0, out.count);
+
+	unlink(path);
+	ck_assert_int_eq(SELINT_IO_ERROR, replay_av_cache(path, &key, record_entry, &out));
+
+	// The directory to write in does not exist
+	cache = make_av_cache();
+	ck_assert_int_eq(SELINT_IO_ERROR,
+	                 write_av_cache(cache, &key, "/tmp/selint_nonexistent_dir/cache"));
+	free_av_cache(cache);
+}
+END_TEST
+
+Suite *av_cache_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("AV_Cache");
+
+	tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_read_key);
+	tcase_add_test(tc_core, test_write_and_replay);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int main(void) {
+
+	int number_failed = 0;
+	Suite *s;
+	SRunner *sr;
+
+	s = av_cache_suite();
+	sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0)? 0 : -1;
+}
@@ -0,0 +1,207 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/call_graph.h"
+#include "../src/tree.h"
+
+static struct policy_node *add_def(struct policy_node *prev, enum node_flavor flavor,
+                                   const char *name)
+{
+	union node_data nd;
+	nd.str = strdup(name);
+
+	ck_assert_int_eq(SELINT_SUCCESS, insert_policy_node_next(prev, flavor, nd, prev->lineno + 1));
+
+	return prev->next;
+}
+
+// Add a call to name as the last child of def
+static void add_call(struct policy_node *def, const char *name)
+{
+	union node_data nd;
+	nd.ic_data = calloc(1, sizeof(struct if_call_data));
+	nd.ic_data->name = strdup(name);
+
+	ck_assert_int_eq(SELINT_SUCCESS, insert_policy_node_child(def, NODE_IF_CALL, nd, def->lineno));
+}
+
+static int contains(const unsigned int *ids, unsigned int count, const char *name)
+{
+	for (unsigned int i = 0; i < count; i++) {
+		if (0 == strcmp(name, call_graph_name(ids[i]))) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+START_TEST (test_call_graph) {
+	struct policy_node *head = calloc(1, sizeof(struct policy_node));
+	head->flavor = NODE_IF_FILE;
+
+	struct policy_node *a = add_def(head, NODE_INTERFACE_DEF, "a");
+	struct policy_node *b = add_def(a, NODE_INTERFACE_DEF, "b");
+	struct policy_node *c = add_def(b, NODE_INTERFACE_DEF, "c");
+	struct policy_node *d = add_def(c, NODE_INTERFACE_DEF, "d");
+	struct policy_node *e = add_def(d, NODE_INTERFACE_DEF, "e");
+	struct policy_node *f = add_def(e, NODE_TEMP_DEF, "f");
+
+	add_call(a, "b");
+	add_call(a, "b");
+	add_call(b, "c");
+	add_call(c, "b");
+	add_call(d, "d");
+	add_call(e, "a");
+	add_call(e, "m");
+	add_call(f, "a");
+
+	struct policy_file_list *files = calloc(1, sizeof(struct policy_file_list));
+	file_list_push_back(files, make_policy_file("test.if", head));
+
+	ck_assert_int_eq(SELINT_SUCCESS, build_call_graph(files));
+
+	ck_assert_int_eq(6, call_graph_node_count());
+	ck_assert_int_eq(-1, call_graph_id("m"));
+
+	int id_a = call_graph_id("a");
+	int id_b = call_graph_id("b");
+	int id_c = call_graph_id("c");
+	int id_d = call_graph_id("d");
+	int id_e = call_graph_id("e");
+	ck_assert_int_ne(-1, id_a);
+	ck_assert_str_eq("a", call_graph_name(id_a));
+
+	unsigned int count;
+	const unsigned int *ids = call_graph_callees(id_a, &count);
+	ck_assert_int_eq(1, count);
+	ck_assert_int_eq(id_b, ids[0]);
+
+	ids = call_graph_callers(id_b, &count);
+	ck_assert_int_eq(2, count);
+	ck_assert_int_eq(1, contains(ids, count, "a"));
+	ck_assert_int_eq(1, contains(ids, count, "c"));
+
+	ids = call_graph_callees(id_e, &count);
+	ck_assert_int_eq(1, count);
+
+	ck_assert_int_eq(call_graph_component(id_b), call_graph_component(id_c));
+	ck_assert_int_lt(call_graph_component(id_b), call_graph_component(id_a));
+	ck_assert_int_lt(call_graph_component(id_a), call_graph_component(id_e));
+
+	ck_assert_int_eq(0, call_graph_in_cycle(id_a));
+	ck_assert_int_eq(1, call_graph_in_cycle(id_b));
+	ck_assert_int_eq(1, call_graph_in_cycle(id_c));
+	ck_assert_int_eq(1, call_graph_in_cycle(id_d));
+	ck_assert_int_eq(0, call_graph_in_cycle(id_e));
+
+	unsigned int *out = malloc(call_graph_node_count() * sizeof(unsigned int));
+
+	count = call_graph_reachable(id_e, 0, out);
+	ck_assert_int_eq(3, count);
+	ck_assert_int_eq(1, contains(out, count, "a"));
+	ck_assert_int_eq(1, contains(out, count, "b"));
+	ck_assert_int_eq(1, contains(out, count, "c"));
+
+	count = call_graph_reachable(id_c, 1, out);
+	ck_assert_int_eq(5, count);
+	ck_assert_int_eq(1, contains(out, count, "c"));
+	ck_assert_int_eq(1, contains(out, count, "f"));
+	ck_assert_int_eq(0, contains(out, count, "d"));
+
+	count = call_graph_reachable(id_a, 1, out);
+	ck_assert_int_eq(2, count);
+
+	free(out);
+	free_call_graph();
+	ck_assert_int_eq(0, call_graph_node_count());
+	ck_assert_int_eq(-1, call_graph_id("a"));
+
+	free_file_list(files);
+}
+END_TEST
+
+START_TEST (test_call_graph_without_calls) {
+	struct policy_node *head = calloc(1, sizeof(struct policy_node));
+	head->flavor = NODE_IF_FILE;
+	struct policy_file_list *files = calloc(1, sizeof(struct policy_file_list));
+	file_list_push_back(files, make_policy_file("test.if", head));
+
+	// No definitions at all
+	ck_assert_int_eq(SELINT_SUCCESS, build_call_graph(files));
+	ck_assert_int_eq(0, call_graph_node_count());
+	ck_assert_int_eq(-1, call_graph_id("a"));
+	ck_assert_ptr_null(call_graph_name(0));
+
+	// Definitions, but no calls between them
+	struct policy_node *a = add_def(head, NODE_INTERFACE_DEF, "a");
+	add_def(a, NODE_TEMP_DEF, "b");
+	add_call(a, "m");
+
+	ck_assert_int_eq(SELINT_SUCCESS, build_call_graph(files));
+	ck_assert_int_eq(2, call_graph_node_count());
+
+	int id_a = call_graph_id("a");
+	unsigned int count = 1;
+	ck_assert_ptr_null(call_graph_callees(id_a, &count));
+	ck_assert_int_eq(0, count);
+	count = 1;
+	ck_assert_ptr_null(call_graph_callers(id_a, &count));
+	ck_assert_int_eq(0, count);
+	ck_assert_int_eq(0, call_graph_in_cycle(id_a));
+	ck_assert_int_ne(call_graph_component(id_a), call_graph_component(call_graph_id("b")));
+
+	unsigned int out[2];
+	ck_assert_int_eq(0, call_graph_reachable(id_a, 0, out));
+	ck_assert_int_eq(0, call_graph_reachable(id_a, 1, out));
+
+	free_call_graph();
+	free_file_list(files);
+}
+END_TEST
+
+Suite *call_graph_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Call_Graph");
+
+	tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_call_graph);
+	tcase_add_test(tc_core, test_call_graph_without_calls);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int main(void) {
+
+	int number_failed = 0;
+	Suite *s;
+	SRunner *sr;
+
+	s = call_graph_suite();
+	sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0)? 0 : -1;
+}
@@ -140,7 +140,7 @@ START_TEST (test_disable_check) {
 	struct checks *ck = calloc(1, sizeof(struct checks));
 
 	check_called = 0;
-	ck_assert_int_eq(SELINT_SUCCESS, add_check(NODE_AV_RULE, ck, "E-999", example_check));
+	ck_assert_int_eq(SELINT_SUCCESS, add_check(NODE_AV_RULE, ck, "E-002", example_check));
 
 	struct policy_node *node = calloc(1, sizeof(struct policy_node));
 	node->flavor = NODE_AV_RULE;
@@ -150,12 +150,72 @@ START_TEST (test_disable_check) {
 
 	check_called = 0;
 
-	node->exceptions = strdup("E-999\n");
+	node->exceptions = CHECK_BIT(check_index("E-002"));
+
+	ck_assert_int_eq(SELINT_SUCCESS, call_checks(ck, NULL, node));
+	ck_assert_int_eq(0, check_called);
+
+	// Only exact ids are disabled
+	node->exceptions = CHECK_BIT(check_index("E-003"));
 
 	ck_assert_int_eq(SELINT_SUCCESS, call_checks(ck, NULL, node));
+	ck_assert_int_eq(1, check_called);
+
+	free_policy_node(node);
+	free_checks(ck);
+
+}
+END_TEST
+
+START_TEST (test_dispatch_checks) {
+	struct checks *ck = calloc(1, sizeof(struct checks));
+	struct check_data *data = calloc(1, sizeof(struct check_data));
+
+	ck_assert_int_eq(SELINT_SUCCESS, add_check_for_files(FILE_MASK(FILE_IF_FILE), NODE_AV_RULE, ck, "E-002", example_check));
+	ck_assert_int_eq(SELINT_SUCCESS, add_check(NODE_AV_RULE, ck, "E-003", example_check2));
+	ck_assert_int_eq(SELINT_SUCCESS, compile_checks(ck));
+	ck_assert_ptr_nonnull(ck->dispatch);
+
+	struct policy_node *node = calloc(1, sizeof(struct policy_node));
+	node->flavor = NODE_AV_RULE;
+
+	check_called = 0;
+	check2_called = 0;
+	data->flavor = FILE_TE_FILE;
+	ck_assert_int_eq(SELINT_SUCCESS, dispatch_checks(ck, data, node));
+	ck_assert_int_eq(0, check_called);
+	ck_assert_int_eq(1, check2_called);
+
+	check2_called = 0;
+	data->flavor = FILE_IF_FILE;
+	ck_assert_int_eq(SELINT_SUCCESS, dispatch_checks(ck, data, node));
+	ck_assert_int_eq(1, check_called);
+	ck_assert_int_eq(1, check2_called);
+
+	check_called = 0;
+	check2_called = 0;
+	node->flavor = NODE_TT_RULE;
+	ck_assert_int_eq(SELINT_SUCCESS, dispatch_checks(ck, data, node));
+	ck_assert_int_eq(0, check_called);
+	ck_assert_int_eq(0, check2_called);
+
+	// Adding a check discards the table, and it is rebuilt on the next dispatch
+	ck_assert_int_eq(SELINT_SUCCESS, add_check_for_files(FILE_MASK(FILE_IF_FILE), NODE_TT_RULE, ck, "E-002", example_check));
+	ck_assert_ptr_null(ck->dispatch);
+	ck_assert_int_eq(SELINT_SUCCESS, dispatch_checks(ck, data, node));
+	ck_assert_ptr_nonnull(ck->dispatch);
+	ck_assert_int_eq(1, check_called);
+
+	check_called = 0;
+	check2_called = 0;
+	node->flavor = NODE_AV_RULE;
+	node->exceptions = CHECK_BIT(check_index("E-002"));
+	ck_assert_int_eq(SELINT_SUCCESS, dispatch_checks(ck, data, node));
 	ck_assert_int_eq(0, check_called);
+	ck_assert_int_eq(1, check2_called);
 
 	free_policy_node(node);
+	free(data);
 	free_checks(ck);
 
 }
@@ -163,19 +223,45 @@ END_TEST
 
 START_TEST (test_is_valid_check) {
 	ck_assert_int_eq(1, is_valid_check("W-001"));
-	ck_assert_int_eq(1, is_valid_check("W-005"));
-	ck_assert_int_eq(0, is_valid_check("W-006"));
+	ck_assert_int_eq(1, is_valid_check("W-006"));
+	ck_assert_int_eq(1, is_valid_check("W-007"));
+	ck_assert_int_eq(0, is_valid_check("W-008"));
 	ck_assert_int_eq(0, is_valid_check("foobar"));
 	ck_assert_int_eq(1, is_valid_check("C-001"));
 	ck_assert_int_eq(1, is_valid_check("S-001"));
+	ck_assert_int_eq(1, is_valid_check("S-005"));
+	ck_assert_int_eq(1, is_valid_check("S-006"));
+	ck_assert_int_eq(0, is_valid_check("S-007"));
 	ck_assert_int_eq(1, is_valid_check("E-001"));
 	ck_assert_int_eq(1, is_valid_check("F-001"));
+	ck_assert_int_eq(1, is_valid_check("E-007"));
+	ck_assert_int_eq(1, is_valid_check("E-008"));
+	ck_assert_int_eq(0, is_valid_check("E-009"));
 	ck_assert_int_eq(0, is_valid_check("C-005"));
 	ck_assert_int_eq(0, is_valid_check("X-001"));
 	ck_assert_int_eq(0, is_valid_check("C-101"));
 }
 END_TEST
 
+START_TEST (test_check_index) {
+	ck_assert_int_eq(0, check_index("C-001"));
+	ck_assert_int_eq(C_END - 1, check_index("S-001"));
+	ck_assert_int_eq(CHECK_COUNT - 1, check_index("F-002"));
+	ck_assert_int_eq(check_index("W-001") + 1, check_index("W-002"));
+	ck_assert_int_eq(check_index("W-001"), check_index("W-001,W-002"));
+	ck_assert_int_eq(CHECK_INDEX_INVALID, check_index("W-00"));
+	ck_assert_int_eq(check_index("W-005") + 1, check_index("W-006"));
+	ck_assert_int_eq(check_index("W-006") + 1, check_index("W-007"));
+	ck_assert_int_eq(CHECK_INDEX_INVALID, check_index("W-008"));
+	ck_assert_int_eq(check_index("E-006") + 1, check_index("E-007"));
+	ck_assert_int_eq(check_index("E-007") + 1, check_index("E-008"));
+	ck_assert_int_eq(CHECK_INDEX_INVALID, check_index("E-009"));
+	ck_assert_int_eq(CHECK_INDEX_INVALID, check_index("X-001"));
+	ck_assert_int_eq(CHECK_INDEX_INVALID, check_index(""));
+	ck_assert_int_eq(CHECK_INDEX_INVALID, check_index(NULL));
+}
+END_TEST
+
 START_TEST (test_increment_issues) {
 	struct checks *ck = calloc(1, sizeof(struct checks));
 	ck_assert_int_eq(SELINT_SUCCESS, add_check(NODE_AV_RULE, ck, "E-999", returns_blank_result));
@@ -212,7 +298,9 @@ Suite *check_hooks_suite(void) {
 	tcase_add_test(tc_core, test_add_check);
 	tcase_add_test(tc_core, test_call_checks);
 	tcase_add_test(tc_core, test_disable_check);
+	tcase_add_test(tc_core, test_dispatch_checks);
 	tcase_add_test(tc_core, test_is_valid_check);
+	tcase_add_test(tc_core, test_check_index);
 	tcase_add_test(tc_core, test_increment_issues);
 	suite_add_tcase(s, tc_core);
 
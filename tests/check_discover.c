@@ -0,0 +1,179 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#define _GNU_SOURCE
+#include <check.h>
+#include <fts.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../src/discover.h"
+#include "../src/parallel.h"
+
+#define MAX_VISITS 256
+
+struct visits {
+	char *seen[MAX_VISITS];
+	unsigned int count;
+};
+
+static void record(struct visits *visits, const char *path, const char *name,
+                   const char *parent_name, int is_dir)
+{
+	ck_assert_int_lt(visits->count, MAX_VISITS);
+	ck_assert_int_ne(-1, asprintf(&visits->seen[visits->count++], "%s|%s|%s|%d",
+	                              path, name, parent_name, is_dir));
+}
+
+static void record_visit(const struct discovered_file *file, void *ctx)
+{
+	record(ctx, file->path, file->name, file->parent_name, file->is_dir);
+}
+
+static void free_visits(struct visits *visits)
+{
+	for (unsigned int i = 0; i < visits->count; i++) {
+		free(visits->seen[i]);
+	}
+	visits->count = 0;
+}
+
+static void make_file(const char *dir, const char *name)
+{
+	char *path;
+	ck_assert_int_ne(-1, asprintf(&path, "%s/%s", dir, name));
+	FILE *f = fopen(path, "w");
+	ck_assert_ptr_nonnull(f);
+	fclose(f);
+	free(path);
+}
+
+static void make_dir(const char *dir, const char *name)
+{
+	char *path;
+	ck_assert_int_ne(-1, asprintf(&path, "%s/%s", dir, name));
+	ck_assert_int_eq(0, mkdir(path, 0700));
+	free(path);
+}
+
+START_TEST (test_discover_matches_fts) {
+	char tmpl[] = "/tmp/selint_discover_XXXXXX";
+	char *root = mkdtemp(tmpl);
+	ck_assert_ptr_nonnull(root);
+
+	make_dir(root, "a");
+	make_dir(root, "a/b");
+	make_dir(root, "a/b/c");
+	make_dir(root, "d");
+	make_file(root, "a/foo.te");
+	make_file(root, "a/foo.if");
+	make_file(root, "a/foo.fc");
+	make_file(root, "a/b/bar.te");
+	make_file(root, "a/b/c/baz.if");
+	make_file(root, "modules.conf");
+	make_file(root, "README");
+
+	char *link_path;
+	ck_assert_int_ne(-1, asprintf(&link_path, "%s/link", root));
+	ck_assert_int_eq(0, symlink("a", link_path));
+
+	char *file_path;
+	ck_assert_int_ne(-1, asprintf(&file_path, "%s/a/foo.te", root));
+	char *slash_path;
+	ck_assert_int_ne(-1, asprintf(&slash_path, "%s/a/", root));
+
+	char *paths[] = { root, file_path, slash_path, "/nonexistent/foo.te", NULL };
+
+	struct visits expected = { .count = 0 };
+	FTS *ftsp = fts_open(paths, FTS_PHYSICAL | FTS_NOSTAT, NULL);
+	ck_assert_ptr_nonnull(ftsp);
+	for (FTSENT *ent = fts_read(ftsp); ent; ent = fts_read(ftsp)) {
+		int is_dir = ent->fts_info == FTS_D || ent->fts_info == FTS_DP ||
+		             ent->fts_info == FTS_DNR;
+		record(&expected, ent->fts_path, ent->fts_name,
+		       ent->fts_parent->fts_name, is_dir);
+	}
+	fts_close(ftsp);
+
+	unsigned int jobs[] = { 1, 4 };
+	for (unsigned int j = 0; j < 2; j++) {
+		struct visits actual = { .count = 0 };
+
+		set_parallel_jobs(jobs[j]);
+		ck_assert_int_eq(SELINT_SUCCESS,
+		                 discover_files(paths, 1, record_visit, &actual));
+
+		ck_assert_int_eq(expected.count, actual.count);
+		for (unsigned int i = 0; i < expected.count; i++) {
+			ck_assert_str_eq(expected.seen[i], actual.seen[i]);
+		}
+		free_visits(&actual);
+	}
+
+	// Without recursion, directories are visited once but not their
+	// contents
+	struct visits actual = { .count = 0 };
+	char *flat_paths[] = { file_path, root, NULL };
+	ck_assert_int_eq(SELINT_SUCCESS,
+	                 discover_files(flat_paths, 0, record_visit, &actual));
+	ck_assert_int_eq(2, actual.count);
+	ck_assert_ptr_nonnull(strstr(actual.seen[0], "/a/foo.te|foo.te||0"));
+	ck_assert_ptr_nonnull(strstr(actual.seen[1], "|1"));
+	free_visits(&actual);
+
+	free_visits(&expected);
+	free(file_path);
+	free(slash_path);
+
+	char *cmd;
+	ck_assert_int_ne(-1, asprintf(&cmd, "rm -rf %s", root));
+	ck_assert_int_eq(0, system(cmd));
+	free(cmd);
+	free(link_path);
+}
+END_TEST
+
+Suite *discover_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Discover");
+
+	tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_discover_matches_fts);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int main(void) {
+
+	int number_failed = 0;
+	Suite *s;
+	SRunner *sr;
+
+	s = discover_suite();
+	sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0)? 0 : -1;
+}
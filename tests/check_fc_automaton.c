@@ -0,0 +1,179 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <check.h>
+#include <stdlib.h>
+
+#include "../src/fc_automaton.h"
+
+static int includes(const char *outer, const char *inner)
+{
+	struct fc_regex *outer_re = compile_fc_regex(outer);
+	struct fc_regex *inner_re = compile_fc_regex(inner);
+
+	ck_assert_ptr_nonnull(outer_re);
+	ck_assert_ptr_nonnull(inner_re);
+	int result = fc_regex_includes(outer_re, inner_re, FC_INCLUSION_STATE_LIMIT);
+	free_fc_regex(outer_re);
+	free_fc_regex(inner_re);
+
+	return result;
+}
+
+START_TEST (test_compile_fc_regex) {
+	struct fc_regex *re = compile_fc_regex("/usr/lib/foo(/.*)?");
+
+	ck_assert_ptr_nonnull(re);
+	ck_assert_int_eq(1, fc_regex_matches(re, "/usr/lib/foo"));
+	ck_assert_int_eq(1, fc_regex_matches(re, "/usr/lib/foo/bar/baz"));
+	ck_assert_int_eq(0, fc_regex_matches(re, "/usr/lib/foobar"));
+	ck_assert_int_eq(0, fc_regex_matches(re, "/usr/lib/fo"));
+	free_fc_regex(re);
+
+	re = compile_fc_regex("/var/run/[^/]+\\.pid");
+	ck_assert_ptr_nonnull(re);
+	ck_assert_int_eq(1, fc_regex_matches(re, "/var/run/foo.pid"));
+	ck_assert_int_eq(0, fc_regex_matches(re, "/var/run/fooXpid"));
+	ck_assert_int_eq(0, fc_regex_matches(re, "/var/run/a/b.pid"));
+	ck_assert_int_eq(0, fc_regex_matches(re, "/var/run/.pid"));
+	free_fc_regex(re);
+
+	re = compile_fc_regex("/dev/(tty|pts/)[[:digit:]]*");
+	ck_assert_ptr_nonnull(re);
+	ck_assert_int_eq(1, fc_regex_matches(re, "/dev/tty"));
+	ck_assert_int_eq(1, fc_regex_matches(re, "/dev/pts/12"));
+	ck_assert_int_eq(0, fc_regex_matches(re, "/dev/pts/x"));
+	free_fc_regex(re);
+
+	re = compile_fc_regex("/a[]b-]c");
+	ck_assert_ptr_nonnull(re);
+	ck_assert_int_eq(1, fc_regex_matches(re, "/a]c"));
+	ck_assert_int_eq(1, fc_regex_matches(re, "/a-c"));
+	ck_assert_int_eq(0, fc_regex_matches(re, "/abbc"));
+	free_fc_regex(re);
+
+	re = compile_fc_regex("/a[\\]\\-]\\.b");
+	ck_assert_ptr_nonnull(re);
+	ck_assert_int_eq(1, fc_regex_matches(re, "/a].b"));
+	ck_assert_int_eq(1, fc_regex_matches(re, "/a-.b"));
+	ck_assert_int_eq(0, fc_regex_matches(re, "/a\\.b"));
+	ck_assert_int_eq(0, fc_regex_matches(re, "/a]xb"));
+	free_fc_regex(re);
+
+	ck_assert_ptr_null(compile_fc_regex("/foo{1,2}"));
+	ck_assert_ptr_null(compile_fc_regex("^/foo$"));
+	ck_assert_ptr_null(compile_fc_regex("/foo(/.*"));
+	ck_assert_ptr_null(compile_fc_regex("/foo)"));
+	ck_assert_ptr_null(compile_fc_regex("/foo[a"));
+	ck_assert_ptr_null(compile_fc_regex("/foo[[:nothing:]]"));
+	ck_assert_ptr_null(compile_fc_regex("/foo\\"));
+	// Escaped letters and digits are classes or back references
+	ck_assert_ptr_null(compile_fc_regex("/foo\\d+"));
+	ck_assert_ptr_null(compile_fc_regex("/foo\\w*"));
+	ck_assert_ptr_null(compile_fc_regex("/foo\\sbar"));
+	ck_assert_ptr_null(compile_fc_regex("/(foo)\\1"));
+	ck_assert_ptr_null(compile_fc_regex("/foo[\\d]"));
+}
+END_TEST
+
+START_TEST (test_fc_regex_example) {
+	struct fc_regex *re = compile_fc_regex("/etc/foo(/.*)?");
+	char *example = fc_regex_example(re);
+
+	ck_assert_str_eq(example, "/etc/foo");
+	free(example);
+	free_fc_regex(re);
+
+	re = compile_fc_regex("/home/[^/]+/\\.foo");
+	example = fc_regex_example(re);
+	ck_assert_int_eq(1, fc_regex_matches(re, example));
+	free(example);
+	free_fc_regex(re);
+}
+END_TEST
+
+START_TEST (test_fc_regex_literal) {
+	struct fc_regex *re = compile_fc_regex("/home/[^/]+/\\.foo(/.*)?");
+
+	ck_assert_str_eq(fc_regex_literal(re), "/.foo");
+	free_fc_regex(re);
+
+	re = compile_fc_regex("/usr/lib/[.]so");
+	ck_assert_str_eq(fc_regex_literal(re), "/usr/lib/.so");
+	free_fc_regex(re);
+
+	re = compile_fc_regex("/var/log/foo[^/]*\\.log(\\.[0-9]+)?");
+	ck_assert_str_eq(fc_regex_literal(re), ".log");
+	free_fc_regex(re);
+
+	re = compile_fc_regex("/a|/b");
+	ck_assert_str_eq(fc_regex_literal(re), "");
+	free_fc_regex(re);
+}
+END_TEST
+
+START_TEST (test_fc_regex_includes) {
+	ck_assert_int_eq(1, includes("/usr/lib(/.*)?", "/usr/lib/foo(/.*)?"));
+	ck_assert_int_eq(0, includes("/usr/lib/foo(/.*)?", "/usr/lib(/.*)?"));
+	ck_assert_int_eq(1, includes("/var/run/.*", "/var/run/[^/]+\\.pid"));
+	ck_assert_int_eq(1, includes("/a[bc]*", "/a(b|c)*"));
+	ck_assert_int_eq(1, includes("/a(b|c)*", "/a[bc]*"));
+	ck_assert_int_eq(0, includes("/a[bc]+", "/a[bc]*"));
+	ck_assert_int_eq(1, includes("/x/[0-9]*", "/x/[[:digit:]]+"));
+	ck_assert_int_eq(0, includes("/home/[^/]+/\\..*", "/home/.*/\\.foo"));
+	ck_assert_int_eq(1, includes("/home/.*/\\..*", "/home/[^/]+/\\.foo"));
+
+	// Too few states to decide
+	struct fc_regex *outer = compile_fc_regex("/(a|b)*a(a|b)(a|b)(a|b)");
+	struct fc_regex *inner = compile_fc_regex("/(a|b)*a(a|b)(a|b)(a|b)");
+	ck_assert_int_eq(-1, fc_regex_includes(outer, inner, 4));
+	ck_assert_int_eq(1, fc_regex_includes(outer, inner, FC_INCLUSION_STATE_LIMIT));
+	free_fc_regex(outer);
+	free_fc_regex(inner);
+}
+END_TEST
+
+Suite *fc_automaton_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("FC_Automaton");
+
+	tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_compile_fc_regex);
+	tcase_add_test(tc_core, test_fc_regex_example);
+	tcase_add_test(tc_core, test_fc_regex_literal);
+	tcase_add_test(tc_core, test_fc_regex_includes);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int main(void) {
+
+	int number_failed = 0;
+	Suite *s;
+	SRunner *sr;
+
+	s = fc_automaton_suite();
+	sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0)? 0 : -1;
+}
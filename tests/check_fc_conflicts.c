@@ -0,0 +1,219 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/fc_conflicts.h"
+#include "../src/parse_fc.h"
+
+static void add_fc_file(struct policy_file_list *files, const char *filename,
+                        const char *contents)
+{
+	struct policy_node *head = calloc(1, sizeof(struct policy_node));
+
+	head->flavor = NODE_FC_FILE;
+	ck_assert_ptr_nonnull(parse_fc_lines(head, contents, contents + strlen(contents), 1));
+	file_list_push_back(files, make_policy_file(filename, head));
+}
+
+static const struct policy_node *entry_on_line(const struct policy_file_list *files,
+                                               const char *filename,
+                                               unsigned int lineno)
+{
+	for (const struct policy_file_node *file = files->head; file; file = file->next) {
+		if (0 != strcmp(file->file->filename, filename)) {
+			continue;
+		}
+		for (const struct policy_node *node = file->file->ast; node; node = node->next) {
+			if (node->flavor == NODE_FC_ENTRY && node->lineno == lineno) {
+				return node;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+static struct policy_file_list *make_files(void)
+{
+	struct policy_file_list *files = calloc(1, sizeof(struct policy_file_list));
+
+	add_fc_file(files, "policy/modules/a.fc",
+	            "/usr/bin/foo\t--\tgen_context(system_u:object_r:foo_exec_t,s0)\n"
+	            "/etc/foo(/.*)?\t\tgen_context(system_u:object_r:foo_conf_t,s0)\n"
+	            "/var/log/foo[^/]*\\.log\t--\tgen_context(system_u:object_r:foo_log_t,s0)\n"
+	            "/var/log/foo(/.*)?\t\tgen_context(system_u:object_r:foo_log_t,s0)\n"
+	            "/srv/foo/.*\t\tgen_context(system_u:object_r:foo_srv_t,s0)\n");
+	add_fc_file(files, "policy/modules/b.fc",
+	            "/usr/bin/foo\t\tgen_context(system_u:object_r:foo_exec_t,s0)\n"
+	            "/etc/foo(/.*)?\t\tgen_context(system_u:object_r:bar_conf_t,s0)\n"
+	            "/usr/bin/foo\t-d\t<<none>>\n"
+	            "/var/log/foo[^/]*\\.log(\\.[0-9]+)?\t\tgen_context(system_u:object_r:bar_log_t,s0)\n"
+	            "/srv/foo/.*\\.html\t-d\tgen_context(system_u:object_r:bar_srv_t,s0)\n"
+	            "/srv/foo/.*[^/]\t--\tgen_context(system_u:object_r:bar_srv_t,s0)\n");
+
+	return files;
+}
+
+START_TEST (test_repeated_file_contexts) {
+	struct policy_file_list *files = make_files();
+	const char *filename = NULL;
+	unsigned int lineno = 0;
+
+	ck_assert_int_eq(SELINT_SUCCESS, build_fc_conflict_index(files, 0));
+
+	ck_assert_int_eq(FC_NOT_REPEATED,
+	                 find_repeated_file_context(entry_on_line(files, "policy/modules/a.fc", 1),
+	                                            &filename, &lineno));
+
+	// The same context, with no object type
+	ck_assert_int_eq(FC_DUPLICATE,
+	                 find_repeated_file_context(entry_on_line(files, "policy/modules/b.fc", 1),
+	                                            &filename, &lineno));
+	ck_assert_str_eq(filename, "a.fc");
+	ck_assert_int_eq(lineno, 1);
+
+	ck_assert_int_eq(FC_CONFLICT,
+	                 find_repeated_file_context(entry_on_line(files, "policy/modules/b.fc", 2),
+	                                            &filename, &lineno));
+	ck_assert_str_eq(filename, "a.fc");
+	ck_assert_int_eq(lineno, 2);
+
+	// Only b.fc:1 has no object type, and its context differs
+	ck_assert_int_eq(FC_CONFLICT,
+	                 find_repeated_file_context(entry_on_line(files, "policy/modules/b.fc", 3),
+	                                            &filename, &lineno));
+	ck_assert_str_eq(filename, "b.fc");
+	ck_assert_int_eq(lineno, 1);
+
+	// Shadows are not searched for
+	ck_assert_int_eq(0, find_shadowing_file_context(entry_on_line(files, "policy/modules/a.fc", 3),
+	                                                &filename, &lineno));
+
+	free_fc_conflict_index();
+	ck_assert_int_eq(FC_NOT_REPEATED,
+	                 find_repeated_file_context(entry_on_line(files, "policy/modules/b.fc", 2),
+	                                            &filename, &lineno));
+
+	free_file_list(files);
+}
+END_TEST
+
+START_TEST (test_shadowed_file_contexts) {
+	struct policy_file_list *files = make_files();
+	const char *filename = NULL;
+	unsigned int lineno = 0;
+
+	ck_assert_int_eq(SELINT_SUCCESS, build_fc_conflict_index(files, 1));
+
+	// Matched by the later, longer regex for the rotated logs as well
+	ck_assert_int_eq(1, find_shadowing_file_context(entry_on_line(files, "policy/modules/a.fc", 3),
+	                                                &filename, &lineno));
+	ck_assert_str_eq(filename, "b.fc");
+	ck_assert_int_eq(lineno, 4);
+
+	// The longer regexes take precedence, but match less
+	ck_assert_int_eq(0, find_shadowing_file_context(entry_on_line(files, "policy/modules/a.fc", 4),
+	                                                &filename, &lineno));
+	ck_assert_int_eq(0, find_shadowing_file_context(entry_on_line(files, "policy/modules/b.fc", 4),
+	                                                &filename, &lineno));
+
+	// b.fc:6 only covers regular files, and b.fc:5 only directories
+	ck_assert_int_eq(0, find_shadowing_file_context(entry_on_line(files, "policy/modules/a.fc", 5),
+	                                                &filename, &lineno));
+
+	// Repeats are not shadows
+	ck_assert_int_eq(0, find_shadowing_file_context(entry_on_line(files, "policy/modules/a.fc", 2),
+	                                                &filename, &lineno));
+
+	free_fc_conflict_index();
+	free_file_list(files);
+}
+END_TEST
+
+START_TEST (test_exclusive_branches) {
+	struct policy_file_list *files = calloc(1, sizeof(struct policy_file_list));
+	const char *filename = NULL;
+	unsigned int lineno = 0;
+
+	add_fc_file(files, "policy/modules/a.fc",
+	            "ifdef(`distro_debian',`\n"
+	            "/usr/lib/foo\t\tgen_context(system_u:object_r:foo_lib_t,s0)\n"
+	            "/var/log/foo[^/]*\\.log\t--\tgen_context(system_u:object_r:foo_log_t,s0)\n"
+	            "',`\n"
+	            "/usr/lib/foo\t\tgen_context(system_u:object_r:lib_t,s0)\n"
+	            "')\n"
+	            "ifndef(`distro_debian',`\n"
+	            "/var/log/foo[^/]*\\.log(\\.[0-9]+)?\t\tgen_context(system_u:object_r:bar_log_t,s0)\n"
+	            "')\n"
+	            "ifdef(`distro_redhat',`\n"
+	            "/usr/lib/foo\t\tgen_context(system_u:object_r:foo_rh_t,s0)\n"
+	            "')\n");
+
+	ck_assert_int_eq(SELINT_SUCCESS, build_fc_conflict_index(files, 1));
+
+	// The else branch of the same block, and an ifndef of the same condition,
+	// are never loaded with the ifdef branch
+	ck_assert_int_eq(FC_NOT_REPEATED,
+	                 find_repeated_file_context(entry_on_line(files, "policy/modules/a.fc", 5),
+	                                            &filename, &lineno));
+	ck_assert_int_eq(0, find_shadowing_file_context(entry_on_line(files, "policy/modules/a.fc", 3),
+	                                                &filename, &lineno));
+
+	// Blocks with other conditions may be loaded together
+	ck_assert_int_eq(FC_CONFLICT,
+	                 find_repeated_file_context(entry_on_line(files, "policy/modules/a.fc", 11),
+	                                            &filename, &lineno));
+	ck_assert_str_eq(filename, "a.fc");
+	ck_assert_int_eq(lineno, 2);
+
+	free_fc_conflict_index();
+	free_file_list(files);
+}
+END_TEST
+
+Suite *fc_conflicts_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("FC_Conflicts");
+
+	tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_repeated_file_contexts);
+	tcase_add_test(tc_core, test_shadowed_file_contexts);
+	tcase_add_test(tc_core, test_exclusive_branches);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int main(void) {
+
+	int number_failed = 0;
+	Suite *s;
+	SRunner *sr;
+
+	s = fc_conflicts_suite();
+	sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0)? 0 : -1;
+}
@@ -0,0 +1,148 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/file_loader.h"
+
+#define BASIC_TE_FILENAME SAMPLE_POL_DIR "basic.te"
+#define EMPTY_TE_FILENAME SAMPLE_POL_DIR "empty.te"
+#define MISSING_FILENAME SAMPLE_POL_DIR "nonexistent.te"
+
+START_TEST (test_read_file_for_lexing) {
+	char expected[8192];
+	FILE *f = fopen(BASIC_TE_FILENAME, "r");
+	ck_assert_ptr_nonnull(f);
+	size_t len = fread(expected, 1, sizeof(expected), f);
+	fclose(f);
+	ck_assert_int_gt(len, 0);
+	ck_assert_int_lt(len, sizeof(expected));
+
+	size_t size = 0;
+	char *buf = read_file_for_lexing(BASIC_TE_FILENAME, &size);
+	ck_assert_ptr_nonnull(buf);
+	ck_assert_int_eq(len + 2, size);
+	ck_assert_int_eq(0, memcmp(expected, buf, len));
+	ck_assert_int_eq('\0', buf[len]);
+	ck_assert_int_eq('\0', buf[len + 1]);
+	free(buf);
+
+	ck_assert_ptr_null(read_file_for_lexing(MISSING_FILENAME, &size));
+}
+END_TEST
+
+static struct policy_file_list *make_test_list(unsigned int count)
+{
+	const char *names[] = { BASIC_TE_FILENAME, EMPTY_TE_FILENAME, MISSING_FILENAME };
+	struct policy_file_list *list = calloc(1, sizeof(struct policy_file_list));
+
+	for (unsigned int i = 0; i < count; i++) {
+		file_list_push_back(list, make_policy_file(names[i % 3], NULL));
+	}
+
+	return list;
+}
+
+START_TEST (test_file_loader) {
+	struct policy_file_list *list = make_test_list(20);
+	struct file_loader *loader = start_file_loader(list, 3);
+
+	ck_assert_ptr_nonnull(loader);
+
+	// Files come back in list order, with the same contents as a direct read
+	for (struct policy_file_node *cur = list->head; cur; cur = cur->next) {
+		size_t size = 0, expected_size = 0;
+		char *buf = file_loader_next(loader, &size);
+		char *expected = read_file_for_lexing(cur->file->filename, &expected_size);
+
+		if (expected) {
+			ck_assert_ptr_nonnull(buf);
+			ck_assert_int_eq(expected_size, size);
+			ck_assert_int_eq(0, memcmp(expected, buf, size));
+		} else {
+			ck_assert_ptr_null(buf);
+		}
+
+		free(buf);
+		free(expected);
+	}
+
+	size_t size;
+	ck_assert_ptr_null(file_loader_next(loader, &size));
+
+	stop_file_loader(loader);
+	free_file_list(list);
+}
+END_TEST
+
+START_TEST (test_stop_file_loader_early) {
+	struct policy_file_list *list = make_test_list(10);
+	struct file_loader *loader = start_file_loader(list, 4);
+	size_t size;
+
+	ck_assert_ptr_nonnull(loader);
+
+	char *buf = file_loader_next(loader, &size);
+	ck_assert_ptr_nonnull(buf);
+	free(buf);
+
+	// Files read ahead but never returned are freed
+	stop_file_loader(loader);
+	free_file_list(list);
+
+	// An empty list has nothing to return
+	list = make_test_list(0);
+	loader = start_file_loader(list, 4);
+	ck_assert_ptr_nonnull(loader);
+	ck_assert_ptr_null(file_loader_next(loader, &size));
+	stop_file_loader(loader);
+	free_file_list(list);
+}
+END_TEST
+
+Suite *file_loader_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("File_Loader");
+
+	tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_read_file_for_lexing);
+	tcase_add_test(tc_core, test_file_loader);
+	tcase_add_test(tc_core, test_stop_file_loader_early);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int main(void) {
+
+	int number_failed = 0;
+	Suite *s;
+	SRunner *sr;
+
+	s = file_loader_suite();
+	sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0)? 0 : -1;
+}
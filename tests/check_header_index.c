@@ -0,0 +1,167 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/header_index.h"
+#include "../src/maps.h"
+
+#define HEADERS_FILENAME SAMPLE_POL_DIR "headers.if"
+#define CALLS_FILENAME SAMPLE_POL_DIR "header_calls.te"
+
+static struct policy_file_list *make_header_list(void)
+{
+	struct policy_file_list *files = calloc(1, sizeof(struct policy_file_list));
+
+	file_list_push_back(files, make_policy_file(HEADERS_FILENAME, NULL));
+	file_list_push_back(files, make_policy_file(SAMPLE_POL_DIR "nonexistent.if", NULL));
+
+	return files;
+}
+
+static unsigned int count_lines(const char *text)
+{
+	unsigned int count = 0;
+
+	for (; *text; text++) {
+		if (*text == '\n') {
+			count++;
+		}
+	}
+	return count;
+}
+
+START_TEST (test_nothing_requested) {
+	struct policy_file_list *files = make_header_list();
+	size_t size = 0;
+
+	ck_assert_int_eq(SELINT_SUCCESS, index_header_files(files));
+	ck_assert_int_eq(0, requested_definition_count());
+	ck_assert_ptr_null(read_requested_definitions(0, &size));
+	ck_assert_ptr_null(read_requested_definitions(1, &size));
+	ck_assert_ptr_null(read_requested_definitions(2, &size));
+
+	ck_assert_int_eq(SELINT_SUCCESS, request_header_definition("not_a_header_interface"));
+	ck_assert_int_eq(0, requested_definition_count());
+
+	free_header_index();
+	free_file_list(files);
+}
+END_TEST
+
+START_TEST (test_request_definition) {
+	struct policy_file_list *files = make_header_list();
+	size_t size = 0;
+
+	ck_assert_int_eq(SELINT_SUCCESS, index_header_files(files));
+
+	// headers_unused calls headers_manage
+	ck_assert_int_eq(SELINT_SUCCESS, request_header_definition("headers_unused"));
+	ck_assert_int_eq(2, requested_definition_count());
+	ck_assert_int_eq(SELINT_SUCCESS, request_header_definition("headers_manage"));
+	ck_assert_int_eq(2, requested_definition_count());
+
+	char *text = read_requested_definitions(0, &size);
+	ck_assert_ptr_nonnull(text);
+	ck_assert_int_eq(strlen(text) + 2, size);
+	ck_assert_int_eq(36, count_lines(text));
+	ck_assert_ptr_nonnull(strstr(text, "interface(`headers_unused'"));
+	ck_assert_ptr_nonnull(strstr(text, "interface(`headers_manage'"));
+	ck_assert_ptr_null(strstr(text, "headers_read"));
+	ck_assert_ptr_null(strstr(text, "summary"));
+	// Line numbers are kept
+	ck_assert_int_eq(0, strncmp(text + size - 2 - strlen("')\n"), "')\n", 3));
+	free(text);
+
+	free_header_index();
+	ck_assert_int_eq(0, requested_definition_count());
+	free_file_list(files);
+}
+END_TEST
+
+START_TEST (test_request_calls_in_file) {
+	struct policy_file_list *files = make_header_list();
+	size_t size = 0;
+
+	ck_assert_int_eq(SELINT_SUCCESS, index_header_files(files));
+	ck_assert_int_eq(SELINT_IO_ERROR,
+	                 request_header_definitions_in_file(SAMPLE_POL_DIR "nonexistent.te"));
+
+	// headers_read, and headers_search through it
+	ck_assert_int_eq(SELINT_SUCCESS, request_header_definitions_in_file(CALLS_FILENAME));
+	ck_assert_int_eq(2, requested_definition_count());
+
+	char *text = read_requested_definitions(0, &size);
+	ck_assert_ptr_nonnull(text);
+	ck_assert_ptr_nonnull(strstr(text, "interface(`headers_read'"));
+	ck_assert_ptr_nonnull(strstr(text, "interface(`headers_search'"));
+	ck_assert_ptr_null(strstr(text, "headers_domain_template"));
+	ck_assert_ptr_null(strstr(text, "headers_manage"));
+	free(text);
+
+	free_header_index();
+	free_file_list(files);
+}
+END_TEST
+
+START_TEST (test_skip_known_definitions) {
+	struct policy_file_list *files = make_header_list();
+
+	insert_into_ifs_map("headers_read", "other");
+
+	ck_assert_int_eq(SELINT_SUCCESS, index_header_files(files));
+	ck_assert_int_eq(SELINT_SUCCESS, request_header_definitions_in_file(CALLS_FILENAME));
+	ck_assert_int_eq(0, requested_definition_count());
+
+	free_header_index();
+	free_all_maps();
+	free_file_list(files);
+}
+END_TEST
+
+Suite *header_index_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Header_Index");
+
+	tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_nothing_requested);
+	tcase_add_test(tc_core, test_request_definition);
+	tcase_add_test(tc_core, test_request_calls_in_file);
+	tcase_add_test(tc_core, test_skip_known_definitions);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int main(void) {
+
+	int number_failed = 0;
+	Suite *s;
+	SRunner *sr;
+
+	s = header_index_suite();
+	sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0)? 0 : -1;
+}
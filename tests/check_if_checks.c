@@ -22,6 +22,7 @@
 #include "../src/if_checks.h"
 #include "../src/check_hooks.h"
 #include "../src/maps.h"
+#include "../src/references.h"
 
 START_TEST (test_check_interface_defs_have_comment) {
 
@@ -119,6 +120,7 @@ START_TEST(test_check_type_used_but_not_required_in_if) {
 	ck_assert_str_eq("Type baz_t is used in interface but not required", res->message);
 
 	free_check_result(res);
+	free_interface_names();
 	free_policy_node(head);
 	free_all_maps();
 
@@ -168,6 +170,7 @@ START_TEST (test_check_type_required_but_not_used_in_if) {
 	cur = cur->prev->first_child->next; // the declaration
 
 	ck_assert_ptr_null(check_type_required_but_not_used_in_if(NULL, cur));
+	free_interface_names();
 
 	free(data->name);
 	data->name = strdup("not_used_t");
@@ -176,6 +179,7 @@ START_TEST (test_check_type_required_but_not_used_in_if) {
 	ck_assert_ptr_nonnull(res);
 
 	free_check_result(res);
+	free_interface_names();
 	free_policy_node(head);
 
 }
@@ -227,11 +231,102 @@ START_TEST (test_system_r_exception) {
 
 	ck_assert_ptr_null(check_type_used_but_not_required_in_if(NULL, cur));
 
+	free_interface_names();
 	free_policy_node(head);
 	free_all_maps();
 }
 END_TEST
 
+START_TEST (test_required_names_per_definition) {
+	union node_data nd;
+
+	// interface(`first',`
+	//     ifdef(`distro',`
+	//         gen_require(` type a_t; ')
+	//     ')
+	//     allow $1 a_t:file read;
+	// ')
+	// interface(`second',`
+	//     allow $1 a_t:file read;
+	// ')
+	struct policy_node *head = calloc(1, sizeof(struct policy_node));
+	head->flavor = NODE_IF_FILE;
+	struct policy_node *first = add_def(head, NODE_INTERFACE_DEF, "first");
+	nd.str = strdup("distro");
+	struct policy_node *ifdef = add_child(first, NODE_IFDEF, nd);
+	nd.str = NULL;
+	struct policy_node *req = add_child(ifdef, NODE_GEN_REQ, nd);
+	struct policy_node *decl = add_child(req, NODE_DECL, make_decl(DECL_TYPE, "a_t", NULL));
+	struct policy_node *first_allow =
+		add_next(ifdef, NODE_AV_RULE, make_av_rule(AV_RULE_ALLOW, "$1", "a_t", "file", "read"));
+	struct policy_node *second = add_def(first, NODE_INTERFACE_DEF, "second");
+	struct policy_node *second_allow =
+		add_child(second, NODE_AV_RULE, make_av_rule(AV_RULE_ALLOW, "$1", "a_t", "file", "read"));
+
+	insert_into_decl_map("a_t", "test", DECL_TYPE);
+
+	// A require block nested in an ifdef counts
+	ck_assert_ptr_null(check_type_required_but_not_used_in_if(NULL, decl));
+	ck_assert_ptr_null(check_type_used_but_not_required_in_if(NULL, first_allow));
+
+	// Only the names of the enclosing definition count
+	struct check_result *res = check_type_used_but_not_required_in_if(NULL, second_allow);
+	ck_assert_ptr_nonnull(res);
+	ck_assert_int_eq(W_ID_NO_REQ, res->check_id);
+	ck_assert_str_eq("Type a_t is used in interface but not required", res->message);
+	free_check_result(res);
+
+	ck_assert_ptr_null(check_type_used_but_not_required_in_if(NULL, first_allow));
+
+	free_interface_names();
+	free_policy_node(head);
+	free_all_maps();
+}
+END_TEST
+
+START_TEST (test_check_unused_interface) {
+	struct check_result *res;
+	union node_data nd;
+
+	// interface(`foo_caller',`
+	//     foo_called($1)
+	// ')
+	// template(`foo_called',`
+	// ')
+	struct policy_node *head = calloc(1, sizeof(struct policy_node));
+	head->flavor = NODE_IF_FILE;
+	nd.str = strdup("foo_caller");
+	ck_assert_int_eq(SELINT_SUCCESS, insert_policy_node_next(head, NODE_INTERFACE_DEF, nd, 1));
+	struct policy_node *caller = head->next;
+	nd.ic_data = calloc(1, sizeof(struct if_call_data));
+	nd.ic_data->name = strdup("foo_called");
+	nd.ic_data->args = sl_array_append(NULL, strdup("$1"));
+	ck_assert_int_eq(SELINT_SUCCESS, insert_policy_node_child(caller, NODE_IF_CALL, nd, 2));
+	nd.str = strdup("foo_called");
+	ck_assert_int_eq(SELINT_SUCCESS, insert_policy_node_next(caller, NODE_TEMP_DEF, nd, 4));
+	struct policy_node *called = caller->next;
+
+	struct policy_file_list *if_files = calloc(1, sizeof(struct policy_file_list));
+	file_list_push_back(if_files, make_policy_file("test.if", head));
+	struct policy_file_list *empty = calloc(1, sizeof(struct policy_file_list));
+
+	ck_assert_int_eq(SELINT_SUCCESS, build_reference_counts(empty, if_files, empty));
+
+	res = check_unused_interface(NULL, caller);
+	ck_assert_ptr_nonnull(res);
+	ck_assert_int_eq(res->severity, 'S');
+	ck_assert_int_eq(res->check_id, S_ID_UNUSED_IF);
+	ck_assert_str_eq(res->message, "Interface foo_caller is never called");
+	free_check_result(res);
+
+	ck_assert_ptr_null(check_unused_interface(NULL, called));
+
+	free_reference_counts();
+	free_file_list(if_files);
+	free_file_list(empty);
+}
+END_TEST
+
 Suite *if_checks_suite(void) {
 	Suite *s;
 	TCase *tc_core;
@@ -244,6 +339,8 @@ Suite *if_checks_suite(void) {
 	tcase_add_test(tc_core, test_check_type_used_but_not_required_in_if);
 	tcase_add_test(tc_core, test_check_type_required_but_not_used_in_if);
 	tcase_add_test(tc_core, test_system_r_exception);
+	tcase_add_test(tc_core, test_required_names_per_definition);
+	tcase_add_test(tc_core, test_check_unused_interface);
 	suite_add_tcase(s, tc_core);
 
 	return s;
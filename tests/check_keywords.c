@@ -0,0 +1,217 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <check.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../src/keywords.h"
+#include "../src/tree.h"
+#include "../src/parse.h"
+
+#define KEYWORD(name, token) { name, token, #token }
+
+static const struct {
+	const char *name;
+	int token;
+	const char *token_name;
+} all_keywords[] = {
+	KEYWORD("policy_module", POLICY_MODULE),
+	KEYWORD("module", MODULE),
+	KEYWORD("type", TYPE),
+	KEYWORD("typealias", TYPEALIAS),
+	KEYWORD("alias", ALIAS),
+	KEYWORD("attribute", ATTRIBUTE),
+	KEYWORD("bool", BOOL),
+	KEYWORD("typeattribute", TYPE_ATTRIBUTE),
+	KEYWORD("roleattribute", ROLE_ATTRIBUTE),
+	KEYWORD("role", ROLE),
+	KEYWORD("types", TYPES),
+	KEYWORD("attribute_role", ATTRIBUTE_ROLE),
+	KEYWORD("allow", ALLOW),
+	KEYWORD("auditallow", AUDIT_ALLOW),
+	KEYWORD("dontaudit", DONT_AUDIT),
+	KEYWORD("neverallow", NEVER_ALLOW),
+	KEYWORD("type_transition", TYPE_TRANSITION),
+	KEYWORD("type_member", TYPE_MEMBER),
+	KEYWORD("type_change", TYPE_CHANGE),
+	KEYWORD("range_transition", RANGE_TRANSITION),
+	KEYWORD("role_transition", ROLE_TRANSITION),
+	KEYWORD("optional_policy", OPTIONAL_POLICY),
+	KEYWORD("gen_require", GEN_REQUIRE),
+	KEYWORD("gen_tunable", GEN_TUNABLE),
+	KEYWORD("require", REQUIRE),
+	KEYWORD("tunable_policy", TUNABLE_POLICY),
+	KEYWORD("ifelse", IFELSE),
+	KEYWORD("refpolicywarn", REFPOLICYWARN),
+	KEYWORD("class", CLASS),
+	KEYWORD("if", IF),
+	KEYWORD("else", ELSE),
+	KEYWORD("ifdef", IFDEF),
+	KEYWORD("ifndef", IFNDEF),
+	KEYWORD("genfscon", GENFSCON),
+	KEYWORD("sid", SID),
+	KEYWORD("portcon", PORTCON),
+	KEYWORD("netifcon", NETIFCON),
+	KEYWORD("nodecon", NODECON),
+	KEYWORD("fs_use_trans", FS_USE_TRANS),
+	KEYWORD("fs_use_xattr", FS_USE_XATTR),
+	KEYWORD("fs_use_task", FS_USE_TASK),
+	KEYWORD("define", DEFINE),
+	KEYWORD("gen_user", GEN_USER),
+	KEYWORD("gen_context", GEN_CONTEXT),
+	KEYWORD("permissive", PERMISSIVE),
+	KEYWORD("typebounds", TYPEBOUNDS),
+	KEYWORD("interface", INTERFACE),
+	KEYWORD("template", TEMPLATE),
+	KEYWORD("userdebug_or_eng", USERDEBUG_OR_ENG),
+};
+
+#define KEYWORD_COUNT (sizeof(all_keywords) / sizeof(all_keywords[0]))
+
+START_TEST (test_all_keywords) {
+	for (size_t i = 0; i < KEYWORD_COUNT; i++) {
+		const char *name = all_keywords[i].name;
+		ck_assert_int_eq(all_keywords[i].token, lookup_keyword(name, strlen(name)));
+	}
+}
+END_TEST
+
+static int find_keyword_token(const char *token_name)
+{
+	for (size_t i = 0; i < KEYWORD_COUNT; i++) {
+		if (0 == strcmp(all_keywords[i].token_name, token_name)) {
+			return (int)i;
+		}
+	}
+	return -1;
+}
+
+START_TEST (test_parser_keyword_tokens) {
+	// Tokens declared in parse.y that the lexer does not get from
+	// lookup_keyword()
+	const char *other_tokens[] = { "OPEN_PAREN", "COMMA", "PERIOD", "CLOSE_PAREN",
+		                       "OPEN_CURLY", "CLOSE_CURLY", "COLON", "SEMICOLON",
+		                       "BACKTICK", "SINGLE_QUOTE", "TILDA", "STAR",
+		                       "DASH", "COMMENT", NULL };
+
+	FILE *f = fopen(SRC_DIR "parse.y", "r");
+	ck_assert_ptr_nonnull(f);
+
+	char line[256];
+	char token_name[64];
+	unsigned int found = 0;
+	while (fgets(line, sizeof(line), f)) {
+		// Tokens with a value type are not keywords
+		if (1 != sscanf(line, "%%token %63[A-Z_];", token_name)) {
+			continue;
+		}
+		int other = 0;
+		for (int i = 0; other_tokens[i]; i++) {
+			other |= (0 == strcmp(other_tokens[i], token_name));
+		}
+		if (other) {
+			continue;
+		}
+		int index = find_keyword_token(token_name);
+		ck_assert_msg(index >= 0, "%s is not a known keyword", token_name);
+		const char *name = all_keywords[index].name;
+		ck_assert_int_eq(all_keywords[index].token, lookup_keyword(name, strlen(name)));
+		found++;
+	}
+	fclose(f);
+
+	ck_assert_int_eq(KEYWORD_COUNT, found);
+}
+END_TEST
+
+START_TEST (test_keyword_list) {
+	FILE *f = fopen(SRC_DIR "keywords.gperf", "r");
+	ck_assert_ptr_nonnull(f);
+
+	char line[256];
+	char name[64];
+	char token_name[64];
+	int section = 0;
+	unsigned int found = 0;
+	while (fgets(line, sizeof(line), f)) {
+		if (0 == strncmp(line, "%%", 2)) {
+			section++;
+			continue;
+		}
+		if (section != 1) {
+			continue;
+		}
+		ck_assert_int_eq(2, sscanf(line, "%63[a-z_], %63[A-Z_]", name, token_name));
+		int index = find_keyword_token(token_name);
+		ck_assert_int_ge(index, 0);
+		ck_assert_str_eq(all_keywords[index].name, name);
+		found++;
+	}
+	fclose(f);
+
+	// The generated table holds every keyword
+	ck_assert_int_eq(KEYWORD_COUNT, found);
+}
+END_TEST
+
+START_TEST (test_not_keywords) {
+	const char *not_keywords[] = { "", "a", "allo", "allowed", "Allow", "ALLOW",
+		                       "type_", "_type", "foo_t", "if2", "gen_requires",
+		                       "userdebug_or_eng_", "$1_t", "/usr/bin", NULL };
+
+	for (int i = 0; not_keywords[i]; i++) {
+		ck_assert_int_eq(0, lookup_keyword(not_keywords[i], strlen(not_keywords[i])));
+	}
+
+	// Only len characters are considered
+	ck_assert_int_eq(ALLOW, lookup_keyword("allowed", 5));
+	ck_assert_int_eq(TYPE, lookup_keyword("type_transition", 4));
+	ck_assert_int_eq(0, lookup_keyword("allow", 4));
+}
+END_TEST
+
+Suite *keywords_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Keywords");
+
+	tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_all_keywords);
+	tcase_add_test(tc_core, test_parser_keyword_tokens);
+	tcase_add_test(tc_core, test_keyword_list);
+	tcase_add_test(tc_core, test_not_keywords);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int main(void) {
+
+	int number_failed = 0;
+	Suite *s;
+	SRunner *sr;
+
+	s = keywords_suite();
+	sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0)? 0 : -1;
+}
@@ -15,6 +15,8 @@
 */
 
 #include <check.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "../src/maps.h"
 
@@ -121,6 +123,64 @@ START_TEST (test_class_and_perm_maps) {
 }
 END_TEST
 
+START_TEST (test_class_perms_map) {
+
+	ck_assert_int_eq(SELINT_SUCCESS, insert_into_class_perms_map("file", "read", -1));
+	ck_assert_int_eq(SELINT_SUCCESS, insert_into_class_perms_map("file", "write", -1));
+	ck_assert_int_eq(SELINT_SUCCESS, insert_into_class_perms_map("file", "execute", 5));
+	ck_assert_int_eq(SELINT_SUCCESS, insert_into_class_perms_map("file", "read", -1));
+	ck_assert_int_eq(SELINT_BAD_ARG, insert_into_class_perms_map("file", "read", 3));
+	ck_assert_int_eq(SELINT_BAD_ARG, insert_into_class_perms_map("file", "open", 1));
+	ck_assert_int_eq(SELINT_BAD_ARG, insert_into_class_perms_map("file", "open", MAX_CLASS_PERMS));
+	ck_assert_int_eq(SELINT_SUCCESS, insert_into_class_perms_map("dir", NULL, -1));
+	insert_into_decl_map("read", "perm", DECL_PERM);
+	insert_into_decl_map("write", "perm", DECL_PERM);
+	insert_into_decl_map("search", "perm", DECL_PERM);
+
+	ck_assert_ptr_null(look_up_in_class_perms_map("socket"));
+
+	struct class_hash_elem *file = look_up_in_class_perms_map("file");
+	ck_assert_ptr_nonnull(file);
+	ck_assert_int_eq(6, file->perm_count);
+	ck_assert_str_eq("write", file->perms[1]);
+	ck_assert_ptr_null(file->perms[2]);
+	ck_assert_int_eq(0, look_up_perm_bit(file, "read"));
+	ck_assert_int_eq(5, look_up_perm_bit(file, "execute"));
+	ck_assert_int_eq(-1, look_up_perm_bit(file, "search"));
+
+	struct class_hash_elem *dir = look_up_in_class_perms_map("dir");
+	ck_assert_ptr_nonnull(dir);
+	ck_assert_int_eq(0, dir->perm_count);
+
+	const char *unknown;
+	struct string_list *perms = sl_array_append(NULL, strdup("read"));
+	perms = sl_array_append(perms, strdup("execute"));
+	ck_assert_int_eq(0x21, make_perm_mask(file, perms, &unknown));
+	ck_assert_ptr_null(unknown);
+
+	// Macros are left out, other classes' permissions are reported
+	perms = sl_array_append(perms, strdup("rw_file_perms"));
+	perms = sl_array_append(perms, strdup("search"));
+	ck_assert_int_eq(0x21, make_perm_mask(file, perms, &unknown));
+	ck_assert_str_eq("search", unknown);
+	free_string_list(perms);
+
+	perms = sl_array_append(NULL, strdup("~"));
+	perms = sl_array_append(perms, strdup("write"));
+	ck_assert_int_eq(0x21, make_perm_mask(file, perms, &unknown));
+	free_string_list(perms);
+
+	perms = sl_array_append(NULL, strdup("*"));
+	ck_assert_int_eq(0x23, make_perm_mask(file, perms, &unknown));
+	ck_assert_int_eq(0, make_perm_mask(dir, perms, &unknown));
+	free_string_list(perms);
+
+	free_all_maps();
+
+	ck_assert_ptr_null(look_up_in_class_perms_map("file"));
+}
+END_TEST
+
 START_TEST (test_mods_map) {
 
 	insert_into_mods_map("systemd", "base");
@@ -223,6 +283,7 @@ Suite *maps_suite(void) {
 	tcase_add_test(tc_core, test_insert_into_type_map_dup);
 	tcase_add_test(tc_core, test_role_and_user_maps);
 	tcase_add_test(tc_core, test_class_and_perm_maps);
+	tcase_add_test(tc_core, test_class_perms_map);
 	tcase_add_test(tc_core, test_mods_map);
 	tcase_add_test(tc_core, test_insert_decl_into_template_map);
 	tcase_add_test(tc_core, test_insert_call_into_template_map);
@@ -0,0 +1,264 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/neverallow.h"
+#include "../src/tree.h"
+#include "../src/maps.h"
+#include "test_utils.h"
+
+// Lines:
+//  1 attribute domain;
+//  2 attribute admin;
+//  3 type user_t, domain;
+//  4 type admin_t, domain, admin;
+//  5 type shadow_t;
+//  6 type etc_t;
+//  7 neverallow { domain -admin } shadow_t:file { read write };
+//  8 neverallow domain self:process execmem;
+//  9 neverallow * ~{ etc_t shadow_t }:dir *;
+static struct policy_file_list *make_files(void)
+{
+	struct policy_node *head = calloc(1, sizeof(struct policy_node));
+	head->flavor = NODE_TE_FILE;
+
+	struct policy_node *cur = add_next(head, NODE_DECL, make_decl(DECL_ATTRIBUTE, "domain", NULL));
+	cur = add_next(cur, NODE_DECL, make_decl(DECL_ATTRIBUTE, "admin", NULL));
+	cur = add_next(cur, NODE_DECL, make_decl(DECL_TYPE, "user_t", "domain"));
+	cur = add_next(cur, NODE_DECL, make_decl(DECL_TYPE, "admin_t", "domain admin"));
+	cur = add_next(cur, NODE_DECL, make_decl(DECL_TYPE, "shadow_t", NULL));
+	cur = add_next(cur, NODE_DECL, make_decl(DECL_TYPE, "etc_t", NULL));
+	cur = add_next(cur, NODE_AV_RULE, make_av_rule(AV_RULE_NEVERALLOW, "domain -admin", "shadow_t", "file", "read write"));
+	cur = add_next(cur, NODE_AV_RULE, make_av_rule(AV_RULE_NEVERALLOW, "domain", "self", "process", "execmem"));
+	add_next(cur, NODE_AV_RULE, make_av_rule(AV_RULE_NEVERALLOW, "*", "~ etc_t shadow_t", "dir", "*"));
+
+	return make_file_list("policy/modules/test.te", head);
+}
+
+// Returns the line of the neverallow rule the allow rule violates, or 0
+static unsigned int violated_line(const char *sources, const char *targets,
+                                  const char *classes, const char *perms)
+{
+	struct av_rule_data *allow = make_av_rule(AV_RULE_ALLOW, sources, targets,
+	                                          classes, perms).av_data;
+	const char *filename = NULL;
+	unsigned int lineno = 0;
+
+	if (find_violated_neverallow(allow, &filename, &lineno)) {
+		ck_assert_str_eq("test.te", filename);
+		ck_assert_int_ne(0, lineno);
+	} else {
+		lineno = 0;
+	}
+
+	free_av_rule_data(allow);
+
+	return lineno;
+}
+
+START_TEST (test_find_violated_neverallow) {
+	struct policy_file_list *files = make_files();
+	struct policy_file_list *no_files = make_file_list(NULL, NULL);
+
+	ck_assert_int_eq(SELINT_SUCCESS, build_neverallow_index(files, no_files));
+
+	ck_assert_int_eq(7, violated_line("user_t", "shadow_t", "file", "read"));
+	ck_assert_int_eq(7, violated_line("domain", "shadow_t", "file", "getattr write"));
+	ck_assert_int_eq(7, violated_line("user_t", "shadow_t", "~ dir", "read"));
+	ck_assert_int_eq(7, violated_line("user_t", "shadow_t", "file", "*"));
+	ck_assert_int_eq(7, violated_line("user_t", "shadow_t", "file", "~ getattr"));
+
+	// Excluded by the neverallow rule, or not covered by it
+	ck_assert_int_eq(0, violated_line("admin_t", "shadow_t", "file", "read"));
+	ck_assert_int_eq(0, violated_line("user_t", "shadow_t", "file", "getattr"));
+	ck_assert_int_eq(0, violated_line("user_t", "shadow_t", "lnk_file", "read"));
+	ck_assert_int_eq(0, violated_line("user_t", "etc_t", "file", "read"));
+	ck_assert_int_eq(0, violated_line("unknown_t", "shadow_t", "file", "read"));
+	ck_assert_int_eq(0, violated_line("user_t", "shadow_t", "file", "~ read write"));
+	ck_assert_int_eq(0, violated_line("domain -user_t", "shadow_t", "file", "read"));
+
+	// self on either side
+	ck_assert_int_eq(8, violated_line("user_t", "self", "process", "execmem"));
+	ck_assert_int_eq(8, violated_line("admin_t", "admin_t", "process", "execmem"));
+	ck_assert_int_eq(8, violated_line("user_t", "domain", "process", "execmem"));
+	ck_assert_int_eq(0, violated_line("user_t", "admin_t", "process", "execmem"));
+	ck_assert_int_eq(0, violated_line("shadow_t", "self", "process", "execmem"));
+	ck_assert_int_eq(0, violated_line("user_t", "self", "process", "signal"));
+
+	// Complemented targets and * permissions
+	ck_assert_int_eq(9, violated_line("etc_t", "user_t", "dir", "search"));
+	ck_assert_int_eq(9, violated_line("user_t", "self", "dir", "search"));
+	ck_assert_int_eq(0, violated_line("shadow_t", "self", "dir", "search"));
+	ck_assert_int_eq(0, violated_line("user_t", "etc_t", "dir", "search"));
+	ck_assert_int_eq(0, violated_line("etc_t", "self", "dir", "search"));
+
+	free_neverallow_index();
+
+	// Nothing is indexed once freed
+	ck_assert_int_eq(0, violated_line("user_t", "shadow_t", "file", "read"));
+
+	free_file_list(files);
+	free_file_list(no_files);
+	free_all_maps();
+}
+END_TEST
+
+START_TEST (test_class_perms) {
+	struct policy_file_list *files = make_files();
+	struct policy_file_list *no_files = make_file_list(NULL, NULL);
+
+	ck_assert_int_eq(SELINT_SUCCESS, insert_into_class_perms_map("file", "getattr", -1));
+	ck_assert_int_eq(SELINT_SUCCESS, insert_into_class_perms_map("file", "read", -1));
+	ck_assert_int_eq(SELINT_SUCCESS, insert_into_class_perms_map("file", "write", -1));
+	ck_assert_int_eq(SELINT_SUCCESS, build_neverallow_index(files, no_files));
+
+	// ~ and * cover the permissions of the class
+	ck_assert_int_eq(0, violated_line("user_t", "shadow_t", "file", "~ read write"));
+	ck_assert_int_eq(7, violated_line("user_t", "shadow_t", "file", "~ getattr"));
+	ck_assert_int_eq(7, violated_line("user_t", "shadow_t", "file", "*"));
+	ck_assert_int_eq(0, violated_line("user_t", "shadow_t", "file", "getattr"));
+
+	// Permission set macros are still compared by name
+	ck_assert_int_eq(0, violated_line("user_t", "shadow_t", "file", "read_file_perms"));
+	ck_assert_int_eq(7, violated_line("user_t", "shadow_t", "file", "read_file_perms write"));
+
+	// Classes that are not loaded are compared as before
+	ck_assert_int_eq(9, violated_line("user_t", "self", "dir", "search"));
+
+	free_neverallow_index();
+	free_file_list(files);
+	free_file_list(no_files);
+	free_all_maps();
+}
+END_TEST
+
+// interface(`read_shadow',`
+//	allow $1 shadow_t:file { getattr read };
+// ')
+// interface(`read_all',`
+//	read_shadow($1)
+//	allow $1 etc_t:file read;
+// ')
+static struct policy_node *make_interfaces(void)
+{
+	struct policy_node *head = calloc(1, sizeof(struct policy_node));
+	head->flavor = NODE_IF_FILE;
+
+	union node_data nd;
+	nd.str = NULL;
+
+	struct policy_node *def = add_def(head, NODE_INTERFACE_DEF, "read_shadow");
+	struct policy_node *cur = add_child(def, NODE_START_BLOCK, nd);
+	add_next(cur, NODE_AV_RULE, make_av_rule(AV_RULE_ALLOW, "$1", "shadow_t", "file", "getattr read"));
+
+	def = add_def(def, NODE_INTERFACE_DEF, "read_all");
+	cur = add_child(def, NODE_START_BLOCK, nd);
+	cur = add_next(cur, NODE_IF_CALL, make_call("read_shadow", "$1"));
+	add_next(cur, NODE_AV_RULE, make_av_rule(AV_RULE_ALLOW, "$1", "etc_t", "file", "read"));
+
+	return head;
+}
+
+static unsigned int violated_line_of_call(const char *name, const char *args)
+{
+	struct if_call_data *call = make_call(name, args).ic_data;
+	const char *filename = NULL;
+	unsigned int lineno = 0;
+
+	if (find_call_violating_neverallow(call, &filename, &lineno)) {
+		ck_assert_str_eq("test.te", filename);
+	} else {
+		lineno = 0;
+	}
+
+	free_if_call_data(call);
+
+	return lineno;
+}
+
+START_TEST (test_interface_calls) {
+	struct policy_file_list *files = make_files();
+	struct policy_file_list *if_files = make_file_list("test.if", make_interfaces());
+
+	ck_assert_int_eq(SELINT_SUCCESS, build_neverallow_index(files, if_files));
+
+	ck_assert_int_eq(7, violated_line_of_call("read_shadow", "user_t"));
+	ck_assert_int_eq(7, violated_line_of_call("read_all", "domain"));
+	ck_assert_int_eq(0, violated_line_of_call("read_all", "admin_t"));
+	ck_assert_int_eq(0, violated_line_of_call("unknown_interface", "user_t"));
+
+	// Calls passing on parameters are checked where the parameters are set
+	ck_assert_int_eq(0, violated_line_of_call("read_all", "$1"));
+
+	free_neverallow_index();
+	free_file_list(files);
+	free_file_list(if_files);
+	free_all_maps();
+}
+END_TEST
+
+START_TEST (test_no_neverallows) {
+	struct policy_node *head = calloc(1, sizeof(struct policy_node));
+	head->flavor = NODE_TE_FILE;
+	add_next(head, NODE_DECL, make_decl(DECL_TYPE, "foo_t", NULL));
+
+	struct policy_file_list *files = make_file_list("empty.te", head);
+	struct policy_file_list *no_files = make_file_list(NULL, NULL);
+
+	ck_assert_int_eq(SELINT_SUCCESS, build_neverallow_index(files, no_files));
+	ck_assert_int_eq(0, violated_line("*", "*", "*", "*"));
+
+	free_neverallow_index();
+	free_file_list(files);
+	free_file_list(no_files);
+	free_all_maps();
+}
+END_TEST
+
+Suite *neverallow_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Neverallow");
+
+	tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_find_violated_neverallow);
+	tcase_add_test(tc_core, test_class_perms);
+	tcase_add_test(tc_core, test_interface_calls);
+	tcase_add_test(tc_core, test_no_neverallows);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int main(void) {
+
+	int number_failed = 0;
+	Suite *s;
+	SRunner *sr;
+
+	s = neverallow_suite();
+	sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0)? 0 : -1;
+}
@@ -0,0 +1,269 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#define _GNU_SOURCE
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../src/output.h"
+
+// Format a result the way display_check_result() historically did with printf
+static char *reference_format(const struct check_result *res, const char *filename)
+{
+	char *ret;
+	size_t len = strlen(filename);
+	unsigned int padding = len > 18 ? 0 : 18 - len;
+
+	ck_assert_int_ne(-1, asprintf(&ret, "%s:%*u: (%c): %s (%c-%03u)\n",
+	                              filename, padding, res->lineno,
+	                              res->severity, res->message,
+	                              res->severity, res->check_id));
+	return ret;
+}
+
+static void check_one_format(const char *filename, unsigned int lineno,
+                             char severity, unsigned int check_id,
+                             const char *message)
+{
+	struct check_result res = { lineno, severity, check_id, (char *)message };
+	struct output_buffer *buf = make_output_buffer(0);
+
+	ck_assert_ptr_nonnull(buf);
+
+	output_append_result(buf, &res, filename);
+
+	char *expected = reference_format(&res, filename);
+	ck_assert_int_eq(strlen(expected), buf->len);
+	ck_assert_int_eq(0, memcmp(expected, buf->data, buf->len));
+
+	free(expected);
+	free_output_buffer(buf);
+}
+
+START_TEST (test_append_result_format) {
+
+	check_one_format("foo.te", 12, 'W', 2, "Some message");
+	check_one_format("foo.te", 0, 'C', 1, "");
+	check_one_format("a_much_longer_filename.if", 7, 'E', 5, "msg");
+	check_one_format("exactly_18_chars.te", 4294967295U, 'S', 1000, "big");
+	check_one_format("x", 123456, 'F', 2, "Syntax error");
+
+}
+END_TEST
+
+START_TEST (test_append_grows) {
+
+	struct output_buffer *buf = make_output_buffer(0);
+	struct check_result res = { 1, 'C', 1, "filler message" };
+
+	ck_assert_ptr_nonnull(buf);
+
+	size_t expected_len = 0;
+	char *one = reference_format(&res, "grow.te");
+	for (int i = 0; i < 10000; i++) {
+		output_append_result(buf, &res, "grow.te");
+		expected_len += strlen(one);
+	}
+
+	ck_assert_int_eq(expected_len, buf->len);
+	ck_assert_int_ge(buf->cap, buf->len);
+	ck_assert_int_eq(0, memcmp(one, buf->data + buf->len - strlen(one), strlen(one)));
+
+	free(one);
+	free_output_buffer(buf);
+
+}
+END_TEST
+
+START_TEST (test_json_format) {
+
+	struct check_result res = { 42, 'W', 2, "Type \"foo_t\" used\tbut\\not\x01 required" };
+	struct output_buffer *buf = make_output_buffer(0);
+
+	ck_assert_int_eq(SELINT_SUCCESS, output_set_format("json"));
+	ck_assert_int_eq(OUTPUT_FORMAT_JSON, output_get_format());
+
+	output_append_result(buf, &res, "foo.if");
+	output_append(buf, "", 1);
+
+	ck_assert_str_eq("{\"filename\":\"foo.if\",\"lineno\":42,\"severity\":\"W\","
+	                 "\"check_id\":\"W-002\",\"message\":\"Type \\\"foo_t\\\" used\\tbut"
+	                 "\\\\not\\u0001 required\"}\n", buf->data);
+	ck_assert_int_eq(1, buf->results);
+
+	ck_assert_int_eq(SELINT_SUCCESS, output_set_format("text"));
+	ck_assert_int_eq(OUTPUT_FORMAT_TEXT, output_get_format());
+	ck_assert_int_eq(SELINT_BAD_ARG, output_set_format("xml"));
+	ck_assert_int_eq(OUTPUT_FORMAT_TEXT, output_get_format());
+
+	free_output_buffer(buf);
+
+}
+END_TEST
+
+// Run output_begin(), append results to two buffers, flush them in order and
+// then output_end(), returning everything written to stdout
+static char *capture_sarif_log(void)
+{
+	int fds[2];
+	static char readback[4096];
+	struct check_result res1 = { 3, 'C', 4, "first" };
+	struct check_result res2 = { 7, 'E', 5, "second" };
+
+	ck_assert_int_eq(0, pipe(fds));
+
+	fflush(stdout);
+	int saved_stdout = dup(STDOUT_FILENO);
+	dup2(fds[1], STDOUT_FILENO);
+
+	struct output_buffer *buf1 = make_output_buffer(0);
+	struct output_buffer *buf2 = make_output_buffer(0);
+
+	output_begin();
+	output_append_result(buf1, &res1, "a.te");
+	output_append_result(buf2, &res2, "b.fc");
+	output_buffer_flush(buf1);
+	output_buffer_flush(buf2);
+	output_end();
+
+	dup2(saved_stdout, STDOUT_FILENO);
+	close(saved_stdout);
+	close(fds[1]);
+
+	ssize_t nread = read(fds[0], readback, sizeof(readback) - 1);
+	close(fds[0]);
+	ck_assert_int_gt(nread, 0);
+	readback[nread] = '\0';
+
+	free_output_buffer(buf1);
+	free_output_buffer(buf2);
+
+	return readback;
+}
+
+START_TEST (test_sarif_format) {
+
+	ck_assert_int_eq(SELINT_SUCCESS, output_set_format("sarif"));
+
+	char *log = capture_sarif_log();
+
+	ck_assert_int_eq(0, strncmp("{\"version\":\"2.1.0\",", log, 19));
+	ck_assert_ptr_nonnull(strstr(log, "\"results\":[\n{\"ruleId\":\"C-004\",\"level\":\"note\","
+	                              "\"message\":{\"text\":\"first\"},\"locations\":[{\"physicalLocation\":"
+	                              "{\"artifactLocation\":{\"uri\":\"a.te\"},\"region\":{\"startLine\":3}}}]}\n"
+	                              ",{\"ruleId\":\"E-005\",\"level\":\"error\","));
+	size_t len = strlen(log);
+	ck_assert_str_eq("]}]}\n", log + len - 5);
+
+	// A second log starts over without a leading comma
+	log = capture_sarif_log();
+	ck_assert_ptr_nonnull(strstr(log, "\"results\":[\n{\"ruleId\":\"C-004\""));
+
+	ck_assert_int_eq(SELINT_SUCCESS, output_set_format("text"));
+
+}
+END_TEST
+
+START_TEST (test_thread_buffer) {
+
+	struct output_buffer *def = output_get_thread_buffer();
+	struct output_buffer *buf = make_output_buffer(0);
+
+	ck_assert_ptr_nonnull(def);
+	ck_assert_int_eq(1, def->autoflush);
+
+	output_set_thread_buffer(buf);
+	ck_assert_ptr_eq(buf, output_get_thread_buffer());
+
+	output_set_thread_buffer(NULL);
+	ck_assert_ptr_eq(def, output_get_thread_buffer());
+
+	// Freeing the default buffer is a no-op
+	free_output_buffer(def);
+	free_output_buffer(buf);
+
+}
+END_TEST
+
+START_TEST (test_flush) {
+
+	int fds[2];
+	char readback[64];
+
+	ck_assert_int_eq(0, pipe(fds));
+
+	fflush(stdout);
+	int saved_stdout = dup(STDOUT_FILENO);
+	dup2(fds[1], STDOUT_FILENO);
+
+	struct output_buffer *buf = make_output_buffer(1);
+	output_append(buf, "hello\n", 6);
+	ck_assert_int_eq(6, buf->len);
+	output_buffer_flush(buf);
+	ck_assert_int_eq(0, buf->len);
+
+	dup2(saved_stdout, STDOUT_FILENO);
+	close(saved_stdout);
+	close(fds[1]);
+
+	ssize_t nread = read(fds[0], readback, sizeof(readback) - 1);
+	close(fds[0]);
+
+	ck_assert_int_eq(6, nread);
+	readback[nread] = '\0';
+	ck_assert_str_eq("hello\n", readback);
+
+	free_output_buffer(buf);
+
+}
+END_TEST
+
+Suite *output_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Output");
+
+	tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_append_result_format);
+	tcase_add_test(tc_core, test_append_grows);
+	tcase_add_test(tc_core, test_json_format);
+	tcase_add_test(tc_core, test_sarif_format);
+	tcase_add_test(tc_core, test_thread_buffer);
+	tcase_add_test(tc_core, test_flush);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int main(void) {
+
+	int number_failed = 0;
+	Suite *s;
+	SRunner *sr;
+
+	s = output_suite();
+	sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0)? 0 : -1;
+}
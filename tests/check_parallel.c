@@ -0,0 +1,178 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <check.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../src/parallel.h"
+
+#define ITEM_COUNT 10000
+
+struct counts {
+	unsigned int calls[ITEM_COUNT];
+	pthread_t threads[ITEM_COUNT];
+};
+
+static void count_call(void *ctx, unsigned int item)
+{
+	struct counts *counts = ctx;
+
+	__atomic_add_fetch(&counts->calls[item], 1, __ATOMIC_RELAXED);
+	counts->threads[item] = pthread_self();
+}
+
+START_TEST (test_run_in_parallel) {
+	struct counts *counts = calloc(1, sizeof(struct counts));
+
+	set_parallel_jobs(4);
+	ck_assert_int_eq(4, get_parallel_jobs());
+
+	run_in_parallel(ITEM_COUNT, count_call, counts);
+
+	// Every item is run exactly once
+	for (unsigned int i = 0; i < ITEM_COUNT; i++) {
+		ck_assert_int_eq(1, counts->calls[i]);
+	}
+
+	// Nothing to do
+	run_in_parallel(0, count_call, counts);
+	ck_assert_int_eq(1, counts->calls[0]);
+
+	free(counts);
+}
+END_TEST
+
+// Count the threads other than the calling one that ran an item
+static unsigned int other_threads(const struct counts *counts, unsigned int count,
+                                  pthread_t *seen, unsigned int max)
+{
+	unsigned int found = 0;
+
+	for (unsigned int i = 0; i < count; i++) {
+		if (pthread_equal(pthread_self(), counts->threads[i])) {
+			continue;
+		}
+		unsigned int j;
+		for (j = 0; j < found; j++) {
+			if (pthread_equal(seen[j], counts->threads[i])) {
+				break;
+			}
+		}
+		if (j == found && found < max) {
+			seen[found++] = counts->threads[i];
+		}
+	}
+
+	return found;
+}
+
+static void slow_call(void *ctx, unsigned int item)
+{
+	usleep(100);
+	count_call(ctx, item);
+}
+
+START_TEST (test_run_in_parallel_reuses_threads) {
+	struct counts *counts = calloc(1, sizeof(struct counts));
+	pthread_t first[4];
+	pthread_t second[4];
+
+	set_parallel_jobs(4);
+
+	run_in_parallel(1000, slow_call, counts);
+	unsigned int first_count = other_threads(counts, 1000, first, 4);
+	ck_assert_int_ge(first_count, 1);
+	ck_assert_int_ge(3, first_count);
+
+	memset(counts, 0, sizeof(struct counts));
+	run_in_parallel(1000, slow_call, counts);
+	unsigned int second_count = other_threads(counts, 1000, second, 4);
+
+	// The second run is done by the threads started for the first
+	for (unsigned int i = 0; i < second_count; i++) {
+		int found = 0;
+		for (unsigned int j = 0; j < first_count; j++) {
+			found |= pthread_equal(second[i], first[j]);
+		}
+		ck_assert(found);
+	}
+
+	// Once stopped, new threads are started
+	stop_parallel_jobs();
+	memset(counts, 0, sizeof(struct counts));
+	run_in_parallel(1000, slow_call, counts);
+	for (unsigned int i = 0; i < 1000; i++) {
+		ck_assert_int_eq(1, counts->calls[i]);
+	}
+
+	free(counts);
+}
+END_TEST
+
+START_TEST (test_run_in_parallel_single_job) {
+	struct counts *counts = calloc(1, sizeof(struct counts));
+
+	set_parallel_jobs(1);
+
+	run_in_parallel(100, count_call, counts);
+
+	// Everything runs on the calling thread
+	for (unsigned int i = 0; i < 100; i++) {
+		ck_assert_int_eq(1, counts->calls[i]);
+		ck_assert(pthread_equal(pthread_self(), counts->threads[i]));
+	}
+
+	// One job per CPU
+	set_parallel_jobs(0);
+	ck_assert_int_ge(get_parallel_jobs(), 1);
+
+	free(counts);
+}
+END_TEST
+
+Suite *parallel_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Parallel");
+
+	tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_run_in_parallel);
+	tcase_add_test(tc_core, test_run_in_parallel_reuses_threads);
+	tcase_add_test(tc_core, test_run_in_parallel_single_job);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int main(void) {
+
+	int number_failed = 0;
+	Suite *s;
+	SRunner *sr;
+
+	s = parallel_suite();
+	sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0)? 0 : -1;
+}
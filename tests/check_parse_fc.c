@@ -16,6 +16,8 @@
 
 #include <check.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "../src/tree.h"
 #include "../src/parse_fc.h"
@@ -74,6 +76,36 @@ START_TEST (test_parse_fc_line_with_gen_context) {
 }
 END_TEST
 
+START_TEST (test_parse_fc_line_with_mcs_range) {
+	const char *line = "/var/tmp	-d	gen_context(system_u:object_r:tmp_t,s0-mls_systemhigh, mcs_allcats)\n";
+	char *copy = strdup(line);
+
+	struct fc_entry *out = parse_fc_line(copy);
+
+	ck_assert_ptr_nonnull(out);
+	// The line is left as it was
+	ck_assert_str_eq(line, copy);
+	ck_assert_str_eq("/var/tmp", out->path);
+	ck_assert(out->obj == 'd');
+	ck_assert_ptr_nonnull(out->context);
+	ck_assert_int_eq(1, out->context->has_gen_context);
+	ck_assert_str_eq("tmp_t", out->context->type);
+	ck_assert_str_eq("s0-mls_systemhigh:mcs_allcats", out->context->range);
+
+	free_fc_entry(out);
+	free(copy);
+
+	ck_assert_ptr_null(parse_fc_line("/usr/bin -- gen_context(system_u:object_r:bin_t,s0\n"));
+	ck_assert_ptr_null(parse_fc_line("/usr/bin -dir system_u:object_r:bin_t\n"));
+	ck_assert_ptr_null(parse_fc_line(" \t"));
+
+	out = parse_fc_line("/usr/bin\t<<none>>\n");
+	ck_assert_ptr_nonnull(out);
+	ck_assert_ptr_null(out->context);
+	free_fc_entry(out);
+}
+END_TEST
+
 START_TEST (test_parse_fc_line) {
 	char line[] = "/usr/bin(/.*)?		system_u:object_r:bin_t:s0";
 
@@ -159,6 +191,7 @@ START_TEST (test_parse_m4) {
 	struct policy_node *cur = ast->next;
 
 	ck_assert_int_eq(cur->flavor, NODE_FC_ENTRY);
+	ck_assert_ptr_null(cur->data.fc_data->conditions);
 	ck_assert_ptr_nonnull(cur->next);
 
 	cur = cur->next;
@@ -170,6 +203,9 @@ START_TEST (test_parse_m4) {
 
 	ck_assert_ptr_nonnull(data->context);
 	ck_assert_str_eq(data->context->type, "hijklmn_t");
+	ck_assert_ptr_nonnull(data->conditions);
+	ck_assert_str_eq(data->conditions->string, "distro_windows");
+	ck_assert_ptr_null(data->conditions->next);
 
 	ck_assert_ptr_null(cur->next);
 
@@ -198,6 +234,97 @@ START_TEST (test_parse_none_context) {
 END_TEST
 
 
+START_TEST (test_parse_fc_lines) {
+	const char *contents = "/usr/bin/foo\t--\tgen_context(system_u:object_r:foo_exec_t, s0)\n"
+	                       "\n"
+	                       "# comment\n"
+	                       "/etc/foo(/.*)?\tgen_context(system_u:object_r:foo_conf_t, s0)\n"
+	                       "/var/foo\tsystem_u:object_r:foo_var_t:s0";
+	const char *split = strchr(contents, '#');
+
+	struct policy_node *head = calloc(1, sizeof(struct policy_node));
+	head->flavor = NODE_FC_FILE;
+
+	// Parse in two parts, the second starting on line 3
+	struct policy_node *last = parse_fc_lines(head, contents, split, 1);
+	ck_assert_ptr_nonnull(last);
+	ck_assert_int_eq(last->flavor, NODE_FC_ENTRY);
+	ck_assert_int_eq(last->lineno, 1);
+	ck_assert_str_eq(last->data.fc_data->context->type, "foo_exec_t");
+
+	last = parse_fc_lines(last, split, contents + strlen(contents), 3);
+	ck_assert_ptr_nonnull(last);
+
+	struct policy_node *cur = head->next;
+	ck_assert_int_eq(cur->lineno, 1);
+
+	cur = cur->next;
+	ck_assert_int_eq(cur->flavor, NODE_FC_ENTRY);
+	ck_assert_int_eq(cur->lineno, 4);
+	ck_assert_str_eq(cur->data.fc_data->path, "/etc/foo(/.*)?");
+
+	cur = cur->next;
+	ck_assert_ptr_eq(cur, last);
+	ck_assert_int_eq(cur->lineno, 5);
+	ck_assert_str_eq(cur->data.fc_data->context->type, "foo_var_t");
+	ck_assert_ptr_null(cur->next);
+
+	// Nothing to parse
+	ck_assert_ptr_eq(last, parse_fc_lines(last, split, split, 3));
+
+	free_policy_node(head);
+}
+END_TEST
+
+START_TEST (test_parse_fc_conditions) {
+	const char *contents = "ifdef(`distro_a',`\n"
+	                       "/a\tgen_context(system_u:object_r:a_t, s0)\n"
+	                       "ifndef(`distro_b',`\n"
+	                       "/b\tgen_context(system_u:object_r:b_t, s0)\n"
+	                       "', `\n"
+	                       "/c\tgen_context(system_u:object_r:c_t, s0)\n"
+	                       "')\n"
+	                       "',`\n"
+	                       "/d\tgen_context(system_u:object_r:d_t, s0)\n"
+	                       "')\n"
+	                       "ifdef(`distro_e',`/e\tgen_context(system_u:object_r:e_t, s0)')\n"
+	                       "/f\tgen_context(system_u:object_r:f_t, s0)\n";
+
+	struct policy_node *head = calloc(1, sizeof(struct policy_node));
+	head->flavor = NODE_FC_FILE;
+
+	ck_assert_ptr_nonnull(parse_fc_lines(head, contents, contents + strlen(contents), 1));
+
+	struct policy_node *cur = head->next;
+	ck_assert_str_eq(cur->data.fc_data->path, "/a");
+	ck_assert_str_eq(cur->data.fc_data->conditions->string, "distro_a");
+	ck_assert_ptr_null(cur->data.fc_data->conditions->next);
+
+	cur = cur->next;
+	ck_assert_str_eq(cur->data.fc_data->path, "/b");
+	ck_assert_str_eq(cur->data.fc_data->conditions->string, "distro_a");
+	ck_assert_str_eq(cur->data.fc_data->conditions->next->string, "!distro_b");
+
+	cur = cur->next;
+	ck_assert_str_eq(cur->data.fc_data->path, "/c");
+	ck_assert_str_eq(cur->data.fc_data->conditions->string, "distro_a");
+	ck_assert_str_eq(cur->data.fc_data->conditions->next->string, "distro_b");
+
+	cur = cur->next;
+	ck_assert_str_eq(cur->data.fc_data->path, "/d");
+	ck_assert_str_eq(cur->data.fc_data->conditions->string, "!distro_a");
+	ck_assert_ptr_null(cur->data.fc_data->conditions->next);
+
+	// Blocks on a single line are skipped
+	cur = cur->next;
+	ck_assert_str_eq(cur->data.fc_data->path, "/f");
+	ck_assert_ptr_null(cur->data.fc_data->conditions);
+	ck_assert_ptr_null(cur->next);
+
+	free_policy_node(head);
+}
+END_TEST
+
 Suite *parse_fc_suite(void) {
 	Suite *s;
 	TCase *tc_core;
@@ -209,11 +336,14 @@ Suite *parse_fc_suite(void) {
 	tcase_add_test(tc_core, test_parse_context);
 	tcase_add_test(tc_core, test_parse_context_missing_field);
 	tcase_add_test(tc_core, test_parse_fc_line_with_gen_context);
+	tcase_add_test(tc_core, test_parse_fc_line_with_mcs_range);
 	tcase_add_test(tc_core, test_parse_fc_line);
 	tcase_add_test(tc_core, test_parse_fc_line_with_obj);
 	tcase_add_test(tc_core, test_parse_basic_fc_file);
 	tcase_add_test(tc_core, test_parse_m4);
 	tcase_add_test(tc_core, test_parse_none_context);
+	tcase_add_test(tc_core, test_parse_fc_lines);
+	tcase_add_test(tc_core, test_parse_fc_conditions);
 	suite_add_tcase(s, tc_core);
 
 	return s;
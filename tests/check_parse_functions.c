@@ -20,6 +20,7 @@
 
 #include "../src/parse_functions.h"
 #include "../src/maps.h"
+#include "../src/check_hooks.h"
 
 #define EXAMPLE_TYPE_1 "foo_t"
 #define EXAMPLE_TYPE_2 "bar_t"
@@ -460,9 +461,22 @@ START_TEST (test_save_command) {
 
 	ck_assert_int_eq(SELINT_PARSE_ERROR, save_command(cur, "selint-fake:W-001"));
 
-	ck_assert_ptr_null(cur->exceptions);
+	ck_assert_int_eq(0, cur->exceptions);
 	ck_assert_int_eq(SELINT_SUCCESS, save_command(cur, "selint-disable:W-001"));
-	ck_assert_str_eq("W-001", cur->exceptions);
+	ck_assert_int_eq(CHECK_BIT(check_index("W-001")), cur->exceptions);
+
+	cur->exceptions = 0;
+	ck_assert_int_eq(SELINT_SUCCESS, save_command(cur, "#selint-disable:C-001,W-005\n"));
+	ck_assert_int_eq(CHECK_BIT(check_index("C-001")) | CHECK_BIT(check_index("W-005")), cur->exceptions);
+
+	// File wide exceptions go on the head of the file
+	ck_assert_int_eq(SELINT_SUCCESS, insert_comment(&cur, 1));
+	ck_assert_ptr_nonnull(cur->prev);
+	ck_assert_int_eq(SELINT_SUCCESS, save_command(cur, "#selint-disable-file:S-001\n"));
+	ck_assert_int_eq(0, cur->exceptions);
+	ck_assert_int_eq(CHECK_BIT(check_index("C-001")) | CHECK_BIT(check_index("W-005")) | CHECK_BIT(check_index("S-001")),
+	                 cur->prev->exceptions);
+	cur = cur->prev;
 
 	ck_assert_int_eq(SELINT_SUCCESS, free_policy_node(cur));
 	cleanup_parsing();
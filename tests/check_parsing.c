@@ -20,20 +20,26 @@
 #include "../src/tree.h"
 #include "../src/parse.h"
 #include "../src/parse_functions.h"
+#include "../src/check_hooks.h"
 
 #define POLICIES_DIR SAMPLE_POL_DIR
 #define BASIC_TE_FILENAME POLICIES_DIR "basic.te"
 #define BASIC_IF_FILENAME POLICIES_DIR "basic.if"
 #define UNCOMMON_TE_FILENAME POLICIES_DIR "uncommon.te"
 #define BLOCKS_TE_FILENAME POLICIES_DIR "blocks.te"
+#define CONDITIONALS_TE_FILENAME POLICIES_DIR "conditionals.te"
 #define EMPTY_TE_FILENAME POLICIES_DIR "empty.te"
 #define SYNTAX_ERROR_FILENAME POLICIES_DIR "syntax_error.te"
 #define BAD_RA_FILENAME POLICIES_DIR "bad_role_allow.te"
 #define DISABLE_COMMENT_FILENAME POLICIES_DIR "disable_comment.te"
+#define DISABLE_BLOCK_FILENAME POLICIES_DIR "disable_block.te"
+#define DISABLE_FILE_POSITIONS_FILENAME POLICIES_DIR "disable_file_positions.te"
 
 extern FILE * yyin;
 extern int yyparse(void);
 extern int yyrestart(FILE *input_file);
+extern int set_lex_buffer(char *buf, size_t size);
+extern void clear_lex_buffer(void);
 struct policy_node *ast;
 extern struct policy_node *cur;
 extern const char *parsing_filename;
@@ -212,6 +218,58 @@ START_TEST (test_parse_blocks) {
 }
 END_TEST
 
+// Check that node is a block holding a single av rule granting perm
+static void check_block_with_rule(const struct policy_node *node,
+                                  enum node_flavor flavor, const char *perm)
+{
+	ck_assert_int_eq(flavor, node->flavor);
+	ck_assert_ptr_nonnull(node->first_child);
+	ck_assert_int_eq(NODE_START_BLOCK, node->first_child->flavor);
+	ck_assert_ptr_nonnull(node->first_child->next);
+	ck_assert_int_eq(NODE_AV_RULE, node->first_child->next->flavor);
+	ck_assert_str_eq(perm, node->first_child->next->data.av_data->perms->string);
+	ck_assert_ptr_null(node->first_child->next->next);
+}
+
+START_TEST (test_parse_conditional_blocks) {
+
+	ast = cur = calloc(1, sizeof(struct policy_node));
+	set_current_module_name("conditionals");
+
+	yyin = fopen(CONDITIONALS_TE_FILENAME, "r");
+	ck_assert_int_eq(0, yyparse());
+
+	ck_assert_ptr_nonnull(ast);
+	ck_assert_int_eq(NODE_TE_FILE, ast->flavor);
+
+	// Each branch is a block of its own, with the branch taken otherwise
+	// following the first
+	struct policy_node *current = ast->next;
+	check_block_with_rule(current, NODE_IFDEF, "read");
+	current = current->next;
+	check_block_with_rule(current, NODE_IFDEF_ELSE, "write");
+	ck_assert_int_eq(SCOPE_IFDEF, current->first_child->next->scope);
+
+	current = current->next;
+	check_block_with_rule(current, NODE_TUNABLE_POLICY, "read");
+	current = current->next;
+	check_block_with_rule(current, NODE_TUNABLE_ELSE, "write");
+	ck_assert_int_eq(SCOPE_TUNABLE, current->first_child->next->scope);
+
+	current = current->next;
+	check_block_with_rule(current, NODE_BOOLEAN_POLICY, "read");
+	ck_assert_int_eq(SCOPE_BOOLEAN, current->first_child->next->scope);
+	current = current->next;
+	check_block_with_rule(current, NODE_BOOLEAN_ELSE, "write");
+	ck_assert_int_eq(SCOPE_BOOLEAN, current->first_child->next->scope);
+	ck_assert_ptr_null(current->next);
+
+	free_policy_node(ast);
+	cleanup_parsing();
+	fclose(yyin);
+}
+END_TEST
+
 START_TEST (test_parse_empty_file) {
 
 	ast = cur = calloc(1, sizeof(struct policy_node));
@@ -280,7 +338,71 @@ START_TEST (test_disable_comment) {
 	ck_assert_int_eq(NODE_DECL, ast->next->flavor);
 	ck_assert_ptr_nonnull(ast->next->next);
 	ck_assert_int_eq(NODE_AV_RULE, ast->next->next->flavor);
-	ck_assert_str_eq("W-001\n", ast->next->next->exceptions);
+	ck_assert_int_eq(CHECK_BIT(check_index("W-001")), ast->next->next->exceptions);
+	ck_assert_int_eq(0, ast->next->exceptions);
+
+	free_policy_node(ast);
+	cleanup_parsing();
+	fclose(yyin);
+
+}
+END_TEST
+
+START_TEST (test_disable_block) {
+
+	ast = cur = calloc(1, sizeof(struct policy_node));
+	set_current_module_name("disable_block");
+
+	yyin = fopen(DISABLE_BLOCK_FILENAME, "r");
+	yyrestart(yyin);
+	ck_assert_int_eq(0, yyparse());
+
+	uint64_t w001 = CHECK_BIT(check_index("W-001"));
+	uint64_t w005 = CHECK_BIT(check_index("W-005"));
+
+	// File wide exceptions are saved on the head
+	ck_assert_int_eq(CHECK_BIT(check_index("C-001")), ast->exceptions);
+
+	ck_assert_ptr_nonnull(ast->next);
+	ck_assert_int_eq(NODE_OPTIONAL_POLICY, ast->next->flavor);
+	ck_assert_int_eq(w001 | w005, ast->next->exceptions);
+
+	// Nodes in the block inherit its exceptions
+	ck_assert_ptr_nonnull(ast->next->first_child);
+	ck_assert_ptr_nonnull(ast->next->first_child->next);
+	ck_assert_int_eq(NODE_AV_RULE, ast->next->first_child->next->flavor);
+	ck_assert_int_eq(w001 | w005, ast->next->first_child->next->exceptions);
+
+	ck_assert_ptr_nonnull(ast->next->next);
+	ck_assert_int_eq(NODE_AV_RULE, ast->next->next->flavor);
+	ck_assert_int_eq(0, ast->next->next->exceptions);
+
+	free_policy_node(ast);
+	cleanup_parsing();
+	fclose(yyin);
+
+}
+END_TEST
+
+START_TEST (test_disable_file_positions) {
+
+	ast = cur = calloc(1, sizeof(struct policy_node));
+	set_current_module_name("disable_file_positions");
+
+	yyin = fopen(DISABLE_FILE_POSITIONS_FILENAME, "r");
+	yyrestart(yyin);
+	ck_assert_int_eq(0, yyparse());
+
+	// Only a disable-file comment starting a line is file wide, indented or
+	// trailing ones are ordinary comments
+	ck_assert_int_eq(CHECK_BIT(check_index("W-001")), ast->exceptions);
+
+	ck_assert_ptr_nonnull(ast->next);
+	ck_assert_int_eq(NODE_AV_RULE, ast->next->flavor);
+	ck_assert_ptr_nonnull(ast->next->next);
+	ck_assert_int_eq(NODE_AV_RULE, ast->next->next->flavor);
+	ck_assert_int_eq(0, ast->next->next->exceptions);
+	ck_assert_ptr_null(ast->next->next->next);
 
 	free_policy_node(ast);
 	cleanup_parsing();
@@ -289,6 +411,72 @@ START_TEST (test_disable_comment) {
 }
 END_TEST
 
+static unsigned int count_nodes(const struct policy_node *head)
+{
+	unsigned int count = 0;
+
+	for (const struct policy_node *node = head; node; node = dfs_next(node)) {
+		count++;
+	}
+
+	return count;
+}
+
+START_TEST (test_lex_buffer_then_yyin) {
+
+	// The buffer ends in two NULs, which are part of its size
+	char buf[] = "policy_module(buffered, 1.0)\n\ntype buffered_t;\n\0";
+
+	ast = cur = calloc(1, sizeof(struct policy_node));
+	ast->flavor = NODE_TE_FILE;
+	set_current_module_name("buffered");
+	ck_assert_int_eq(0, set_lex_buffer(buf, sizeof(buf)));
+	ck_assert_int_eq(0, yyparse());
+	clear_lex_buffer();
+
+	ck_assert_ptr_nonnull(ast->next);
+	ck_assert_int_eq(NODE_DECL, ast->next->flavor);
+	ck_assert_str_eq("buffered_t", ast->next->data.d_data->name);
+	free_policy_node(ast);
+
+	// Once the buffer is cleared, the lexer reads the file set in yyin
+	ast = cur = calloc(1, sizeof(struct policy_node));
+	ast->flavor = NODE_TE_FILE;
+	set_current_module_name("basic");
+	yyin = fopen(BASIC_TE_FILENAME, "r");
+	ck_assert_ptr_nonnull(yyin);
+	ck_assert_int_eq(0, yyparse());
+	fclose(yyin);
+
+	unsigned int from_file = count_nodes(ast);
+	ck_assert_ptr_nonnull(ast->next);
+	ck_assert_str_eq("basic_t", ast->next->data.d_data->name);
+	free_policy_node(ast);
+
+	// And a buffer can be lexed again after a file
+	char basic[4096];
+	yyin = fopen(BASIC_TE_FILENAME, "r");
+	size_t len = fread(basic, 1, sizeof(basic) - 2, yyin);
+	fclose(yyin);
+	yyin = NULL;
+	basic[len] = basic[len + 1] = '\0';
+
+	ast = cur = calloc(1, sizeof(struct policy_node));
+	ast->flavor = NODE_TE_FILE;
+	ck_assert_int_eq(0, set_lex_buffer(basic, len + 2));
+	ck_assert_int_eq(0, yyparse());
+	clear_lex_buffer();
+	ck_assert_int_eq(from_file, count_nodes(ast));
+
+	// A buffer without the two NULs is rejected
+	ck_assert_int_eq(-1, set_lex_buffer(buf, sizeof(buf) - 1));
+
+	free_policy_node(ast);
+	cleanup_parsing();
+
+}
+END_TEST
+
 Suite *parsing_suite(void) {
 	Suite *s;
 	TCase *tc_core;
@@ -301,10 +489,14 @@ Suite *parsing_suite(void) {
 	tcase_add_test(tc_core, test_parse_basic_if);
 	tcase_add_test(tc_core, test_parse_uncommon_constructs);
 	tcase_add_test(tc_core, test_parse_blocks);
+	tcase_add_test(tc_core, test_parse_conditional_blocks);
 	tcase_add_test(tc_core, test_parse_empty_file);
 	tcase_add_test(tc_core, test_syntax_error);
 	tcase_add_test(tc_core, test_parse_bad_role_allow);
 	tcase_add_test(tc_core, test_disable_comment);
+	tcase_add_test(tc_core, test_disable_block);
+	tcase_add_test(tc_core, test_disable_file_positions);
+	tcase_add_test(tc_core, test_lex_buffer_then_yyin);
 	suite_add_tcase(s, tc_core);
 
 	return s;
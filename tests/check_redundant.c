@@ -0,0 +1,228 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/redundant.h"
+#include "../src/tree.h"
+#include "../src/maps.h"
+#include "test_utils.h"
+
+// Returns the line of the rule covering node, or 0
+static unsigned int covering_line(const struct policy_node *node)
+{
+	const char *filename = NULL;
+	unsigned int lineno = 0;
+
+	if (!find_covering_rule(node, &filename, &lineno)) {
+		return 0;
+	}
+	ck_assert_ptr_nonnull(filename);
+
+	return lineno;
+}
+
+START_TEST (test_find_covering_rule) {
+	struct policy_node *head = calloc(1, sizeof(struct policy_node));
+	head->flavor = NODE_TE_FILE;
+
+	// 1 allow a_t { b_t c_t }:file { read write getattr };
+	// 2 allow a_t b_t:file read;
+	// 3 dontaudit a_t b_t:file read;
+	// 4 allow a_t { b_t d_t }:file read;
+	// 5 allow a_t c_t:{ file dir } read;
+	// 6 allow a_t c_t:file { write getattr read };
+	// 7 allow a_t ~b_t:file read;
+	// 8 optional_policy(`
+	// 9     allow e_t f_t:file read;
+	// 10    allow a_t b_t:file write;
+	// 11 ')
+	// 12 allow e_t f_t:file read;
+	struct policy_node *line1 = add_next(head, NODE_AV_RULE, make_av_rule(AV_RULE_ALLOW, "a_t", "b_t c_t", "file", "read write getattr"));
+	struct policy_node *line2 = add_next(line1, NODE_AV_RULE, make_av_rule(AV_RULE_ALLOW, "a_t", "b_t", "file", "read"));
+	struct policy_node *line3 = add_next(line2, NODE_AV_RULE, make_av_rule(AV_RULE_DONTAUDIT, "a_t", "b_t", "file", "read"));
+	struct policy_node *line4 = add_next(line3, NODE_AV_RULE, make_av_rule(AV_RULE_ALLOW, "a_t", "b_t d_t", "file", "read"));
+	struct policy_node *line5 = add_next(line4, NODE_AV_RULE, make_av_rule(AV_RULE_ALLOW, "a_t", "c_t", "file dir", "read"));
+	struct policy_node *line6 = add_next(line5, NODE_AV_RULE, make_av_rule(AV_RULE_ALLOW, "a_t", "c_t", "file", "write getattr read"));
+	struct policy_node *line7 = add_next(line6, NODE_AV_RULE, make_av_rule(AV_RULE_ALLOW, "a_t", "~ b_t", "file", "read"));
+
+	union node_data nd;
+	nd.str = NULL;
+	struct policy_node *optional = add_next(line7, NODE_OPTIONAL_POLICY, nd);
+	struct policy_node *line9 = add_child(optional, NODE_AV_RULE,
+	                                      make_av_rule(AV_RULE_ALLOW, "e_t", "f_t", "file", "read"));
+	struct policy_node *line10 = add_next(line9, NODE_AV_RULE, make_av_rule(AV_RULE_ALLOW, "a_t", "b_t", "file", "write"));
+	line10->lineno = 10;
+	struct policy_node *line12 = add_next(optional, NODE_AV_RULE, make_av_rule(AV_RULE_ALLOW, "e_t", "f_t", "file", "read"));
+	line12->lineno = 12;
+
+	struct policy_file_list *files = make_file_list("test.te", head);
+
+	ck_assert_int_eq(SELINT_SUCCESS, build_redundant_rule_index(files));
+
+	ck_assert_int_eq(0, covering_line(line1));
+	ck_assert_int_eq(1, covering_line(line2));
+	// Different flavor
+	ck_assert_int_eq(0, covering_line(line3));
+	// d_t is only in this rule
+	ck_assert_int_eq(0, covering_line(line4));
+	ck_assert_int_eq(0, covering_line(line5));
+	// Identical to line 1 for c_t, but line 1 also covers b_t
+	ck_assert_int_eq(1, covering_line(line6));
+	ck_assert_int_eq(0, covering_line(line7));
+	// A rule in a block only covers rules in the same block
+	ck_assert_int_eq(12, covering_line(line9));
+	ck_assert_int_eq(1, covering_line(line10));
+	ck_assert_int_eq(0, covering_line(line12));
+
+	free_redundant_rule_index();
+	ck_assert_int_eq(0, covering_line(line2));
+
+	free_file_list(files);
+	free_all_maps();
+}
+END_TEST
+
+START_TEST (test_identical_rules) {
+	struct policy_node *head = calloc(1, sizeof(struct policy_node));
+	head->flavor = NODE_TE_FILE;
+	struct policy_node *first = add_next(head, NODE_AV_RULE, make_av_rule(AV_RULE_ALLOW, "a_t", "b_t", "file", "read write"));
+	struct policy_node *second = add_next(first, NODE_AV_RULE, make_av_rule(AV_RULE_ALLOW, "a_t", "b_t", "file", "write read"));
+
+	struct policy_node *other_head = calloc(1, sizeof(struct policy_node));
+	other_head->flavor = NODE_TE_FILE;
+	struct policy_node *third = add_next(other_head, NODE_AV_RULE, make_av_rule(AV_RULE_ALLOW, "a_t", "b_t", "file", "read write"));
+
+	struct policy_file_list *files = make_file_list("first.te", head);
+	file_list_push_back(files, make_policy_file("dir/second.te", other_head));
+
+	ck_assert_int_eq(SELINT_SUCCESS, build_redundant_rule_index(files));
+
+	// Only the later copies are reported
+	ck_assert_int_eq(0, covering_line(first));
+	ck_assert_int_eq(1, covering_line(second));
+
+	const char *filename;
+	unsigned int lineno;
+	ck_assert_int_eq(1, find_covering_rule(third, &filename, &lineno));
+	ck_assert_str_eq("first.te", filename);
+	ck_assert_int_eq(1, lineno);
+
+	free_redundant_rule_index();
+	free_file_list(files);
+	free_all_maps();
+}
+END_TEST
+
+// Add a block after prev holding one av rule, and return the block
+static struct policy_node *add_block_with_rule(struct policy_node *prev,
+                                               enum node_flavor flavor,
+                                               const char *class, const char *perms,
+                                               struct policy_node **rule)
+{
+	union node_data nd;
+	nd.str = NULL;
+
+	struct policy_node *block = add_next(prev, flavor, nd);
+	*rule = add_child(block, NODE_AV_RULE,
+	                  make_av_rule(AV_RULE_ALLOW, "a_t", "b_t", class, perms));
+
+	return block;
+}
+
+START_TEST (test_exclusive_branches) {
+	struct policy_node *head = calloc(1, sizeof(struct policy_node));
+	head->flavor = NODE_TE_FILE;
+
+	struct policy_node *narrow_ifdef, *wide_ifdef_else;
+	struct policy_node *narrow_tunable, *wide_tunable_else;
+	struct policy_node *narrow_boolean, *wide_boolean_else;
+	struct policy_node *wide_boolean, *narrow_in_boolean;
+
+	// ifdef(`x',`allow a_t b_t:file read;',`allow a_t b_t:file { read write };')
+	struct policy_node *cur = add_block_with_rule(head, NODE_IFDEF, "file", "read", &narrow_ifdef);
+	cur = add_block_with_rule(cur, NODE_IFDEF_ELSE, "file", "read write", &wide_ifdef_else);
+
+	// The same in the branches of a tunable_policy
+	cur = add_block_with_rule(cur, NODE_TUNABLE_POLICY, "dir", "read", &narrow_tunable);
+	cur = add_block_with_rule(cur, NODE_TUNABLE_ELSE, "dir", "read write", &wide_tunable_else);
+
+	// if (b) { allow a_t b_t:lnk_file read; } else { ... { read write }; }
+	cur = add_block_with_rule(cur, NODE_BOOLEAN_POLICY, "lnk_file", "read", &narrow_boolean);
+	cur = add_block_with_rule(cur, NODE_BOOLEAN_ELSE, "lnk_file", "read write", &wide_boolean_else);
+
+	// An unconditional rule, and a wider one that only applies if b is set
+	struct policy_node *unconditional = add_next(cur, NODE_AV_RULE, make_av_rule(AV_RULE_ALLOW, "a_t", "b_t", "sock_file", "read"));
+	cur = add_block_with_rule(unconditional, NODE_BOOLEAN_POLICY, "sock_file", "read write", &wide_boolean);
+
+	// A conditional rule that an unconditional one covers
+	struct policy_node *wide = add_next(cur, NODE_AV_RULE, make_av_rule(AV_RULE_ALLOW, "a_t", "b_t", "fifo_file", "read write"));
+	wide->lineno = 100;
+	add_block_with_rule(wide, NODE_BOOLEAN_POLICY, "fifo_file", "read", &narrow_in_boolean);
+
+	struct policy_file_list *files = make_file_list("test.te", head);
+
+	ck_assert_int_eq(SELINT_SUCCESS, build_redundant_rule_index(files));
+
+	// Rules in branches that exclude each other cover nothing in the other
+	ck_assert_int_eq(0, covering_line(narrow_ifdef));
+	ck_assert_int_eq(0, covering_line(wide_ifdef_else));
+	ck_assert_int_eq(0, covering_line(narrow_tunable));
+	ck_assert_int_eq(0, covering_line(wide_tunable_else));
+	ck_assert_int_eq(0, covering_line(narrow_boolean));
+	ck_assert_int_eq(0, covering_line(wide_boolean_else));
+	ck_assert_int_eq(0, covering_line(unconditional));
+	ck_assert_int_eq(0, covering_line(wide_boolean));
+	ck_assert_int_eq(100, covering_line(narrow_in_boolean));
+
+	free_redundant_rule_index();
+	free_file_list(files);
+	free_all_maps();
+}
+END_TEST
+
+Suite *redundant_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Redundant");
+
+	tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_find_covering_rule);
+	tcase_add_test(tc_core, test_identical_rules);
+	tcase_add_test(tc_core, test_exclusive_branches);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int main(void) {
+
+	int number_failed = 0;
+	Suite *s;
+	SRunner *sr;
+
+	s = redundant_suite();
+	sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0)? 0 : -1;
+}
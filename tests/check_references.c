@@ -0,0 +1,151 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/references.h"
+#include "../src/tree.h"
+#include "../src/maps.h"
+#include "test_utils.h"
+
+START_TEST (test_reference_counts) {
+	union node_data nd;
+
+	// type a_t;
+	// type a_b_t;
+	// type a_c_t;
+	// type c_t;
+	// type d_t;
+	// type fc_t;
+	// type port_t;
+	// role r_r;
+	// role r_r types a_t;
+	// require {
+	//     type c_t;
+	// }
+	// tmpl(a)
+	// portcon tcp 80 gen_context(system_u:object_r:port_t,s0)
+	struct policy_node *te_head = calloc(1, sizeof(struct policy_node));
+	te_head->flavor = NODE_TE_FILE;
+	struct policy_node *cur = add_next(te_head, NODE_DECL, make_decl(DECL_TYPE, "a_t", NULL));
+	cur = add_next(cur, NODE_DECL, make_decl(DECL_TYPE, "a_b_t", NULL));
+	cur = add_next(cur, NODE_DECL, make_decl(DECL_TYPE, "a_c_t", NULL));
+	cur = add_next(cur, NODE_DECL, make_decl(DECL_TYPE, "c_t", NULL));
+	cur = add_next(cur, NODE_DECL, make_decl(DECL_TYPE, "d_t", NULL));
+	cur = add_next(cur, NODE_DECL, make_decl(DECL_TYPE, "fc_t", NULL));
+	cur = add_next(cur, NODE_DECL, make_decl(DECL_TYPE, "port_t", NULL));
+	cur = add_next(cur, NODE_DECL, make_decl(DECL_ROLE, "r_r", NULL));
+	cur = add_next(cur, NODE_DECL, make_decl(DECL_ROLE, "r_r", "a_t"));
+	nd.str = NULL;
+	cur = add_next(cur, NODE_REQUIRE, nd);
+	add_child(cur, NODE_DECL, make_decl(DECL_TYPE, "c_t", NULL));
+	cur = add_next(cur, NODE_IF_CALL, make_call("tmpl", "a"));
+	nd.sl_data = make_names("system_u object_r port_t");
+	cur = add_next(cur, NODE_CONTEXT_STMT, nd);
+
+	// template(`tmpl',`
+	//     allow $1_t $1_b_t:file read;
+	//     inner($1_c)
+	// ')
+	// template(`inner',`
+	//     allow $1_t self:file read;
+	// ')
+	// interface(`unused_if',`
+	//     allow $1 c_t:file read;
+	// ')
+	struct policy_node *if_head = calloc(1, sizeof(struct policy_node));
+	if_head->flavor = NODE_IF_FILE;
+	struct policy_node *def = add_def(if_head, NODE_TEMP_DEF, "tmpl");
+	add_child(def, NODE_AV_RULE, make_av_rule(AV_RULE_ALLOW, "$1_t", "$1_b_t", "file", "read"));
+	add_next(def->first_child, NODE_IF_CALL, make_call("inner", "$1_c"));
+	def = add_def(def, NODE_TEMP_DEF, "inner");
+	add_child(def, NODE_AV_RULE, make_av_rule(AV_RULE_ALLOW, "$1_t", "self", "file", "read"));
+	def = add_def(def, NODE_INTERFACE_DEF, "unused_if");
+	add_child(def, NODE_AV_RULE, make_av_rule(AV_RULE_ALLOW, "$1", "c_t", "file", "read"));
+
+	// /foo -- gen_context(system_u:object_r:fc_t,s0)
+	struct policy_node *fc_head = calloc(1, sizeof(struct policy_node));
+	fc_head->flavor = NODE_FC_FILE;
+	nd.fc_data = calloc(1, sizeof(struct fc_entry));
+	nd.fc_data->path = strdup("/foo");
+	nd.fc_data->context = calloc(1, sizeof(struct sel_context));
+	nd.fc_data->context->type = strdup("fc_t");
+	add_next(fc_head, NODE_FC_ENTRY, nd);
+
+	struct policy_file_list *te_files = make_file_list("test.te", te_head);
+	struct policy_file_list *if_files = make_file_list("test.if", if_head);
+	struct policy_file_list *fc_files = make_file_list("test.fc", fc_head);
+
+	ck_assert_int_eq(SELINT_SUCCESS, build_reference_counts(te_files, if_files, fc_files));
+
+	// Once in the role declaration, once through tmpl(a)
+	ck_assert_int_eq(2, count_references("a_t"));
+	ck_assert_int_eq(1, count_references("a_b_t"));
+	// Through inner($1_c) in tmpl
+	ck_assert_int_eq(1, count_references("a_c_t"));
+	// Only in unused_if, as the require does not count
+	ck_assert_int_eq(1, count_references("c_t"));
+	ck_assert_int_eq(0, count_references("d_t"));
+	ck_assert_int_eq(1, count_references("fc_t"));
+	ck_assert_int_eq(1, count_references("port_t"));
+	ck_assert_int_eq(1, count_references("r_r"));
+	ck_assert_int_eq(1, count_references("tmpl"));
+	ck_assert_int_eq(1, count_references("inner"));
+	ck_assert_int_eq(0, count_references("unused_if"));
+	ck_assert_int_eq(-1, count_references("a"));
+	ck_assert_int_eq(-1, count_references("$1_t"));
+	ck_assert_int_eq(-1, count_references("self"));
+
+	free_reference_counts();
+	ck_assert_int_eq(-1, count_references("a_t"));
+
+	free_file_list(te_files);
+	free_file_list(if_files);
+	free_file_list(fc_files);
+	free_all_maps();
+}
+END_TEST
+
+Suite *references_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("References");
+
+	tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_reference_counts);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int main(void) {
+
+	int number_failed = 0;
+	Suite *s;
+	SRunner *sr;
+
+	s = references_suite();
+	sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0)? 0 : -1;
+}
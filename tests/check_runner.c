@@ -19,6 +19,7 @@
 
 #include "../src/string_list.h"
 #include "../src/runner.h"
+#include "../src/parse_functions.h"
 
 START_TEST (test_is_check_enabled) {
 	struct string_list *con_e = calloc(1, sizeof(struct string_list));
@@ -55,6 +56,39 @@ START_TEST (test_is_check_enabled) {
 }
 END_TEST
 
+static unsigned int count_nodes(const struct policy_node *head)
+{
+	unsigned int count = 0;
+
+	for (const struct policy_node *node = head; node; node = dfs_next(node)) {
+		count++;
+	}
+
+	return count;
+}
+
+START_TEST (test_parse_one_file) {
+	struct policy_node *first = parse_one_file(SAMPLE_POL_DIR "basic.te", NODE_TE_FILE);
+
+	ck_assert_ptr_nonnull(first);
+	ck_assert_int_eq(NODE_TE_FILE, first->flavor);
+	ck_assert_ptr_nonnull(first->next);
+	ck_assert_int_eq(NODE_DECL, first->next->flavor);
+	ck_assert_str_eq("basic_t", first->next->data.d_data->name);
+
+	// The lexer starts over on the next file
+	struct policy_node *second = parse_one_file(SAMPLE_POL_DIR "basic.te", NODE_TE_FILE);
+	ck_assert_ptr_nonnull(second);
+	ck_assert_int_eq(count_nodes(first), count_nodes(second));
+
+	ck_assert_ptr_null(parse_one_file(SAMPLE_POL_DIR "nonexistent.te", NODE_TE_FILE));
+
+	free_policy_node(first);
+	free_policy_node(second);
+	cleanup_parsing();
+}
+END_TEST
+
 Suite *runner_suite(void) {
 	Suite *s;
 	TCase *tc_core;
@@ -64,6 +98,7 @@ Suite *runner_suite(void) {
 	tc_core = tcase_create("Core");
 
 	tcase_add_test(tc_core, test_is_check_enabled);
+	tcase_add_test(tc_core, test_parse_one_file);
 	suite_add_tcase(s, tc_core);
 
 	return s;
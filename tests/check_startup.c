@@ -15,6 +15,11 @@
 */
 
 #include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "../src/startup.h"
 #include "../src/maps.h"
@@ -23,6 +28,8 @@
 #define MODULES_CONF_PATH SAMPLE_POL_DIR "modules.conf"
 #define BAD_MODULES_CONF_PATH SAMPLE_POL_DIR "bad_modules.conf"
 #define SAMPLE_AV_PATH SAMPLE_AV_DIR
+#define SECURITY_CLASSES_PATH SAMPLE_POL_DIR "security_classes"
+#define ACCESS_VECTORS_PATH SAMPLE_POL_DIR "access_vectors"
 
 START_TEST (test_load_access_vectors_normal) {
 
@@ -36,6 +43,193 @@ START_TEST (test_load_access_vectors_normal) {
 	ck_assert_str_eq(look_up_in_decl_map("listen", DECL_PERM), "perm");
 	ck_assert_str_eq(look_up_in_decl_map("use", DECL_PERM), "perm");
 
+	// Bits come from the values in the perms files
+	const struct class_hash_elem *file = look_up_in_class_perms_map("file");
+	ck_assert_ptr_nonnull(file);
+	ck_assert_int_eq(2, look_up_perm_bit(file, "write"));
+	ck_assert_int_eq(9, look_up_perm_bit(file, "append"));
+	ck_assert_int_eq(-1, look_up_perm_bit(file, "listen"));
+	ck_assert_int_eq(13, look_up_perm_bit(look_up_in_class_perms_map("socket"), "listen"));
+
+	free_all_maps();
+
+}
+END_TEST
+
+// Write a file under a directory standing in for selinuxfs
+static void write_selinuxfs_file(const char *dir, const char *name, const char *contents)
+{
+	char path[128];
+
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	FILE *f = fopen(path, "w");
+	ck_assert_ptr_nonnull(f);
+	fputs(contents, f);
+	fclose(f);
+}
+
+static void make_selinuxfs_dir(const char *dir, const char *name)
+{
+	char path[128];
+
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	ck_assert_int_eq(0, mkdir(path, 0700));
+}
+
+static void remove_selinuxfs_entry(const char *dir, const char *name)
+{
+	char path[128];
+
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	ck_assert_int_eq(0, remove(path));
+}
+
+// Fill in a class directory named name with the file and socket classes
+static void make_class_dir(const char *dir, const char *name, int with_write)
+{
+	char path[128];
+
+	make_selinuxfs_dir(dir, name);
+	snprintf(path, sizeof(path), "%s/file", name);
+	make_selinuxfs_dir(dir, path);
+	snprintf(path, sizeof(path), "%s/file/index", name);
+	write_selinuxfs_file(dir, path, "6\n");
+	snprintf(path, sizeof(path), "%s/file/perms", name);
+	make_selinuxfs_dir(dir, path);
+	snprintf(path, sizeof(path), "%s/file/perms/read", name);
+	write_selinuxfs_file(dir, path, "1\n");
+	if (with_write) {
+		snprintf(path, sizeof(path), "%s/file/perms/write", name);
+		write_selinuxfs_file(dir, path, "2\n");
+	}
+	snprintf(path, sizeof(path), "%s/socket", name);
+	make_selinuxfs_dir(dir, path);
+	snprintf(path, sizeof(path), "%s/socket/perms", name);
+	make_selinuxfs_dir(dir, path);
+	snprintf(path, sizeof(path), "%s/socket/perms/listen", name);
+	write_selinuxfs_file(dir, path, "14\n");
+}
+
+static void remove_class_dir(const char *dir, const char *name)
+{
+	const char *entries[] = { "socket/perms/listen", "socket/perms", "socket",
+	                          "file/perms/read", "file/perms/write", "file/perms",
+	                          "file/index", "file", "" };
+	char path[128];
+
+	for (unsigned int i = 0; i < sizeof(entries) / sizeof(entries[0]); i++) {
+		snprintf(path, sizeof(path), "%s/%s", name, entries[i]);
+		remove_selinuxfs_entry(dir, path);
+	}
+}
+
+START_TEST (test_load_access_vectors_cached) {
+
+	char dir[] = "/tmp/selint_selinuxfs_XXXXXX";
+	char cache_path[64];
+	char path[128];
+
+	ck_assert_ptr_nonnull(mkdtemp(dir));
+	snprintf(cache_path, sizeof(cache_path), "%s/cache", dir);
+	write_selinuxfs_file(dir, "policyvers", "33\n");
+	make_class_dir(dir, "class", 1);
+
+	ck_assert_int_eq(SELINT_SUCCESS, load_access_vectors_cached(dir, cache_path));
+	ck_assert_int_eq(2, decl_map_count(DECL_CLASS));
+	ck_assert_int_eq(3, decl_map_count(DECL_PERM));
+	ck_assert_int_eq(1, look_up_perm_bit(look_up_in_class_perms_map("file"), "write"));
+	ck_assert_int_eq(0, access(cache_path, R_OK));
+	free_all_maps();
+
+	// The cache is read while the same policy is loaded, even if the
+	// entries below the class directory change
+	remove_selinuxfs_entry(dir, "class/file/perms/write");
+	ck_assert_int_eq(SELINT_SUCCESS, load_access_vectors_cached(dir, cache_path));
+	ck_assert_int_eq(3, decl_map_count(DECL_PERM));
+	ck_assert_int_eq(1, look_up_perm_bit(look_up_in_class_perms_map("file"), "write"));
+	ck_assert_int_eq(13, look_up_perm_bit(look_up_in_class_perms_map("socket"), "listen"));
+	free_all_maps();
+
+	// Without a cache, or once another policy is loaded, selinuxfs is read
+	ck_assert_int_eq(SELINT_SUCCESS, load_access_vectors_cached(dir, NULL));
+	ck_assert_int_eq(2, decl_map_count(DECL_PERM));
+	free_all_maps();
+
+	// Loading a policy replaces the class directory, as the kernel does
+	make_class_dir(dir, "class.new", 0);
+	snprintf(path, sizeof(path), "%s/class", dir);
+	char old_path[128];
+	snprintf(old_path, sizeof(old_path), "%s/class.old", dir);
+	ck_assert_int_eq(0, rename(path, old_path));
+	snprintf(old_path, sizeof(old_path), "%s/class.new", dir);
+	ck_assert_int_eq(0, rename(old_path, path));
+	ck_assert_int_eq(SELINT_SUCCESS, load_access_vectors_cached(dir, cache_path));
+	ck_assert_int_eq(2, decl_map_count(DECL_PERM));
+	ck_assert_int_eq(-1, look_up_perm_bit(look_up_in_class_perms_map("file"), "write"));
+	free_all_maps();
+
+	// And the rewritten cache is read next time
+	write_selinuxfs_file(dir, "class/file/perms/write", "2\n");
+	ck_assert_int_eq(SELINT_SUCCESS, load_access_vectors_cached(dir, cache_path));
+	ck_assert_int_eq(2, decl_map_count(DECL_PERM));
+	free_all_maps();
+
+	write_selinuxfs_file(dir, "policyvers", "34\n");
+	ck_assert_int_eq(SELINT_SUCCESS, load_access_vectors_cached(dir, cache_path));
+	ck_assert_int_eq(3, decl_map_count(DECL_PERM));
+	free_all_maps();
+
+	// Nothing to key a cache on
+	remove_selinuxfs_entry(dir, "policyvers");
+	ck_assert_int_eq(SELINT_SUCCESS, load_access_vectors_cached(dir, cache_path));
+	ck_assert_int_eq(3, decl_map_count(DECL_PERM));
+	free_all_maps();
+
+	remove_selinuxfs_entry(dir, "cache");
+	write_selinuxfs_file(dir, "class.old/file/perms/write", "2\n");
+	remove_class_dir(dir, "class.old");
+	remove_class_dir(dir, "class");
+	ck_assert_int_eq(0, rmdir(dir));
+
+}
+END_TEST
+
+START_TEST (test_load_access_vectors_source) {
+
+	ck_assert_int_eq(SELINT_SUCCESS,
+	                 load_access_vectors_source(SECURITY_CLASSES_PATH, ACCESS_VECTORS_PATH));
+
+	ck_assert_int_eq(4, decl_map_count(DECL_CLASS));
+	ck_assert_str_eq("class", look_up_in_decl_map("dbus", DECL_CLASS));
+	ck_assert_str_eq("perm", look_up_in_decl_map("sigchld", DECL_PERM));
+	// Commons no class inherits add no permissions
+	ck_assert_ptr_null(look_up_in_decl_map("bind", DECL_PERM));
+
+	// Inherited permissions come first
+	const struct class_hash_elem *dir = look_up_in_class_perms_map("dir");
+	ck_assert_ptr_nonnull(dir);
+	ck_assert_int_eq(8, dir->perm_count);
+	ck_assert_str_eq("ioctl", dir->perms[0]);
+	ck_assert_str_eq("getattr", dir->perms[4]);
+	ck_assert_str_eq("add_name", dir->perms[5]);
+	ck_assert_int_eq(7, look_up_perm_bit(dir, "search"));
+	ck_assert_int_eq(-1, look_up_perm_bit(dir, "entrypoint"));
+
+	const struct class_hash_elem *process = look_up_in_class_perms_map("process");
+	ck_assert_ptr_nonnull(process);
+	ck_assert_int_eq(4, process->perm_count);
+	ck_assert_int_eq(2, look_up_perm_bit(process, "sigchld"));
+
+	ck_assert_int_eq(2, look_up_in_class_perms_map("dbus")->perm_count);
+
+	free_all_maps();
+
+	ck_assert_int_eq(SELINT_IO_ERROR,
+	                 load_access_vectors_source(SECURITY_CLASSES_PATH, "nonexistent"));
+	// Not an access_vectors file
+	ck_assert_int_eq(SELINT_PARSE_ERROR,
+	                 load_access_vectors_source(SECURITY_CLASSES_PATH, MODULES_CONF_PATH));
+
 	free_all_maps();
 
 }
@@ -69,6 +263,8 @@ Suite *startup_suite(void) {
 	tc_core = tcase_create("Core");
 
 	tcase_add_test(tc_core, test_load_access_vectors_normal);
+	tcase_add_test(tc_core, test_load_access_vectors_cached);
+	tcase_add_test(tc_core, test_load_access_vectors_source);
 	tcase_add_test(tc_core, test_load_modules_source);
 	suite_add_tcase(s, tc_core);
 
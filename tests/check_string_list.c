@@ -15,6 +15,7 @@
 */
 
 #include <check.h>
+#include <stdio.h>
 #include <stdlib.h>
 
 #include "../src/string_list.h"
@@ -89,6 +90,70 @@ START_TEST (test_copy_string_list_null) {
 }
 END_TEST
 
+START_TEST (test_sl_array_append) {
+
+	struct string_list *sl = NULL;
+	char name[16];
+
+	for (int i = 0; i < 100; i++) {
+		snprintf(name, sizeof(name), "item%d", i);
+		sl = sl_array_append(sl, strdup(name));
+		ck_assert_ptr_nonnull(sl);
+	}
+
+	ck_assert_int_eq(100, sl->array_len);
+
+	struct string_list *cur = sl;
+	for (int i = 0; i < 100; i++) {
+		snprintf(name, sizeof(name), "item%d", i);
+		ck_assert_ptr_nonnull(cur);
+		ck_assert_str_eq(name, cur->string);
+		// Entries are contiguous
+		if (cur->next) {
+			ck_assert_ptr_eq(cur + 1, cur->next);
+		}
+		cur = cur->next;
+	}
+	ck_assert_ptr_null(cur);
+
+	ck_assert_int_eq(1, str_in_sl("item99", sl));
+
+	free_string_list(sl);
+
+}
+END_TEST
+
+START_TEST (test_sl_concat) {
+
+	struct string_list *sl1 = sl_array_append(NULL, strdup("foo"));
+	struct string_list *sl2 = sl_array_append(NULL, strdup("bar"));
+	sl2 = sl_array_append(sl2, strdup("baz"));
+	sl2->next->has_incorrect_space = 1;
+
+	sl1 = sl_concat(sl1, sl2);
+
+	ck_assert_str_eq("foo", sl1->string);
+	ck_assert_str_eq("bar", sl1->next->string);
+	ck_assert_str_eq("baz", sl1->next->next->string);
+	ck_assert_int_eq(1, sl1->next->next->has_incorrect_space);
+	ck_assert_ptr_null(sl1->next->next->next);
+	ck_assert_ptr_eq(sl1 + 2, sl1->next->next);
+
+	ck_assert_ptr_eq(sl1, sl_concat(sl1, NULL));
+
+	// A separately allocated list is linked to instead
+	struct string_list *sl3 = calloc(1, sizeof(struct string_list));
+	sl3->string = strdup("qux");
+
+	sl3 = sl_concat(sl3, sl1);
+	ck_assert_str_eq("qux", sl3->string);
+	ck_assert_ptr_eq(sl1, sl3->next);
+
+	free_string_list(sl3);
+
+}
+END_TEST
+
 Suite *string_list_suite(void) {
 	Suite *s;
 	TCase *tc_core;
@@ -100,6 +165,8 @@ Suite *string_list_suite(void) {
 	tcase_add_test(tc_core, test_str_in_sl);
 	tcase_add_test(tc_core, test_copy_string_list);
 	tcase_add_test(tc_core, test_copy_string_list_null);
+	tcase_add_test(tc_core, test_sl_array_append);
+	tcase_add_test(tc_core, test_sl_concat);
 	suite_add_tcase(s, tc_core);
 
 	return s;
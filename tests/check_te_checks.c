@@ -22,6 +22,7 @@
 #include "../src/te_checks.h"
 #include "../src/check_hooks.h"
 #include "../src/maps.h"
+#include "../src/references.h"
 
 START_TEST (test_check_te_order) {
 	struct check_data *cd = calloc(1, sizeof(struct check_data));
@@ -224,6 +225,7 @@ START_TEST (test_check_module_if_call_in_optional) {
 	cur->parent = calloc(1, sizeof(struct policy_node));
 	cur->parent->flavor = NODE_OPTIONAL_POLICY;
 	cur->parent->first_child = cur;
+	cur->scope = SCOPE_OPTIONAL;
 
 	res = check_module_if_call_in_optional(cd, cur);
 	ck_assert_ptr_null(res);
@@ -241,6 +243,86 @@ START_TEST (test_check_module_if_call_in_optional) {
 }
 END_TEST
 
+START_TEST (test_check_perms_in_class) {
+	struct check_result *res;
+
+	struct policy_node *node = calloc(1, sizeof(struct policy_node));
+	node->flavor = NODE_AV_RULE;
+	// allow foo_t { bar_t baz_t }:file { read write getattr };
+	node->data.av_data = make_example_av_rule();
+
+	// No classes loaded
+	res = check_perms_in_class(NULL, node);
+	ck_assert_ptr_null(res);
+
+	insert_into_class_perms_map("file", "read", -1);
+	insert_into_class_perms_map("file", "write", -1);
+	insert_into_class_perms_map("dir", "getattr", -1);
+	insert_into_decl_map("read", "perm", DECL_PERM);
+	insert_into_decl_map("write", "perm", DECL_PERM);
+	insert_into_decl_map("getattr", "perm", DECL_PERM);
+
+	res = check_perms_in_class(NULL, node);
+	ck_assert_ptr_nonnull(res);
+	ck_assert_int_eq(res->severity, 'E');
+	ck_assert_int_eq(res->check_id, E_ID_UNKNOWN_PERM);
+	ck_assert_str_eq(res->message, "Permission getattr is not defined for class file");
+	free_check_result(res);
+
+	insert_into_class_perms_map("file", "getattr", -1);
+
+	res = check_perms_in_class(NULL, node);
+	ck_assert_ptr_null(res);
+
+	free_policy_node(node);
+	free_all_maps();
+}
+END_TEST
+
+START_TEST (test_check_unused_declaration) {
+	struct check_result *res;
+	union node_data nd;
+
+	// type foo_t, used_attr;
+	// attribute used_attr;
+	struct policy_node *head = calloc(1, sizeof(struct policy_node));
+	head->flavor = NODE_TE_FILE;
+	nd.d_data = calloc(1, sizeof(struct declaration_data));
+	nd.d_data->flavor = DECL_TYPE;
+	nd.d_data->name = strdup("foo_t");
+	nd.d_data->attrs = sl_array_append(NULL, strdup("used_attr"));
+	ck_assert_int_eq(SELINT_SUCCESS, insert_policy_node_next(head, NODE_DECL, nd, 1));
+	struct policy_node *type_decl = head->next;
+	nd.d_data = calloc(1, sizeof(struct declaration_data));
+	nd.d_data->flavor = DECL_ATTRIBUTE;
+	nd.d_data->name = strdup("used_attr");
+	ck_assert_int_eq(SELINT_SUCCESS, insert_policy_node_next(type_decl, NODE_DECL, nd, 2));
+	struct policy_node *attr_decl = type_decl->next;
+
+	struct policy_file_list *te_files = calloc(1, sizeof(struct policy_file_list));
+	file_list_push_back(te_files, make_policy_file("test.te", head));
+	struct policy_file_list *empty = calloc(1, sizeof(struct policy_file_list));
+
+	ck_assert_int_eq(SELINT_SUCCESS, build_reference_counts(te_files, empty, empty));
+
+	res = check_unused_declaration(NULL, type_decl);
+	ck_assert_ptr_nonnull(res);
+	ck_assert_int_eq(res->severity, 'W');
+	ck_assert_int_eq(res->check_id, W_ID_UNUSED_DECL);
+	ck_assert_str_eq(res->message, "Type foo_t is declared but never used");
+	free_check_result(res);
+
+	ck_assert_ptr_null(check_unused_declaration(NULL, attr_decl));
+
+	// Nothing is reported for names that were not counted
+	free_reference_counts();
+	ck_assert_ptr_null(check_unused_declaration(NULL, type_decl));
+
+	free_file_list(te_files);
+	free_file_list(empty);
+}
+END_TEST
+
 Suite *te_checks_suite(void) {
 	Suite *s;
 	TCase *tc_core;
@@ -254,6 +336,8 @@ Suite *te_checks_suite(void) {
 	tcase_add_test(tc_core, test_check_useless_semicolon);
 	tcase_add_test(tc_core, test_check_no_explicit_declaration);
 	tcase_add_test(tc_core, test_check_module_if_call_in_optional);
+	tcase_add_test(tc_core, test_check_perms_in_class);
+	tcase_add_test(tc_core, test_check_unused_declaration);
 	suite_add_tcase(s, tc_core);
 
 	return s;
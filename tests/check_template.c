@@ -191,7 +191,7 @@ START_TEST (test_nested_template_declarations) {
 	called_args->next->next->string = strdup("third");
 	called_args->next->next->next = NULL;
 
-	ck_assert_int_eq(SELINT_SUCCESS, add_template_declarations("outer", called_args, NULL, "nested_interfaces"));
+	ck_assert_int_eq(SELINT_SUCCESS, add_template_declarations("outer", called_args, "nested_interfaces"));
 
 	ck_assert_str_eq("nested_interfaces", look_up_in_decl_map("first_t", DECL_TYPE));
 	ck_assert_str_eq("nested_interfaces", look_up_in_decl_map("third_foo_t", DECL_TYPE));
@@ -205,6 +205,52 @@ START_TEST (test_nested_template_declarations) {
 }
 END_TEST
 
+// The template map does not own the calls saved in it
+static struct if_call_data *loop_calls[4];
+static unsigned int loop_call_count = 0;
+
+static struct if_call_data *make_call(const char *name)
+{
+	struct if_call_data *call = calloc(1, sizeof(struct if_call_data));
+	call->name = strdup(name);
+	call->args = calloc(1, sizeof(struct string_list));
+	call->args->string = strdup("$1");
+	loop_calls[loop_call_count++] = call;
+	return call;
+}
+
+START_TEST (test_template_declarations_loop) {
+
+	// loop_a calls loop_b, which calls loop_a again
+	insert_decl_into_template_map("loop_a", DECL_TYPE, "$1_a_t");
+	insert_call_into_template_map("loop_a", make_call("loop_b"));
+	insert_call_into_template_map("loop_b", make_call("loop_a"));
+	insert_call_into_template_map("leaf_caller", make_call("loop_leaf"));
+	insert_decl_into_template_map("loop_leaf", DECL_TYPE, "$1_leaf_t");
+
+	struct string_list *args = calloc(1, sizeof(struct string_list));
+	args->string = strdup("foo");
+
+	ck_assert_int_eq(SELINT_IF_CALL_LOOP, add_template_declarations("loop_a", args, "loops"));
+	ck_assert_int_eq(SELINT_IF_CALL_LOOP, add_template_declarations("loop_b", args, "loops"));
+
+	// Calling the same template twice, rather than recursively, is fine
+	insert_call_into_template_map("leaf_caller", make_call("loop_leaf"));
+	ck_assert_int_eq(SELINT_SUCCESS, add_template_declarations("leaf_caller", args, "loops"));
+	ck_assert_str_eq("loops", look_up_in_decl_map("foo_leaf_t", DECL_TYPE));
+
+	// Not a template
+	ck_assert_int_eq(SELINT_SUCCESS, add_template_declarations("some_interface", args, "loops"));
+
+	free_string_list(args);
+	free_all_maps();
+	for (unsigned int i = 0; i < loop_call_count; i++) {
+		free_if_call_data(loop_calls[i]);
+	}
+
+}
+END_TEST
+
 Suite *template_suite(void) {
 	Suite *s;
 	TCase *tc_core;
@@ -220,6 +266,7 @@ Suite *template_suite(void) {
 	tcase_add_test(tc_core, test_replace_m4_list);
 	tcase_add_test(tc_core, test_replace_m4_list_too_few_args);
 	tcase_add_test(tc_core, test_nested_template_declarations);
+	tcase_add_test(tc_core, test_template_declarations_loop);
 	suite_add_tcase(s, tc_core);
 
 	return s;
@@ -257,6 +257,147 @@ START_TEST (test_get_types_in_node_exclusion) {
 }
 END_TEST
 
+START_TEST (test_type_iter) {
+	struct policy_node *node = calloc(1, sizeof(struct policy_node));
+	node->flavor = NODE_TT_RULE;
+
+	node->data.tt_data = calloc(1, sizeof(struct type_transition_data));
+	node->data.tt_data->targets = calloc(1, sizeof(struct string_list));
+	node->data.tt_data->targets->string = strdup("-init_t");
+	node->data.tt_data->targets->next = calloc(1, sizeof(struct string_list));
+	node->data.tt_data->targets->next->string = strdup(EXAMPLE_TYPE_2);
+	node->data.tt_data->default_type = strdup(EXAMPLE_TYPE_1);
+
+	struct type_iter it;
+	const char *name;
+	int excluded;
+
+	type_iter_init(&it, node);
+
+	ck_assert_int_eq(1, type_iter_next(&it, &name, &excluded));
+	ck_assert_str_eq("init_t", name);
+	ck_assert_int_eq(1, excluded);
+	// Names are not copied
+	ck_assert_ptr_eq(node->data.tt_data->targets->string + 1, name);
+
+	ck_assert_int_eq(1, type_iter_next(&it, &name, &excluded));
+	ck_assert_str_eq(EXAMPLE_TYPE_2, name);
+	ck_assert_int_eq(0, excluded);
+
+	ck_assert_int_eq(1, type_iter_next(&it, &name, NULL));
+	ck_assert_str_eq(EXAMPLE_TYPE_1, name);
+
+	ck_assert_int_eq(0, type_iter_next(&it, &name, &excluded));
+	ck_assert_int_eq(0, type_iter_next(&it, &name, &excluded));
+
+	// No types at all
+	node->flavor = NODE_COMMENT;
+	type_iter_init(&it, node);
+	ck_assert_int_eq(0, type_iter_next(&it, &name, &excluded));
+	node->flavor = NODE_TT_RULE;
+
+	free_policy_node(node);
+}
+END_TEST
+
+START_TEST (test_node_scope) {
+	struct policy_node *head = calloc(1, sizeof(struct policy_node));
+	head->flavor = NODE_TE_FILE;
+
+	union node_data nd;
+	nd.str = strdup("foo");
+	ck_assert_int_eq(SELINT_SUCCESS, insert_policy_node_next(head, NODE_TEMP_DEF, nd, 1));
+	struct policy_node *cur = head->next;
+	ck_assert_int_eq(0, cur->scope);
+
+	nd.str = NULL;
+	ck_assert_int_eq(SELINT_SUCCESS, insert_policy_node_child(cur, NODE_START_BLOCK, nd, 1));
+	cur = cur->first_child;
+	ck_assert_int_eq(SELINT_SUCCESS, insert_policy_node_next(cur, NODE_OPTIONAL_POLICY, nd, 2));
+	cur = cur->next;
+	ck_assert_int_eq(SELINT_SUCCESS, insert_policy_node_child(cur, NODE_GEN_REQ, nd, 3));
+	cur = cur->first_child;
+	ck_assert_int_eq(SELINT_SUCCESS, insert_policy_node_child(cur, NODE_START_BLOCK, nd, 3));
+	cur = cur->first_child;
+	ck_assert_int_eq(SELINT_SUCCESS, insert_policy_node_next(cur, NODE_COMMENT, nd, 4));
+	cur = cur->next;
+
+	ck_assert_int_eq(SCOPE_TEMPLATE | SCOPE_OPTIONAL | SCOPE_REQUIRE, cur->scope);
+	ck_assert_int_eq(SCOPE_TEMPLATE | SCOPE_OPTIONAL, cur->parent->scope);
+	ck_assert_int_eq(1, is_in_require(cur));
+	ck_assert_int_eq(0, is_in_require(cur->parent));
+	ck_assert_str_eq("foo", get_name_if_in_template(cur));
+	ck_assert_ptr_null(get_name_if_in_template(head->next));
+
+	ck_assert_int_eq(SCOPE_IFDEF, get_block_scope(NODE_IFDEF));
+	ck_assert_int_eq(SCOPE_IFDEF, get_block_scope(NODE_IFDEF_ELSE));
+	ck_assert_int_eq(SCOPE_TUNABLE, get_block_scope(NODE_TUNABLE_ELSE));
+	ck_assert_int_eq(SCOPE_BOOLEAN, get_block_scope(NODE_BOOLEAN_POLICY));
+	ck_assert_int_eq(SCOPE_BOOLEAN, get_block_scope(NODE_BOOLEAN_ELSE));
+	ck_assert_int_eq(SCOPE_INTERFACE, get_block_scope(NODE_INTERFACE_DEF));
+	ck_assert_int_eq(0, get_block_scope(NODE_AV_RULE));
+
+	ck_assert_int_eq(SELINT_BAD_ARG, free_flat_policy_tree(head));
+	free_policy_node(head);
+}
+END_TEST
+
+START_TEST (test_flatten_policy_tree) {
+	struct policy_node *head = calloc(1, sizeof(struct policy_node));
+	head->flavor = NODE_TE_FILE;
+
+	union node_data nd;
+	nd.str = strdup("foo");
+	ck_assert_int_eq(SELINT_SUCCESS, insert_policy_node_next(head, NODE_INTERFACE_DEF, nd, 1));
+	struct policy_node *def = head->next;
+	nd.str = NULL;
+	ck_assert_int_eq(SELINT_SUCCESS, insert_policy_node_child(def, NODE_START_BLOCK, nd, 1));
+	nd.av_data = make_example_av_rule();
+	ck_assert_int_eq(SELINT_SUCCESS, insert_policy_node_next(def->first_child, NODE_AV_RULE, nd, 2));
+	nd.str = strdup("# comment");
+	ck_assert_int_eq(SELINT_SUCCESS, insert_policy_node_next(def, NODE_COMMENT, nd, 4));
+
+	enum node_flavor expected[] = { NODE_TE_FILE, NODE_INTERFACE_DEF, NODE_START_BLOCK,
+	                                NODE_AV_RULE, NODE_COMMENT };
+
+	struct policy_node *flat = flatten_policy_tree(head);
+
+	ck_assert_ptr_nonnull(flat);
+	ck_assert_int_eq(NODE_FLAT, flat->storage);
+
+	// Nodes are adjacent in depth first order, and still linked as a tree
+	struct policy_node *node = flat;
+	for (unsigned int i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+		ck_assert_ptr_nonnull(node);
+		ck_assert_ptr_eq(flat + i, node);
+		ck_assert_int_eq(expected[i], node->flavor);
+		node = dfs_next(node);
+	}
+	ck_assert_ptr_null(node);
+	ck_assert_int_eq(NODE_FLAT_LAST, flat[4].storage);
+
+	ck_assert_ptr_eq(flat + 1, flat->next);
+	ck_assert_ptr_null(flat[1].parent);
+	ck_assert_ptr_eq(flat + 2, flat[1].first_child);
+	ck_assert_ptr_eq(flat + 4, flat[1].next);
+	ck_assert_ptr_eq(flat + 1, flat[4].prev);
+	ck_assert_ptr_eq(flat + 1, flat[3].parent);
+	ck_assert_ptr_eq(flat + 2, flat[3].prev);
+	ck_assert_ptr_null(flat[3].next);
+	ck_assert_str_eq("foo", flat[1].data.str);
+	ck_assert_int_eq(2, flat[3].lineno);
+
+	// Flattening again is a no-op
+	ck_assert_ptr_eq(flat, flatten_policy_tree(flat));
+
+	// Only the head of the array can be freed
+	ck_assert_int_eq(SELINT_BAD_ARG, free_policy_node(flat + 3));
+	ck_assert_int_eq(SELINT_BAD_ARG, free_flat_policy_tree(flat + 1));
+	ck_assert_int_eq(SELINT_BAD_ARG, free_flat_policy_tree(flat + 3));
+	ck_assert_int_eq(SELINT_SUCCESS, free_policy_node(flat));
+}
+END_TEST
+
 Suite *tree_suite(void) {
 	Suite *s;
 	TCase *tc_core;
@@ -274,6 +415,9 @@ Suite *tree_suite(void) {
 	tcase_add_test(tc_core, test_get_types_in_node_if_call);
 	tcase_add_test(tc_core, test_get_types_in_node_no_types);
 	tcase_add_test(tc_core, test_get_types_in_node_exclusion);
+	tcase_add_test(tc_core, test_type_iter);
+	tcase_add_test(tc_core, test_node_scope);
+	tcase_add_test(tc_core, test_flatten_policy_tree);
 	suite_add_tcase(s, tc_core);
 
 	return s;
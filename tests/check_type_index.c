@@ -0,0 +1,315 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/type_index.h"
+#include "../src/tree.h"
+#include "../src/maps.h"
+#include "test_utils.h"
+
+// type foo_t, domain, exec_type;
+// attribute domain;
+// type bar_t alias bar_alias_t;
+// typeattribute bar_t domain;
+// type baz_t;
+// gen_require(` type req_t, domain; ')
+// type $1_t, domain;
+static struct policy_node *make_policy(void)
+{
+	struct policy_node *head = calloc(1, sizeof(struct policy_node));
+	head->flavor = NODE_TE_FILE;
+
+	struct policy_node *cur = add_next(head, NODE_DECL,
+	                                   make_decl(DECL_TYPE, "foo_t", "domain exec_type"));
+	cur = add_next(cur, NODE_DECL, make_decl(DECL_ATTRIBUTE, "domain", NULL));
+	cur = add_next(cur, NODE_DECL, make_decl(DECL_TYPE, "bar_t", NULL));
+
+	union node_data nd;
+	nd.str = strdup("bar_alias_t");
+	add_child(cur, NODE_ALIAS, nd);
+
+	cur = add_next(cur, NODE_TYPE_ATTRIBUTE, make_typeattribute("bar_t", "domain"));
+
+	cur = add_next(cur, NODE_DECL, make_decl(DECL_TYPE, "baz_t", NULL));
+
+	nd.str = NULL;
+	cur = add_next(cur, NODE_GEN_REQ, nd);
+	add_next(add_child(cur, NODE_START_BLOCK, nd), NODE_DECL,
+	         make_decl(DECL_TYPE, "req_t", "domain"));
+
+	add_next(cur, NODE_DECL, make_decl(DECL_TYPE, "$1_t", "domain"));
+
+	return head;
+}
+
+START_TEST (test_build_type_index) {
+	struct policy_file_list *files = make_file_list("test.te", make_policy());
+	struct policy_file_list *if_files = make_file_list(NULL, NULL);
+
+	ck_assert_int_eq(SELINT_SUCCESS, build_type_index(files, if_files));
+
+	// Types in require blocks and parameters are not indexed
+	ck_assert_int_eq(3, type_index_type_count());
+	ck_assert_str_eq("foo_t", type_index_type_name(0));
+	ck_assert_str_eq("bar_t", type_index_type_name(1));
+	ck_assert_str_eq("baz_t", type_index_type_name(2));
+	ck_assert_ptr_null(type_index_type_name(3));
+
+	struct type_set *domains = make_type_set();
+	ck_assert_int_eq(1, type_set_add_name(domains, "domain"));
+	ck_assert_int_eq(2, type_set_count(domains));
+	ck_assert_int_eq(0, type_set_next(domains, 0));
+	ck_assert_int_eq(1, type_set_next(domains, 1));
+	ck_assert_int_eq(-1, type_set_next(domains, 2));
+	ck_assert_int_eq(-1, type_set_next(domains, 64));
+
+	struct type_set *set = make_type_set();
+	ck_assert_int_eq(0, type_set_add_name(set, "req_t"));
+	ck_assert_int_eq(0, type_set_add_name(set, "unknown_t"));
+	ck_assert_int_eq(0, type_set_count(set));
+	ck_assert_int_eq(0, type_set_intersects(set, domains));
+
+	// Aliases name the same type
+	ck_assert_int_eq(1, type_set_add_name(set, "bar_alias_t"));
+	ck_assert_int_eq(1, type_set_next(set, 0));
+	ck_assert_int_eq(1, type_set_intersects(set, domains));
+
+	ck_assert_int_eq(1, type_set_add_name(set, "baz_t"));
+	ck_assert_int_eq(1, type_set_add_name(set, "exec_type"));
+	ck_assert_int_eq(3, type_set_count(set));
+
+	type_set_intersect(set, domains);
+	ck_assert_int_eq(2, type_set_count(set));
+
+	type_set_subtract(set, domains);
+	ck_assert_int_eq(0, type_set_count(set));
+
+	type_set_add_name(set, "baz_t");
+	type_set_union(set, domains);
+	ck_assert_int_eq(3, type_set_count(set));
+
+	type_set_complement(domains);
+	ck_assert_int_eq(1, type_set_count(domains));
+	ck_assert_int_eq(2, type_set_next(domains, 0));
+
+	free_type_set(set);
+	free_type_set(domains);
+	free_type_index();
+	ck_assert_int_eq(0, type_index_type_count());
+
+	free_file_list(files);
+	free_file_list(if_files);
+	free_all_maps();
+}
+END_TEST
+
+// interface(`domain_type',`
+//	gen_require(` attribute domain; ')
+//	typeattribute $1 domain;
+// ')
+// interface(`domain_entry_file',`
+//	files_type($2)
+// ')
+// interface(`files_type',`
+//	typeattribute $1 file_type;
+// ')
+// template(`app_template',`
+//	type $1_t;
+//	domain_type($1_t)
+//	domain_entry_file($1_t, $1_exec_t)
+//	type $1_exec_t;
+// ')
+static struct policy_node *make_interfaces(void)
+{
+	struct policy_node *head = calloc(1, sizeof(struct policy_node));
+	head->flavor = NODE_IF_FILE;
+
+	union node_data nd;
+	nd.str = NULL;
+
+	struct policy_node *def = add_def(head, NODE_INTERFACE_DEF, "domain_type");
+	struct policy_node *cur = add_child(def, NODE_START_BLOCK, nd);
+	cur = add_next(cur, NODE_GEN_REQ, nd);
+	add_next(add_child(cur, NODE_START_BLOCK, nd), NODE_DECL,
+	         make_decl(DECL_ATTRIBUTE, "domain", NULL));
+	add_next(cur, NODE_TYPE_ATTRIBUTE, make_typeattribute("$1", "domain"));
+
+	def = add_def(def, NODE_INTERFACE_DEF, "domain_entry_file");
+	cur = add_child(def, NODE_START_BLOCK, nd);
+	add_next(cur, NODE_IF_CALL, make_call("files_type", "$2"));
+
+	def = add_def(def, NODE_INTERFACE_DEF, "files_type");
+	cur = add_child(def, NODE_START_BLOCK, nd);
+	add_next(cur, NODE_TYPE_ATTRIBUTE, make_typeattribute("$1", "file_type"));
+
+	def = add_def(def, NODE_TEMP_DEF, "app_template");
+	cur = add_child(def, NODE_START_BLOCK, nd);
+	cur = add_next(cur, NODE_DECL, make_decl(DECL_TYPE, "$1_t", NULL));
+	cur = add_next(cur, NODE_IF_CALL, make_call("domain_type", "$1_t"));
+	cur = add_next(cur, NODE_IF_CALL, make_call("domain_entry_file", "$1_t $1_exec_t"));
+	add_next(cur, NODE_DECL, make_decl(DECL_TYPE, "$1_exec_t", NULL));
+
+	return head;
+}
+
+// attribute domain;
+// attribute file_type;
+// type foo_t;
+// domain_type(foo_t)
+// app_template(bar)
+// type baz_t;
+static struct policy_node *make_calls(void)
+{
+	struct policy_node *head = calloc(1, sizeof(struct policy_node));
+	head->flavor = NODE_TE_FILE;
+
+	struct policy_node *cur = add_next(head, NODE_DECL, make_decl(DECL_ATTRIBUTE, "domain", NULL));
+	cur = add_next(cur, NODE_DECL, make_decl(DECL_ATTRIBUTE, "file_type", NULL));
+	cur = add_next(cur, NODE_DECL, make_decl(DECL_TYPE, "foo_t", NULL));
+	cur = add_next(cur, NODE_IF_CALL, make_call("domain_type", "foo_t"));
+	cur = add_next(cur, NODE_IF_CALL, make_call("app_template", "bar"));
+	add_next(cur, NODE_DECL, make_decl(DECL_TYPE, "baz_t", NULL));
+
+	return head;
+}
+
+START_TEST (test_type_index_interface_calls) {
+	struct policy_file_list *files = make_file_list("calls.te", make_calls());
+	struct policy_file_list *if_files = make_file_list("calls.if", make_interfaces());
+
+	ck_assert_int_eq(SELINT_SUCCESS, build_type_index(files, if_files));
+
+	// Types declared by the template are indexed
+	ck_assert_int_eq(4, type_index_type_count());
+
+	// Membership only comes from the interface calls
+	struct type_set *domains = make_type_set();
+	ck_assert_int_eq(1, type_set_add_name(domains, "domain"));
+	ck_assert_int_eq(2, type_set_count(domains));
+
+	struct type_set *set = make_type_set();
+	ck_assert_int_eq(1, type_set_add_name(set, "foo_t"));
+	ck_assert_int_eq(1, type_set_add_name(set, "bar_t"));
+	type_set_subtract(set, domains);
+	ck_assert_int_eq(0, type_set_count(set));
+
+	ck_assert_int_eq(1, type_set_add_name(set, "baz_t"));
+	ck_assert_int_eq(0, type_set_intersects(set, domains));
+
+	// Calls passing on parameters are followed from the call that sets them
+	struct type_set *file_types = make_type_set();
+	ck_assert_int_eq(1, type_set_add_name(file_types, "file_type"));
+	ck_assert_int_eq(1, type_set_count(file_types));
+	memset(set->words, 0, set->word_count * sizeof(uint64_t));
+	ck_assert_int_eq(1, type_set_add_name(set, "bar_exec_t"));
+	type_set_subtract(set, file_types);
+	ck_assert_int_eq(0, type_set_count(set));
+
+	// Nothing is indexed for the parameters themselves
+	ck_assert_int_eq(0, type_set_add_name(set, "$1"));
+	ck_assert_int_eq(0, type_set_add_name(set, "$1_t"));
+
+	free_type_set(file_types);
+	free_type_set(set);
+	free_type_set(domains);
+	free_type_index();
+	free_file_list(files);
+	free_file_list(if_files);
+	free_all_maps();
+}
+END_TEST
+
+START_TEST (test_type_set_many_types) {
+	struct policy_node *head = calloc(1, sizeof(struct policy_node));
+	head->flavor = NODE_TE_FILE;
+	struct policy_node *cur = head;
+	char name[32];
+
+	// Enough types to need several words, half of them in one attribute
+	for (int i = 0; i < 200; i++) {
+		snprintf(name, sizeof(name), "type%d_t", i);
+		cur = add_next(cur, NODE_DECL, make_decl(DECL_TYPE, name, (i % 2) ? "odd" : NULL));
+	}
+
+	struct policy_file_list *files = make_file_list("many.te", head);
+	struct policy_file_list *if_files = make_file_list(NULL, NULL);
+
+	ck_assert_int_eq(SELINT_SUCCESS, build_type_index(files, if_files));
+	ck_assert_int_eq(200, type_index_type_count());
+
+	struct type_set *odd = make_type_set();
+	ck_assert_int_eq(1, type_set_add_name(odd, "odd"));
+	ck_assert_int_eq(100, type_set_count(odd));
+
+	int seen = 0;
+	for (int id = type_set_next(odd, 0); id >= 0; id = type_set_next(odd, (unsigned int)id + 1)) {
+		ck_assert_int_eq(1, id % 2);
+		seen++;
+	}
+	ck_assert_int_eq(100, seen);
+
+	struct type_set *last = make_type_set();
+	ck_assert_int_eq(1, type_set_add_name(last, "type199_t"));
+	ck_assert_int_eq(199, type_set_next(last, 0));
+	ck_assert_int_eq(1, type_set_intersects(last, odd));
+
+	// Nothing past the last type is set
+	type_set_complement(odd);
+	ck_assert_int_eq(100, type_set_count(odd));
+	ck_assert_int_eq(-1, type_set_next(odd, 199));
+
+	free_type_set(last);
+	free_type_set(odd);
+	free_type_index();
+	free_file_list(files);
+	free_file_list(if_files);
+	free_all_maps();
+}
+END_TEST
+
+Suite *type_index_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Type_Index");
+
+	tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_build_type_index);
+	tcase_add_test(tc_core, test_type_index_interface_calls);
+	tcase_add_test(tc_core, test_type_set_many_types);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int main(void) {
+
+	int number_failed = 0;
+	Suite *s;
+	SRunner *sr;
+
+	s = type_index_suite();
+	sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0)? 0 : -1;
+}
@@ -0,0 +1,212 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../src/xref.h"
+#include "../src/tree.h"
+#include "test_utils.h"
+
+#define MAX_FOUND 16
+
+struct found {
+	unsigned int count;
+	struct {
+		const char *filename;
+		unsigned int lineno;
+		enum xref_kind kind;
+		const char *description;
+	} sites[MAX_FOUND];
+};
+
+static void record_site(const struct xref_site *site, void *ctx)
+{
+	struct found *found = ctx;
+
+	ck_assert_int_lt(found->count, MAX_FOUND);
+	found->sites[found->count].filename = site->filename;
+	found->sites[found->count].lineno = site->lineno;
+	found->sites[found->count].kind = site->kind;
+	found->sites[found->count].description = xref_site_description(site);
+	found->count++;
+}
+
+static unsigned int query(const struct xref_db *db, const char *name, struct found *found)
+{
+	memset(found, 0, sizeof(struct found));
+	unsigned int count = query_xref_db(db, name, record_site, found);
+	ck_assert_int_eq(count, found->count);
+	return count;
+}
+
+static void check_site(const struct found *found, unsigned int index,
+                       const char *filename, unsigned int lineno,
+                       enum xref_kind kind, const char *description)
+{
+	ck_assert_str_eq(filename, found->sites[index].filename);
+	ck_assert_int_eq(lineno, found->sites[index].lineno);
+	ck_assert_int_eq(kind, found->sites[index].kind);
+	ck_assert_str_eq(description, found->sites[index].description);
+}
+
+START_TEST (test_xref_db) {
+	union node_data nd;
+
+	// 1 type foo_t;
+	// 2 allow foo_t bar_t:file read;
+	// 3 foo_read(foo_t, unknown_t)
+	struct policy_node *te_head = calloc(1, sizeof(struct policy_node));
+	te_head->flavor = NODE_TE_FILE;
+	struct policy_node *cur = add_next(te_head, NODE_DECL, make_decl(DECL_TYPE, "foo_t", NULL));
+	cur = add_next(cur, NODE_AV_RULE, make_av_rule(AV_RULE_ALLOW, "foo_t", "bar_t", "file", "read"));
+	add_next(cur, NODE_IF_CALL, make_call("foo_read", "foo_t unknown_t"));
+
+	// 1 interface(`foo_read',`
+	// 2     gen_require(`
+	// 3         type foo_t;
+	// 4     ')
+	// 5     allow $1 foo_t:file read;
+	// 6 ')
+	struct policy_node *if_head = calloc(1, sizeof(struct policy_node));
+	if_head->flavor = NODE_IF_FILE;
+	struct policy_node *def = add_def(if_head, NODE_INTERFACE_DEF, "foo_read");
+	nd.str = NULL;
+	struct policy_node *req = add_child(def, NODE_GEN_REQ, nd);
+	add_child(req, NODE_DECL, make_decl(DECL_TYPE, "foo_t", NULL));
+	struct policy_node *allow = add_next(req, NODE_AV_RULE,
+	                                     make_av_rule(AV_RULE_ALLOW, "$1", "foo_t", "file", "read"));
+	allow->lineno = 5;
+
+	// 1 /foo -- gen_context(system_u:object_r:foo_t,s0)
+	struct policy_node *fc_head = calloc(1, sizeof(struct policy_node));
+	fc_head->flavor = NODE_FC_FILE;
+	nd.fc_data = calloc(1, sizeof(struct fc_entry));
+	nd.fc_data->path = strdup("/foo");
+	nd.fc_data->context = calloc(1, sizeof(struct sel_context));
+	nd.fc_data->context->type = strdup("foo_t");
+	add_next(fc_head, NODE_FC_ENTRY, nd);
+
+	struct policy_file_list *te_files = make_file_list("test.te", te_head);
+	struct policy_file_list *if_files = make_file_list("test.if", if_head);
+	struct policy_file_list *fc_files = make_file_list("test.fc", fc_head);
+
+	char path[] = "/tmp/selint_xref_XXXXXX";
+	int fd = mkstemp(path);
+	ck_assert_int_ge(fd, 0);
+	close(fd);
+
+	ck_assert_int_eq(SELINT_SUCCESS, write_xref_db(te_files, if_files, fc_files, path));
+
+	struct xref_db *db = NULL;
+	ck_assert_int_eq(SELINT_SUCCESS, open_xref_db(path, &db));
+	ck_assert_ptr_nonnull(db);
+
+	struct found found;
+	ck_assert_int_eq(6, query(db, "foo_t", &found));
+	check_site(&found, 0, "test.te", 1, XREF_DECLARATION, "type");
+	check_site(&found, 1, "test.te", 2, XREF_USE, "av rule");
+	check_site(&found, 2, "test.te", 3, XREF_USE, "interface call");
+	check_site(&found, 3, "test.if", 3, XREF_REQUIRE, "type");
+	check_site(&found, 4, "test.if", 5, XREF_USE, "av rule");
+	check_site(&found, 5, "test.fc", 1, XREF_USE, "file context");
+
+	ck_assert_int_eq(2, query(db, "foo_read", &found));
+	check_site(&found, 0, "test.te", 3, XREF_USE, "interface call");
+	check_site(&found, 1, "test.if", 1, XREF_DECLARATION, "interface");
+
+	ck_assert_int_eq(1, query(db, "bar_t", &found));
+	ck_assert_int_eq(2, query(db, "file", &found));
+	// Call arguments only count for names declared or required somewhere
+	ck_assert_int_eq(0, query(db, "unknown_t", &found));
+	ck_assert_int_eq(0, query(db, "$1", &found));
+	ck_assert_int_eq(0, query(db, "a", &found));
+	ck_assert_int_eq(0, query(db, "zzz", &found));
+
+	// Rewriting replaces the file, so an index already open is unaffected
+	struct policy_file_list *empty = make_file_list(NULL, NULL);
+	ck_assert_int_eq(SELINT_SUCCESS, write_xref_db(empty, empty, fc_files, path));
+	ck_assert_int_eq(6, query(db, "foo_t", &found));
+	struct xref_db *rewritten = NULL;
+	ck_assert_int_eq(SELINT_SUCCESS, open_xref_db(path, &rewritten));
+	ck_assert_int_eq(1, query(rewritten, "foo_t", &found));
+	check_site(&found, 0, "test.fc", 1, XREF_USE, "file context");
+	close_xref_db(rewritten);
+
+	// The index gets the usual permissions rather than the private ones of
+	// the temporary file
+	mode_t mask = umask(0);
+	umask(mask);
+	struct stat st;
+	ck_assert_int_eq(0, stat(path, &st));
+	ck_assert_int_eq(0666 & ~mask, st.st_mode & 0777);
+
+	char missing[sizeof(path) + 16];
+	snprintf(missing, sizeof(missing), "%s.d/xref.db", path);
+	ck_assert_int_eq(SELINT_IO_ERROR, write_xref_db(empty, empty, fc_files, missing));
+	free(empty);
+
+	free_file_list(te_files);
+	free_file_list(if_files);
+	free_file_list(fc_files);
+
+	close_xref_db(db);
+
+	FILE *f = fopen(path, "w");
+	ck_assert_ptr_nonnull(f);
+	fputs("not an index\n", f);
+	fclose(f);
+	db = NULL;
+	ck_assert_int_eq(SELINT_PARSE_ERROR, open_xref_db(path, &db));
+	ck_assert_ptr_null(db);
+
+	unlink(path);
+	ck_assert_int_eq(SELINT_IO_ERROR, open_xref_db(path, &db));
+}
+END_TEST
+
+Suite *xref_suite(void) {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Xref");
+
+	tc_core = tcase_create("Core");
+
+	tcase_add_test(tc_core, test_xref_db);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int main(void) {
+
+	int number_failed = 0;
+	Suite *s;
+	SRunner *sr;
+
+	s = xref_suite();
+	sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0)? 0 : -1;
+}
@@ -16,6 +16,16 @@
 
 SELINT_PATH=../../src/selint
 
+setup() {
+	# Runs outside of source mode write the access vector cache under
+	# XDG_CACHE_HOME, which is kept out of the home directory
+	export XDG_CACHE_HOME=$(mktemp -d)
+}
+
+teardown() {
+	rm -rf "${XDG_CACHE_HOME}"
+}
+
 do_test() {
 	local CHECK_ID=$1
 	local FILENAME=$2
@@ -94,6 +104,18 @@ test_one_check() {
 	test_one_check "S-003" "s03.te"
 }
 
+@test "S-004" {
+	test_one_check_expect "S-004" "s04.te" 2
+}
+
+@test "S-005" {
+	test_one_check_expect "S-005" "s05.*" 2
+}
+
+@test "S-006" {
+	test_one_check "S-006" "s06.fc"
+}
+
 @test "W-001" {
 	test_one_check "W-001" "w01*"
 }
@@ -118,6 +140,14 @@ test_one_check() {
 	test_one_check "W-005" "w05*"
 }
 
+@test "W-006" {
+	test_one_check_expect "W-006" "w06.*" 3
+}
+
+@test "W-007" {
+	test_one_check "W-007" "w07.fc"
+}
+
 @test "E-002" {
 	test_one_check "E-002" "e02.fc"
 }
@@ -134,6 +164,27 @@ test_one_check() {
 	test_one_check "E-005" "e03e04e05.fc"
 }
 
+@test "E-006" {
+	test_one_check "E-006" "e06.te"
+	# Attributes assigned and access granted by interface and template calls
+	local FILES="e06_interfaces.te ./policies/check_triggers/e06_interfaces.if"
+	do_test "E-006" "${FILES}" 3 "-e E-006"
+	do_test "E-006" "${FILES}" 0 "-d E-006"
+}
+
+@test "E-007" {
+	local FLASK_DIR=./policies/check_triggers/flask
+	local FILES="e07.te ${FLASK_DIR}/security_classes ${FLASK_DIR}/access_vectors"
+	do_test "E-007" "${FILES}" 1 "-e E-007"
+	do_test "E-007" "${FILES}" 0 "-d E-007"
+	# Nothing is checked without the class definitions
+	do_test "E-007" "e07.te" 0 "-e E-007"
+}
+
+@test "E-008" {
+	test_one_check "E-008" "e08.fc"
+}
+
 @test "assume_user" {
 	do_test "E-003" "e03e04e05.fc" 1 "-e E-003"
 	echo "assume_users = { system_u }" >> tmp.conf
@@ -204,6 +255,17 @@ test_one_check() {
 	[ "$count" -eq 0 ]
 }
 
+@test "interface checks in te files" {
+	run ${SELINT_PATH} -c configs/default.conf -e C-004 -e W-002 -e W-003 -e S-005 -E -s policies/misc/if_in_te.te
+	[ "$status" -eq 0 ]
+	count=$(echo ${output} | grep -o "C-004" | wc -l)
+	[ "$count" -eq 1 ]
+	count=$(echo ${output} | grep -o "W-003" | wc -l)
+	[ "$count" -eq 1 ]
+	count=$(echo ${output} | grep -o "S-005" | wc -l)
+	[ "$count" -eq 1 ]
+}
+
 @test "disable comment" {
 	run ${SELINT_PATH} -c configs/default.conf -e W-002 -E -s policies/misc/disable.*
 	[ "$status" -eq 0 ]
@@ -219,6 +281,14 @@ test_one_check() {
 	run ${SELINT_PATH} -c configs/default.conf policies/misc/disable_require_start.*
 	[ "$status" -eq 0 ]
 	[ "$output" == "" ]
+
+	run ${SELINT_PATH} -c configs/default.conf -e W-003 policies/misc/disable_block.if
+	[ "$status" -eq 0 ]
+	[ "$output" == "" ]
+
+	run ${SELINT_PATH} -c configs/default.conf policies/misc/disable_file.te
+	[ "$status" -eq 0 ]
+	[ "$output" == "" ]
 }
 
 @test "nonexistent file" {
@@ -256,3 +326,95 @@ test_one_check() {
 	count=$(echo ${output} | grep -o "Warning" | wc -l)
 	[ "$count" -eq 5 ]
 }
+
+@test "JSON output" {
+	run ${SELINT_PATH} -c configs/default.conf -rs policies/check_triggers
+	[ "$status" -eq 0 ]
+	local text_count=${#lines[@]}
+
+	run ${SELINT_PATH} -c configs/default.conf -rs -F json policies/check_triggers
+	[ "$status" -eq 0 ]
+	echo $output
+	[ "${#lines[@]}" -eq "$text_count" ]
+	count=$(echo "${output}" | grep -c '^{"filename":"[^"]*","lineno":[0-9]*,"severity":"[CSWEF]","check_id":"[CSWEF]-[0-9]*","message":".*"}$')
+	[ "$count" -eq "$text_count" ]
+}
+
+@test "SARIF output" {
+	run ${SELINT_PATH} -c configs/default.conf -s --format=sarif policies/check_triggers/w05* policies/check_triggers/modules.conf
+	[ "$status" -eq 0 ]
+	echo $output
+	count=$(echo "${output}" | grep -o '^{"version":"2.1.0"' | wc -l)
+	[ "$count" -eq 1 ]
+	count=$(echo "${output}" | grep -o '"ruleId":"W-005","level":"warning"' | wc -l)
+	[ "$count" -eq 1 ]
+	[ "${lines[-1]}" == "]}]}" ]
+
+	run ${SELINT_PATH} -c configs/default.conf --format=sarif policies/misc/disable_multiple*
+	[ "$status" -eq 0 ]
+	[ "${lines[-1]}" == "]}]}" ]
+	count=$(echo "${output}" | grep -o "ruleId" | wc -l)
+	[ "$count" -eq 0 ]
+}
+
+@test "Machine readable output keeps stdout clean" {
+	run bash -c "${SELINT_PATH} -c configs/default.conf -rs -S -F json -e foo policies/check_triggers 2>/dev/null"
+	[ "$status" -eq 0 ]
+	count=$(echo "${output}" | grep -v '^{' | wc -l)
+	[ "$count" -eq 0 ]
+
+	run ${SELINT_PATH} -c configs/default.conf -F yaml policies/misc/no_issues.te
+	[ "$status" -eq 64 ]
+}
+
+@test "Parallel jobs" {
+	run ${SELINT_PATH} -c configs/default.conf -rs -j 1 policies/check_triggers
+	[ "$status" -eq 0 ]
+	local serial_output="${output}"
+
+	run ${SELINT_PATH} -c configs/default.conf -rs -j 4 policies/check_triggers
+	[ "$status" -eq 0 ]
+	[ "${output}" == "${serial_output}" ]
+
+	run ${SELINT_PATH} -c configs/default.conf -j 0 policies/misc/no_issues.te
+	[ "$status" -eq 64 ]
+	message_presence=$(echo ${output} | grep -o "Invalid number of jobs" | wc -l)
+	[ "$message_presence" -eq 1 ]
+}
+
+@test "Cross-reference index" {
+	run ${SELINT_PATH} -rs --xref-build=xref.db policies/check_triggers
+	[ "$status" -eq 0 ]
+	[ -z "${output}" ]
+
+	run ${SELINT_PATH} --xref-query=foo_conf_t xref.db
+	[ "$status" -eq 0 ]
+	echo $output
+	[ "${lines[0]}" == "policies/check_triggers/w02.if:3: require (type)" ]
+	[ "${lines[1]}" == "policies/check_triggers/w02.if:6: use (av rule)" ]
+	count=$(echo "${output}" | grep -c "w02_role.if:7: use (interface call)")
+	[ "$count" -eq 1 ]
+
+	run ${SELINT_PATH} --xref-query=no_such_t xref.db
+	[ "$status" -eq 0 ]
+	[ "${output}" == "No references to no_such_t found" ]
+	rm xref.db
+
+	run ${SELINT_PATH} --xref-query=foo_conf_t policies/misc/no_issues.te
+	[ "$status" -eq 65 ]
+}
+
+@test "Access vector cache directory" {
+	local cache_home="${XDG_CACHE_HOME}"
+
+	export XDG_CACHE_HOME="${cache_home}/nested/cache"
+	run ${SELINT_PATH} --no-av-cache -c configs/default.conf policies/misc/no_issues.te
+	[ "$status" -eq 0 ]
+	[ ! -e "${XDG_CACHE_HOME}" ]
+
+	run ${SELINT_PATH} -c configs/default.conf policies/misc/no_issues.te
+	[ "$status" -eq 0 ]
+	[ -d "${XDG_CACHE_HOME}/selint" ]
+
+	export XDG_CACHE_HOME="${cache_home}"
+}
@@ -0,0 +1,182 @@
+#!/bin/sh
+
+# Copyright 2020 Tresys Technology, LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#    http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Generate a synthetic refpolicy style source tree for the performance suite.
+# The output only depends on the arguments, so benchmark results are
+# comparable between runs and machines.
+#
+# Usage: gen_policy.sh OUTDIR [MODULES] [RULES]
+#   MODULES - number of modules to generate (default 200)
+#   RULES   - number of av rules per te file (default 40)
+
+set -e
+
+if [ -z "$1" ]; then
+	echo "Usage: $0 OUTDIR [MODULES] [RULES]" >&2
+	exit 64
+fi
+
+OUTDIR=$1
+MODULES=${2:-200}
+RULES=${3:-40}
+
+rm -rf "${OUTDIR}"
+mkdir -p "${OUTDIR}"
+
+awk -v outdir="${OUTDIR}" -v modules="${MODULES}" -v rules="${RULES}" '
+function mod(i) {
+	return "perf" (i % modules)
+}
+function layer(i) {
+	return "layer" (i % 4)
+}
+function gen_te(i,    f, m, other, j, t, c, s, cl) {
+	m = mod(i)
+	other = mod(i + 1)
+	f = outdir "/" layer(i) "/" m ".te"
+	print "policy_module(" m ", 1.0.0)" > f
+	print "" > f
+	print "########################################" > f
+	print "#" > f
+	print "# Declarations" > f
+	print "#" > f
+	print "" > f
+	print "attribute " m "_domain;" > f
+	print "" > f
+	print "type " m "_t, " m "_domain;" > f
+	print "type " m "_exec_t;" > f
+	print "type " m "_conf_t;" > f
+	print "type " m "_log_t;" > f
+	print "type " m "_tmp_t;" > f
+	print "type " m "_var_lib_t;" > f
+	print "" > f
+	print "gen_tunable(" m "_manage_all, false)" > f
+	print "" > f
+	print "########################################" > f
+	print "#" > f
+	print "# Local policy" > f
+	print "#" > f
+	print "" > f
+	print "allow " m "_t self:process { fork sigchld signal };" > f
+	print "allow " m "_t self:fifo_file rw_fifo_file_perms;" > f
+	split("conf log tmp var_lib exec", s, " ")
+	split("file dir lnk_file sock_file fifo_file chr_file blk_file", cl, " ")
+	for (j = 0; j < rules; j++) {
+		t = m "_" s[(j % 5) + 1] "_t"
+		c = cl[(j % 7) + 1]
+		if (j % 3 == 0) {
+			print "allow " m "_t " t ":" c " { read getattr open };" > f
+		} else if (j % 3 == 1) {
+			print "allow " m "_t " t ":" c " { getattr ioctl lock };" > f
+		} else {
+			print "dontaudit " m "_t " t ":" c " write;" > f
+		}
+	}
+	print "" > f
+	print "type_transition " m "_t " m "_tmp_t:file " m "_log_t;" > f
+	print "" > f
+	print "tunable_policy(`" m "_manage_all'"'"',`" > f
+	print "\tallow " m "_t " m "_var_lib_t:file { create write unlink };" > f
+	print "'"'"')" > f
+	print "" > f
+	print "optional_policy(`" > f
+	print "\t" other "_read_conf(" m "_t)" > f
+	print "\t" other "_append_log(" m "_t)" > f
+	print "'"'"')" > f
+	print "" > f
+	print "optional_policy(`" > f
+	print "\t" other "_domain_template(" m ")" > f
+	print "'"'"')" > f
+	close(f)
+}
+function gen_if_header(f, desc, param) {
+	print "" > f
+	print "########################################" > f
+	print "## <summary>" > f
+	print "##\t" desc > f
+	print "## </summary>" > f
+	print "## <param name=\"" param "\">" > f
+	print "##\t<summary>" > f
+	print "##\tThe " param " to use." > f
+	print "##\t</summary>" > f
+	print "## </param>" > f
+	print "#" > f
+}
+function gen_if(i,    f, m) {
+	m = mod(i)
+	f = outdir "/" layer(i) "/" m ".if"
+	print "## <summary>Synthetic module " m " for performance tests</summary>" > f
+	gen_if_header(f, "Read " m " configuration files.", "domain")
+	print "interface(`" m "_read_conf'"'"',`" > f
+	print "\tgen_require(`" > f
+	print "\t\ttype " m "_conf_t;" > f
+	print "\t'"'"')" > f
+	print "" > f
+	print "\tallow $1 " m "_conf_t:dir search;" > f
+	print "\tallow $1 " m "_conf_t:file { read getattr open };" > f
+	print "'"'"')" > f
+	gen_if_header(f, "Append to " m " log files.", "domain")
+	print "interface(`" m "_append_log'"'"',`" > f
+	print "\tgen_require(`" > f
+	print "\t\ttype " m "_log_t;" > f
+	print "\t'"'"')" > f
+	print "" > f
+	print "\tallow $1 " m "_log_t:file { append getattr open };" > f
+	print "'"'"')" > f
+	gen_if_header(f, "Execute " m " in the " m " domain.", "domain")
+	print "interface(`" m "_domtrans'"'"',`" > f
+	print "\tgen_require(`" > f
+	print "\t\ttype " m "_t, " m "_exec_t;" > f
+	print "\t'"'"')" > f
+	print "" > f
+	print "\tdomtrans_pattern($1, " m "_exec_t, " m "_t)" > f
+	print "'"'"')" > f
+	gen_if_header(f, "Create a derived " m " domain.", "prefix")
+	print "template(`" m "_domain_template'"'"',`" > f
+	print "\tgen_require(`" > f
+	print "\t\tattribute " m "_domain;" > f
+	print "\t'"'"')" > f
+	print "" > f
+	print "\ttype $1_" m "_t, " m "_domain;" > f
+	print "\tallow $1_" m "_t self:process signal;" > f
+	print "\t" m "_read_conf($1_" m "_t)" > f
+	print "'"'"')" > f
+	close(f)
+}
+function gen_fc(i,    f, m) {
+	m = mod(i)
+	f = outdir "/" layer(i) "/" m ".fc"
+	print "/usr/bin/" m "\t\t--\tgen_context(system_u:object_r:" m "_exec_t,s0)" > f
+	print "/etc/" m "(/.*)?\t\t\tgen_context(system_u:object_r:" m "_conf_t,s0)" > f
+	print "/var/log/" m "\\.log.*\t\t--\tgen_context(system_u:object_r:" m "_log_t,s0)" > f
+	print "/var/lib/" m "(/.*)?\t\tgen_context(system_u:object_r:" m "_var_lib_t,s0)" > f
+	print "/run/" m "\\.pid\t\t--\tgen_context(system_u:object_r:" m "_var_lib_t,s0)" > f
+	close(f)
+}
+BEGIN {
+	for (i = 0; i < 4; i++) {
+		system("mkdir -p \"" outdir "/" layer(i) "\"")
+	}
+	conf = outdir "/modules.conf"
+	for (i = 0; i < modules; i++) {
+		gen_te(i)
+		gen_if(i)
+		gen_fc(i)
+		print mod(i) " = module" > conf
+	}
+	close(conf)
+}
+'
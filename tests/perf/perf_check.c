@@ -0,0 +1,677 @@
+/*
+* Copyright 2020 Tresys Technology, LLC
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+ * Performance regression gate.  Runs selint against a generated policy tree
+ * several times per benchmark, takes the median wall clock time and peak
+ * resident set size, and compares them against a committed baseline.
+ */
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <fts.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/utsname.h>
+#include <sys/wait.h>
+#include <sysexits.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_RUNS 100
+#define MAX_ARGS 16
+
+struct benchmark {
+	const char *name;
+	// Arguments passed to selint before the config file and policy path
+	const char *args[MAX_ARGS];
+};
+
+static const struct benchmark benchmarks[] = {
+	// Parsing and setup only.  -E with no -e disables every check.
+	{ "parse", { "-r", "-s", "-E", NULL } },
+	// All checks at convention level and above
+	{ "full", { "-r", "-s", NULL } },
+	{ NULL, { NULL } }
+};
+
+struct result {
+	char *name;
+	double files_per_sec;
+	long peak_rss_kb;
+	struct result *next;
+};
+
+// The machine and settings a baseline was recorded with.  Throughput and
+// memory use are only comparable between runs that match.
+struct machine {
+	char cpu[128];
+	char arch[128];
+	long cpus;
+	int runs;
+};
+
+static void usage(void)
+{
+	printf("Usage: perf_check [OPTIONS] -b BASELINE -c CONFIG SELINT POLICY_DIR\n"
+	       "  -b, --baseline=FILE\tJSON baseline to compare against (or write)\n"
+	       "  -c, --config=FILE\tselint config file used for every run\n"
+	       "  -n, --runs=N\t\tNumber of timed runs per benchmark (default 5)\n"
+	       "  -t, --tolerance=F\tAllowed relative regression (default 0.25)\n"
+	       "  -w, --write\t\tWrite measured results as the new baseline\n");
+}
+
+static struct result *find_result(struct result *head, const char *name)
+{
+	while (head) {
+		if (0 == strcmp(head->name, name)) {
+			return head;
+		}
+		head = head->next;
+	}
+	return NULL;
+}
+
+static struct result *add_result(struct result **head, const char *name)
+{
+	struct result *res = find_result(*head, name);
+
+	if (res) {
+		return res;
+	}
+	res = calloc(1, sizeof(struct result));
+	res->name = strdup(name);
+	res->next = *head;
+	*head = res;
+	return res;
+}
+
+static void free_results(struct result *head)
+{
+	while (head) {
+		struct result *next = head->next;
+		free(head->name);
+		free(head);
+		head = next;
+	}
+}
+
+static int compare_doubles(const void *a, const void *b)
+{
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+static double median(double *vals, int count)
+{
+	qsort(vals, count, sizeof(double), compare_doubles);
+	if (count % 2) {
+		return vals[count / 2];
+	}
+	return (vals[count / 2 - 1] + vals[count / 2]) / 2;
+}
+
+static int count_policy_files(const char *dir)
+{
+	char *paths[] = { (char *)dir, NULL };
+	int count = 0;
+	FTS *ftsp = fts_open(paths, FTS_PHYSICAL | FTS_NOSTAT, NULL);
+
+	if (!ftsp) {
+		return -1;
+	}
+
+	FTSENT *file;
+	while ((file = fts_read(ftsp))) {
+		if (file->fts_pathlen < 3) {
+			continue;
+		}
+		const char *suffix = file->fts_path + file->fts_pathlen - 3;
+		if (!strcmp(suffix, ".te") || !strcmp(suffix, ".if")
+		    || !strcmp(suffix, ".fc")) {
+			count++;
+		}
+	}
+
+	fts_close(ftsp);
+	return count;
+}
+
+static void get_machine(struct machine *mach, int runs)
+{
+	memset(mach, 0, sizeof(struct machine));
+	strcpy(mach->cpu, "unknown");
+	strcpy(mach->arch, "unknown");
+
+	FILE *f = fopen("/proc/cpuinfo", "r");
+	if (f) {
+		char line[256];
+		while (fgets(line, sizeof(line), f)) {
+			char *colon = strchr(line, ':');
+			if (colon && 0 == strncmp(line, "model name", 10)) {
+				colon++;
+				while (isspace((unsigned char)*colon)) {
+					colon++;
+				}
+				colon[strcspn(colon, "\n\"")] = '\0';
+				snprintf(mach->cpu, sizeof(mach->cpu), "%s", colon);
+				break;
+			}
+		}
+		fclose(f);
+	}
+
+	struct utsname name;
+	if (0 == uname(&name)) {
+		snprintf(mach->arch, sizeof(mach->arch), "%s", name.machine);
+	}
+	mach->cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	mach->runs = runs;
+}
+
+static int same_machine(const struct machine *a, const struct machine *b)
+{
+	return 0 == strcmp(a->cpu, b->cpu) && 0 == strcmp(a->arch, b->arch)
+	       && a->cpus == b->cpus && a->runs == b->runs;
+}
+
+static void print_machine(const char *label, const struct machine *mach)
+{
+	printf( "%s: %s, %ld CPUs, %s, %d runs\n", label, mach->cpu,
+	        mach->cpus, mach->arch, mach->runs);
+}
+
+/*
+ * Run selint once.  On success the elapsed wall clock seconds and the peak
+ * RSS of the child (in KB) are stored and 0 is returned.
+ */
+static int run_once(const char *selint, const struct benchmark *bench,
+                    const char *config, const char *policy_dir,
+                    double *seconds, long *rss_kb)
+{
+	const char *argv[MAX_ARGS + 5];
+	int argc = 0;
+
+	argv[argc++] = selint;
+	for (int i = 0; bench->args[i]; i++) {
+		argv[argc++] = bench->args[i];
+	}
+	argv[argc++] = "-c";
+	argv[argc++] = config;
+	argv[argc++] = policy_dir;
+	argv[argc] = NULL;
+
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	pid_t pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		return -1;
+	}
+	if (pid == 0) {
+		int devnull = open("/dev/null", O_WRONLY);
+		if (devnull >= 0) {
+			dup2(devnull, STDOUT_FILENO);
+			dup2(devnull, STDERR_FILENO);
+			close(devnull);
+		}
+		execv(selint, (char *const *)argv);
+		_exit(EX_UNAVAILABLE);
+	}
+
+	int status;
+	struct rusage usage;
+	if (wait4(pid, &status, 0, &usage) < 0) {
+		perror("wait4");
+		return -1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		fprintf(stderr, "%s: selint exited abnormally (status %d)\n",
+		        bench->name, WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+		return -1;
+	}
+
+	*seconds = (end.tv_sec - start.tv_sec)
+	           + (end.tv_nsec - start.tv_nsec) / 1e9;
+	*rss_kb = usage.ru_maxrss;
+	return 0;
+}
+
+static int run_benchmark(const char *selint, const struct benchmark *bench,
+                         const char *config, const char *policy_dir,
+                         int runs, int file_count, struct result *res)
+{
+	double times[MAX_RUNS];
+	double rss[MAX_RUNS];
+	long rss_kb;
+
+	// One untimed run so that every timed run sees a warm page cache
+	if (0 != run_once(selint, bench, config, policy_dir, &times[0], &rss_kb)) {
+		return -1;
+	}
+
+	for (int i = 0; i < runs; i++) {
+		if (0 != run_once(selint, bench, config, policy_dir,
+		                  &times[i], &rss_kb)) {
+			return -1;
+		}
+		rss[i] = rss_kb;
+	}
+
+	double secs = median(times, runs);
+	res->files_per_sec = secs > 0 ? file_count / secs : 0;
+	res->peak_rss_kb = (long)median(rss, runs);
+	return 0;
+}
+
+/*
+ * A minimal reader for the baseline format written by write_baseline().
+ * Objects, strings and numbers are understood, anything else is an error.
+ */
+struct json_reader {
+	const char *pos;
+};
+
+static void json_skip_ws(struct json_reader *rd)
+{
+	while (isspace((unsigned char)*rd->pos)) {
+		rd->pos++;
+	}
+}
+
+static int json_expect(struct json_reader *rd, char c)
+{
+	json_skip_ws(rd);
+	if (*rd->pos != c) {
+		return -1;
+	}
+	rd->pos++;
+	return 0;
+}
+
+static char *json_string(struct json_reader *rd)
+{
+	json_skip_ws(rd);
+	if (*rd->pos != '"') {
+		return NULL;
+	}
+	const char *start = ++rd->pos;
+	while (*rd->pos && *rd->pos != '"') {
+		rd->pos++;
+	}
+	if (!*rd->pos) {
+		return NULL;
+	}
+	char *ret = strndup(start, rd->pos - start);
+	rd->pos++;
+	return ret;
+}
+
+static int json_number(struct json_reader *rd, double *val)
+{
+	char *end;
+
+	json_skip_ws(rd);
+	*val = strtod(rd->pos, &end);
+	if (end == rd->pos) {
+		return -1;
+	}
+	rd->pos = end;
+	return 0;
+}
+
+/*
+ * Iterate over the members of an object.  Returns the next key (to be freed
+ * by the caller) or NULL at the closing brace or on error (*err set).
+ */
+static char *json_next_key(struct json_reader *rd, int *first, int *err)
+{
+	json_skip_ws(rd);
+	if (*rd->pos == '}') {
+		rd->pos++;
+		return NULL;
+	}
+	if (!*first && 0 != json_expect(rd, ',')) {
+		*err = 1;
+		return NULL;
+	}
+	*first = 0;
+	char *key = json_string(rd);
+	if (!key || 0 != json_expect(rd, ':')) {
+		free(key);
+		*err = 1;
+		return NULL;
+	}
+	return key;
+}
+
+static int read_benchmark(struct json_reader *rd, struct result *res)
+{
+	int first = 1, err = 0;
+	char *key;
+
+	if (0 != json_expect(rd, '{')) {
+		return -1;
+	}
+	while ((key = json_next_key(rd, &first, &err))) {
+		double val;
+		if (0 != json_number(rd, &val)) {
+			free(key);
+			return -1;
+		}
+		if (0 == strcmp(key, "files_per_sec")) {
+			res->files_per_sec = val;
+		} else if (0 == strcmp(key, "peak_rss_kb")) {
+			res->peak_rss_kb = (long)val;
+		}
+		free(key);
+	}
+	return err ? -1 : 0;
+}
+
+static int read_machine(struct json_reader *rd, struct machine *mach)
+{
+	int first = 1, err = 0;
+	char *key;
+
+	if (0 != json_expect(rd, '{')) {
+		return -1;
+	}
+	while ((key = json_next_key(rd, &first, &err))) {
+		double val = 0;
+		char *str = NULL;
+		if (0 == strcmp(key, "cpu") || 0 == strcmp(key, "arch")) {
+			str = json_string(rd);
+			if (!str) {
+				err = 1;
+			} else if (0 == strcmp(key, "cpu")) {
+				snprintf(mach->cpu, sizeof(mach->cpu), "%s", str);
+			} else {
+				snprintf(mach->arch, sizeof(mach->arch), "%s", str);
+			}
+		} else if (0 != json_number(rd, &val)) {
+			err = 1;
+		} else if (0 == strcmp(key, "cpus")) {
+			mach->cpus = (long)val;
+		} else if (0 == strcmp(key, "runs")) {
+			mach->runs = (int)val;
+		}
+		free(str);
+		free(key);
+		if (err) {
+			return -1;
+		}
+	}
+	return err ? -1 : 0;
+}
+
+static int read_baseline(const char *path, int *file_count,
+                         struct machine *mach, struct result **results)
+{
+	FILE *f = fopen(path, "r");
+
+	if (!f) {
+		return -1;
+	}
+
+	char *text = NULL;
+	size_t len = 0;
+	ssize_t nread = getdelim(&text, &len, '\0', f);
+	fclose(f);
+	if (nread < 0) {
+		free(text);
+		return -1;
+	}
+
+	struct json_reader rd = { text };
+	int first = 1, err = 0;
+	char *key;
+
+	if (0 != json_expect(&rd, '{')) {
+		err = 1;
+	}
+	while (!err && (key = json_next_key(&rd, &first, &err))) {
+		if (0 == strcmp(key, "files")) {
+			double val;
+			if (0 != json_number(&rd, &val)) {
+				err = 1;
+			} else {
+				*file_count = (int)val;
+			}
+		} else if (0 == strcmp(key, "machine")) {
+			if (0 != read_machine(&rd, mach)) {
+				err = 1;
+			}
+		} else if (0 == strcmp(key, "benchmarks")) {
+			int bench_first = 1;
+			char *name;
+			if (0 != json_expect(&rd, '{')) {
+				err = 1;
+			}
+			while (!err && (name = json_next_key(&rd, &bench_first, &err))) {
+				if (0 != read_benchmark(&rd, add_result(results, name))) {
+					err = 1;
+				}
+				free(name);
+			}
+		} else {
+			err = 1;
+		}
+		free(key);
+	}
+
+	free(text);
+	return err ? -1 : 0;
+}
+
+static int write_baseline(const char *path, int file_count,
+                          const struct machine *mach, struct result *results)
+{
+	FILE *f = fopen(path, "w");
+
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+
+	fprintf(f, "{\n\t\"files\": %d,\n", file_count);
+	fprintf(f, "\t\"machine\": { \"cpu\": \"%s\", \"arch\": \"%s\", \"cpus\": %ld, \"runs\": %d },\n",
+	        mach->cpu, mach->arch, mach->cpus, mach->runs);
+	fprintf(f, "\t\"benchmarks\": {\n");
+	for (int i = 0; benchmarks[i].name; i++) {
+		struct result *res = find_result(results, benchmarks[i].name);
+		fprintf(f, "\t\t\"%s\": { \"files_per_sec\": %.1f, \"peak_rss_kb\": %ld }%s\n",
+		        res->name, res->files_per_sec, res->peak_rss_kb,
+		        benchmarks[i + 1].name ? "," : "");
+	}
+	fprintf(f, "\t}\n}\n");
+	fclose(f);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	const char *baseline_path = NULL;
+	const char *config = NULL;
+	int runs = 5;
+	double tolerance = 0.25;
+	int write_flag = 0;
+
+	while (1) {
+		static struct option long_options[] = {
+			{ "baseline",  required_argument, NULL, 'b' },
+			{ "config",    required_argument, NULL, 'c' },
+			{ "runs",      required_argument, NULL, 'n' },
+			{ "tolerance", required_argument, NULL, 't' },
+			{ "write",     no_argument,       NULL, 'w' },
+			{ 0,           0,                 0,    0   }
+		};
+
+		int c = getopt_long(argc, argv, "b:c:n:t:w", long_options, NULL);
+
+		if (c == -1) {
+			break;
+		}
+
+		switch (c) {
+		case 'b':
+			baseline_path = optarg;
+			break;
+		case 'c':
+			config = optarg;
+			break;
+		case 'n':
+			runs = atoi(optarg);
+			break;
+		case 't':
+			tolerance = atof(optarg);
+			break;
+		case 'w':
+			write_flag = 1;
+			break;
+		default:
+			usage();
+			return EX_USAGE;
+		}
+	}
+
+	if (!baseline_path || !config || argc - optind != 2
+	    || runs < 1 || runs > MAX_RUNS || tolerance < 0) {
+		usage();
+		return EX_USAGE;
+	}
+
+	const char *selint = argv[optind];
+	const char *policy_dir = argv[optind + 1];
+
+	int file_count = count_policy_files(policy_dir);
+	if (file_count <= 0) {
+		fprintf(stderr, "No policy files found in %s\n", policy_dir);
+		return EX_NOINPUT;
+	}
+
+	struct machine mach;
+	get_machine(&mach, runs);
+
+	// Before measuring, check the baseline is comparable.  Without one
+	// recorded on this machine there is nothing to compare against, so the
+	// gate is skipped rather than failed.
+	struct result *baseline = NULL;
+	if (!write_flag) {
+		if (0 != access(baseline_path, F_OK)) {
+			printf("No baseline at %s, skipping the performance check.  Record one "
+			       "with make perf-baseline before the change to be measured.\n",
+			       baseline_path);
+			return EX_OK;
+		}
+
+		int baseline_files = 0;
+		struct machine baseline_mach;
+		memset(&baseline_mach, 0, sizeof(baseline_mach));
+		if (0 != read_baseline(baseline_path, &baseline_files, &baseline_mach, &baseline)) {
+			fprintf(stderr, "Failed to read baseline %s\n", baseline_path);
+			free_results(baseline);
+			return EX_DATAERR;
+		}
+
+		if (baseline_files != file_count) {
+			fprintf(stderr, "Baseline was recorded for %d files, but %s has %d.  "
+			        "Regenerate the baseline with make perf-baseline.\n",
+			        baseline_files, policy_dir, file_count);
+			free_results(baseline);
+			return EX_DATAERR;
+		}
+
+		if (!same_machine(&mach, &baseline_mach)) {
+			print_machine("Baseline recorded on", &baseline_mach);
+			print_machine("This machine", &mach);
+			printf("Throughput is only comparable on the machine and with the "
+			       "runs the baseline was recorded with, skipping the performance "
+			       "check.  Record a baseline for this machine with make "
+			       "perf-baseline first.\n");
+			free_results(baseline);
+			return EX_OK;
+		}
+	}
+
+	struct result *measured = NULL;
+	for (int i = 0; benchmarks[i].name; i++) {
+		struct result *res = add_result(&measured, benchmarks[i].name);
+		if (0 != run_benchmark(selint, &benchmarks[i], config, policy_dir,
+		                       runs, file_count, res)) {
+			free_results(measured);
+			return EX_SOFTWARE;
+		}
+	}
+
+	if (write_flag) {
+		int ret = write_baseline(baseline_path, file_count, &mach, measured);
+		if (ret == 0) {
+			printf("Wrote baseline for %d files to %s\n", file_count,
+			       baseline_path);
+		}
+		free_results(measured);
+		return ret == 0 ? EX_OK : EX_CANTCREAT;
+	}
+
+	int regressions = 0;
+	printf("%-10s %14s %14s %12s %12s\n", "benchmark", "files/s",
+	       "baseline", "rss (KB)", "baseline");
+	for (int i = 0; benchmarks[i].name; i++) {
+		struct result *cur = find_result(measured, benchmarks[i].name);
+		struct result *base = find_result(baseline, benchmarks[i].name);
+
+		if (!base) {
+			printf("%-10s %14.1f %14s %12ld %12s  (no baseline)\n",
+			       cur->name, cur->files_per_sec, "-", cur->peak_rss_kb, "-");
+			continue;
+		}
+
+		int slow = cur->files_per_sec < base->files_per_sec * (1 - tolerance);
+		int big = cur->peak_rss_kb > base->peak_rss_kb * (1 + tolerance);
+
+		printf("%-10s %14.1f %14.1f %12ld %12ld%s%s\n", cur->name,
+		       cur->files_per_sec, base->files_per_sec,
+		       cur->peak_rss_kb, base->peak_rss_kb,
+		       slow ? "  THROUGHPUT REGRESSION" : "",
+		       big ? "  MEMORY REGRESSION" : "");
+		regressions += slow + big;
+	}
+
+	free_results(measured);
+	free_results(baseline);
+
+	if (regressions) {
+		printf("%d performance regression(s) beyond %.0f%% tolerance\n",
+		       regressions, tolerance * 100);
+		return 1;
+	}
+
+	printf("No performance regressions beyond %.0f%% tolerance\n",
+	       tolerance * 100);
+	return EX_OK;
+}
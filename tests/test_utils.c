@@ -81,4 +81,115 @@ struct av_rule_data * make_example_av_rule() {
 
 }
 
+struct string_list *make_names(const char *names)
+{
+	struct string_list *sl = NULL;
 
+	if (!names) {
+		return NULL;
+	}
+
+	char *copy = strdup(names);
+	ck_assert_ptr_nonnull(copy);
+
+	for (char *tok = strtok(copy, " "); tok; tok = strtok(NULL, " ")) {
+		sl = sl_array_append(sl, strdup(tok));
+	}
+
+	free(copy);
+	return sl;
+}
+
+union node_data make_decl(enum decl_flavor flavor, const char *name, const char *attrs)
+{
+	union node_data nd;
+
+	nd.d_data = calloc(1, sizeof(struct declaration_data));
+	ck_assert_ptr_nonnull(nd.d_data);
+	nd.d_data->flavor = flavor;
+	nd.d_data->name = strdup(name);
+	nd.d_data->attrs = make_names(attrs);
+
+	return nd;
+}
+
+union node_data make_av_rule(enum av_rule_flavor flavor, const char *sources,
+                             const char *targets, const char *classes,
+                             const char *perms)
+{
+	union node_data nd;
+
+	nd.av_data = calloc(1, sizeof(struct av_rule_data));
+	ck_assert_ptr_nonnull(nd.av_data);
+	nd.av_data->flavor = flavor;
+	nd.av_data->sources = make_names(sources);
+	nd.av_data->targets = make_names(targets);
+	nd.av_data->object_classes = make_names(classes);
+	nd.av_data->perms = make_names(perms);
+
+	return nd;
+}
+
+union node_data make_typeattribute(const char *type, const char *attrs)
+{
+	union node_data nd;
+
+	nd.ta_data = calloc(1, sizeof(struct type_attribute_data));
+	ck_assert_ptr_nonnull(nd.ta_data);
+	nd.ta_data->type = strdup(type);
+	nd.ta_data->attrs = make_names(attrs);
+
+	return nd;
+}
+
+union node_data make_call(const char *name, const char *args)
+{
+	union node_data nd;
+
+	nd.ic_data = calloc(1, sizeof(struct if_call_data));
+	ck_assert_ptr_nonnull(nd.ic_data);
+	nd.ic_data->name = strdup(name);
+	nd.ic_data->args = make_names(args);
+
+	return nd;
+}
+
+struct policy_node *add_next(struct policy_node *prev, enum node_flavor flavor,
+                             union node_data nd)
+{
+	ck_assert_int_eq(SELINT_SUCCESS, insert_policy_node_next(prev, flavor, nd, prev->lineno + 1));
+
+	return prev->next;
+}
+
+struct policy_node *add_child(struct policy_node *parent, enum node_flavor flavor,
+                              union node_data nd)
+{
+	ck_assert_int_eq(SELINT_SUCCESS, insert_policy_node_child(parent, flavor, nd, parent->lineno + 1));
+
+	struct policy_node *child = parent->first_child;
+	while (child->next) {
+		child = child->next;
+	}
+	return child;
+}
+
+struct policy_node *add_def(struct policy_node *prev, enum node_flavor flavor,
+                            const char *name)
+{
+	union node_data nd;
+
+	nd.str = strdup(name);
+	return add_next(prev, flavor, nd);
+}
+
+struct policy_file_list *make_file_list(const char *filename, struct policy_node *head)
+{
+	struct policy_file_list *files = calloc(1, sizeof(struct policy_file_list));
+	ck_assert_ptr_nonnull(files);
+
+	if (head) {
+		file_list_push_back(files, make_policy_file(filename, head));
+	}
+	return files;
+}
@@ -15,6 +15,7 @@
 */
 
 #include "../src/tree.h"
+#include "../src/file_list.h"
 
 #define EXAMPLE_TYPE_1 "foo_t"
 #define EXAMPLE_TYPE_2 "bar_t"
@@ -22,3 +23,34 @@
 
 struct av_rule_data * make_example_av_rule(void);
 
+// Fixtures for building policy trees by hand.  Lists of names are given as
+// one space separated string, and NULL gives an empty list.
+
+struct string_list *make_names(const char *names);
+
+union node_data make_decl(enum decl_flavor flavor, const char *name, const char *attrs);
+
+union node_data make_av_rule(enum av_rule_flavor flavor, const char *sources,
+                             const char *targets, const char *classes,
+                             const char *perms);
+
+union node_data make_typeattribute(const char *type, const char *attrs);
+
+union node_data make_call(const char *name, const char *args);
+
+// Insert a node after prev, on the line after it, and return the new node
+struct policy_node *add_next(struct policy_node *prev, enum node_flavor flavor,
+                             union node_data nd);
+
+// Insert a node as the last child of parent, on the line after it, and
+// return the new node
+struct policy_node *add_child(struct policy_node *parent, enum node_flavor flavor,
+                              union node_data nd);
+
+// Insert an interface or template definition after prev and return it
+struct policy_node *add_def(struct policy_node *prev, enum node_flavor flavor,
+                            const char *name);
+
+// Make a list holding one file, or no files if head is NULL
+struct policy_file_list *make_file_list(const char *filename, struct policy_node *head);
+